@@ -34,8 +34,25 @@ HEADERS += \
     main/bailiedit.h \
     main/baililabel.h \
     main/bailisql.h \
+    main/bailisqlfunc.h \
+    main/bailispecsum.h \
+    main/bailistmt.h \
+    main/bailistore.h \
+    main/bailiplan.h \
+    main/bailibackup.h \
+    main/bailiarchive.h \
+    main/bailicache.h \
+    main/bailicatalog.h \
+    main/bailisearch.h \
     main/bailiterminator.h \
+    main/bailiframe.h \
+    main/bailischeduler.h \
+    main/bailimetrics.h \
+    main/bailicrypto.h \
+    main/bailizip.h \
+    main/bailiflight.h \
     main/bailipublisher.h \
+    main/bailiwriter.h \
     main/bailiserver.h \
     main/bailishare.h \
     main/bailidialog.h \
@@ -45,6 +62,8 @@ HEADERS += \
     tools/bsbatchrecheck.h \
     tools/bslabeldesigner.h \
     tools/bstoolstockreset.h \
+    tools/bstoolindexadvisor.h \
+    tools/bstoolarchive.h \
     dialog/bsabout.h \
     dialog/bsnetloading.h \
     dialog/bspapersizedlg.h \
@@ -100,8 +119,25 @@ SOURCES += main/main.cpp \
     main/bailigrid.cpp \
     main/bailiedit.cpp \
     main/bailisql.cpp \
+    main/bailisqlfunc.cpp \
+    main/bailispecsum.cpp \
+    main/bailistmt.cpp \
+    main/bailistore.cpp \
+    main/bailiplan.cpp \
+    main/bailibackup.cpp \
+    main/bailiarchive.cpp \
+    main/bailicache.cpp \
+    main/bailicatalog.cpp \
+    main/bailisearch.cpp \
     main/bailiterminator.cpp \
+    main/bailiframe.cpp \
+    main/bailischeduler.cpp \
+    main/bailimetrics.cpp \
+    main/bailicrypto.cpp \
+    main/bailizip.cpp \
+    main/bailiflight.cpp \
     main/bailipublisher.cpp \
+    main/bailiwriter.cpp \
     main/bailiserver.cpp \
     main/bailishare.cpp \
     main/bailidialog.cpp \
@@ -111,6 +147,8 @@ SOURCES += main/main.cpp \
     tools/bsbatchrecheck.cpp \
     tools/bslabeldesigner.cpp \
     tools/bstoolstockreset.cpp \
+    tools/bstoolindexadvisor.cpp \
+    tools/bstoolarchive.cpp \
     dialog/bsabout.cpp \
     dialog/bsnetloading.cpp \
     dialog/bspapersizedlg.cpp \
@@ -149,6 +187,21 @@ RESOURCES += \
 
 DISTFILES +=
 
+#尺码扩展函数（见bailisqlfunc.cpp）与在线备份API（见bailibackup.cpp）须直接调用QSQLITE驱动所用的那份SQLite。
+#Qt自带SQLite静态编在qsqlite插件内且不导出符号，无法注册，故只在Qt（或单独重建的qsqlite驱动插件）使用共享SQLite库时启用：
+#configure时加-system-sqlite，或在Qt源码qtbase/src/plugins/sqldrivers下执行qmake -- -system-sqlite重建驱动后随程序发布，
+#单独重建驱动时Qt自身配置不变，qmake加CONFIG+=bs_shared_sqlite表明驱动已用共享库。
+#windows上sqlite3.h与sqlite3.lib所在目录用SQLITE_DIR指定（qmake SQLITE_DIR=...），sqlite3.dll随程序发布。
+#未启用时各处沿用原SQL，在线备份改用VACUUM INTO。
+qtConfig(system-sqlite)|bs_shared_sqlite {
+    DEFINES += BAILI_SQLITE_FUNCS
+    !isEmpty(SQLITE_DIR) {
+        INCLUDEPATH += $$SQLITE_DIR
+        LIBS += -L$$SQLITE_DIR
+    }
+    LIBS += -lsqlite3
+}
+
 
 ############################ Below is platform difference ############################
 
@@ -178,6 +231,8 @@ win32 {     #win32 means all windows platform not only win_x86
     }
 }
 else {
+    LIBS += -lz     #bailizip.cpp直接使用zlib流接口（windows用Qt自带zlib）
+
     macx {
         #INCLUDEPATH += $$PWD/third/RockeyDog/mac
         #DESTDIR = /Users/roger/BailiR17Dist
@@ -5,6 +5,10 @@
 #include "main/bailidata.h"
 #include "main/bailifunc.h"
 #include "main/bailisql.h"
+#include "main/bailistmt.h"
+#include "main/bailistore.h"
+#include "main/bailiarchive.h"
+#include "main/bailicache.h"
 #include "misc/bsimportr15dlg.h"
 #include "misc/bsimportr16dlg.h"
 
@@ -497,11 +501,11 @@ QString BsLoginGuide::loadUserInfo()
 
     //更换默认主工作库
     QSqlDatabase defaultdb = QSqlDatabase::database();
+    BsStmtCache::release(defaultdb.connectionName());
+    BsResultCache::bumpAll();
     if ( defaultdb.isOpen() )
         defaultdb.close();
-    defaultdb.setDatabaseName(loginFile);
-
-    if ( ! defaultdb.open() )
+    if ( ! openBookDatabase(defaultdb, loginFile) )
         return QStringLiteral("无效或非法的数据库文件%1").arg(loginFile);
 
     //账册名可先设
@@ -607,6 +611,22 @@ void BsLoginGuide::upgradeSqlCheck()
                                "'app_encryption_key', '网络保密码', '', '', "
                                "'用于数据加密传输，防止网络偷窥。设置后需要重启服务、终端重新设置登录。');");
 
+        sqls << QStringLiteral("insert or ignore into bailiOption(optcode, optname, vsetting, vdefault, vformat) values("
+                               "'app_net_min_threads', '网络服务最少线程数', '2', '2', "
+                               "'空闲时保留的处理线程数，1~64。设置后需要重启服务。');");
+
+        sqls << QStringLiteral("insert or ignore into bailiOption(optcode, optname, vsetting, vdefault, vformat) values("
+                               "'app_net_max_threads', '网络服务最多线程数', '16', '16', "
+                               "'繁忙时最多扩充到的处理线程数，不小于最少线程数，最多64。设置后需要重启服务。');");
+
+        sqls << QStringLiteral("insert or ignore into bailiOption(optcode, optname, vsetting, vdefault, vformat) values("
+                               "'app_net_lane_limits', '网络请求分类并发上限', '0,0,2,0', '0,0,2,0', "
+                               "'依次为交互写、轻查询、重报表、聊天四类请求同时处理的线程数上限，逗号分隔，0为不限。设置后需要重启服务。');");
+
+        sqls << QStringLiteral("insert or ignore into bailiOption(optcode, optname, vsetting, vdefault, vformat) values("
+                               "'app_net_lane_pinned', '网络请求专用线程类别', '', '', "
+                               "'填“交互写”“轻查询”“重报表”“聊天”之一，则该类请求由一个专用线程单独处理。留空不设。设置后需要重启服务。');");
+
     }
 
     sqls << QStringLiteral("create table if not exists colorbase(codename text primary key);");
@@ -724,6 +744,24 @@ void BsLoginGuide::upgradeSqlCheck()
          << QStringLiteral("CREATE INDEX IF NOT EXISTS idxpftshop ON pft(shop);")
          << QStringLiteral("CREATE INDEX IF NOT EXISTS idxszdshop ON szd(shop);");
 
+    //库存账表及其维护触发器（老账册首次升级或上次重建未成功时需按单据重建）
+    sqls << stockBalanceSqls();
+
+    //期末快照表及失效触发器
+    sqls << periodSnapshotSqls();
+
+    //尺码数量规范子表及分尺码视图（首次建表时按现有明细拆分填充）
+    sqls << sizerDetailUpgradeSqls(defaultdb);
+
+    //统计查询索引（按版本号逐步追加）
+    sqls << indexMigrationSqls(defaultdb);
+
+    //历史年度归档登记
+    sqls << BsArchive::registrySqls();
+
+    //登记变更日志（前端按序号增量同步）
+    sqls << regChangeLogSqls();
+
     //最终批处理执行
     defaultdb.transaction();
     foreach (QString sql, sqls) {
@@ -735,6 +773,18 @@ void BsLoginGuide::upgradeSqlCheck()
         }
     }
     defaultdb.commit();
+
+    //触发器只追加尺码分段，登录时顺便合并过长的行
+    if ( stockBalanceReady(defaultdb) ) {
+        stockBalanceCompact(defaultdb, 4096);
+    } else {
+        QString strErr = stockBalanceRebuild(defaultdb);
+        if ( !strErr.isEmpty() ) qDebug() << "stockBalanceRebuild" << strErr;
+    }
+
+    //补建已结束月份的期末快照（首次或历史单据改动后，从最早缺失月份起逐月增量生成）
+    QString snapErr = periodSnapshotRefresh(defaultdb);
+    if ( !snapErr.isEmpty() ) qDebug() << "periodSnapshotRefresh" << snapErr;
 }
 
 
@@ -0,0 +1,639 @@
+#include "bailiarchive.h"
+#include "bailicode.h"
+#include "bailisql.h"
+#include "bailigrid.h"
+#include "bailicache.h"
+
+#define ARCHIVE_MAX_YEARS       9               //SQLite默认最多挂接10个库，留一个余量
+#define ARCHIVE_CARRY_PROOF     "历史结转"
+
+namespace BailiSoft {
+
+static QStringList archiveSheetTables()
+{
+    return QStringList({"cgd", "cgj", "cgt", "pfd", "pff", "pft", "lsd", "dbd", "syd"});
+}
+
+static QString sqlText(const QString &text)
+{
+    QString s = text;
+    return s.replace(QChar(39), QStringLiteral("''"));
+}
+
+static QStringList tableColumns(QSqlDatabase &db, const QString &schema, const QString &table,
+                                QStringList *types = nullptr)
+{
+    QStringList cols;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("PRAGMA %1.table_info(%2);").arg(schema, table));
+    while ( qry.next() ) {
+        cols << qry.value(1).toString();
+        if ( types ) *types << qry.value(2).toString();
+    }
+    return cols;
+}
+
+//合并group_concat后的尺码分段串为单据明细格式，nonZero返回是否有非零尺码
+static QString carrySizers(const QString &sizers, bool *nonZero)
+{
+    QStringList pairs;
+    QStringList sums = BsGrid::sizerTextSum(sizers).split(QChar(10), QString::SkipEmptyParts);
+    for ( int i = 0, iLen = sums.length(); i < iLen; ++i ) {
+        QStringList pair = QString(sums.at(i)).split(QChar(9));
+        if ( pair.length() == 2 && QString(pair.at(1)).toLongLong() != 0 )
+            pairs << sums.at(i);
+    }
+    *nonZero = !pairs.isEmpty();
+    return pairs.join(QChar(10));
+}
+
+//结转单据，rows每行依次为cargo、color、sizers、qty、actmoney、dismoney；无明细时用sums五合计值
+static QStringList carrySheetSqls(const QString &table, const qint64 sheetid, const qint64 dated,
+                                  const QString &shop, const QString &trader, const QList<QVariantList> &rows,
+                                  const QList<qint64> &sums, const QString &checker, const int cutoffYear)
+{
+    QStringList sqls;
+    qint64 rowtime = QDateTime::currentMSecsSinceEpoch();
+    qint64 sumqty = 0, summoney = 0, sumdis = 0;
+    for ( int i = 0, iLen = rows.length(); i < iLen; ++i ) {
+        const QVariantList &row = rows.at(i);
+        sumqty += row.at(3).toLongLong();
+        summoney += row.at(4).toLongLong();
+        sumdis += row.at(5).toLongLong();
+        sqls << QStringLiteral("INSERT INTO %1dtl(parentid, rowtime, cargo, color, sizers, qty, actmoney, dismoney) "
+                               "VALUES(%2, %3, '%4', '%5', '%6', %7, %8, %9);")
+                .arg(table).arg(sheetid).arg(rowtime + i)
+                .arg(sqlText(row.at(0).toString()), sqlText(row.at(1).toString()), sqlText(row.at(2).toString()))
+                .arg(row.at(3).toLongLong()).arg(row.at(4).toLongLong()).arg(row.at(5).toLongLong());
+    }
+
+    QList<qint64> vals = sums;
+    if ( vals.isEmpty() )
+        vals << sumqty << summoney << sumdis << 0 << 0;
+
+    qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
+    sqls << QStringLiteral("INSERT INTO %1(sheetid, proof, dated, shop, trader, stype, staff, remark, "
+                           "sumqty, summoney, sumdis, actpay, actowe, checker, chktime, upman, uptime) "
+                           "VALUES(%2, '%3', %4, '%5', '%6', '', '', '%7', %8, %9, %10, %11, %12, '%13', %14, '%13', %14);")
+            .arg(table).arg(sheetid).arg(QStringLiteral(ARCHIVE_CARRY_PROOF)).arg(dated)
+            .arg(sqlText(shop), sqlText(trader), QStringLiteral("%1年前单据已归档").arg(cutoffYear))
+            .arg(vals.at(0)).arg(vals.at(1)).arg(vals.at(2)).arg(vals.at(3)).arg(vals.at(4))
+            .arg(sqlText(checker)).arg(now);
+    sqls << QStringLiteral("INSERT INTO archive_carry(tname, sheetid) VALUES('%1', %2);").arg(table).arg(sheetid);
+    return sqls;
+}
+
+//某年待归档单据条件（结转单据除外）
+static QString yearSheetCon(const QString &mainTable, const int year)
+{
+    qint64 yearb = QDateTime(QDate(year, 1, 1)).toMSecsSinceEpoch() / 1000;
+    qint64 yeare = QDateTime(QDate(year + 1, 1, 1)).toMSecsSinceEpoch() / 1000;
+    return QStringLiteral("dated>=%1 AND dated<%2 "
+                          "AND sheetid NOT IN (SELECT sheetid FROM main.archive_carry WHERE tname='%3')")
+            .arg(yearb).arg(yeare).arg(mainTable);
+}
+
+//某年单据复制到一个归档库，单库事务。先删归档库中同号单据再插入，中断后重做不会重复
+static QString copyYear(QSqlDatabase &db, const QString &schema, const int year,
+                        const QStringList &moveTables, int *sheets)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    QString strErr;
+    *sheets = 0;
+
+    db.transaction();
+    for ( int i = 0, iLen = moveTables.length(); i < iLen && strErr.isEmpty(); ++i ) {
+        QString table = moveTables.at(i);
+        QString mainTable = table.left(3);
+        bool isMain = ( table == mainTable );
+
+        //归档表（含尺码子表），不存在时按热库结构建，热库后加的字段补上
+        QStringList sqls;
+        sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS %1.%2 AS SELECT * FROM main.%2 WHERE 0;").arg(schema, table);
+        sqls << ( ( isMain )
+                  ? QStringLiteral("CREATE INDEX IF NOT EXISTS %1.idx%2dated ON %2(dated);").arg(schema, table)
+                  : QStringLiteral("CREATE INDEX IF NOT EXISTS %1.idx%2parent ON %2(parentid);").arg(schema, table) );
+        for ( int j = 0, jLen = sqls.length(); j < jLen && strErr.isEmpty(); ++j ) {
+            qry.exec(sqls.at(j));
+            if ( qry.lastError().isValid() ) strErr = qry.lastError().text();
+        }
+
+        QStringList types;
+        QStringList cols = tableColumns(db, QStringLiteral("main"), table, &types);
+        QStringList arcCols = tableColumns(db, schema, table);
+        for ( int j = 0, jLen = cols.length(); j < jLen && strErr.isEmpty(); ++j ) {
+            if ( !arcCols.contains(cols.at(j)) ) {
+                qry.exec(QStringLiteral("ALTER TABLE %1.%2 ADD COLUMN %3 %4;").arg(schema, table, cols.at(j), types.at(j)));
+                if ( qry.lastError().isValid() ) strErr = qry.lastError().text();
+            }
+        }
+        if ( !strErr.isEmpty() ) break;
+
+        QString keyCol = ( isMain ) ? QStringLiteral("sheetid") : QStringLiteral("parentid");
+        QString keys = QStringLiteral("SELECT sheetid FROM main.%1 WHERE %2").arg(mainTable, yearSheetCon(mainTable, year));
+        sqls.clear();
+        sqls << QStringLiteral("DELETE FROM %1.%2 WHERE %3 IN (%4);").arg(schema, table, keyCol, keys);
+        sqls << QStringLiteral("INSERT INTO %1.%2(%3) SELECT %3 FROM main.%2 WHERE %4 IN (%5);")
+                .arg(schema, table, cols.join(QStringLiteral(", ")), keyCol, keys);
+        for ( int j = 0, jLen = sqls.length(); j < jLen && strErr.isEmpty(); ++j ) {
+            qry.exec(sqls.at(j));
+            if ( qry.lastError().isValid() )
+                strErr = qry.lastError().text();
+            else if ( isMain && j == 1 )
+                *sheets += qry.numRowsAffected();
+        }
+    }
+
+    if ( strErr.isEmpty() ) {
+        if ( !db.commit() ) strErr = db.lastError().text();
+    }
+    else {
+        db.rollback();
+    }
+    return strErr;
+}
+
+//核对归档库与热库某年单据的行数及数量金额合计，不一致不得删热库
+static QString verifyYear(QSqlDatabase &db, const QString &schema, const int year, const QStringList &moveTables)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    QStringList sumCols({"sumqty", "summoney", "actpay", "qty", "actmoney"});
+
+    for ( int i = 0, iLen = moveTables.length(); i < iLen; ++i ) {
+        QString table = moveTables.at(i);
+        QString mainTable = table.left(3);
+        QString keyCol = ( table == mainTable ) ? QStringLiteral("sheetid") : QStringLiteral("parentid");
+        QString keys = QStringLiteral("SELECT sheetid FROM main.%1 WHERE %2").arg(mainTable, yearSheetCon(mainTable, year));
+
+        QStringList aggs;
+        aggs << QStringLiteral("count(*)");
+        QStringList cols = tableColumns(db, QStringLiteral("main"), table);
+        for ( int j = 0, jLen = sumCols.length(); j < jLen; ++j ) {
+            if ( cols.contains(sumCols.at(j)) )
+                aggs << QStringLiteral("ifnull(sum(%1), 0)").arg(sumCols.at(j));
+        }
+
+        QStringList results;
+        QStringList schemas({QStringLiteral("main"), schema});
+        for ( int k = 0; k < 2; ++k ) {
+            qry.exec(QStringLiteral("SELECT %1 FROM %2.%3 WHERE %4 IN (%5);")
+                     .arg(aggs.join(QStringLiteral(", ")), schemas.at(k), table, keyCol, keys));
+            if ( qry.lastError().isValid() )
+                return qry.lastError().text();
+            if ( !qry.next() )
+                return QStringLiteral("归档库%1年%2无法核对，热库未删除。").arg(year).arg(table);
+            QStringList vals;
+            for ( int j = 0, jLen = aggs.length(); j < jLen; ++j )
+                vals << qry.value(j).toString();
+            results << vals.join(QChar(44));
+            qry.finish();
+        }
+        if ( results.at(0) != results.at(1) )
+            return QStringLiteral("归档库%1年%2核对不符（热库%3，归档库%4），热库未删除。")
+                    .arg(year).arg(table, results.at(0), results.at(1));
+    }
+    return QString();
+}
+
+QStringList BsArchive::registrySqls()
+{
+    QStringList sqls;
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS archive_book("
+                           "archyear    INTEGER PRIMARY KEY, "
+                           "filename    TEXT NOT NULL, "
+                           "sheets      INTEGER DEFAULT 0, "
+                           "archtime    INTEGER DEFAULT 0);");
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS archive_carry("
+                           "tname       TEXT NOT NULL, "
+                           "sheetid     INTEGER NOT NULL, "
+                           "primary key(tname, sheetid));");
+    return sqls;
+}
+
+qint64 BsArchive::cutoffDated(QSqlDatabase &db)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("SELECT max(archyear) FROM main.archive_book;"));
+    if ( qry.lastError().isValid() || !qry.next() || qry.value(0).isNull() )
+        return 0;
+    int year = qry.value(0).toInt();
+    return QDateTime(QDate(year + 1, 1, 1)).toMSecsSinceEpoch() / 1000;
+}
+
+QString BsArchive::archiveFile(const QString &bookFile, const int year)
+{
+    QFileInfo fi(bookFile);
+    return fi.absoluteDir().absoluteFilePath(QStringLiteral("%1.%2.arc").arg(fi.completeBaseName()).arg(year));
+}
+
+QString BsArchive::archiveBefore(QSqlDatabase &db, const int cutoffYear, const QString &checker, int *movedSheets)
+{
+    if ( movedSheets ) *movedSheets = 0;
+    if ( cutoffYear > QDate::currentDate().year() )
+        return QStringLiteral("不能归档本年度及以后的单据。");
+
+    qint64 oldCutoff = cutoffDated(db);
+    qint64 cutoff = QDateTime(QDate(cutoffYear, 1, 1)).toMSecsSinceEpoch() / 1000;
+    if ( cutoff < oldCutoff )
+        return QStringLiteral("已归档至%1年，截止年份不能更早。").arg(QDateTime::fromMSecsSinceEpoch(oldCutoff * 1000).date().year() - 1);
+    qint64 carryDated = QDateTime(QDate(cutoffYear - 1, 12, 31)).toMSecsSinceEpoch() / 1000;
+
+    //先卸下查询挂接，ATTACH不能在事务中
+    detachAll(db);
+
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    QStringList tables = archiveSheetTables();
+
+    //待归档年份（结转单据不归档，随后删除重建）
+    QSet<int> yearSet;
+    qry.exec(QStringLiteral("SELECT archyear FROM main.archive_book;"));
+    while ( qry.next() ) yearSet << qry.value(0).toInt();
+    qry.finish();
+    QList<int> years;
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        qry.exec(QStringLiteral("SELECT DISTINCT CAST(strftime('%Y', dated, 'unixepoch', 'localtime') AS INTEGER) "
+                                "FROM main.%1 WHERE dated<%2 "
+                                "AND sheetid NOT IN (SELECT sheetid FROM main.archive_carry WHERE tname='%1');")
+                 .arg(tables.at(i)).arg(cutoff));
+        if ( qry.lastError().isValid() )
+            return qry.lastError().text();
+        while ( qry.next() ) {
+            int year = qry.value(0).toInt();
+            yearSet << year;
+            if ( !years.contains(year) ) years << year;
+        }
+        qry.finish();
+    }
+    if ( years.isEmpty() )
+        return QStringLiteral("%1年以前没有需要归档的单据。").arg(cutoffYear);
+    if ( yearSet.count() > ARCHIVE_MAX_YEARS )
+        return QStringLiteral("归档库最多%1个年份，超出无法同时挂接查询。").arg(ARCHIVE_MAX_YEARS);
+    std::sort(years.begin(), years.end());
+
+    //挂接各年归档库
+    QStringList schemas;
+    for ( int i = 0, iLen = years.length(); i < iLen; ++i ) {
+        QString schema = QStringLiteral("arc%1").arg(years.at(i));
+        qry.exec(QStringLiteral("ATTACH DATABASE '%1' AS %2;")
+                 .arg(sqlText(archiveFile(db.databaseName(), years.at(i))), schema));
+        if ( qry.lastError().isValid() ) {
+            QString strErr = qry.lastError().text();
+            detachAll(db);
+            return strErr;
+        }
+        schemas << schema;
+    }
+
+    //归档表（含尺码子表）
+    QStringList moveTables;
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        moveTables << tables.at(i) << tables.at(i) + QStringLiteral("dtl");
+        if ( !tableColumns(db, QStringLiteral("main"), tables.at(i) + QStringLiteral("dtlsizer")).isEmpty() )
+            moveTables << tables.at(i) + QStringLiteral("dtlsizer");
+    }
+
+    QString strErr;
+    int moved = 0;
+
+    //未审核单据会被结转合计遗漏，须先处理
+    for ( int i = 0, iLen = tables.length(); i < iLen && strErr.isEmpty(); ++i ) {
+        qry.exec(QStringLiteral("SELECT count(*) FROM main.%1 WHERE dated<%2 AND ifnull(chktime, 0)=0;")
+                 .arg(tables.at(i)).arg(cutoff));
+        if ( qry.next() && qry.value(0).toInt() > 0 )
+            strErr = QStringLiteral("%1有%2张%3年以前的单据未审核，请先审核或删除后再归档。")
+                    .arg(mapMsg.value(QStringLiteral("win_%1").arg(tables.at(i))).split(QChar(9)).at(0))
+                    .arg(qry.value(0).toInt()).arg(cutoffYear);
+        qry.finish();
+    }
+
+    //第一步：逐年复制到归档库并各自提交。热库为WAL时多库事务不保证整体原子，故与热库删除分开
+    QHash<int, int> yearSheets;
+    for ( int y = 0, yLen = years.length(); y < yLen && strErr.isEmpty(); ++y ) {
+        int sheets = 0;
+        strErr = copyYear(db, schemas.at(y), years.at(y), moveTables, &sheets);
+        yearSheets.insert(years.at(y), sheets);
+    }
+
+    //第二步只写热库（归档库仅读，故提交只涉热库一个文件，整体原子）。核对在同一事务内，
+    //核对后若有他人写入，升级写锁时快照已旧即失败回滚；中途失败归档库已有的同号单据重做时覆盖
+    if ( strErr.isEmpty() ) {
+        db.transaction();
+        for ( int y = 0, yLen = years.length(); y < yLen && strErr.isEmpty(); ++y ) {
+            strErr = verifyYear(db, schemas.at(y), years.at(y), moveTables);
+        }
+        if ( !strErr.isEmpty() ) db.rollback();
+    }
+    if ( !strErr.isEmpty() ) {
+        detachAll(db);
+        return strErr;
+    }
+
+    //结转数据（含此前结转单据，在删除之前读取）
+    QStringList carrySqls;
+    QHash<QString, qint64> nextIds;
+    for ( int i = 0, iLen = tables.length(); i < iLen && strErr.isEmpty(); ++i ) {
+        qry.exec(QStringLiteral("SELECT max(ifnull((SELECT seq FROM main.sqlite_sequence WHERE name='%1'), 0), "
+                                "ifnull((SELECT max(sheetid) FROM main.%1), 0));").arg(tables.at(i)));
+        nextIds.insert(tables.at(i), ( qry.next() ) ? qry.value(0).toLongLong() + 1 : 1);
+        qry.finish();
+    }
+
+    //库存按门店、订单欠货按门店客户，带明细
+    QList<QPair<QString, QString> > detailCarries;
+    detailCarries << qMakePair(QStringLiteral("syd"), QStringLiteral("vi_stock"))
+                  << qMakePair(QStringLiteral("cgd"), QStringLiteral("vi_cg_rest"))
+                  << qMakePair(QStringLiteral("pfd"), QStringLiteral("vi_pf_rest"));
+    for ( int i = 0, iLen = detailCarries.length(); i < iLen && strErr.isEmpty(); ++i ) {
+        QString table = detailCarries.at(i).first;
+        bool byShop = ( table == QStringLiteral("syd") );
+        QString traderExp = ( byShop ) ? QStringLiteral("shop") : QStringLiteral("ifnull(trader, '')");
+        qry.exec(QStringLiteral("SELECT shop, %1 AS trader, cargo, color, group_concat(sizers, ''), "
+                                "sum(qty), sum(actmoney), sum(dismoney) FROM main.%2 "
+                                "WHERE dated<%3 AND shop IS NOT NULL AND cargo IS NOT NULL AND color IS NOT NULL "
+                                "GROUP BY shop, %1, cargo, color ORDER BY shop, %1;")
+                 .arg(traderExp, detailCarries.at(i).second).arg(cutoff));
+        if ( qry.lastError().isValid() ) {
+            strErr = qry.lastError().text();
+            break;
+        }
+
+        QString shop, trader;
+        QList<QVariantList> rows;
+        bool hasNext = qry.next();
+        while ( hasNext || !rows.isEmpty() ) {
+            bool sameSheet = hasNext && qry.value(0).toString() == shop && qry.value(1).toString() == trader;
+            if ( !rows.isEmpty() && !sameSheet ) {
+                qint64 sheetid = nextIds.value(table);
+                nextIds.insert(table, sheetid + 1);
+                carrySqls << carrySheetSqls(table, sheetid, carryDated, shop, trader, rows,
+                                            QList<qint64>(), checker, cutoffYear);
+                rows.clear();
+            }
+            if ( !hasNext ) break;
+
+            shop = qry.value(0).toString();
+            trader = qry.value(1).toString();
+            bool nonZero = false;
+            QString sizers = carrySizers(qry.value(4).toString(), &nonZero);
+            qint64 qty = qry.value(5).toLongLong();
+            qint64 actmoney = qry.value(6).toLongLong();
+            qint64 dismoney = qry.value(7).toLongLong();
+            if ( nonZero || qty != 0 || actmoney != 0 || dismoney != 0 ) {
+                rows << QVariantList({qry.value(2), qry.value(3), sizers, qty, actmoney, dismoney});
+            }
+            hasNext = qry.next();
+        }
+        qry.finish();
+    }
+
+    //往来按单据表、门店客户，只有主表合计
+    QStringList cashTables({"cgj", "cgt", "pff", "pft", "lsd"});
+    for ( int i = 0, iLen = cashTables.length(); i < iLen && strErr.isEmpty(); ++i ) {
+        QString table = cashTables.at(i);
+        qry.exec(QStringLiteral("SELECT shop, ifnull(trader, ''), sum(sumqty), sum(summoney), sum(sumdis), "
+                                "sum(actpay), sum(actowe) FROM main.%1 WHERE dated<%2 "
+                                "GROUP BY shop, ifnull(trader, '');").arg(table).arg(cutoff));
+        if ( qry.lastError().isValid() ) {
+            strErr = qry.lastError().text();
+            break;
+        }
+        while ( qry.next() ) {
+            QList<qint64> sums;
+            bool allZero = true;
+            for ( int j = 2; j < 7; ++j ) {
+                sums << qry.value(j).toLongLong();
+                if ( sums.last() != 0 ) allZero = false;
+            }
+            if ( allZero ) continue;
+            qint64 sheetid = nextIds.value(table);
+            nextIds.insert(table, sheetid + 1);
+            carrySqls << carrySheetSqls(table, sheetid, carryDated, qry.value(0).toString(), qry.value(1).toString(),
+                                        QList<QVariantList>(), sums, checker, cutoffYear);
+        }
+        qry.finish();
+    }
+
+    //热库删除（尺码子表由触发器删，库存账表、快照登记随触发器调整），再写入结转单据
+    for ( int i = 0, iLen = tables.length(); i < iLen && strErr.isEmpty(); ++i ) {
+        QStringList sqls;
+        sqls << QStringLiteral("DELETE FROM main.%1dtl WHERE parentid IN (SELECT sheetid FROM main.%1 WHERE dated<%2);")
+                .arg(tables.at(i)).arg(cutoff);
+        sqls << QStringLiteral("DELETE FROM main.%1 WHERE dated<%2;").arg(tables.at(i)).arg(cutoff);
+        for ( int j = 0, jLen = sqls.length(); j < jLen && strErr.isEmpty(); ++j ) {
+            qry.exec(sqls.at(j));
+            if ( qry.lastError().isValid() ) strErr = qry.lastError().text();
+        }
+    }
+
+    if ( strErr.isEmpty() ) {
+        carrySqls.prepend(QStringLiteral("DELETE FROM main.archive_carry;"));
+        qint64 now = QDateTime::currentMSecsSinceEpoch() / 1000;
+        for ( int y = 0, yLen = years.length(); y < yLen; ++y ) {
+            carrySqls << QStringLiteral("INSERT OR IGNORE INTO main.archive_book(archyear, filename) VALUES(%1, '%2');")
+                         .arg(years.at(y)).arg(sqlText(QFileInfo(archiveFile(db.databaseName(), years.at(y))).fileName()));
+            carrySqls << QStringLiteral("UPDATE main.archive_book SET sheets=sheets+%1, archtime=%2 WHERE archyear=%3;")
+                         .arg(yearSheets.value(years.at(y))).arg(now).arg(years.at(y));
+            moved += yearSheets.value(years.at(y));
+        }
+        for ( int i = 0, iLen = carrySqls.length(); i < iLen && strErr.isEmpty(); ++i ) {
+            qry.exec(carrySqls.at(i));
+            if ( qry.lastError().isValid() ) {
+                qDebug() << carrySqls.at(i);
+                strErr = qry.lastError().text();
+            }
+        }
+    }
+
+    if ( strErr.isEmpty() ) {
+        if ( !db.commit() ) strErr = db.lastError().text();
+    }
+    else {
+        db.rollback();
+    }
+    detachAll(db);
+    if ( !strErr.isEmpty() )
+        return strErr;
+
+    if ( movedSheets ) *movedSheets = moved;
+    BsResultCache::bumpAll();
+
+    //删除触发器只追加库存账表尺码分段、使快照登记失效，顺便整理并收缩热库
+    stockBalanceCompact(db, 0);
+    QString snapErr = periodSnapshotRefresh(db);
+    if ( !snapErr.isEmpty() ) qDebug() << "periodSnapshotRefresh" << snapErr;
+    qry.exec(QStringLiteral("VACUUM;"));
+    if ( qry.lastError().isValid() ) qDebug() << "archive vacuum" << qry.lastError();
+
+    return QString();
+}
+
+QString BsArchive::attachFor(QSqlDatabase &db, const qint64 reachDated)
+{
+    qint64 cutoff = cutoffDated(db);
+    bool needed = ( cutoff > 0 && reachDated < cutoff );
+    bool attached = !attachedSchemas(db).isEmpty();
+
+    if ( needed && !attached )
+        return attachAll(db);
+
+    if ( !needed && attached )
+        detachAll(db);
+
+    return QString();
+}
+
+void BsArchive::detachAll(QSqlDatabase &db)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+
+    QStringList views;
+    qry.exec(QStringLiteral("SELECT name FROM sqlite_temp_master WHERE type='view' AND name LIKE 'vi\\_%' ESCAPE '\\';"));
+    while ( qry.next() ) views << qry.value(0).toString();
+    qry.finish();
+    for ( int i = 0, iLen = views.length(); i < iLen; ++i ) {
+        qry.exec(QStringLiteral("DROP VIEW IF EXISTS temp.%1;").arg(views.at(i)));
+    }
+
+    QStringList schemas = attachedSchemas(db);
+    for ( int i = 0, iLen = schemas.length(); i < iLen; ++i ) {
+        qry.exec(QStringLiteral("DETACH DATABASE %1;").arg(schemas.at(i)));
+        if ( qry.lastError().isValid() ) qDebug() << "archive detach" << qry.lastError();
+    }
+}
+
+QStringList BsArchive::attachedSchemas(QSqlDatabase &db)
+{
+    QStringList schemas;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("PRAGMA database_list;"));
+    QRegularExpression re(QStringLiteral("^arc\\d{4}$"));
+    while ( qry.next() ) {
+        QString name = qry.value(1).toString();
+        if ( re.match(name).hasMatch() ) schemas << name;
+    }
+    return schemas;
+}
+
+QString BsArchive::attachAll(QSqlDatabase &db)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+
+    //全部挂接：余额类查询须从头累计，只挂部分年份会漏
+    QList<QPair<int, QString> > books;
+    qry.exec(QStringLiteral("SELECT archyear, filename FROM main.archive_book ORDER BY archyear;"));
+    while ( qry.next() ) books << qMakePair(qry.value(0).toInt(), qry.value(1).toString());
+    qry.finish();
+
+    QDir dir = QFileInfo(db.databaseName()).absoluteDir();
+    QStringList schemas;
+    for ( int i = 0, iLen = books.length(); i < iLen; ++i ) {
+        QString file = dir.absoluteFilePath(books.at(i).second);
+        if ( !QFile::exists(file) ) {
+            detachAll(db);
+            return QStringLiteral("找不到归档库%1").arg(file);
+        }
+        QString schema = QStringLiteral("arc%1").arg(books.at(i).first);
+        qry.exec(QStringLiteral("ATTACH DATABASE '%1' AS %2;").arg(sqlText(file), schema));
+        if ( qry.lastError().isValid() ) {
+            QString strErr = qry.lastError().text();
+            detachAll(db);
+            return strErr;
+        }
+        schemas << schema;
+    }
+
+    //各单据表合并源
+    QHash<QString, QString> sources;
+    QStringList tables = archiveSheetTables();
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        QStringList names;
+        names << tables.at(i) << tables.at(i) + QStringLiteral("dtl") << tables.at(i) + QStringLiteral("dtlsizer");
+        for ( int j = 0, jLen = names.length(); j < jLen; ++j ) {
+            QString source = unionSource(db, names.at(j), schemas);
+            if ( !source.isEmpty() ) sources.insert(names.at(j), source);
+        }
+    }
+
+    //热库视图按原定义重建为同名临时视图（临时库优先解析），单据表换成合并源；
+    //引用其他视图的（如vi_stock引用vi_cgj）原样重建即改为引用临时视图
+    QList<QPair<QString, QString> > views;
+    qry.exec(QStringLiteral("SELECT name, sql FROM main.sqlite_master "
+                            "WHERE type='view' AND name LIKE 'vi\\_%' ESCAPE '\\' ORDER BY rowid;"));
+    while ( qry.next() ) views << qMakePair(qry.value(0).toString(), qry.value(1).toString());
+    qry.finish();
+
+    QRegularExpression reHead(QStringLiteral("^\\s*CREATE\\s+(?:TEMP\\w*\\s+)?VIEW\\s+(?:IF\\s+NOT\\s+EXISTS\\s+)?\\S+\\s+AS\\s+"),
+                              QRegularExpression::CaseInsensitiveOption);
+    QRegularExpression reTable(QStringLiteral("\\b(FROM|JOIN)(\\s*\\(?\\s*)(%1)(dtl|dtlsizer)?\\b")
+                               .arg(tables.join(QChar('|'))),
+                               QRegularExpression::CaseInsensitiveOption);
+    for ( int i = 0, iLen = views.length(); i < iLen; ++i ) {
+        QString sql = views.at(i).second;
+        QRegularExpressionMatch head = reHead.match(sql);
+        if ( !head.hasMatch() ) continue;
+        sql = sql.mid(head.capturedLength());
+
+        QString body;
+        int pos = 0;
+        QRegularExpressionMatchIterator it = reTable.globalMatch(sql);
+        while ( it.hasNext() ) {
+            QRegularExpressionMatch m = it.next();
+            QString table = m.captured(3).toLower() + m.captured(4).toLower();
+            body += sql.mid(pos, m.capturedStart() - pos);
+            body += ( sources.contains(table) )
+                    ? QStringLiteral("%1%2%3 AS %4").arg(m.captured(1), m.captured(2), sources.value(table), table)
+                    : m.captured(0);
+            pos = m.capturedEnd();
+        }
+        body += sql.mid(pos);
+
+        qry.exec(QStringLiteral("CREATE TEMP VIEW %1 AS %2").arg(views.at(i).first, body));
+        if ( qry.lastError().isValid() ) {
+            QString strErr = qry.lastError().text();
+            qDebug() << "archive view" << views.at(i).first << strErr;
+            detachAll(db);
+            return strErr;
+        }
+    }
+
+    return QString();
+}
+
+//热库（除结转单据）与各归档库同名表UNION ALL，列以热库为准，归档库缺的列取NULL
+QString BsArchive::unionSource(QSqlDatabase &db, const QString &table, const QStringList &schemas)
+{
+    QStringList cols = tableColumns(db, QStringLiteral("main"), table);
+    if ( cols.isEmpty() )
+        return QString();
+
+    QString mainTable = table.left(3);
+    QString keyCol = ( table == mainTable ) ? QStringLiteral("sheetid") : QStringLiteral("parentid");
+    QStringList parts;
+    parts << QStringLiteral("SELECT %1 FROM main.%2 WHERE %3 NOT IN "
+                            "(SELECT sheetid FROM main.archive_carry WHERE tname='%4')")
+             .arg(cols.join(QStringLiteral(", ")), table, keyCol, mainTable);
+
+    for ( int i = 0, iLen = schemas.length(); i < iLen; ++i ) {
+        QStringList arcCols = tableColumns(db, schemas.at(i), table);
+        if ( arcCols.isEmpty() ) continue;
+        QStringList sels;
+        for ( int j = 0, jLen = cols.length(); j < jLen; ++j ) {
+            sels << ( ( arcCols.contains(cols.at(j)) )
+                      ? cols.at(j)
+                      : QStringLiteral("NULL AS %1").arg(cols.at(j)) );
+        }
+        parts << QStringLiteral("SELECT %1 FROM %2.%3").arg(sels.join(QStringLiteral(", ")), schemas.at(i), table);
+    }
+
+    return QStringLiteral("(%1)").arg(parts.join(QStringLiteral(" UNION ALL ")));
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef BAILIARCHIVE_H
+#define BAILIARCHIVE_H
+
+#include <QtCore>
+#include <QtSql>
+
+namespace BailiSoft {
+
+// 历史年度归档 ============================================================================
+// 截止年份之前已审核的单据按年移入账册旁的归档库（账册名.年份.arc），热库只留结转单据：
+// 各门店库存一张syd，各客户订单欠货一张cgd/pfd，各客户往来一张无明细主表，登记于archive_carry。
+// 先逐年复制到归档库并各自提交，再在只写热库的事务中核对行数合计、删除并写结转，中断后可重做。
+// 截止日在热库内的查询由结转单据得余额，无需归档库；起始日伸入归档年份时才挂接全部归档库，
+// 以同名临时视图合并“热库（除结转）+归档库”，查询语句不变。归档库只读，登记的归档库随在线备份集一并备份。
+class BsArchive
+{
+public:
+    static QStringList registrySqls();
+    static qint64 cutoffDated(QSqlDatabase &db);        //热库首日（此前已归档），未归档返回0
+    static QString archiveFile(const QString &bookFile, const int year);
+
+    //截止年份1月1日之前单据归档，成功返回空串
+    static QString archiveBefore(QSqlDatabase &db, const int cutoffYear, const QString &checker,
+                                 int *movedSheets = nullptr);
+
+    //reachDated为查询所及最早日期（有起始日用起始日，否则截止日），据此挂接或卸下归档库
+    static QString attachFor(QSqlDatabase &db, const qint64 reachDated);
+    static void detachAll(QSqlDatabase &db);
+
+private:
+    static QStringList attachedSchemas(QSqlDatabase &db);
+    static QString attachAll(QSqlDatabase &db);
+    static QString unionSource(QSqlDatabase &db, const QString &table, const QStringList &schemas);
+};
+
+}
+
+#endif // BAILIARCHIVE_H
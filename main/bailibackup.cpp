@@ -0,0 +1,516 @@
+#include "bailibackup.h"
+#include "bailidata.h"
+#include "bailistore.h"
+
+#ifdef BAILI_SQLITE_FUNCS
+#include <sqlite3.h>
+#endif
+
+#define BACKUP_INTERVAL_SECS        (6 * 3600)
+#define BACKUP_CHECK_INTERVAL_MS    60000
+#define BACKUP_KEEP_SETS            14
+#define BACKUP_BLOCK_BYTES          (256 * 1024)
+#define BACKUP_STEP_PAGES           1024            //每步页数，步间只查是否取消
+#define BACKUP_STEP_SLEEP_MS        20              //非WAL账册步间让出，便于写入方取锁
+#define BACKUP_MAX_SECS             1800            //整体时限：非WAL账册反复重来、WAL账册久占快照时放弃本次
+#define BACKUP_BUSY_RETRIES         250             //连续忙（每次等BACKUP_STEP_SLEEP_MS）超过即放弃，免得久占快照挡住检查点
+#define BACKUP_RETRY_SECS           600             //失败后隔此再试
+
+#define BACKUP_SET_HEAD             "BAILIBSET\t1"
+
+namespace BailiSoft {
+
+static QString backupBookDir(const QString &bookName)
+{
+    QDir dir(backupDir);
+    dir.mkpath(bookName + QStringLiteral("/blocks"));
+    return dir.absoluteFilePath(bookName);
+}
+
+static QString checkDatabaseFile(const QString &dbFile)
+{
+    QString strErr;
+    QString connName = QStringLiteral("bsbackupcheck");
+    {
+        //复制出的文件头仍标记WAL模式，只读连接在无-shm时打不开，故按读写打开（仅检查）
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connName);
+        db.setDatabaseName(dbFile);
+        if ( db.open() ) {
+            QSqlQuery qry(db);
+            qry.setForwardOnly(true);
+            qry.exec(QStringLiteral("PRAGMA integrity_check;"));
+            if ( qry.lastError().isValid() )
+                strErr = qry.lastError().text();
+            else if ( !qry.next() || qry.value(0).toString() != QStringLiteral("ok") )
+                strErr = QStringLiteral("integrity check failed: %1").arg(qry.value(0).toString());
+            qry.finish();
+            db.close();
+        } else {
+            strErr = db.lastError().text();
+        }
+    }
+    QSqlDatabase::removeDatabase(connName);
+    return strErr;
+}
+
+//在线复制账册到destFile（一致的时间点快照），逐页原样复制，未变的块在各备份集间仍可共享
+static QString onlineCopy(const QString &bookFile, const QString &destFile, const QAtomicInteger<int> *cancel)
+{
+    QString strErr;
+    QString connName = QStringLiteral("bsbackupconn%1").arg(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connName);
+        if ( !openBookDatabase(db, bookFile, true) ) {
+            strErr = db.lastError().text();
+        } else {
+#ifdef BAILI_SQLITE_FUNCS
+            QVariant v = db.driver()->handle();
+            sqlite3 *src = ( v.isValid() && qstrcmp(v.typeName(), "sqlite3*") == 0 )
+                    ? *static_cast<sqlite3 **>(v.data())
+                    : nullptr;
+            sqlite3 *dest = nullptr;
+
+            //WAL账册：源连接先开读事务并保持到复制结束，各步都读同一快照，其间他人写入不会使备份从头再来，
+            //也不阻塞写入（只是检查点不能越过该快照）。回滚日志模式的网络账册读事务会挡住写入，
+            //仍按步复制、步间释放，被改动时自动重来。
+            QSqlQuery qry(db);
+            qry.setForwardOnly(true);
+            qry.exec(QStringLiteral("PRAGMA journal_mode;"));
+            bool walMode = qry.next() && qry.value(0).toString().compare(QStringLiteral("wal"), Qt::CaseInsensitive) == 0;
+            qry.finish();
+            bool snapshotHeld = false;
+            if ( src && walMode && db.transaction() ) {
+                qry.exec(QStringLiteral("SELECT count(*) FROM sqlite_master;"));     //读事务在首次读时才真正开始
+                snapshotHeld = !qry.lastError().isValid();
+                qry.finish();
+            }
+
+            if ( !src ) {
+                strErr = QStringLiteral("no sqlite handle");
+            }
+            else if ( sqlite3_open_v2(destFile.toUtf8().constData(), &dest,
+                                      SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr) != SQLITE_OK ) {
+                strErr = QString::fromUtf8(sqlite3_errmsg(dest));
+            }
+            else {
+                sqlite3_backup *bak = sqlite3_backup_init(dest, "main", src, "main");
+                if ( bak ) {
+                    QElapsedTimer timer;
+                    timer.start();
+                    int busyCount = 0;
+                    int rc;
+                    do {
+                        rc = sqlite3_backup_step(bak, BACKUP_STEP_PAGES);
+                        bool busy = ( rc == SQLITE_BUSY || rc == SQLITE_LOCKED );
+                        busyCount = ( busy ) ? busyCount + 1 : 0;
+                        if ( busy || (!snapshotHeld && rc == SQLITE_OK) )
+                            QThread::msleep(BACKUP_STEP_SLEEP_MS);
+                        if ( cancel && cancel->load() ) {
+                            strErr = QStringLiteral("backup cancelled");
+                            break;
+                        }
+                        //持有快照时久等会钉住WAL使检查点无法推进，放弃后由调度线程稍后再试
+                        if ( busyCount > BACKUP_BUSY_RETRIES || timer.elapsed() > BACKUP_MAX_SECS * 1000 ) {
+                            strErr = QStringLiteral("backup busy, given up");
+                            break;
+                        }
+                    } while ( rc == SQLITE_OK || rc == SQLITE_BUSY || rc == SQLITE_LOCKED );
+                    sqlite3_backup_finish(bak);
+                }
+                if ( strErr.isEmpty() && sqlite3_errcode(dest) != SQLITE_OK )
+                    strErr = QString::fromUtf8(sqlite3_errmsg(dest));
+            }
+            sqlite3_close(dest);
+
+            if ( snapshotHeld )
+                db.rollback();
+#else
+            Q_UNUSED(cancel)
+            //驱动未用共享SQLite时无备份API可调。单条语句在一个读事务内完成，WAL模式下不阻塞写入；
+            //但页序重排，各备份集间块难以共享
+            QString path = destFile;
+            path.replace(QChar(39), QStringLiteral("''"));
+            QSqlQuery qry(db);
+            qry.exec(QStringLiteral("VACUUM INTO '%1';").arg(path));
+            if ( qry.lastError().isValid() )
+                strErr = qry.lastError().text();
+#endif
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connName);
+    return strErr;
+}
+
+//arcs返回归档库各项：文件名、大小、修改时间、逗号分隔的块序列
+static QStringList readSetFile(const QString &setFile, QMap<QString, QString> *heads,
+                               QList<QStringList> *arcs = nullptr)
+{
+    QStringList blocks;
+    QFile f(setFile);
+    if ( !f.open(QIODevice::ReadOnly) )
+        return blocks;
+    QStringList lines = QString::fromUtf8(f.readAll()).split(QChar('\n'), QString::SkipEmptyParts);
+    f.close();
+    if ( lines.isEmpty() || lines.first() != QStringLiteral(BACKUP_SET_HEAD) )
+        return blocks;
+
+    for ( int i = 1, iLen = lines.length(); i < iLen; ++i ) {
+        QString line = lines.at(i);
+        int tab = line.indexOf(QChar('\t'));
+        if ( tab <= 0 ) continue;
+        QString key = line.left(tab);
+        if ( key == QStringLiteral("block") ) {
+            blocks << line.mid(tab + 1);
+        }
+        else if ( key == QStringLiteral("arc") ) {
+            QStringList arc = line.mid(tab + 1).split(QChar('\t'));
+            if ( arcs && arc.length() == 4 ) *arcs << arc;
+        }
+        else if ( heads ) {
+            heads->insert(key, line.mid(tab + 1));
+        }
+    }
+    return blocks;
+}
+
+//按固定大小切块，以内容SHA1为名压缩存放，已有的块不再写
+static QString storeBlocks(QFile &f, const QDir &blockDir, QStringList *hashes, int *newBlocks)
+{
+    while ( !f.atEnd() ) {
+        QByteArray data = f.read(BACKUP_BLOCK_BYTES);
+        QString hash = QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex());
+        QString blockFile = blockDir.absoluteFilePath(hash + QStringLiteral(".z"));
+        if ( !QFile::exists(blockFile) ) {
+            QSaveFile bf(blockFile);
+            if ( !bf.open(QIODevice::WriteOnly) || bf.write(qCompress(data)) < 0 || !bf.commit() )
+                return bf.errorString();
+            (*newBlocks)++;
+        }
+        *hashes << hash;
+    }
+    return QString();
+}
+
+//按块序列拼回到destFile，逐块校验
+static QString joinBlocks(const QDir &blockDir, const QStringList &hashes, const QString &destFile)
+{
+    QFile tf(destFile);
+    if ( !tf.open(QIODevice::WriteOnly | QIODevice::Truncate) )
+        return tf.errorString();
+    for ( int i = 0, iLen = hashes.length(); i < iLen; ++i ) {
+        QString hash = hashes.at(i);
+        QFile bf(blockDir.absoluteFilePath(hash + QStringLiteral(".z")));
+        QByteArray data = ( bf.open(QIODevice::ReadOnly) ) ? qUncompress(bf.readAll()) : QByteArray();
+        bf.close();
+        if ( QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Sha1).toHex()) != hash ) {
+            tf.close();
+            QFile::remove(destFile);
+            return QStringLiteral("备份块%1缺失或损坏").arg(hash);
+        }
+        tf.write(data);
+    }
+    tf.close();
+    return QString();
+}
+
+//快照副本中登记的归档库文件名（相对账册目录）
+static QStringList registeredArchives(const QString &dbFile)
+{
+    QStringList files;
+    QString connName = QStringLiteral("bsbackuparchives");
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connName);
+        db.setDatabaseName(dbFile);
+        if ( db.open() ) {
+            QSqlQuery qry(db);
+            qry.setForwardOnly(true);
+            qry.exec(QStringLiteral("SELECT filename FROM archive_book ORDER BY archyear;"));    //未归档过的账册无此表
+            while ( qry.next() ) files << qry.value(0).toString();
+            qry.finish();
+            db.close();
+        }
+    }
+    QSqlDatabase::removeDatabase(connName);
+    return files;
+}
+
+//保留最新若干集，删除其余及不再被引用的块
+static void rotateSets(const QString &bookDir)
+{
+    QDir dir(bookDir);
+    QStringList sets = dir.entryList(QStringList() << QStringLiteral("*.bset"), QDir::Files, QDir::Name | QDir::Reversed);
+    for ( int i = BACKUP_KEEP_SETS, iLen = sets.length(); i < iLen; ++i ) {
+        dir.remove(sets.at(i));
+    }
+
+    QSet<QString> useds;
+    for ( int i = 0, iLen = qMin(sets.length(), BACKUP_KEEP_SETS); i < iLen; ++i ) {
+        QList<QStringList> arcs;
+        QStringList blocks = readSetFile(dir.absoluteFilePath(sets.at(i)), nullptr, &arcs);
+        for ( int j = 0, jLen = arcs.length(); j < jLen; ++j ) {
+            blocks << arcs.at(j).at(3).split(QChar(','), QString::SkipEmptyParts);
+        }
+        for ( int j = 0, jLen = blocks.length(); j < jLen; ++j ) {
+            useds.insert(blocks.at(j));
+        }
+    }
+
+    QDir blockDir(dir.absoluteFilePath(QStringLiteral("blocks")));
+    QStringList files = blockDir.entryList(QDir::Files);
+    for ( int i = 0, iLen = files.length(); i < iLen; ++i ) {
+        if ( !useds.contains(QFileInfo(files.at(i)).completeBaseName()) )
+            blockDir.remove(files.at(i));
+    }
+}
+
+QString BsBackupService::backupBook(const QString &bookFile, const QString &bookName,
+                                    QString *setFile, const QAtomicInteger<int> *cancel)
+{
+    QString bookDir = backupBookDir(bookName);
+    QDir dir(bookDir);
+    QString tmpFile = dir.absoluteFilePath(QStringLiteral("backup.tmp"));
+    QFile::remove(tmpFile);
+
+    //复制并校验
+    QString strErr = onlineCopy(bookFile, tmpFile, cancel);
+    if ( strErr.isEmpty() )
+        strErr = checkDatabaseFile(tmpFile);
+    QStringList arcNames = ( strErr.isEmpty() ) ? registeredArchives(tmpFile) : QStringList();
+    QFile::remove(tmpFile + QStringLiteral("-wal"));
+    QFile::remove(tmpFile + QStringLiteral("-shm"));
+    if ( !strErr.isEmpty() ) {
+        QFile::remove(tmpFile);
+        return strErr;
+    }
+
+    //切块，已有的块不再写
+    QFile f(tmpFile);
+    if ( !f.open(QIODevice::ReadOnly) )
+        return f.errorString();
+
+    QStringList lines;
+    QDateTime now = QDateTime::currentDateTime();
+    lines << QStringLiteral(BACKUP_SET_HEAD)
+          << QStringLiteral("book\t%1").arg(bookName)
+          << QStringLiteral("file\t%1").arg(QFileInfo(bookFile).absoluteFilePath())
+          << QStringLiteral("time\t%1").arg(now.toMSecsSinceEpoch() / 1000)
+          << QStringLiteral("size\t%1").arg(f.size());
+
+    QDir blockDir(dir.absoluteFilePath(QStringLiteral("blocks")));
+    QStringList hashes;
+    int newBlocks = 0;
+    strErr = storeBlocks(f, blockDir, &hashes, &newBlocks);
+    f.close();
+    QFile::remove(tmpFile);
+    if ( !strErr.isEmpty() )
+        return strErr;
+    for ( int i = 0, iLen = hashes.length(); i < iLen; ++i ) {
+        lines << QStringLiteral("block\t%1").arg(hashes.at(i));
+    }
+
+    //归档后那些年份只在归档库中，一并备份。归档库不再改动，大小与修改时间同上一集的沿用其块序列不再读
+    QList<QStringList> lastArcs;
+    QStringList sets = backupSets(bookName);
+    if ( !sets.isEmpty() )
+        readSetFile(sets.first(), nullptr, &lastArcs);
+    QDir bookFileDir = QFileInfo(bookFile).absoluteDir();
+    for ( int i = 0, iLen = arcNames.length(); i < iLen && strErr.isEmpty(); ++i ) {
+        QFileInfo fi(bookFileDir.absoluteFilePath(arcNames.at(i)));
+        if ( !fi.exists() ) {
+            qDebug() << "backup archive missing" << fi.absoluteFilePath();
+            continue;
+        }
+        QString size = QString::number(fi.size());
+        QString mtime = QString::number(fi.lastModified().toMSecsSinceEpoch() / 1000);
+        QStringList arc;
+        for ( int j = 0, jLen = lastArcs.length(); j < jLen; ++j ) {
+            const QStringList &last = lastArcs.at(j);
+            if ( last.at(0) == arcNames.at(i) && last.at(1) == size && last.at(2) == mtime )
+                arc = last;
+        }
+        if ( arc.isEmpty() ) {
+            QFile af(fi.absoluteFilePath());
+            if ( !af.open(QIODevice::ReadOnly) ) {
+                strErr = af.errorString();
+                break;
+            }
+            QStringList arcHashes;
+            strErr = storeBlocks(af, blockDir, &arcHashes, &newBlocks);
+            af.close();
+            arc << arcNames.at(i) << size << mtime << arcHashes.join(QChar(','));
+        }
+        lines << QStringLiteral("arc\t%1").arg(arc.join(QChar('\t')));
+    }
+    if ( !strErr.isEmpty() )
+        return strErr;
+
+    //清单最后写，中途失败不会留下不完整的备份集
+    QString bset = dir.absoluteFilePath(now.toString(QStringLiteral("yyyyMMdd-hhmmss")) + QStringLiteral(".bset"));
+    QSaveFile sf(bset);
+    if ( !sf.open(QIODevice::WriteOnly) )
+        return sf.errorString();
+    sf.write(lines.join(QChar('\n')).toUtf8());
+    sf.write("\n");
+    if ( !sf.commit() )
+        return sf.errorString();
+
+    qDebug() << "backup" << bookName << "blocks:" << hashes.length() << "archives:" << arcNames.length() << "new:" << newBlocks;
+    rotateSets(bookDir);
+    if ( setFile ) *setFile = bset;
+    return QString();
+}
+
+QString BsBackupService::restoreSet(const QString &setFile, const QString &bookFile)
+{
+    QMap<QString, QString> heads;
+    QList<QStringList> arcs;
+    QStringList blocks = readSetFile(setFile, &heads, &arcs);
+    if ( blocks.isEmpty() )
+        return QStringLiteral("无效的备份集文件%1").arg(setFile);
+
+    QString targetFile = ( bookFile.isEmpty() ) ? heads.value(QStringLiteral("file")) : bookFile;
+    if ( targetFile.isEmpty() )
+        return QStringLiteral("未指定恢复到的账册文件");
+
+    //拼回并逐块校验
+    QDir blockDir(QFileInfo(setFile).absoluteDir().absoluteFilePath(QStringLiteral("blocks")));
+    QString tmpFile = targetFile + QStringLiteral(".restoring");
+    QString strErr = joinBlocks(blockDir, blocks, tmpFile);
+    if ( !strErr.isEmpty() )
+        return strErr;
+
+    QFile tf(tmpFile);
+    if ( tf.size() != heads.value(QStringLiteral("size")).toLongLong() )
+        strErr = QStringLiteral("恢复文件大小不符");
+    if ( strErr.isEmpty() )
+        strErr = checkDatabaseFile(tmpFile);
+    QFile::remove(tmpFile + QStringLiteral("-wal"));
+    QFile::remove(tmpFile + QStringLiteral("-shm"));
+    if ( !strErr.isEmpty() ) {
+        QFile::remove(tmpFile);
+        return strErr;
+    }
+
+    //原账册改名留存，其-wal、-shm须一并移走，否则会被当作恢复后账册的日志
+    if ( QFile::exists(targetFile) ) {
+        QString keepFile = QStringLiteral("%1.before-restore-%2").arg(targetFile)
+                .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss")));
+        if ( !QFile::rename(targetFile, keepFile) ) {
+            QFile::remove(tmpFile);
+            return QStringLiteral("账册文件%1正在使用，请先退出程序").arg(targetFile);
+        }
+        QFile::rename(targetFile + QStringLiteral("-wal"), keepFile + QStringLiteral("-wal"));
+        QFile::remove(targetFile + QStringLiteral("-shm"));
+    }
+    if ( !QFile::rename(tmpFile, targetFile) )
+        return QStringLiteral("不能写入账册文件%1").arg(targetFile);
+
+    //归档库：已有且大小相同的视为未变（归档后不再改动），否则拼回
+    QDir targetDir = QFileInfo(targetFile).absoluteDir();
+    for ( int i = 0, iLen = arcs.length(); i < iLen; ++i ) {
+        const QStringList &arc = arcs.at(i);
+        QString arcFile = targetDir.absoluteFilePath(arc.at(0));
+        if ( QFileInfo(arcFile).size() == arc.at(1).toLongLong() )
+            continue;
+        QString arcTmp = arcFile + QStringLiteral(".restoring");
+        strErr = joinBlocks(blockDir, arc.at(3).split(QChar(','), QString::SkipEmptyParts), arcTmp);
+        if ( strErr.isEmpty() )
+            strErr = checkDatabaseFile(arcTmp);
+        if ( !strErr.isEmpty() ) {
+            QFile::remove(arcTmp);
+            return QStringLiteral("账册已恢复，但归档库%1恢复失败：%2").arg(arc.at(0), strErr);
+        }
+        if ( QFile::exists(arcFile) )
+            QFile::rename(arcFile, QStringLiteral("%1.before-restore-%2").arg(arcFile)
+                          .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyyMMdd-hhmmss"))));
+        if ( !QFile::rename(arcTmp, arcFile) )
+            return QStringLiteral("不能写入归档库文件%1").arg(arcFile);
+    }
+
+    return QString();
+}
+
+QStringList BsBackupService::backupSets(const QString &bookName)
+{
+    QDir dir(backupBookDir(bookName));
+    QStringList sets = dir.entryList(QStringList() << QStringLiteral("*.bset"), QDir::Files, QDir::Name | QDir::Reversed);
+    for ( int i = 0, iLen = sets.length(); i < iLen; ++i ) {
+        sets[i] = dir.absoluteFilePath(sets.at(i));
+    }
+    return sets;
+}
+
+
+// 备份调度线程 ============================================================================
+void BsBackupService::bookLogin(const QString &dbfile, const QString &bookName)
+{
+    //网络共享账册由其所在主机备份
+    QMutexLocker locker(&mMutex);
+    bool networkFile = dbfile.contains(QStringLiteral("//")) || dbfile.contains(QStringLiteral("\\\\"));
+    mDatabaseFile = ( networkFile ) ? QString() : dbfile;
+    mBookName = bookName;
+    mCondition.wakeOne();
+}
+
+void BsBackupService::backupNow()
+{
+    QMutexLocker locker(&mMutex);
+    mRequested = true;
+    mCondition.wakeOne();
+}
+
+void BsBackupService::stopWait()
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mStopping = true;
+        mCancel.store(1);
+        mCondition.wakeOne();
+    }
+    wait();
+}
+
+void BsBackupService::run()
+{
+    qint64 retryAfter = 0;
+    forever {
+        QString dbFile, bookName;
+        bool requested;
+        {
+            QMutexLocker locker(&mMutex);
+            if ( !mStopping )
+                mCondition.wait(&mMutex, BACKUP_CHECK_INTERVAL_MS);
+            if ( mStopping )
+                break;
+            dbFile = mDatabaseFile;
+            bookName = mBookName;
+            requested = mRequested;
+            mRequested = false;
+        }
+        if ( dbFile.isEmpty() )
+            continue;
+
+        //距最近备份集已满间隔才备份，上次失败的隔一阵再试
+        if ( !requested ) {
+            if ( QDateTime::currentMSecsSinceEpoch() / 1000 < retryAfter )
+                continue;
+            QStringList sets = backupSets(bookName);
+            QMap<QString, QString> heads;
+            if ( !sets.isEmpty() )
+                readSetFile(sets.first(), &heads);
+            qint64 lastTime = heads.value(QStringLiteral("time")).toLongLong();
+            if ( QDateTime::currentMSecsSinceEpoch() / 1000 - lastTime < BACKUP_INTERVAL_SECS )
+                continue;
+        }
+
+        QString strErr = backupBook(dbFile, bookName, nullptr, &mCancel);
+        retryAfter = 0;
+        if ( !strErr.isEmpty() ) {
+            qDebug() << "backupBook" << bookName << strErr;
+            retryAfter = QDateTime::currentMSecsSinceEpoch() / 1000 + BACKUP_RETRY_SECS;
+        }
+    }
+}
+
+}
@@ -0,0 +1,49 @@
+#ifndef BAILIBACKUP_H
+#define BAILIBACKUP_H
+
+#include <QtCore>
+#include <QtSql>
+#include <QThread>
+
+namespace BailiSoft {
+
+// 账册在线备份 ============================================================================
+// 后台线程定时用在线备份API把账册逐页复制到临时文件：WAL账册在一个读事务快照内分步复制，
+// 终端写入照常进行且不会使复制重来；页序与原文件一致，未变的块可跨备份集共享（驱动未用共享SQLite时改用
+// VACUUM INTO，块难以共享）。复制后完整性检查通过，
+// 才按固定大小切块，以内容SHA1为名压缩存放于backupDir下账册名目录。块在各备份集间共享，
+// 只有变化的块才新写入。备份集清单（.bset）记录块序列，超出保留数的旧集及无引用的块随即删除。
+// 账册登记的归档库（归档年份只存于此）也切块记入清单，大小与修改时间未变的沿用上一集块序列，不再重读。
+// 恢复：BailiR17 --restore 备份集文件 [账册文件]，按清单拼回并逐块校验，完整性检查后替换原账册，
+// 缺失或大小不符的归档库一并拼回。
+class BsBackupService : public QThread
+{
+    Q_OBJECT
+public:
+    BsBackupService(QObject *parent) : QThread(parent) {}
+
+    void bookLogin(const QString &dbfile, const QString &bookName);
+    void backupNow();
+    void stopWait();
+
+    //成功返回空串，setFile返回新备份集清单文件
+    static QString backupBook(const QString &bookFile, const QString &bookName,
+                              QString *setFile = nullptr, const QAtomicInteger<int> *cancel = nullptr);
+    static QString restoreSet(const QString &setFile, const QString &bookFile = QString());
+    static QStringList backupSets(const QString &bookName);     //新的在前
+
+private:
+    void run() override;
+
+    QString                 mDatabaseFile;
+    QString                 mBookName;
+    bool                    mStopping = false;
+    bool                    mRequested = false;
+    QMutex                  mMutex;
+    QWaitCondition          mCondition;
+    QAtomicInteger<int>     mCancel;
+};
+
+}
+
+#endif // BAILIBACKUP_H
@@ -0,0 +1,364 @@
+#include "bailicache.h"
+#include "bailicatalog.h"
+#include "bailistore.h"
+
+#define RESULT_CACHE_BUDGET     (64 * 1024 * 1024)
+#define RESULT_CACHE_MAX_ITEM   (RESULT_CACHE_BUDGET / 4)       //单项过大的不缓存，免得挤掉其余
+
+namespace BailiSoft {
+
+QMutex BsResultCache::mutex;
+QCache<QString, BsResultCache::Entry> BsResultCache::entries(RESULT_CACHE_BUDGET);
+QHash<QString, quint64> BsResultCache::tableGens;
+quint64 BsResultCache::epoch = 0;
+qint64 BsResultCache::bookCounter = 0;
+qint64 BsResultCache::hits = 0;
+qint64 BsResultCache::misses = 0;
+
+static QStringList sheetTables()
+{
+    return QStringList({"cgd", "cgj", "cgt", "pfd", "pff", "pft", "lsd", "dbd", "syd", "szd"});
+}
+
+static QStringList stockTables()
+{
+    return QStringList({"syd", "cgj", "cgt", "pff", "pft", "lsd", "dbd"});
+}
+
+static QStringList registryTables()
+{
+    return QStringList({"barcoderule", "sizertype", "colortype", "cargo", "shop",
+                        "customer", "supplier", "staff", "subject"});
+}
+
+//只有提交处会递增代次的表才可缓存（单据、登记及其视图与触发器维护表）；
+//消息、会议、日志等表的写入不递增代次，必须每次实查
+static bool cacheableTable(const QString &name)
+{
+    QString table = name.toLower();
+    int dot = table.lastIndexOf(QChar('.'));
+    if ( dot >= 0 ) table = table.mid(dot + 1);
+
+    QStringList sheets = sheetTables();
+    if ( sheets.contains(table) || registryTables().contains(table) )
+        return true;
+    if ( table.length() > 3 && sheets.contains(table.left(3)) &&
+         ( table.mid(3) == QStringLiteral("dtl") || table.mid(3) == QStringLiteral("dtlsizer") ) )
+        return true;
+    return table.startsWith(QStringLiteral("vi_")) || table.startsWith(QStringLiteral("snap_")) ||
+            table == QStringLiteral("stock_balance") || table == QStringLiteral("reg_changelog");
+}
+
+bool BsResultCache::cacheable(const QString &sql)
+{
+    QString s = sql.trimmed();
+    if ( !s.startsWith(QStringLiteral("select"), Qt::CaseInsensitive) ||
+         s.indexOf(QStringLiteral("tmp_"), 0, Qt::CaseInsensitive) >= 0 ||
+         s.indexOf(QStringLiteral("random("), 0, Qt::CaseInsensitive) >= 0 )
+        return false;
+
+    int tableCount = 0;
+    QRegularExpression re(QStringLiteral("\\b(?:FROM|JOIN)\\s+\\(?\\s*([A-Za-z_][A-Za-z0-9_.]*)"),
+                          QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatchIterator it = re.globalMatch(s);
+    while ( it.hasNext() ) {
+        QString name = it.next().captured(1);
+        if ( name.compare(QStringLiteral("select"), Qt::CaseInsensitive) == 0 ) continue;
+        if ( !cacheableTable(name) )
+            return false;
+        tableCount++;
+    }
+    return tableCount > 0;
+}
+
+QString BsResultCache::keyOf(const QString &scope, const QString &sql)
+{
+    return scope + QChar(31) + sql.simplified();
+}
+
+QStringList BsResultCache::dependsOf(const QString &name)
+{
+    QString table = name.toLower();
+    int dot = table.lastIndexOf(QChar('.'));
+    if ( dot >= 0 ) table = table.mid(dot + 1);
+
+    QStringList sheets = sheetTables();
+    if ( sheets.contains(table) )
+        return QStringList(table);
+
+    if ( table.length() > 3 && sheets.contains(table.left(3)) &&
+         ( table.mid(3) == QStringLiteral("dtl") || table.mid(3) == QStringLiteral("dtlsizer") ) )
+        return QStringList(table.left(3));
+
+    //库存账表、期末快照、登记变更日志由触发器维护
+    if ( table == QStringLiteral("stock_balance") )
+        return stockTables();
+    if ( table.startsWith(QStringLiteral("snap_")) )
+        return sheets;
+    if ( table == QStringLiteral("reg_changelog") )
+        return registryTables();
+
+    if ( !table.startsWith(QStringLiteral("vi_")) )
+        return QStringList(table);
+
+    QStringList parts = table.mid(3).split(QChar('_'));
+    QString family = parts.at(0);
+    bool rest = parts.contains(QStringLiteral("rest"));
+    QStringList deps;
+    if ( sheets.contains(family) )
+        deps << family;
+    else if ( family == QStringLiteral("dbr") )
+        deps << QStringLiteral("dbd");
+    else if ( family == QStringLiteral("cg") )
+        deps << ( ( rest ) ? QStringList({"cgd", "cgj"}) : QStringList({"cgj", "cgt"}) );
+    else if ( family == QStringLiteral("pf") )
+        deps << ( ( rest ) ? QStringList({"pfd", "pff"}) : QStringList({"pff", "pft"}) );
+    else if ( family == QStringLiteral("xs") )
+        deps << QStringList({"pff", "lsd", "pft"});
+    else if ( family == QStringLiteral("stock") )
+        deps << stockTables();
+    else
+        deps << sheets;
+
+    if ( parts.contains(QStringLiteral("attr")) || parts.contains(QStringLiteral("sizer")) )
+        deps << ( ( family == QStringLiteral("szd") ) ? QStringLiteral("subject") : QStringLiteral("cargo") );
+
+    return deps;
+}
+
+QStringList BsResultCache::dependsOfSql(const QString &sql)
+{
+    QStringList deps;
+    QRegularExpression re(QStringLiteral("\\b(?:FROM|JOIN)\\s+\\(?\\s*([A-Za-z_][A-Za-z0-9_.]*)"),
+                          QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatchIterator it = re.globalMatch(sql);
+    while ( it.hasNext() ) {
+        QString name = it.next().captured(1);
+        if ( name.compare(QStringLiteral("select"), Qt::CaseInsensitive) == 0 ) continue;
+        deps << dependsOf(name);
+    }
+    deps.removeDuplicates();
+    return deps;
+}
+
+BsCacheStamp BsResultCache::stampOf(const QStringList &tables)
+{
+    syncExternalChanges();
+    BsCacheStamp stamp;
+    QMutexLocker locker(&mutex);
+    stamp.tables = tables;
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        stamp.gens << tableGens.value(tables.at(i));
+    }
+    stamp.epoch = epoch;
+    return stamp;
+}
+
+//调用方已加锁
+bool BsResultCache::stampValid(const BsCacheStamp &stamp)
+{
+    if ( stamp.epoch != epoch )
+        return false;
+    for ( int i = 0, iLen = stamp.tables.length(); i < iLen; ++i ) {
+        if ( tableGens.value(stamp.tables.at(i)) != stamp.gens.at(i) )
+            return false;
+    }
+    return true;
+}
+
+bool BsResultCache::fetchText(const QString &key, QString *text)
+{
+    syncExternalChanges();
+    QMutexLocker locker(&mutex);
+    Entry *entry = entries.object(key);
+    if ( entry && !entry->rows && !entry->store && stampValid(entry->stamp) ) {
+        *text = entry->text;
+        hits++;
+        return true;
+    }
+    if ( entry ) entries.remove(key);
+    misses++;
+    return false;
+}
+
+void BsResultCache::storeText(const QString &key, const BsCacheStamp &stamp, const QString &text)
+{
+    Entry *entry = new Entry;
+    entry->stamp = stamp;
+    entry->text = text;
+    insertEntry(key, entry, 2 * (key.length() + text.length()));
+}
+
+BsCachedRowsPtr BsResultCache::fetchRows(const QString &key)
+{
+    syncExternalChanges();
+    QMutexLocker locker(&mutex);
+    Entry *entry = entries.object(key);
+    if ( entry && entry->rows && stampValid(entry->stamp) ) {
+        hits++;
+        return entry->rows;
+    }
+    if ( entry ) entries.remove(key);
+    misses++;
+    return BsCachedRowsPtr();
+}
+
+void BsResultCache::storeRows(const QString &key, const BsCacheStamp &stamp, const BsCachedRowsPtr &rows)
+{
+    //估算：每值QVariant约16字节，文本另计
+    int cost = 2 * key.length();
+    for ( int i = 0, iLen = rows->rows.length(); i < iLen && cost <= RESULT_CACHE_MAX_ITEM; ++i ) {
+        const QVariantList &row = rows->rows.at(i);
+        cost += 16 * row.length();
+        for ( int j = 0, jLen = row.length(); j < jLen; ++j ) {
+            if ( row.at(j).type() == QVariant::String )
+                cost += 2 * row.at(j).toString().length();
+        }
+    }
+
+    Entry *entry = new Entry;
+    entry->stamp = stamp;
+    entry->rows = rows;
+    insertEntry(key, entry, cost);
+}
+
+BsGridStorePtr BsResultCache::fetchStore(const QString &key)
+{
+    syncExternalChanges();
+    QMutexLocker locker(&mutex);
+    Entry *entry = entries.object(key);
+    if ( entry && entry->store && stampValid(entry->stamp) ) {
+        hits++;
+        return entry->store;
+    }
+    if ( entry ) entries.remove(key);
+    misses++;
+    return BsGridStorePtr();
+}
+
+void BsResultCache::storeStore(const QString &key, const BsCacheStamp &stamp, const BsGridStorePtr &store, const int cost)
+{
+    Entry *entry = new Entry;
+    entry->stamp = stamp;
+    entry->store = store;
+    insertEntry(key, entry, 2 * key.length() + qMin(cost, RESULT_CACHE_MAX_ITEM + 1));    //估算值已很大时防溢出
+}
+
+BsCachedRowsPtr BsResultCache::selectRows(QSqlDatabase db, const QString &sql,
+                                          const QSql::NumericalPrecisionPolicy policy,
+                                          const QString &scope, QString *errText)
+{
+    //数值精度策略影响取值类型，须计入键
+    QString key;
+    if ( !scope.isEmpty() && cacheable(sql) ) {
+        key = keyOf(QStringLiteral("%1:%2").arg(scope).arg(int(policy)), sql);
+        BsCachedRowsPtr cached = fetchRows(key);
+        if ( cached )
+            return cached;
+    }
+
+    //代次须在执行前取，执行期间有写入则存入时作废
+    BsCacheStamp stamp;
+    if ( !key.isEmpty() )
+        stamp = stampOf(dependsOfSql(sql));
+
+    BsCachedRows *data = new BsCachedRows;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.setNumericalPrecisionPolicy(policy);
+    qry.exec(sql);
+    if ( qry.lastError().isValid() ) {
+        qDebug() << qry.lastError().text();
+        qDebug() << sql;
+        if ( errText ) *errText = qry.lastError().text();
+        return BsCachedRowsPtr(data);
+    }
+
+    QSqlRecord rec = qry.record();
+    int fcount = rec.count();
+    for ( int i = 0; i < fcount; ++i ) {
+        data->fields << rec.fieldName(i);
+    }
+    while ( qry.next() ) {
+        QVariantList row;
+        row.reserve(fcount);
+        for ( int i = 0; i < fcount; ++i ) {
+            row << qry.value(i);
+        }
+        data->rows << row;
+    }
+    qry.finish();
+
+    BsCachedRowsPtr rows(data);
+    if ( !key.isEmpty() )
+        storeRows(key, stamp, rows);
+    return rows;
+}
+
+void BsResultCache::insertEntry(const QString &key, Entry *entry, const int cost)
+{
+    QMutexLocker locker(&mutex);
+    if ( cost > RESULT_CACHE_MAX_ITEM || cost > entries.maxCost() || !stampValid(entry->stamp) ) {
+        delete entry;
+        return;
+    }
+    entries.insert(key, entry, cost);       //超出预算时QCache按最久未用淘汰
+}
+
+void BsResultCache::bump(const QString &table)
+{
+    QStringList deps = dependsOf(table);
+    QMutexLocker locker(&mutex);
+    for ( int i = 0, iLen = deps.length(); i < iLen; ++i ) {
+        tableGens[deps.at(i)]++;
+        BsCatalog::touch(deps.at(i));       //登记目录快照随之过期
+    }
+}
+
+void BsResultCache::bumpSql(const QString &sql)
+{
+    QRegularExpression re(QStringLiteral("^\\s*(?:INSERT(?:\\s+OR\\s+\\w+)?\\s+INTO|REPLACE\\s+INTO|"
+                                         "UPDATE(?:\\s+OR\\s+\\w+)?|DELETE\\s+FROM)\\s+([A-Za-z_][A-Za-z0-9_.]*)"),
+                          QRegularExpression::CaseInsensitiveOption);
+    QRegularExpressionMatch m = re.match(sql);
+    if ( m.hasMatch() )
+        bump(m.captured(1));
+}
+
+void BsResultCache::bumpAll()
+{
+    QMutexLocker locker(&mutex);
+    epoch++;
+    entries.clear();
+    BsCatalog::touchAll();
+}
+
+//查询前取代次、取用前均核对：其间他处提交的，下次取用时计数已变，不会把旧结果当新
+void BsResultCache::syncExternalChanges()
+{
+    qint64 counter = bookChangeCounter();
+    QMutexLocker locker(&mutex);
+    if ( counter == bookCounter && counter >= 0 )
+        return;
+    bookCounter = counter;
+    epoch++;
+    entries.clear();
+    BsCatalog::touchAll();
+}
+
+void BsResultCache::setBudget(const int budgetBytes)
+{
+    QMutexLocker locker(&mutex);
+    entries.setMaxCost(budgetBytes);
+}
+
+void BsResultCache::stats(qint64 *hitCount, qint64 *missCount, int *entryCount, int *usedBytes)
+{
+    QMutexLocker locker(&mutex);
+    *hitCount = hits;
+    *missCount = misses;
+    *entryCount = entries.count();
+    *usedBytes = entries.totalCost();
+}
+
+}
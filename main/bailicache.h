@@ -0,0 +1,85 @@
+#ifndef BAILICACHE_H
+#define BAILICACHE_H
+
+#include <QtCore>
+#include <QtSql>
+
+namespace BailiSoft {
+
+//查询结果行（列名加各行值），拣货表格与网络数据集共用
+struct BsCachedRows
+{
+    QStringList             fields;
+    QVector<QVariantList>   rows;
+};
+typedef QSharedPointer<const BsCachedRows> BsCachedRowsPtr;
+
+//桌面查询表格直接缓存填好的列式存储（bailigrid.h）
+class BsGridStore;
+typedef QSharedPointer<const BsGridStore> BsGridStorePtr;
+
+//查询前取得的所依赖各表写入代次
+struct BsCacheStamp
+{
+    QStringList     tables;
+    QList<quint64>  gens;
+    quint64         epoch = 0;
+};
+
+// 报表结果缓存 ============================================================================
+// 键为调用范围加规范化SQL（空白折叠），范围区分输出格式及不体现在SQL中的权限差异。
+// 每表一个写入代次，各提交处按所写表递增；缓存项记下查询前所依赖各表（视图展开为单据表）的代次，
+// 取用时任一有变即失效。网络账册另核对文件头变更计数，他处有提交即整体失效。
+// 按估算字节数在预算内LRU淘汰，各线程共用，内部加锁。
+class BsResultCache
+{
+public:
+    static bool cacheable(const QString &sql);          //只读SELECT，且所涉表均在单据登记白名单内
+    static QString keyOf(const QString &scope, const QString &sql);
+    static QStringList dependsOf(const QString &name);  //表或视图名对应的写入代次表
+    static QStringList dependsOfSql(const QString &sql);
+
+    static BsCacheStamp stampOf(const QStringList &tables);
+    static bool fetchText(const QString &key, QString *text);
+    static void storeText(const QString &key, const BsCacheStamp &stamp, const QString &text);
+    static BsCachedRowsPtr fetchRows(const QString &key);
+    static void storeRows(const QString &key, const BsCacheStamp &stamp, const BsCachedRowsPtr &rows);
+    static BsGridStorePtr fetchStore(const QString &key);
+    static void storeStore(const QString &key, const BsCacheStamp &stamp, const BsGridStorePtr &store, const int cost);
+
+    //执行并取全部行；scope非空且可缓存时先查缓存、成功后存入。出错返回空结果并置errText
+    static BsCachedRowsPtr selectRows(QSqlDatabase db, const QString &sql, const QSql::NumericalPrecisionPolicy policy,
+                                      const QString &scope, QString *errText = nullptr);
+
+    static void bump(const QString &table);
+    static void bumpSql(const QString &sql);            //按INSERT/UPDATE/DELETE/REPLACE语句的目标表递增
+    static void bumpAll();                              //换账册、归档等整体变化
+    static void syncExternalChanges();                  //网络账册有他处提交时同bumpAll
+
+    static void setBudget(const int budgetBytes);
+    static void stats(qint64 *hits, qint64 *misses, int *entries, int *usedBytes);
+
+private:
+    struct Entry
+    {
+        BsCacheStamp        stamp;
+        QString             text;
+        BsCachedRowsPtr     rows;
+        BsGridStorePtr      store;
+    };
+
+    static bool stampValid(const BsCacheStamp &stamp);
+    static void insertEntry(const QString &key, Entry *entry, const int cost);
+
+    static QMutex                       mutex;
+    static QCache<QString, Entry>       entries;
+    static QHash<QString, quint64>      tableGens;
+    static quint64                      epoch;
+    static qint64                       bookCounter;
+    static qint64                       hits;
+    static qint64                       misses;
+};
+
+}
+
+#endif // BAILICACHE_H
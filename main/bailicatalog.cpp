@@ -0,0 +1,148 @@
+#include "bailicatalog.h"
+#include "bailicache.h"
+#include "bailisql.h"
+#include "comm/pinyincode.h"
+
+namespace BailiSoft {
+
+BsCatalogPtr BsCatalog::snapshots[CATALOG_SLOTS];
+QAtomicInteger<quint64> BsCatalog::generations[CATALOG_SLOTS];
+QMutex BsCatalog::buildMutex;
+
+//各表取用字段（取全各方所需，首字段主键；货品hpname须第二位，拼音由其算得）
+static QStringList catalogFields(const QString &table)
+{
+    if ( table == QStringLiteral("cargo") )
+        return QStringList({"hpcode", "hpname", "unit", "sizertype", "colortype",
+                            "setprice", "retprice", "lotprice", "buyprice",
+                            "attr1", "attr2", "attr3", "attr4", "attr5", "attr6", "amtag"});
+    if ( table == QStringLiteral("subject") )
+        return QStringList({"kname", "adminboss"});
+    if ( table == QStringLiteral("shop") )
+        return QStringList({"kname", "regdis", "amgeo"});
+    return QStringList({"kname", "regdis"});
+}
+
+QString BsCatalogSnapshot::value(const QString &key, const QString &fld) const
+{
+    int row = mRowOf.value(key, -1);
+    int col = mColOf.value(fld, -1);
+    return ( row >= 0 && col >= 0 ) ? mColumns.at(col).at(row) : QString();
+}
+
+int BsCatalog::slotOf(const QString &table)
+{
+    static const QStringList tables({"cargo", "subject", "shop", "customer", "supplier"});
+    return tables.indexOf(table);
+}
+
+BsCatalogPtr BsCatalog::acquire(QSqlDatabase db, const QString &table)
+{
+    int slot = slotOf(table);
+    Q_ASSERT(slot >= 0);
+
+    //网络账册他处有提交时各表代次一并递增
+    BsResultCache::syncExternalChanges();
+
+    BsCatalogPtr snap = std::atomic_load(&snapshots[slot]);
+    quint64 generation = generations[slot].loadAcquire();
+    if ( snap && snap->generation == generation )
+        return snap;
+
+    //多线程同时发现过期时只建一次
+    QMutexLocker locker(&buildMutex);
+    snap = std::atomic_load(&snapshots[slot]);
+    generation = generations[slot].loadAcquire();
+    if ( snap && snap->generation == generation )
+        return snap;
+
+    snap = build(db, table, generation);
+    std::atomic_store(&snapshots[slot], snap);
+    return snap;
+}
+
+BsCatalogPtr BsCatalog::refresh(QSqlDatabase db, const QString &table)
+{
+    int slot = slotOf(table);
+    Q_ASSERT(slot >= 0);
+
+    QMutexLocker locker(&buildMutex);
+    BsCatalogPtr snap = build(db, table, generations[slot].loadAcquire());
+    std::atomic_store(&snapshots[slot], snap);
+    return snap;
+}
+
+void BsCatalog::touch(const QString &table)
+{
+    int slot = slotOf(table);
+    if ( slot >= 0 )
+        generations[slot].fetchAndAddOrdered(1);
+}
+
+void BsCatalog::touchAll()
+{
+    for ( int i = 0; i < CATALOG_SLOTS; ++i ) {
+        generations[i].fetchAndAddOrdered(1);
+    }
+}
+
+//生成代次在查询前取得，建成期间若有写入，代次已变，下次取用再建
+BsCatalogPtr BsCatalog::build(QSqlDatabase db, const QString &table, const quint64 generation)
+{
+    BsCatalogSnapshot *snap = new BsCatalogSnapshot;
+    snap->table = table;
+    snap->generation = generation;
+
+    //老账册未升级的字段不取，值为空
+    QStringList exists = getExistsFieldsOfTable(table, db);
+    QStringList wants = catalogFields(table);
+    for ( int i = 0, iLen = wants.length(); i < iLen; ++i ) {
+        if ( i == 0 || exists.contains(wants.at(i)) )
+            snap->fields << wants.at(i);
+    }
+    for ( int i = 0, iLen = snap->fields.length(); i < iLen; ++i ) {
+        snap->mColOf.insert(snap->fields.at(i), i);
+        snap->mColumns << QStringList();
+    }
+
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.setNumericalPrecisionPolicy(QSql::LowPrecisionInt64);
+    qry.exec(QStringLiteral("SELECT %1 FROM %2;").arg(snap->fields.join(QChar(44))).arg(table));
+    if ( qry.lastError().isValid() ) qDebug() << "catalog" << table << qry.lastError().text();
+
+    bool useCode = snap->fields.at(0).contains(QStringLiteral("code"));
+    int fcount = snap->fields.length();
+    QStringList initials;
+    int row = 0;
+    while ( qry.next() ) {
+        QString key = qry.value(0).toString().trimmed();
+        if ( snap->mRowOf.contains(key) )
+            continue;
+        for ( int i = 0; i < fcount; ++i ) {
+            snap->mColumns[i] << qry.value(i).toString().trimmed();
+        }
+        QString initial = ( useCode && fcount > 1 )
+                ? LxSoft::ChineseConvertor::GetFirstLetter(qry.value(1).toString())
+                : LxSoft::ChineseConvertor::GetFirstLetter(key);
+        snap->mPinyins << ( ( useCode && fcount > 1 ) ? (QChar(32) + key + initial) : (QChar(32) + initial) );
+        initials << initial;
+        snap->mRowOf.insert(key, row);
+        snap->mSorted << row;
+        row++;
+    }
+    qry.finish();
+
+    const QStringList &keys = snap->mColumns.at(0);
+    std::sort(snap->mSorted.begin(), snap->mSorted.end(), [&keys](int a, int b) {
+        return keys.at(a) < keys.at(b);
+    });
+
+    //无编码的表名称即主键，不重复索引
+    snap->mSearch.build(keys, ( useCode && fcount > 1 ) ? snap->mColumns.at(1) : QStringList(),
+                        initials, snap->mSorted);
+
+    return BsCatalogPtr(snap);
+}
+
+}
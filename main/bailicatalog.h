@@ -0,0 +1,67 @@
+#ifndef BAILICATALOG_H
+#define BAILICATALOG_H
+
+#include <QtCore>
+#include <QtSql>
+#include <memory>
+#include "bailisearch.h"
+
+#define CATALOG_SLOTS   5
+
+namespace BailiSoft {
+
+//某一时刻某登记表的全部记录，建成后不再改动
+class BsCatalogSnapshot
+{
+public:
+    QString         table;
+    QStringList     fields;             //首字段为主键
+    quint64         generation = 0;
+
+    int rowCount() const { return mPinyins.length(); }
+    int rowOf(const QString &key) const { return mRowOf.value(key, -1); }
+    int colOf(const QString &fld) const { return mColOf.value(fld, -1); }
+    bool contains(const QString &key) const { return mRowOf.contains(key); }
+    QString keyAt(const int row) const { return mColumns.at(0).at(row); }
+    QString textAt(const int row, const int col) const { return mColumns.at(col).at(row); }
+    QString pinyinAt(const int row) const { return mPinyins.at(row); }
+    QString value(const QString &key, const QString &fld) const;
+    const QVector<int> &sortedRows() const { return mSorted; }      //按主键排序的行号
+    const BsSearchIndex &searchIndex() const { return mSearch; }   //编码、名称、拼音首字母查找
+
+private:
+    friend class BsCatalog;
+    QVector<QStringList>    mColumns;   //每字段一列
+    QStringList             mPinyins;   //下拉匹配用，已含前导空格
+    QVector<int>            mSorted;
+    QHash<QString, int>     mRowOf;
+    QHash<QString, int>     mColOf;
+    BsSearchIndex           mSearch;
+};
+typedef std::shared_ptr<const BsCatalogSnapshot> BsCatalogPtr;
+
+// 登记目录快照 ============================================================================
+// 货品、科目、门店、客户、供应商各一份不可变快照，列式存值，主键哈希到行号，拼音与排序预先算好。
+// 登记表写入提交后（经BsResultCache::bump）该表代次递增，网络账册他处有提交时（经BsResultCache::syncExternalChanges）
+// 全部递增。取用时代次不符才重建并原子换上，旧快照由仍在用的持有者释放。桌面下拉数据集、网络终端、发布线程各取一次指针后无锁只读。
+class BsCatalog
+{
+public:
+    static bool isCatalogTable(const QString &table) { return slotOf(table) >= 0; }
+    static BsCatalogPtr acquire(QSqlDatabase db, const QString &table);     //代次不符时用db重建
+    static BsCatalogPtr refresh(QSqlDatabase db, const QString &table);     //强制重建并发布
+    static void touch(const QString &table);
+    static void touchAll();
+
+private:
+    static int slotOf(const QString &table);
+    static BsCatalogPtr build(QSqlDatabase db, const QString &table, const quint64 generation);
+
+    static BsCatalogPtr             snapshots[CATALOG_SLOTS];
+    static QAtomicInteger<quint64>  generations[CATALOG_SLOTS];
+    static QMutex                   buildMutex;
+};
+
+}
+
+#endif // BAILICATALOG_H
@@ -1,5 +1,7 @@
 #include "bailicode.h"
 #include "bailigrid.h"
+#include "bailistore.h"
+#include "bailicache.h"
 
 #include <QSqlDatabase>
 #include <QSqlQuery>
@@ -729,6 +731,10 @@ void initMapMsg()
     mapMsg.insert("menu_batch_edit", QStringLiteral("登记名批量修改器"));
     mapMsg.insert("menu_batch_check", QStringLiteral("单据批量审核器"));
     mapMsg.insert("menu_stock_reset", QStringLiteral("库存帐盘点清空"));
+    mapMsg.insert("menu_stock_balance", QStringLiteral("库存账表核对重建"));
+    mapMsg.insert("menu_index_advisor", QStringLiteral("查询索引优化"));
+    mapMsg.insert("menu_backup_now", QStringLiteral("账册立即备份"));
+    mapMsg.insert("menu_archive_years", QStringLiteral("历史年度归档"));
     mapMsg.insert("menu_barcode_maker", QStringLiteral("货品明细编码器"));
     mapMsg.insert("menu_label_designer", QStringLiteral("吊牌标签设计器"));
     mapMsg.insert("menu_custom", QStringLiteral("更多定制…"));
@@ -892,6 +898,7 @@ void initMapMsg()
 //批量提交
 QString sqliteCommit(const QStringList sqls)
 {
+    BsCheckpointer::touch();
     QSqlDatabase db = QSqlDatabase::database();
     QSqlQuery qry(db);
     db.transaction();
@@ -910,6 +917,9 @@ QString sqliteCommit(const QStringList sqls)
         }
     }
     db.commit();
+    foreach (QString s, sqls) {
+        BsResultCache::bumpSql(s);
+    }
     return QString();
 }
 
@@ -0,0 +1,213 @@
+#include "bailicrypto.h"
+#include "third/tinyAES/aes.hpp"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BS_AESNI_BUILD 1
+#include <wmmintrin.h>
+#include <emmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BS_AESNI_TARGET
+#else
+#include <cpuid.h>
+#define BS_AESNI_TARGET __attribute__((target("aes,sse2")))
+#endif
+#endif
+
+namespace BailiSoft {
+
+// 基类 =======================================================================
+BsAesCipher::BsAesCipher()
+{
+    memset(mKey, 0, sizeof(mKey));
+    mKeyReady = false;
+}
+
+void BsAesCipher::setKey(const uint8_t *key)
+{
+    if ( mKeyReady && memcmp(mKey, key, sizeof(mKey)) == 0 )
+        return;
+    memcpy(mKey, key, sizeof(mKey));
+    expandKey(mKey);
+    mKeyReady = true;
+}
+
+
+// tinyAES软件实现 =======================================================================
+class BsAesCipherTiny : public BsAesCipher
+{
+public:
+    const char *backendName() const { return "tinyAES"; }
+
+    void encryptCbc(const uint8_t *iv, uint8_t *buff, const size_t len) {
+        AES_ctx_set_iv(&mCtx, iv);
+        AES_CBC_encrypt_buffer(&mCtx, buff, uint32_t(len));
+    }
+
+    void decryptCbc(const uint8_t *iv, uint8_t *buff, const size_t len) {
+        AES_ctx_set_iv(&mCtx, iv);
+        AES_CBC_decrypt_buffer(&mCtx, buff, uint32_t(len));
+    }
+
+protected:
+    void expandKey(const uint8_t *key) {
+        AES_init_ctx(&mCtx, key);
+    }
+
+private:
+    struct AES_ctx  mCtx;
+};
+
+
+#ifdef BS_AESNI_BUILD
+// AES-NI硬件实现 =======================================================================
+static bool cpuHasAesni()
+{
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return (info[2] & (1 << 25)) != 0;
+#else
+    unsigned int eax, ebx, ecx, edx;
+    if ( !__get_cpuid(1, &eax, &ebx, &ecx, &edx) )
+        return false;
+    return (ecx & bit_AES) != 0;
+#endif
+}
+
+BS_AESNI_TARGET
+static inline __m128i aesniExpandStep(__m128i key, __m128i keygened)
+{
+    keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3, 3, 3, 3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, keygened);
+}
+
+#define AESNI_EXPAND(k, rcon)   aesniExpandStep(k, _mm_aeskeygenassist_si128(k, rcon))
+
+//轮密钥以字节存于堆对象（32位下new只保证8字节对齐），用前逐个非对齐载入栈上数组
+BS_AESNI_TARGET
+static inline void aesniLoadKeys(const uint8_t *bytes, __m128i *keys)
+{
+    for ( int r = 0; r < 11; ++r )
+        keys[r] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 16 * r));
+}
+
+class BsAesCipherNi : public BsAesCipher
+{
+public:
+    const char *backendName() const { return "AES-NI"; }
+
+    BS_AESNI_TARGET
+    void encryptCbc(const uint8_t *iv, uint8_t *buff, const size_t len) {
+        //CBC加密前后块相依，只能逐块
+        __m128i keys[11];
+        aesniLoadKeys(mEncKeys, keys);
+        __m128i chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+        for ( size_t pos = 0; pos + 16 <= len; pos += 16 ) {
+            __m128i *p = reinterpret_cast<__m128i*>(buff + pos);
+            __m128i x = _mm_xor_si128(_mm_loadu_si128(p), chain);
+            x = _mm_xor_si128(x, keys[0]);
+            for ( int r = 1; r < 10; ++r )
+                x = _mm_aesenc_si128(x, keys[r]);
+            chain = _mm_aesenclast_si128(x, keys[10]);
+            _mm_storeu_si128(p, chain);
+        }
+    }
+
+    BS_AESNI_TARGET
+    void decryptCbc(const uint8_t *iv, uint8_t *buff, const size_t len) {
+        //CBC解密各块独立，4块一组并行流水
+        __m128i keys[11];
+        aesniLoadKeys(mDecKeys, keys);
+        __m128i chain = _mm_loadu_si128(reinterpret_cast<const __m128i*>(iv));
+        size_t pos = 0;
+        for ( ; pos + 64 <= len; pos += 64 ) {
+            __m128i *p = reinterpret_cast<__m128i*>(buff + pos);
+            __m128i c0 = _mm_loadu_si128(p);
+            __m128i c1 = _mm_loadu_si128(p + 1);
+            __m128i c2 = _mm_loadu_si128(p + 2);
+            __m128i c3 = _mm_loadu_si128(p + 3);
+            __m128i x0 = _mm_xor_si128(c0, keys[0]);
+            __m128i x1 = _mm_xor_si128(c1, keys[0]);
+            __m128i x2 = _mm_xor_si128(c2, keys[0]);
+            __m128i x3 = _mm_xor_si128(c3, keys[0]);
+            for ( int r = 1; r < 10; ++r ) {
+                x0 = _mm_aesdec_si128(x0, keys[r]);
+                x1 = _mm_aesdec_si128(x1, keys[r]);
+                x2 = _mm_aesdec_si128(x2, keys[r]);
+                x3 = _mm_aesdec_si128(x3, keys[r]);
+            }
+            x0 = _mm_aesdeclast_si128(x0, keys[10]);
+            x1 = _mm_aesdeclast_si128(x1, keys[10]);
+            x2 = _mm_aesdeclast_si128(x2, keys[10]);
+            x3 = _mm_aesdeclast_si128(x3, keys[10]);
+            _mm_storeu_si128(p,     _mm_xor_si128(x0, chain));
+            _mm_storeu_si128(p + 1, _mm_xor_si128(x1, c0));
+            _mm_storeu_si128(p + 2, _mm_xor_si128(x2, c1));
+            _mm_storeu_si128(p + 3, _mm_xor_si128(x3, c2));
+            chain = c3;
+        }
+        for ( ; pos + 16 <= len; pos += 16 ) {
+            __m128i *p = reinterpret_cast<__m128i*>(buff + pos);
+            __m128i c = _mm_loadu_si128(p);
+            __m128i x = _mm_xor_si128(c, keys[0]);
+            for ( int r = 1; r < 10; ++r )
+                x = _mm_aesdec_si128(x, keys[r]);
+            x = _mm_aesdeclast_si128(x, keys[10]);
+            _mm_storeu_si128(p, _mm_xor_si128(x, chain));
+            chain = c;
+        }
+    }
+
+protected:
+    BS_AESNI_TARGET
+    void expandKey(const uint8_t *key) {
+        __m128i encKeys[11];
+        __m128i decKeys[11];
+        encKeys[0] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(key));
+        encKeys[1] = AESNI_EXPAND(encKeys[0], 0x01);
+        encKeys[2] = AESNI_EXPAND(encKeys[1], 0x02);
+        encKeys[3] = AESNI_EXPAND(encKeys[2], 0x04);
+        encKeys[4] = AESNI_EXPAND(encKeys[3], 0x08);
+        encKeys[5] = AESNI_EXPAND(encKeys[4], 0x10);
+        encKeys[6] = AESNI_EXPAND(encKeys[5], 0x20);
+        encKeys[7] = AESNI_EXPAND(encKeys[6], 0x40);
+        encKeys[8] = AESNI_EXPAND(encKeys[7], 0x80);
+        encKeys[9] = AESNI_EXPAND(encKeys[8], 0x1b);
+        encKeys[10] = AESNI_EXPAND(encKeys[9], 0x36);
+
+        decKeys[0] = encKeys[10];
+        for ( int r = 1; r < 10; ++r )
+            decKeys[r] = _mm_aesimc_si128(encKeys[10 - r]);
+        decKeys[10] = encKeys[0];
+
+        for ( int r = 0; r < 11; ++r ) {
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mEncKeys + 16 * r), encKeys[r]);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(mDecKeys + 16 * r), decKeys[r]);
+        }
+    }
+
+private:
+    uint8_t     mEncKeys[11 * 16];
+    uint8_t     mDecKeys[11 * 16];
+};
+#endif
+
+
+// 工厂 =======================================================================
+BsAesCipher *BsAesCipher::create()
+{
+#ifdef BS_AESNI_BUILD
+    static const bool hasAesni = cpuHasAesni();
+    if ( hasAesni )
+        return new BsAesCipherNi();
+#endif
+    return new BsAesCipherTiny();
+}
+
+}
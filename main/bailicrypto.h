@@ -0,0 +1,35 @@
+#ifndef BAILICRYPTO_H
+#define BAILICRYPTO_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BailiSoft {
+
+// AES-128-CBC后端 ============================================================================
+// 运行时检测CPU，支持AES-NI指令则用硬件实现，否则回退third/tinyAES。
+// 均为原地加解密（buff长度须为16的整数倍），密钥扩展结果缓存，密钥不变时不重复计算。
+// 非线程安全，每个BsTerminator线程各持一个。
+class BsAesCipher
+{
+public:
+    static BsAesCipher *create();
+    virtual ~BsAesCipher() {}
+
+    virtual const char *backendName() const = 0;
+    void setKey(const uint8_t *key);
+    virtual void encryptCbc(const uint8_t *iv, uint8_t *buff, const size_t len) = 0;
+    virtual void decryptCbc(const uint8_t *iv, uint8_t *buff, const size_t len) = 0;
+
+protected:
+    BsAesCipher();
+    virtual void expandKey(const uint8_t *key) = 0;
+
+private:
+    uint8_t     mKey[16];
+    bool        mKeyReady;
+};
+
+}
+
+#endif // BAILICRYPTO_H
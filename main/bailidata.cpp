@@ -3,6 +3,7 @@
 #include "bailifunc.h"
 #include "bailigrid.h"
 #include "bailicustom.h"
+#include "bailistmt.h"
 #include "comm/pinyincode.h"
 #include "dialog/bsrefsheetdlg.h"
 
@@ -401,140 +402,209 @@ void BsSqlListModel::reload()
 namespace BailiSoft {
 
 BsRegModel::BsRegModel(const QString &table, const QStringList &fields)
-    : BsAbstractModel(nullptr), mTable(table), mFields(fields), mReloadEpochSecs(0)
+    : BsAbstractModel(nullptr), mTable(table), mFields(fields)
 {
-    mUseCode = QString(mFields.at(0)).toLower().contains("code");
-    mCargoSizeIdx = fields.indexOf(QStringLiteral("sizertype"));
-    mCargoColorIdx = fields.indexOf(QStringLiteral("colortype"));
-    mCargoNameIdx = fields.indexOf(QStringLiteral("hpname"));
-    mCargoSetPriceIdx = fields.indexOf(QStringLiteral("setprice"));
+    //货品下拉显示品名与标牌价
+    mCargoList = fields.indexOf(QStringLiteral("sizertype")) > 0 &&
+            fields.indexOf(QStringLiteral("colortype")) > 0 &&
+            fields.indexOf(QStringLiteral("setprice")) > 0;
+    mNameCol = -1;
+    mSetPriceCol = -1;
+    mAdminBossCol = -1;
+    mPriceDots = 0;
 }
 
 int BsRegModel::rowCount(const QModelIndex &parent) const
 {
     Q_UNUSED(parent)
-    return mRecIndex.count();
+    return mRows.count();
 }
 
-//注意：mRecords行内各fieldIndex与mFields偏移一位！前面少了主键字段（hpcode/kname），但后面加了pinyin列。注意别错位。
 QVariant BsRegModel::data(const QModelIndex &index, int role) const
 {
     if ( role == Qt::DisplayRole || role == Qt::EditRole ) {
+        int row = mRows.at(index.row());
         //popup show
         if ( role == Qt::DisplayRole ) {
             //cargo
-            if ( mCargoSizeIdx > 0 && mCargoColorIdx > 0 && mCargoSetPriceIdx > 0 ) {
-                QString key = mRecIndex.at(index.row());
-                QStringList vals = mRecords.value(key);
-                qint64 setPrice = QString(vals.at(mCargoSetPriceIdx - 1)).toLongLong();
-                return QStringLiteral("%1 %2 %3").arg(key).arg(vals.at(1 - 1)).arg(bsNumForRead(setPrice, mPriceDots));
+            if ( mCargoList && mNameCol > 0 && mSetPriceCol > 0 ) {
+                qint64 setPrice = mCatalog->textAt(row, mSetPriceCol).toLongLong();
+                return QStringLiteral("%1 %2 %3").arg(mCatalog->keyAt(row))
+                        .arg(mCatalog->textAt(row, mNameCol)).arg(bsNumForRead(setPrice, mPriceDots));
             }
             //staff, shop, customer, supplier, subject
             else {
-                return mRecIndex.at(index.row());
+                return mCatalog->keyAt(row);
             }
         }
         //pinyin
         else {
-            QString key = mRecIndex.at(index.row());
-            return mRecords.value(key).at(mFields.length() - 1);
+            return mCatalog->pinyinAt(row);
         }
     }
 
     return QVariant();
 }
 
+bool BsRegModel::keyExists(const QString &keyValue)
+{
+    int row = ( mCatalog ) ? mCatalog->rowOf(keyValue) : -1;
+    return row >= 0 && rowVisible(row);
+}
+
 void BsRegModel::switchBookLogin()
 {
-    mReloadEpochSecs = 0;
-    mRecords.clear();
-    mRecIndex.clear();
+    beginResetModel();
+    mCatalog.reset();
+    mRows.clear();
+    mModelRowOf.clear();
+    endResetModel();
+}
+
+//非老板登录不见老板专用科目
+bool BsRegModel::rowVisible(const int catalogRow) const
+{
+    return mAdminBossCol < 0 || loginAsBoss || mCatalog->textAt(catalogRow, mAdminBossCol).toInt() == 0;
 }
 
-//通过时间记录机制，保证每次只传输有变动的数据
-//注意：mRecords行内各fieldIndex与mFields偏移一位！前面少了主键字段（hpcode/kname），但后面加了pinyin列。注意别错位。
+//重建并发布登记目录快照（网络终端等随即共用），本模型只记可见行号
 void BsRegModel::reload()
 {
     mPriceDots = mapOption.value("dots_of_price").toInt();
+    BsCatalogPtr snap = BsCatalog::refresh(QSqlDatabase::database(), mTable);
 
-    //begin
     beginResetModel();
 
-    if ( mReloadEpochSecs > 0 ) {
-        mReloadEpochSecs = QDateTime::currentMSecsSinceEpoch() / 1000 - 60;
-    }
-
-    //数据
-    QStringList sels;
-    for (int i = 0, iLen = mFields.length(); i < iLen; ++i ) {
-        sels << mFields.at(i);
-    }
-    QString sql = QStringLiteral("SELECT %1 FROM %2").arg(sels.join(QChar(44))).arg(mTable);
-    QStringList limits;
-    if ( mTable == QStringLiteral("subject") && !loginAsBoss )
-        limits << QStringLiteral("adminboss=0");
-    if ( mReloadEpochSecs > 0 )
-        limits << QStringLiteral("uptime>%1;").arg(mReloadEpochSecs);
-    if ( limits.length() > 0 )
-        sql += QStringLiteral(" WHERE %1").arg(limits.join(QStringLiteral(" and ")));
-    sql += QChar(';');
-
-    QSqlQuery qry;
-    qry.setForwardOnly(true);
-    qry.setNumericalPrecisionPolicy(QSql::LowPrecisionInt64);
-    qry.exec(sql);
-    if ( qry.lastError().isValid() ) qDebug() << qry.lastError().text() << "\n" << sql;
-    while ( qry.next() ) {
-        QString recKey = qry.value(0).toString().trimmed();
-        QStringList vals;
-        for (int i = 1, iLen = mFields.length(); i < iLen; ++i ) {
-            vals << qry.value(i).toString().trimmed();
-        }
-        QString pinyin = (mUseCode)
-                ? (QChar(32) + recKey + LxSoft::ChineseConvertor::GetFirstLetter(qry.value(1).toString()))
-                : (QChar(32) + LxSoft::ChineseConvertor::GetFirstLetter(recKey));
-        vals << pinyin;
-        mRecords.insert(recKey, vals);
-
-        if ( mRecIndex.indexOf(recKey) < 0 ) {
-            mRecIndex << recKey;
+    mCatalog = snap;
+    mNameCol = snap->colOf(QStringLiteral("hpname"));
+    mSetPriceCol = snap->colOf(QStringLiteral("setprice"));
+    mAdminBossCol = ( mTable == QStringLiteral("subject") ) ? snap->colOf(QStringLiteral("adminboss")) : -1;
+
+    const QVector<int> &sorted = snap->sortedRows();
+    mRows.clear();
+    mRows.reserve(sorted.length());
+    mModelRowOf.fill(-1, snap->rowCount());
+    for ( int i = 0, iLen = sorted.length(); i < iLen; ++i ) {
+        if ( rowVisible(sorted.at(i)) ) {
+            mModelRowOf[sorted.at(i)] = mRows.length();
+            mRows << sorted.at(i);
         }
     }
-    qry.finish();
 
-    //重新排序，重建
-    std::sort(mRecIndex.begin(), mRecIndex.end());
-
-    //end
     endResetModel();
 }
 
 QString BsRegModel::getValue(const QString &keyValue, const QString &fldName)
 {
-    QStringList vals = mRecords.value(keyValue);
-    if ( vals.length() == mFields.length() ) {
-        int fldIdx = mFields.indexOf(fldName);
-        if ( fldIdx > 0 ) {
-            return vals.at(fldIdx - 1);
-        }
-    }
+    if ( mFields.indexOf(fldName) > 0 && keyExists(keyValue) )
+        return mCatalog->value(keyValue, fldName);
     return QString();
 }
 
 QString BsRegModel::getCargoBasicInfo(const QString &keyValue)
 {
-    if ( mCargoNameIdx > 0 && mCargoSetPriceIdx > 0 ) {
-        QStringList vals = mRecords.value(keyValue);
-        if ( vals.isEmpty() )
+    if ( mNameCol > 0 && mSetPriceCol > 0 ) {
+        int row = ( mCatalog ) ? mCatalog->rowOf(keyValue) : -1;
+        if ( row < 0 )
             return QString();
-        Q_ASSERT(vals.length() > mCargoNameIdx - 1);
-        Q_ASSERT(vals.length() > mCargoSetPriceIdx - 1);
-        qint64 setPrice = QString(vals.at(mCargoSetPriceIdx - 1)).toLongLong();
-        return vals.at(mCargoNameIdx - 1) + QChar(32) + bsNumForRead(setPrice, mPriceDots);
+        qint64 setPrice = mCatalog->textAt(row, mSetPriceCol).toLongLong();
+        return mCatalog->textAt(row, mNameCol) + QChar(32) + bsNumForRead(setPrice, mPriceDots);
     }
     return QString();
 }
 
+QVector<int> BsRegModel::search(const QString &term, const QVector<int> *within, bool *truncated) const
+{
+    if ( truncated ) *truncated = false;
+    if ( !mCatalog )
+        return QVector<int>();
+
+    //不可见行（权限等）在截断前剔除
+    const BsSearchIndex &index = mCatalog->searchIndex();
+    BsSearchFilter visible = [this](const int row) { return mModelRowOf.value(row, -1) >= 0; };
+    QVector<int> found;
+    if ( within ) {
+        QVector<int> rows;
+        rows.reserve(within->length());
+        for ( int i = 0, iLen = within->length(); i < iLen; ++i ) {
+            rows << mRows.at(within->at(i));
+        }
+        found = index.refine(rows, term, SEARCH_DEFAULT_LIMIT, truncated, visible);
+    }
+    else {
+        found = index.search(term, SEARCH_DEFAULT_LIMIT, truncated, visible);
+    }
+
+    QVector<int> hits;
+    hits.reserve(found.length());
+    for ( int i = 0, iLen = found.length(); i < iLen; ++i ) {
+        hits << mModelRowOf.at(found.at(i));
+    }
+    return hits;
+}
+
+
+}
+
+
+// BsRegHitModel
+namespace BailiSoft {
+
+BsRegHitModel::BsRegHitModel(QObject *parent, BsRegModel *source)
+    : QAbstractTableModel(parent), mpSource(source), mTruncated(false)
+{
+    connect(mpSource, &QAbstractItemModel::modelAboutToBeReset, this, &BsRegHitModel::beginResetModel);
+    connect(mpSource, &QAbstractItemModel::modelReset, this, &BsRegHitModel::sourceReset);
+}
+
+int BsRegHitModel::rowCount(const QModelIndex &parent) const
+{
+    Q_UNUSED(parent)
+    return ( mTerm.isEmpty() ) ? mpSource->rowCount() : mHits.length();
+}
+
+QVariant BsRegHitModel::data(const QModelIndex &index, int role) const
+{
+    if ( !index.isValid() || index.row() >= rowCount() )
+        return QVariant();
+    int row = ( mTerm.isEmpty() ) ? index.row() : mHits.at(index.row());
+    return mpSource->data(mpSource->index(row, 0), role);
+}
+
+void BsRegHitModel::setTerm(const QString &term)
+{
+    QString newTerm = term.trimmed();
+    if ( newTerm == mTerm )
+        return;
+
+    bool incremental = !mTerm.isEmpty() && !mTruncated && newTerm.startsWith(mTerm, Qt::CaseInsensitive);
+    beginResetModel();
+    mTerm = newTerm;
+    research(incremental);
+    endResetModel();
+}
+
+//源模型重载后行号已变，须全查
+void BsRegHitModel::sourceReset()
+{
+    research(false);
+    endResetModel();
+}
+
+void BsRegHitModel::research(const bool incremental)
+{
+    if ( mTerm.isEmpty() ) {
+        mHits.clear();
+        mTruncated = false;
+    }
+    else if ( incremental ) {
+        QVector<int> prev = mHits;
+        mHits = mpSource->search(mTerm, &prev, &mTruncated);
+    }
+    else {
+        mHits = mpSource->search(mTerm, nullptr, &mTruncated);
+    }
+}
 
 }
 
@@ -600,11 +670,10 @@ void BsSqlModel::reload()
         }
         QString pinyin = (QChar(32) + LxSoft::ChineseConvertor::GetFirstLetter(recKey));
         vals << pinyin;
-        mRecords.insert(recKey, vals);
-
-        if ( mRecIndex.indexOf(recKey) < 0 ) {
+        if ( !mRecords.contains(recKey) ) {
             mRecIndex << recKey;
         }
+        mRecords.insert(recKey, vals);
     }
     qry.finish();
 
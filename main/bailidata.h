@@ -5,6 +5,7 @@
 #include <QObject>
 #include <QtWidgets>
 #include <QtSql>
+#include "bailicatalog.h"
 
 
 // BsAbstractModel
@@ -139,7 +140,7 @@ public:
     QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
 
     void reload();
-    bool keyExists(const QString &keyValue) { return mRecords.contains(keyValue); }
+    bool keyExists(const QString &keyValue);
 
     void switchBookLogin();
     QString getTableName() { return mTable; }
@@ -147,22 +148,57 @@ public:
     QString getValue(const QString &keyValue, const QString &fldName);
     QString getCargoBasicInfo(const QString &keyValue);
 
+    //经快照查找索引取本模型行号，within非空时只在其中续查
+    QVector<int> search(const QString &term, const QVector<int> *within = nullptr, bool *truncated = nullptr) const;
+
 private:
-    bool        mUseCode;
-    int         mCargoSizeIdx;
-    int         mCargoColorIdx;
-    int         mCargoNameIdx;
-    int         mCargoSetPriceIdx;
+    bool rowVisible(const int catalogRow) const;
 
+    bool        mCargoList;
+    int         mNameCol;
+    int         mSetPriceCol;
+    int         mAdminBossCol;
 
     QString                     mTable;
     QStringList                 mFields;
     int                         mPriceDots;
 
-    QMap<QString, QStringList>  mRecords;
-    QStringList                 mRecIndex;
+    BsCatalogPtr                mCatalog;       //登记目录快照，见BsCatalog
+    QVector<int>                mRows;          //可见行在快照中的行号，已按主键排序
+    QVector<int>                mModelRowOf;    //快照行号对应本模型行号，不可见为-1
+};
+
+}
+
+
+// BsRegHitModel
+namespace BailiSoft {
+
+// 登记下拉命中集 ==========================================================================
+// 大目录下拉不再由QCompleter逐行匹配拼音列，而由本模型按输入经查找索引取排好序的命中行，
+// 输入在上次基础上追加且上次未截断时只在上次命中内续查。取值全部转交源模型，输入为空时即全表。
+class BsRegHitModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    BsRegHitModel(QObject *parent, BsRegModel *source);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const { Q_UNUSED(parent) return 1; }
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+
+public slots:
+    void setTerm(const QString &term);
+
+private slots:
+    void sourceReset();
+
+private:
+    void research(const bool incremental);
 
-    qint64               mReloadEpochSecs;
+    BsRegModel          *mpSource;
+    QString             mTerm;
+    QVector<int>        mHits;          //源模型行号
+    bool                mTruncated;
 };
 
 }
@@ -53,7 +53,7 @@ namespace BailiSoft {
 
 BsFldEditor::BsFldEditor(QWidget *parent, BsField* field, BsAbstractModel *pickModel)
     : QLineEdit(parent), mpField(field), mpModel(pickModel),
-      mpView(nullptr), mpCompleter(nullptr), mpCalendar(nullptr)
+      mpView(nullptr), mpCompleter(nullptr), mpHitModel(nullptr), mpCalendar(nullptr)
 {
     uint df = field->mFlags;
 
@@ -104,8 +104,18 @@ BsFldEditor::BsFldEditor(QWidget *parent, BsField* field, BsAbstractModel *pickM
         mpView = new QTableView(this);
         bool useCodee = field->mFldName == QStringLiteral("cargo") || field->mFldName == QStringLiteral("subject");
         mpCompleter = new BsCompleter(this, useCodee);
-        mpCompleter->setModel(pickModel);
-        mpCompleter->setFilterMode(Qt::MatchContains);
+        BsRegModel *regModel = qobject_cast<BsRegModel*>(pickModel);
+        if ( regModel ) {
+            //textEdited先于QLineEdit内部complete()发出，命中集已就绪
+            mpHitModel = new BsRegHitModel(this, regModel);
+            mpCompleter->setModel(mpHitModel);
+            mpCompleter->setCompletionMode(QCompleter::UnfilteredPopupCompletion);
+            connect(this, &QLineEdit::textEdited, mpHitModel, &BsRegHitModel::setTerm);
+        }
+        else {
+            mpCompleter->setModel(pickModel);
+            mpCompleter->setFilterMode(Qt::MatchContains);
+        }
         mpCompleter->setCompletionColumn(0);
         mpCompleter->setCaseSensitivity(Qt::CaseInsensitive);
         mpCompleter->setWrapAround(false);
@@ -296,6 +306,8 @@ void BsFldEditor::checkShowAllPopList()
 {
     //去掉筛选并显示
     if ( mpCompleter ) {
+        if ( mpHitModel )
+            mpHitModel->setTerm(QString());
         mpCompleter->setCompletionPrefix(QString());
         mpCompleter->complete();
     }
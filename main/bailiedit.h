@@ -9,6 +9,7 @@
 namespace BailiSoft {
 class BsField;
 class BsAbstractModel;
+class BsRegHitModel;
 }
 
 
@@ -78,6 +79,7 @@ protected:
     BsAbstractModel     *mpModel;
     QTableView          *mpView;
     BsCompleter         *mpCompleter;
+    BsRegHitModel       *mpHitModel;        //登记下拉经查找索引取命中行
     QCalendarWidget     *mpCalendar;
 
 private slots:
@@ -0,0 +1,56 @@
+#include "bailiflight.h"
+
+namespace BailiSoft {
+
+QMutex BsSingleFlight::mutex;
+BsSingleFlight* BsSingleFlight::instance = nullptr;
+
+bool BsSingleFlight::join(const QString &key, QString *result)
+{
+    BsSingleFlight& inst = BsSingleFlight::getInstance();
+    QMutexLocker locker(&mutex);
+
+    //首个到达者登记执行
+    QSharedPointer<Flight> flight = inst.mFlights.value(key);
+    if ( flight.isNull() ) {
+        inst.mFlights.insert(key, QSharedPointer<Flight>(new Flight()));
+        return false;
+    }
+
+    //等待执行者完成（执行者finish时已从表中移除，这里持有共享指针仍可取结果）
+    flight->waiters++;
+    while ( !flight->done ) {
+        inst.mDone.wait(&mutex);
+    }
+    *result = flight->result;
+    return true;
+}
+
+void BsSingleFlight::finish(const QString &key, const QString &result)
+{
+    BsSingleFlight& inst = BsSingleFlight::getInstance();
+    QMutexLocker locker(&mutex);
+
+    QSharedPointer<Flight> flight = inst.mFlights.take(key);
+    if ( flight.isNull() ) {
+        return;
+    }
+    flight->done = true;
+    if ( flight->waiters > 0 ) {
+        flight->result = result;
+        inst.mDone.wakeAll();
+    }
+}
+
+BsSingleFlight &BsSingleFlight::getInstance()
+{
+    if (nullptr == instance) {
+        QMutexLocker locker(&mutex);
+        if (nullptr == instance) {
+            instance = new BsSingleFlight();
+        }
+    }
+    return *instance;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef BAILIFLIGHT_H
+#define BAILIFLIGHT_H
+
+#include <QtCore>
+
+namespace BailiSoft {
+
+// 同请求合并单例 ============================================================================
+// 多个前端同时发出相同查询（同请求类型、同参数、同权限指纹）时，只由最先到达的线程执行，
+// 其余线程等待并共享其结果。只合并正在执行中的请求，不缓存已完成结果。
+class BsSingleFlight
+{
+public:
+    //返回true表示已有相同请求在执行，已等到其结果存于*result；返回false表示本线程为执行者，完成后须调用finish()
+    static bool join(const QString &key, QString *result);
+    static void finish(const QString &key, const QString &result);
+
+private:
+    static BsSingleFlight& getInstance();
+
+    struct Flight {
+        QString         result;
+        bool            done = false;
+        int             waiters = 0;
+    };
+
+    QHash<QString, QSharedPointer<Flight> >     mFlights;
+    QWaitCondition                              mDone;
+
+    static QMutex                   mutex;
+    static BsSingleFlight *         instance;
+};
+
+}
+
+#endif // BAILIFLIGHT_H
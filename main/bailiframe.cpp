@@ -0,0 +1,83 @@
+#include "bailiframe.h"
+#include <climits>
+
+#define FRAME_RESERVE_MAX       (16 * 1024 * 1024)      //长度头只是声称，超过此值不预先分配，随到随扩
+
+namespace BailiSoft {
+
+// 网络帧 =======================================================================
+bool BsFrame::startsWith(const char *prefix) const
+{
+    int len = int(qstrlen(prefix));
+    return len <= mLength && memcmp(constData(), prefix, size_t(len)) == 0;
+}
+
+QByteArray BsFrame::view(const int pos, const int len) const
+{
+    if ( pos >= mLength )
+        return QByteArray();
+    int viewLen = ( len < 0 || pos + len > mLength ) ? mLength - pos : len;
+    return QByteArray::fromRawData(constData() + pos, viewLen);
+}
+
+QByteArray BsFrame::copy(const int pos, const int len) const
+{
+    if ( pos >= mLength )
+        return QByteArray();
+    int copyLen = ( len < 0 || pos + len > mLength ) ? mLength - pos : len;
+    return QByteArray(constData() + pos, copyLen);
+}
+
+
+// 增量帧解析器 =======================================================================
+void BsFrameDecoder::append(const QByteArray &data)
+{
+    //缓存已取空，直接接管新数据（隐式共享，不复制）
+    if ( mPos >= mBuffer.length() ) {
+        mBuffer = data;
+        mPos = 0;
+        return;
+    }
+
+    //残留不完整帧移到开头。此时缓存可能仍被已取出的帧共享，mid()生成独立新缓存，不影响那些帧。
+    if ( mPos > 0 ) {
+        mBuffer = mBuffer.mid(mPos);
+        mPos = 0;
+    }
+
+    //已知帧长时一次预留，避免大帧分多次到达时反复扩容
+    if ( mBuffer.length() >= 4 ) {
+        int frameLen = qFromBigEndian<qint32>(mBuffer.constData());
+        if ( frameLen > 0 && frameLen <= FRAME_RESERVE_MAX && mBuffer.capacity() < frameLen + 4 )
+            mBuffer.reserve(frameLen + 4);
+    }
+    mBuffer.append(data);
+}
+
+bool BsFrameDecoder::takeFrame(BsFrame *frame)
+{
+    int available = mBuffer.length() - mPos;
+    if ( mCorrupt || available < 4 )
+        return false;
+
+    int frameLen = qFromBigEndian<qint32>(mBuffer.constData() + mPos);
+    if ( frameLen < 0 || frameLen > INT_MAX - 4 ) {
+        mCorrupt = true;
+        return false;
+    }
+    if ( available < frameLen + 4 )
+        return false;
+
+    *frame = BsFrame(mBuffer, mPos + 4, frameLen);
+    mPos += frameLen + 4;
+    return true;
+}
+
+void BsFrameDecoder::clear()
+{
+    mBuffer.clear();
+    mPos = 0;
+    mCorrupt = false;
+}
+
+}
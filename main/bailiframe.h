@@ -0,0 +1,56 @@
+#ifndef BAILIFRAME_H
+#define BAILIFRAME_H
+
+#include <QtCore>
+
+namespace BailiSoft {
+
+// 网络帧（共享接收缓存中的一段，不复制数据）=================================================
+// 持有接收缓存的隐式共享引用，因此只要BsFrame对象存在，view()返回的只读视图就有效。
+class BsFrame
+{
+public:
+    BsFrame() : mOffset(0), mLength(0) {}
+    BsFrame(const QByteArray &buffer, const int offset, const int length)
+        : mBuffer(buffer), mOffset(offset), mLength(length) {}
+
+    bool isEmpty() const { return mLength <= 0; }
+    int length() const { return mLength; }
+    const char *constData() const { return mBuffer.constData() + mOffset; }
+    bool startsWith(const char *prefix) const;
+
+    //只读视图（QByteArray::fromRawData），生命期不得超过本BsFrame对象
+    QByteArray view(const int pos = 0, const int len = -1) const;
+
+    //深拷贝，用于需要长期保存的场合
+    QByteArray copy(const int pos = 0, const int len = -1) const;
+
+private:
+    QByteArray  mBuffer;
+    int         mOffset;
+    int         mLength;
+};
+
+
+// 增量帧解析器（4字节大端长度头 + 数据）====================================================
+// 以读位置推进代替每帧mid()重建剩余缓存，一次收到多帧时整体线性；已取出的帧与缓存共享内存。
+// 仅当缓存尾部残留不完整帧时才把残段移到新缓存开头。
+class BsFrameDecoder
+{
+public:
+    BsFrameDecoder() {}
+
+    void append(const QByteArray &data);
+    bool takeFrame(BsFrame *frame);     //无完整帧返回false
+    bool isCorrupt() const { return mCorrupt; }
+    void clear();
+
+private:
+    QByteArray  mBuffer;
+    int         mPos = 0;
+    bool        mCorrupt = false;
+};
+
+}
+
+#endif // BAILIFRAME_H
@@ -4,12 +4,14 @@
 #include "bailiedit.h"
 #include "bailicustom.h"
 #include "bailiwins.h"
+#include "bailicache.h"
 #include "comm/expresscalc.h"
 #include "comm/pinyincode.h"
 
 #include <QPrinter>
 #include <QPrinterInfo>
 #include <QPrintDialog>
+#include <algorithm>
 
 namespace BailiSoft {
 
@@ -32,6 +34,543 @@ void resetFieldDotsDefine(BsField *bsFld)
     }
 }
 
+//按查询字段名取消息定义新建列（fldCnameDefines为"字段\t显示名"补充定义）
+static BsField *newQueryField(const QString &fld, const QStringList &fldCnameDefines)
+{
+    QStringList defs = mapMsg.value(QStringLiteral("fld_%1").arg(fld)).split(QChar(9), QString::SkipEmptyParts);
+    Q_ASSERT(defs.count() > 4);
+
+    int fldLen = QString(defs.at(4)).toInt();
+    if ( fld == QStringLiteral("subject") ) fldLen = 100;
+
+    BsField *bsCol = new BsField(fld,
+                                 defs.at(0),
+                                 QString(defs.at(3)).toUInt(),
+                                 fldLen,
+                                 defs.at(2));
+
+    //补充cname
+    for ( int j = 0, jLen = fldCnameDefines.length(); j < jLen; ++j )
+    {
+        QStringList cndefs = QString(fldCnameDefines.at(j)).split(QChar(9), QString::SkipEmptyParts);
+        if ( cndefs.at(0) == bsCol->mFldName )
+        {
+            bsCol->mFldCnName = cndefs.at(1);
+            break;
+        }
+    }
+
+    resetFieldDotsDefine(bsCol);
+    return bsCol;
+}
+
+//查询语句FROM后的视图名分析出单据主表3字符名，用于取用户定义字段名
+static QString userFieldTableKey(const QString &sql)
+{
+    QString tblKey;
+    QString str = sql.toLower();
+    int iPos = str.indexOf(QStringLiteral(" from "));
+    str = str.mid(iPos + 6);
+    iPos = str.indexOf(QChar(32));
+    str = str.left(iPos);
+    if ( str.indexOf(QChar('_')) > 0 ) {
+        QStringList nameSecs = str.split(QChar('_'));
+        tblKey = nameSecs.at(1);
+        if ( tblKey.contains(QStringLiteral("cg")) )
+            tblKey = QStringLiteral("cgj");
+        if ( tblKey.contains(QStringLiteral("pf")) ||
+             tblKey.contains(QStringLiteral("xs")) ||
+             tblKey == QStringLiteral("stock")  )
+            tblKey = QStringLiteral("pff");
+    }
+    else
+        tblKey = str.trimmed();  //单据窗口查找打开表格的sql
+    return tblKey;
+}
+
+static void applyUserFieldNames(const QList<BsField*> &cols, const QString &tblKey)
+{
+    for ( int i = 0, iLen = cols.length(); i < iLen; ++i )
+    {
+        QString fldKey = cols.at(i)->mFldName;
+        QString defKey = QStringLiteral("%1_%2").arg(tblKey).arg(fldKey);
+        if ( mapFldUserSetName.contains(defKey) )
+            cols.at(i)->mFldCnName = mapFldUserSetName.value(defKey);
+    }
+}
+
+//列宽存取，BsGrid与BsQueryGrid共用。横排尺码列共用一个平均宽
+static void saveColumnWidths(const QTableView *view, const QList<BsField*> &cols, const QString &group)
+{
+    QSettings settings;
+    settings.beginGroup(BSR17ColumnWidth);
+    settings.beginGroup(group);
+
+    int sizerTotalWidth = 0;
+    int sizerCounts = 0;
+    for ( int i = 0, iLen = cols.length(); i < iLen; ++i ) {
+        QString colFld = cols.at(i)->mFldName;
+        uint colFlags = cols.at(i)->mFlags;
+        if ( (colFlags & bsffSizeUnit) == bsffSizeUnit ) {
+            sizerTotalWidth += view->columnWidth(i);
+            sizerCounts++;
+        }
+        else {
+            int w = ( (colFlags & bsffHideSys) == bsffHideSys ) ? -1 : view->columnWidth(i);
+            settings.setValue(colFld, w);
+        }
+    }
+    if ( sizerCounts > 0 )
+        settings.setValue("sz", sizerTotalWidth / sizerCounts);
+
+    settings.endGroup();
+    settings.endGroup();
+}
+
+static void loadColumnWidths(QTableView *view, const QList<BsField*> &cols, const QStringList &denyFields,
+                             const QString &group)
+{
+    QSettings settings;
+    settings.beginGroup(BSR17ColumnWidth);
+    settings.beginGroup(group);
+
+    for ( int i = 0, iLen = cols.length(); i < iLen; ++i ) {
+        QString colFld = cols.at(i)->mFldName;
+        uint colFlags = cols.at(i)->mFlags;
+        if ( (colFlags & bsffSizeUnit) == bsffSizeUnit ) {
+            int w = settings.value("sz").toInt();
+            if ( w > 0 )
+                view->setColumnWidth(i, w);
+            else
+                view->setColumnWidth(i, 40);
+        }
+        else {
+            int w = settings.value(colFld).toInt();
+            if ( w < 0 || denyFields.indexOf(colFld) >= 0 )
+                view->setColumnHidden(i, true);
+            else if ( w > 0 )
+                view->setColumnWidth(i, w);
+            else
+                view->setColumnWidth(i, 80);
+        }
+    }
+
+    settings.endGroup();
+    settings.endGroup();
+}
+
+//显示文本还原为SQL值（用于“核对”窗口的追加条件）
+static QString sqlValueOfDisplay(const QString &txt, const uint flags)
+{
+    //文本
+    if ( (flags & bsffText) == bsffText )
+    {
+        return QStringLiteral("'%1'").arg(txt);
+    }
+
+    //日期
+    if ( (flags & bsffDate) == bsffDate )
+    {
+        QDate day = QDate::fromString(txt, "yyyy-MM-dd");
+        QTime ztime = QTime(0, 0, 0, 0);
+        QDateTime dt = QDateTime(day, ztime);
+        return QString::number(dt.toMSecsSinceEpoch() / 1000);
+    }
+
+    //布尔
+    if ( (flags & bsffBool) == bsffBool )
+    {
+        return QString();   //没法还原。反正这个函数只是用于“核对”窗口的追加条件，没有用到bool型。
+    }
+    //小数
+    else if ( (flags & bsffNumeric) == bsffNumeric )
+    {
+        return bsNumForSave(txt.toDouble());
+    }
+
+    return txt;
+}
+
+//双击货号弹出货品图片
+static void showCargoImage(QWidget *view, const QString &cargo)
+{
+    QString imgFile = checkCargoImageFile(cargo);
+    if ( imgFile.isEmpty() ) {
+        QMessageBox::information(view, QString(), QStringLiteral("该货品暂无图片。"));
+        return;
+    }
+
+    QImage imgSrc(imgFile);
+    if ( imgSrc.height() > 300 ) {
+        imgSrc = imgSrc.scaled(QSize(300, 300), Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
+    }
+
+    QMdiArea* mdi = nullptr;
+    QObject* p = view->parent();
+    while ( p && !mdi) {
+        mdi = qobject_cast<QMdiArea*>(p);
+        if ( mdi ) break;
+        p = p->parent();
+    }
+
+    QLabel* lbl = new QLabel(mdi);
+    lbl->setPixmap(QPixmap::fromImage(imgSrc));
+    lbl->setWindowTitle(cargo);
+
+    if ( mdi ) {
+        QMdiSubWindow* sub = mdi->addSubWindow(lbl);
+        sub->setWindowFlags(sub->windowFlags()&~Qt::WindowMaximizeButtonHint&~Qt::WindowMinimizeButtonHint);
+    }
+    lbl->show();
+}
+
+// BsGridStore
+void BsGridStore::clear()
+{
+    mCols.clear();
+    mFields.clear();
+    mNotes.clear();
+    mRows = 0;
+}
+
+void BsGridStore::resetColumns(const QList<BsField*> &cols, const int rows)
+{
+    clear();
+    mRows = rows;
+    for ( int i = 0, iLen = cols.length(); i < iLen; ++i )
+        insertColumn(i, (cols.at(i)->mFlags & bsffText) == bsffText);
+}
+
+void BsGridStore::insertColumn(const int col, const bool isText)
+{
+    Column c;
+    c.text = isText;
+    if ( isText ) {
+        c.dict << QString();
+        c.dictIndex.insert(QString(), 0);
+        c.ids.fill(0, mRows);
+    } else {
+        c.ints.fill(0, mRows);
+    }
+    mCols.insert(col, c);
+}
+
+void BsGridStore::appendRow()
+{
+    for ( int i = 0, iLen = mCols.length(); i < iLen; ++i ) {
+        Column &c = mCols[i];
+        if ( c.text )
+            c.ids.append(0);
+        else
+            c.ints.append(0);
+    }
+    mRows++;
+}
+
+void BsGridStore::squeeze()
+{
+    for ( int i = 0, iLen = mCols.length(); i < iLen; ++i ) {
+        mCols[i].ints.squeeze();
+        mCols[i].ids.squeeze();
+    }
+}
+
+int BsGridStore::byteSize() const
+{
+    //字典文本另计每项串头与散列节点约48字节
+    qint64 bytes = 0;
+    for ( int i = 0, iLen = mCols.length(); i < iLen; ++i ) {
+        const Column &c = mCols.at(i);
+        bytes += 8 * c.ints.capacity() + 4 * c.ids.capacity();
+        for ( int j = 0, jLen = c.dict.length(); j < jLen; ++j )
+            bytes += 48 + 2 * c.dict.at(j).length();
+    }
+    QHashIterator<int, QString> it(mNotes);
+    while ( it.hasNext() ) {
+        it.next();
+        bytes += 48 + 2 * it.value().length();
+    }
+    return int(qMin(bytes, qint64(INT_MAX)));
+}
+
+void BsGridStore::setText(const int row, const int col, const QString &text)
+{
+    Column &c = mCols[col];
+    int id = c.dictIndex.value(text, -1);
+    if ( id < 0 ) {
+        id = c.dict.length();
+        c.dict << text;
+        c.dictIndex.insert(text, id);
+    }
+    c.ids[row] = id;
+}
+
+QVector<int> BsGridStore::sortedRows(const QVector<int> &rows, const int col, const Qt::SortOrder order) const
+{
+    QVector<int> sorted = rows;
+    const Column &c = mCols.at(col);
+    bool desc = ( order == Qt::DescendingOrder );
+
+    //文本列只对字典排一次得各序号位次，行间比位次
+    if ( c.text ) {
+        QVector<int> byText(c.dict.length());
+        for ( int i = 0, iLen = byText.length(); i < iLen; ++i )
+            byText[i] = i;
+        std::sort(byText.begin(), byText.end(), [&c](int a, int b) { return c.dict.at(a) < c.dict.at(b); });
+
+        QVector<int> rank(byText.length());
+        for ( int i = 0, iLen = byText.length(); i < iLen; ++i )
+            rank[byText.at(i)] = i;
+
+        std::stable_sort(sorted.begin(), sorted.end(), [&c, &rank, desc](int a, int b) {
+            int ra = rank.at(c.ids.at(a));
+            int rb = rank.at(c.ids.at(b));
+            return ( desc ) ? ra > rb : ra < rb;
+        });
+    }
+    else {
+        std::stable_sort(sorted.begin(), sorted.end(), [&c, desc](int a, int b) {
+            return ( desc ) ? c.ints.at(a) > c.ints.at(b) : c.ints.at(a) < c.ints.at(b);
+        });
+    }
+
+    return sorted;
+}
+
+
+// BsGridModel
+BsGridModel::BsGridModel(const QList<BsField*> *cols, QObject *parent)
+    : QAbstractTableModel(parent), mppCols(cols), mSizerPrevCol(-1), mChkTimeCol(-1), mQtyCol(-1),
+      mCheckIcon(QStringLiteral(":/icon/check.png")), mErrorIcon(QStringLiteral(":/icon/error.png"))
+{
+}
+
+int BsGridModel::rowCount(const QModelIndex &parent) const
+{
+    return ( parent.isValid() ) ? 0 : mRows.length();
+}
+
+int BsGridModel::columnCount(const QModelIndex &parent) const
+{
+    return ( parent.isValid() ) ? 0 : mStore.columnCount();
+}
+
+QString BsGridModel::displayText(const int storeRow, const int col) const
+{
+    if ( mStore.isText(col) )
+        return mStore.textAt(storeRow, col);
+    const BsField *fld = mppCols->at(col);
+    return BsGrid::getDisplayTextOfIntData(mStore.intAt(storeRow, col), fld->mFlags, fld->mLenDots);
+}
+
+QVariant BsGridModel::data(const QModelIndex &index, int role) const
+{
+    if ( !index.isValid() )
+        return QVariant();
+
+    int srow = mRows.at(index.row());
+    int col = index.column();
+    uint flags = mppCols->at(col)->mFlags;
+    bool badQty = ( col == mQtyCol && !mStore.noteAt(srow).isEmpty() );
+
+    switch ( role ) {
+    case Qt::DisplayRole:
+        return displayText(srow, col);
+
+    case Qt::TextAlignmentRole:
+        if ( (flags & bsffBool) == bsffBool )
+            return int(Qt::AlignCenter);
+        if ( (flags & bsffInt) == bsffInt && (flags & bsffDate) != bsffDate && (flags & bsffDateTime) != bsffDateTime )
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        return QVariant();
+
+    case Qt::DecorationRole:
+    {
+        //坏码标qty列，其次另设图标，否则首列标审核
+        if ( badQty )
+            return mErrorIcon;
+        QHash<quint64, QVariant>::const_iterator it = mDecorations.constFind((quint64(srow) << 16) | quint64(col));
+        if ( it != mDecorations.constEnd() )
+            return it.value();
+        if ( col == 0 && mChkTimeCol > 0 && mStore.intAt(srow, mChkTimeCol) != 0 )
+            return mCheckIcon;
+        return QVariant();
+    }
+
+    case Qt::ToolTipRole:
+        if ( badQty )
+            return mStore.noteAt(srow);
+        if ( (flags & bsffSizeUnit) == bsffSizeUnit && col - mSizerPrevCol - 1 < mSizerTitles.length() )
+            return mSizerTitles.at(col - mSizerPrevCol - 1);
+        return QVariant();
+
+    case Qt::UserRole + OFFSET_CELL_CHECK:
+        if ( badQty )
+            return int(bsccError);
+        return QVariant();
+    }
+
+    return QVariant();
+}
+
+QVariant BsGridModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if ( orientation != Qt::Horizontal || section < 0 || section >= mppCols->length() )
+        return QAbstractTableModel::headerData(section, orientation, role);
+
+    const BsField *fld = mppCols->at(section);
+    if ( role == Qt::DisplayRole )
+    {
+        int sizerIdx = section - mSizerPrevCol - 1;
+        if ( (fld->mFlags & bsffSizeUnit) == bsffSizeUnit && sizerIdx >= 0 && sizerIdx < mSizerTitles.length() )
+            return mSizerTitles.at(sizerIdx);
+        return fld->mFldCnName;
+    }
+
+    //列头颜色（如果有筛选显示红色）
+    if ( role == Qt::ForegroundRole )
+    {
+        uint ft = fld->mFilterType;
+        return QBrush((ft == bsftNone || ft == bsftContain) ? Qt::black : Qt::red);
+    }
+
+    return QVariant();
+}
+
+Qt::ItemFlags BsGridModel::flags(const QModelIndex &index) const
+{
+    if ( !index.isValid() )
+        return Qt::NoItemFlags;
+    return Qt::ItemIsSelectable | Qt::ItemIsEnabled;
+}
+
+void BsGridModel::sort(int column, Qt::SortOrder order)
+{
+    if ( column < 0 || column >= mStore.columnCount() || mOrder.isEmpty() )
+        return;
+
+    emit layoutAboutToBeChanged();
+
+    //当前行、选择等持久索引按store行跟到新位置
+    QModelIndexList oldIndexes = persistentIndexList();
+    QVector<int> oldStoreRows;
+    for ( int i = 0, iLen = oldIndexes.length(); i < iLen; ++i )
+        oldStoreRows << mRows.at(oldIndexes.at(i).row());
+
+    mOrder = mStore.sortedRows(mOrder, column, order);
+    rebuildRows();
+
+    QVector<int> rowOf(mStore.rowCount(), -1);
+    for ( int i = 0, iLen = mRows.length(); i < iLen; ++i )
+        rowOf[mRows.at(i)] = i;
+
+    QModelIndexList newIndexes;
+    for ( int i = 0, iLen = oldIndexes.length(); i < iLen; ++i )
+        newIndexes << index(rowOf.at(oldStoreRows.at(i)), oldIndexes.at(i).column());
+    changePersistentIndexList(oldIndexes, newIndexes);
+
+    emit layoutChanged();
+}
+
+void BsGridModel::resetStore(const BsGridStore &store, const int chkTimeCol, const int qtyCol,
+                             const int sizerPrevCol, const QStringList &sizerTitles)
+{
+    beginResetModel();
+    mStore = store;
+    mChkTimeCol = chkTimeCol;
+    mQtyCol = qtyCol;
+    mSizerPrevCol = sizerPrevCol;
+    mSizerTitles = sizerTitles;
+    mDecorations.clear();
+
+    int rows = mStore.rowCount();
+    mOrder.resize(rows);
+    for ( int r = 0; r < rows; ++r )
+        mOrder[r] = r;
+    mVisible.fill(true, rows);
+    mRows = mOrder;
+    endResetModel();
+}
+
+void BsGridModel::setVisible(const QBitArray &visible)
+{
+    beginResetModel();
+    mVisible = visible;
+    rebuildRows();
+    endResetModel();
+}
+
+void BsGridModel::rebuildRows()
+{
+    mRows.clear();
+    mRows.reserve(mOrder.length());
+    for ( int i = 0, iLen = mOrder.length(); i < iLen; ++i )
+    {
+        if ( mVisible.testBit(mOrder.at(i)) )
+            mRows << mOrder.at(i);
+    }
+}
+
+void BsGridModel::setStoreValue(const int row, const int col, const QString &text)
+{
+    //按显示文本还原原值存入
+    int srow = mRows.at(row);
+    uint flags = mppCols->at(col)->mFlags;
+    if ( mStore.isText(col) )
+        mStore.setText(srow, col, text);
+    else if ( (flags & bsffDate) == bsffDate || (flags & bsffDateTime) == bsffDateTime )
+        mStore.setInt(srow, col, QDateTime(QDate::fromString(text, "yyyy-MM-dd"), QTime(0, 0, 0, 0)).toMSecsSinceEpoch() / 1000);
+    else if ( (flags & bsffBool) == bsffBool )
+        mStore.setInt(srow, col, ( text.isEmpty() ) ? 0 : 1);
+    else if ( (flags & bsffNumeric) == bsffNumeric )
+        mStore.setInt(srow, col, bsNumForSave(text.toDouble()).toLongLong());
+    else
+        mStore.setInt(srow, col, text.toLongLong());
+
+    emit dataChanged(index(row, col), index(row, col));
+}
+
+void BsGridModel::setDecoration(const int row, const int col, const QIcon &icon)
+{
+    QVariant v = ( icon.isNull() ) ? QVariant() : QVariant(icon);
+    mDecorations.insert((quint64(mRows.at(row)) << 16) | quint64(col), v);
+    emit dataChanged(index(row, col), index(row, col), QVector<int>() << Qt::DecorationRole);
+}
+
+void BsGridModel::insertStoreColumn(const int col)
+{
+    beginInsertColumns(QModelIndex(), col, col);
+    mStore.insertColumn(col, (mppCols->at(col)->mFlags & bsffText) == bsffText);
+
+    //插入位置及以后的列号后移
+    if ( mChkTimeCol >= col ) mChkTimeCol++;
+    if ( mQtyCol >= col ) mQtyCol++;
+    if ( mSizerPrevCol >= col ) mSizerPrevCol++;
+    QHash<quint64, QVariant> shifted;
+    QHashIterator<quint64, QVariant> it(mDecorations);
+    while ( it.hasNext() ) {
+        it.next();
+        quint64 key = it.key();
+        shifted.insert(( int(key & 0xffff) >= col ) ? key + 1 : key, it.value());
+    }
+    mDecorations = shifted;
+    endInsertColumns();
+}
+
+void BsGridModel::setColumnInts(const int col, const QVector<qint64> &values)
+{
+    for ( int r = 0, rLen = values.length(); r < rLen; ++r )
+        mStore.setInt(r, col, values.at(r));
+    if ( !mRows.isEmpty() )
+        emit dataChanged(index(0, col), index(mRows.length() - 1, col));
+}
+
+void BsGridModel::updateHeaders()
+{
+    if ( mStore.columnCount() > 0 )
+        emit headerDataChanged(Qt::Horizontal, 0, mStore.columnCount() - 1);
+}
+
 // BsFilterSelector
 BsFilterSelector::BsFilterSelector(QWidget *parent) : QWidget(parent)
 {
@@ -92,9 +631,8 @@ void BsFilterSelector::cancelClicked()
 
 
 // BsHeader
-BsHeader::BsHeader(BsGrid *parent) : QHeaderView(Qt::Horizontal, parent)
+BsHeader::BsHeader(QTableView *parent) : QHeaderView(Qt::Horizontal, parent)
 {
-    mpGrid = parent;
     setSortIndicatorShown(true);
     setSectionsClickable(true);
     setStyleSheet("QHeaderView{border-style:none; border-bottom:1px solid silver;} ");
@@ -102,16 +640,17 @@ BsHeader::BsHeader(BsGrid *parent) : QHeaderView(Qt::Horizontal, parent)
 
 
 // BsFooter
-BsFooter::BsFooter(QWidget *parent, BsGrid *grid) : QTableWidget(parent)
+BsFooter::BsFooter(QWidget *parent, QTableView *view, const QList<BsField*> *cols) : QTableWidget(parent)
 {
-    mpGrid = grid;
+    mppView = view;
+    mppCols = cols;
     setRowCount(1);
     setEditTriggers(QAbstractItemView::NoEditTriggers);
     horizontalHeader()->hide();
     verticalHeader()->hide();
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
-    verticalHeader()->setDefaultSectionSize(mpGrid->getRowHeight());
+    verticalHeader()->setDefaultSectionSize(view->verticalHeader()->defaultSectionSize());
     setItemDelegate(new BsNoBorderDelegate(this));
     setStyleSheet(QStringLiteral("QTableWidget{border:none; font-weight:600;} QTableWidget::item{border:none; %1;}")
                   .arg(mapMsg.value("css_vertical_gradient")));
@@ -120,10 +659,10 @@ BsFooter::BsFooter(QWidget *parent, BsGrid *grid) : QTableWidget(parent)
 void BsFooter::initCols()
 {
     clear();
-    setColumnCount(mpGrid->mCols.count());
-    for ( int i = 0; i < mpGrid->mCols.count(); ++i )
+    setColumnCount(mppCols->count());
+    for ( int i = 0; i < mppCols->count(); ++i )
     {
-        uint flags = mpGrid->mCols.at(i)->mFlags;
+        uint flags = mppCols->at(i)->mFlags;
         QTableWidgetItem *it = new QTableWidgetItem();
 
         if ( (flags & bsffAggSum) == bsffAggSum )
@@ -135,7 +674,7 @@ void BsFooter::initCols()
         setColumnHidden(i, (flags & bsffHideSys));
     }
 
-    if ( mpGrid->mCols.count() > 1 )
+    if ( mppCols->count() > 1 )
     {
         item(0, 0)->setText(mapMsg.value("i_footer_sum"));
     }
@@ -143,19 +682,48 @@ void BsFooter::initCols()
 
 void BsFooter::hideAggText()
 {
-    for ( int i = 0; i < mpGrid->mCols.count(); ++i )
+    for ( int i = 0; i < mppCols->count(); ++i )
     {
         item(0, i)->setText(QString());
     }
 }
 
+void BsFooter::showAggs()
+{
+    for ( int j = 0, jLen = mppCols->count(); j < jLen; ++j )
+    {
+        BsField *bsCol = mppCols->at(j);
+        uint flags = bsCol->mFlags;
+        QString aggShow;
+        Qt::AlignmentFlag footAlign = Qt::AlignLeft;
+
+        if ( (flags & bsffAggCount) == bsffAggCount || (flags & bsffAggSum) == bsffAggSum )
+        {
+            if ( (flags & bsffAggCount) == bsffAggCount )
+            {
+                aggShow = QStringLiteral("<%1>").arg(bsCol->mCountSet.count());
+                footAlign = Qt::AlignCenter;
+            }
+
+            if ( (flags & bsffAggSum) == bsffAggSum )
+            {
+                aggShow = BsGrid::getDisplayTextOfIntData(bsCol->mAggValue, flags, bsCol->mLenDots);
+                footAlign = Qt::AlignRight;
+            }
+
+            item(0, j)->setText(aggShow);
+            item(0, j)->setTextAlignment(int(footAlign) | int(Qt::AlignVCenter));
+        }
+    }
+}
+
 void BsFooter::headerSectionResized(int logicalIndex, int oldSize, int newSize)
 {
     if ( newSize != oldSize )
     {
         int setSize = newSize;
         if ( logicalIndex == 0 )
-            setSize += mpGrid->verticalHeader()->width();
+            setSize += mppView->verticalHeader()->width();
         setColumnWidth(logicalIndex, setSize);
     }
 }
@@ -215,8 +783,9 @@ BsGrid::BsGrid(QWidget *parent, const bool forQry, const bool forReg)
 
     mpHeader = new BsHeader(this);
     setHorizontalHeader(mpHeader);
+    verticalHeader()->setDefaultSectionSize(mRowHeight);     //页脚行高随此
 
-    mpFooter = new BsFooter(horizontalScrollBar(), this);
+    mpFooter = new BsFooter(horizontalScrollBar(), this, &mCols);
     connect(mpHeader, SIGNAL(sectionResized(int,int,int)), mpFooter, SLOT(headerSectionResized(int,int,int)));
     connect(mpHeader, SIGNAL(sectionResized(int,int,int)), this, SLOT(updateFooterGeometry()));
 
@@ -234,7 +803,6 @@ BsGrid::BsGrid(QWidget *parent, const bool forQry, const bool forReg)
     mpRestoreCol    = mpMenu->addAction(mapMsg.value("menu_filter_restore_col"), this, SLOT(filterRestoreCol()));
     mpRestoreAll    = mpMenu->addAction(mapMsg.value("menu_filter_restore_all"), this, SLOT(filterRestoreAll()));
 
-    verticalHeader()->setDefaultSectionSize(mRowHeight);
     verticalHeader()->setStyleSheet("color:#999;");
     verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
 
@@ -328,17 +896,15 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
     mFiltering = false;
     mLoadSizerType = useSizerType;
 
-    //数据库执行
-    QSqlQuery qry;
-    qry.setNumericalPrecisionPolicy(QSql::LowPrecisionInt64);
-    qry.exec(sql);  //因为下面可能要遍历两边，所以不加setForwardOnly(true)
-    if ( qry.lastError().isValid() ) qDebug() << qry.lastError().text() << "\n" << sql;
+    //数据库执行（一次取全部行，下面可能要遍历两遍）。拣货表格经结果缓存，单据登记表格编辑频繁不缓存
+    BsCachedRowsPtr data = BsResultCache::selectRows(QSqlDatabase::database(), sql, QSql::LowPrecisionInt64,
+                                                     ( mForQuery ) ? QStringLiteral("rows") : QString());
+    const QStringList &sqlFlds = data->fields;
 
     //根据数据库字段设置列
-    QSqlRecord sqlRec = qry.record();
-    int sizerDataCol = sqlRec.indexOf(QStringLiteral("sizers"));
-    int chkTimeCol = sqlRec.indexOf(QStringLiteral("chktime"));
-    mSizerPrevCol = ( mForQuery ) ? sizerDataCol : sqlRec.indexOf(QStringLiteral("color"));
+    int sizerDataCol = sqlFlds.indexOf(QStringLiteral("sizers"));
+    int chkTimeCol = sqlFlds.indexOf(QStringLiteral("chktime"));
+    mSizerPrevCol = ( mForQuery ) ? sizerDataCol : sqlFlds.indexOf(QStringLiteral("color"));
     mSizerColCount = 0;
 
     //查询重建mCols
@@ -346,74 +912,13 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
     {
         qDeleteAll(mCols);
         mCols.clear();
-        for ( int i = 0, iLen = sqlRec.count(); i < iLen; ++i )
-        {
-            //new BsField()
-            QString fld = sqlRec.fieldName(i);
-            QStringList defs = mapMsg.value(QStringLiteral("fld_%1").arg(fld)).split(QChar(9), QString::SkipEmptyParts);
-            Q_ASSERT(defs.count() > 4);
-
-            int fldLen = QString(defs.at(4)).toInt();
-            if ( fld == QStringLiteral("subject") ) fldLen = 100;
-
-            BsField *bsCol = new BsField(fld,
-                                         defs.at(0),
-                                         QString(defs.at(3)).toUInt(),
-                                         fldLen,
-                                         defs.at(2));
-
-            //补充cname
-            for ( int j = 0, jLen = fldCnameDefines.length(); j < jLen; ++j )
-            {
-                QStringList cndefs = QString(fldCnameDefines.at(j)).split(QChar(9), QString::SkipEmptyParts);
-                if ( cndefs.at(0) == bsCol->mFldName )
-                {
-                    bsCol->mFldCnName = cndefs.at(1);
-                    break;
-                }
-            }
-
-            //加入mCols
-            resetFieldDotsDefine(bsCol);
-            mCols << bsCol;
-        }
+        for ( int i = 0, iLen = sqlFlds.length(); i < iLen; ++i )
+            mCols << newQueryField(sqlFlds.at(i), fldCnameDefines);
     }
 
-    //加载用户字段名与小数位额外定义
-    if ( mForQuery || !mForRegister ) {
-        //单据直接用
-        QString tblKey = mTable;
-
-        //查询需要分析
-        if ( mForQuery ) {
-            QString str = sql.toLower();
-            int iPos = str.indexOf(QStringLiteral(" from "));
-            str = str.mid(iPos + 6);
-            iPos = str.indexOf(QChar(32));
-            str = str.left(iPos);
-            if ( str.indexOf(QChar('_')) > 0 ) {
-                QStringList nameSecs = str.split(QChar('_'));
-                tblKey = nameSecs.at(1);
-                if ( tblKey.contains(QStringLiteral("cg")) )
-                    tblKey = QStringLiteral("cgj");
-                if ( tblKey.contains(QStringLiteral("pf")) ||
-                     tblKey.contains(QStringLiteral("xs")) ||
-                     tblKey == QStringLiteral("stock")  )
-                    tblKey = QStringLiteral("pff");
-            }
-            else
-                tblKey = str.trimmed();  //单据窗口查找打开表格的sql
-        }
-
-        //至此，tblKey应该是单据主表3字符名，可以使用取得用户定义字段了
-        for ( int i = 0, iLen = mCols.length(); i < iLen; ++i )
-        {
-            QString fldKey = mCols.at(i)->mFldName;
-            QString defKey = QStringLiteral("%1_%2").arg(tblKey).arg(fldKey);
-            if ( mapFldUserSetName.contains(defKey) )
-                mCols.at(i)->mFldCnName = mapFldUserSetName.value(defKey);
-        }
-    }
+    //加载用户字段名与小数位额外定义（单据直接用主表名，查询需要分析）
+    if ( mForQuery || !mForRegister )
+        applyUserFieldNames(mCols, ( mForQuery ) ? userFieldTableKey(sql) : mTable);
 
     //尺码横排预备处理
     QStringList sheetFirstRowSizeType;  //代表显示初始尺码列头
@@ -421,14 +926,14 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
     {
         QStringList regList = ( useSizerType.isEmpty() ) ? QStringList() : dsSizer->getSizerList(useSizerType);
         mSizerColCount = regList.length();
-        Q_ASSERT(sqlRec.indexOf(QStringLiteral("qty")) < sqlRec.indexOf(QStringLiteral("sizers")));
+        Q_ASSERT(sqlFlds.indexOf(QStringLiteral("qty")) < sqlFlds.indexOf(QStringLiteral("sizers")));
 
         if ( !mForQuery )
         {
             //单据中可能存在不同品类尺码，maxRegCols与maxBadCols都要重新比较取得最大。
-            while ( qry.next() )
+            for ( int r = 0, rLen = data->rows.length(); r < rLen; ++r )
             {
-                QString cargo = qry.value(0).toString();
+                QString cargo = data->rows.at(r).at(0).toString();
                 QString sizerType = dsCargo->getValue(cargo, QStringLiteral("sizertype"));
                 regList = dsSizer->getSizerList(sizerType);
                 if ( regList.length() > mSizerColCount )
@@ -436,8 +941,6 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
                 if ( sheetFirstRowSizeType.isEmpty() )
                     sheetFirstRowSizeType << regList;
             }
-            qry.first();
-            qry.previous();
 
             //单据重建列定义
             QList<BsField*> keepFlds;
@@ -475,20 +978,51 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
     }
 
     //填数据行
+    setRowCount(data->rows.length());
+    loadItemRows(*data, sizerDataCol, chkTimeCol, joinCargoPinyin);
+
+    //整理
+    updateAllColTitles();
+    mpFooter->initCols();
+
+    //更新合计及单据头
+    mpCorner->setText(QString());
+    if ( rowCount() > 0 )
+    {
+        //合计
+        updateFooterSumCount(false);
+
+        //单据尺码列头（跟随第一行）
+        if ( sizerDataCol > 0 && !mForQuery )
+        {
+            for ( int i = 0, iLen = sheetFirstRowSizeType.length(); i < iLen; ++i )
+                model()->setHeaderData(mSizerPrevCol + i + 1, Qt::Horizontal, sheetFirstRowSizeType.at(i), Qt::DisplayRole);
+        }
+    }
+
+    //恢复光标
+    qApp->restoreOverrideCursor();
+}
+
+void BsGrid::loadItemRows(const BsCachedRows &data, const int sizerDataCol, const int chkTimeCol,
+                          const bool joinCargoPinyin)
+{
+    const QStringList &sqlFlds = data.fields;
     int rows = 0;
-    while ( qry.next() )
+    for ( int r = 0, rLen = data.rows.length(); r < rLen; ++r )
     {
         //增行
-        setRowCount(++rows);
+        const QVariantList &vals = data.rows.at(r);
+        ++rows;
 
         //是否已审核行（仅用于单据窗口打开查找表格）
-        bool rowChecked = ( chkTimeCol > 0 && qry.value(chkTimeCol).toBool() );
+        bool rowChecked = ( chkTimeCol > 0 && vals.at(chkTimeCol).toBool() );
 
         //可能有的sizers字符串
         QString sizers;
 
         //逐列填值
-        for ( int i = 0, iLen = sqlRec.count(); i < iLen; ++i )
+        for ( int i = 0, iLen = sqlFlds.length(); i < iLen; ++i )
         {
             //对应表格列
             int idxCol = ( i <= mSizerPrevCol ) ? i : (i + mSizerColCount);
@@ -500,7 +1034,7 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
             //文本字段
             if ( (flags & bsffText) == bsffText )
             {
-                QString strV = qry.value(i).toString();
+                QString strV = vals.at(i).toString();
                 if ( i == sizerDataCol )
                 {
                     if ( mForQuery ) {
@@ -512,14 +1046,14 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
 
                 //约定joinCargoPinyin的表格第一列货号，第二列品名，不可违反！见BsSheetCargoWin::loadPickStock的sql语句
                 if ( joinCargoPinyin && i == 0 ) {
-                    QString pinyin = strV + LxSoft::ChineseConvertor::GetFirstLetter(qry.value(1).toString());
+                    QString pinyin = strV + LxSoft::ChineseConvertor::GetFirstLetter(vals.at(1).toString());
                     it->setData(Qt::UserRole, pinyin);
                 }
             }
             //数值字段
             else if ( (flags & bsffInt) == bsffInt )
             {
-                qint64 intv = qry.value(i).toLongLong();
+                qint64 intv = vals.at(i).toLongLong();
                 QString txt = getDisplayTextOfIntData(intv, flags, mCols.at(idxCol)->mLenDots);
 
                 if ( (flags & bsffDate) == bsffDate || (flags & bsffDateTime) == bsffDateTime ) {
@@ -574,91 +1108,20 @@ void BsGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, co
         //横排尺码另外处理
         if ( sizerDataCol > 0 )
         {
-            int recQtyColIdx = getColumnIndexByFieldName(QStringLiteral("qty"));   //不能用sqlRec.indexOf()，因为有bsffSizeUnit插入
-            setSizerHCellsFromText(rows - 1, recQtyColIdx, sizers, useSizerType);
-        }
-    }
-    qry.finish();
-
-    //整理
-    updateAllColTitles();
-    mpFooter->initCols();
-
-    //更新合计及单据头
-    mpCorner->setText(QString());
-    if ( rowCount() > 0 )
-    {
-        //合计
-        updateFooterSumCount(false);
-
-        //单据尺码列头（跟随第一行）
-        if ( sizerDataCol > 0 && !mForQuery )
-        {
-            for ( int i = 0, iLen = sheetFirstRowSizeType.length(); i < iLen; ++i )
-                model()->setHeaderData(mSizerPrevCol + i + 1, Qt::Horizontal, sheetFirstRowSizeType.at(i), Qt::DisplayRole);
+            int recQtyColIdx = getColumnIndexByFieldName(QStringLiteral("qty"));   //不能用sqlFlds.indexOf()，因为有bsffSizeUnit插入
+            setSizerHCellsFromText(rows - 1, recQtyColIdx, sizers, mLoadSizerType);
         }
     }
-
-    //恢复光标
-    qApp->restoreOverrideCursor();
 }
 
 void BsGrid::saveColWidths(const QString &sub)
 {
-    QSettings settings;
-    settings.beginGroup(BSR17ColumnWidth);
-    settings.beginGroup(mTable + sub);
-
-    int sizerTotalWidth = 0;
-    int sizerCounts = 0;
-    for ( int i = 0, iLen = mCols.length(); i < iLen; ++i ) {
-        QString colFld = mCols.at(i)->mFldName;
-        uint colFlags = mCols.at(i)->mFlags;
-        if ( (colFlags & bsffSizeUnit) == bsffSizeUnit ) {
-            sizerTotalWidth += columnWidth(i);
-            sizerCounts++;
-        }
-        else {
-            int w = ( (colFlags & bsffHideSys) == bsffHideSys ) ? -1 : columnWidth(i);
-            settings.setValue(colFld, w);
-        }
-    }
-    if ( sizerCounts > 0 )
-        settings.setValue("sz", sizerTotalWidth / sizerCounts);
-
-    settings.endGroup();
-    settings.endGroup();
+    saveColumnWidths(this, mCols, mTable + sub);
 }
 
 void BsGrid::loadColWidths(const QString &sub)
 {
-    QSettings settings;
-    settings.beginGroup(BSR17ColumnWidth);
-    settings.beginGroup(mTable + sub);
-
-    for ( int i = 0, iLen = mCols.length(); i < iLen; ++i ) {
-        QString colFld = mCols.at(i)->mFldName;
-        uint colFlags = mCols.at(i)->mFlags;
-        if ( (colFlags & bsffSizeUnit) == bsffSizeUnit ) {
-            int w = settings.value("sz").toInt();
-            if ( w > 0 )
-                setColumnWidth(i, w);
-            else
-                setColumnWidth(i, 40);
-        }
-        else {
-            int w = settings.value(colFld).toInt();
-            if ( w < 0 || mDenyFields.indexOf(colFld) >= 0 )
-                setColumnHidden(i, true);
-            else if ( w > 0 )
-                setColumnWidth(i, w);
-            else
-                setColumnWidth(i, 80);
-        }
-    }
-
-    settings.endGroup();
-    settings.endGroup();
+    loadColumnWidths(this, mCols, mDenyFields, mTable + sub);
 }
 
 void BsGrid::updateColTitleSetting()
@@ -880,39 +1343,7 @@ QString BsGrid::getDisplayTextOfIntData(const qint64 intV, const uint flags, con
 
 QString BsGrid::getSqlValueFromDisplay(const int row, const int col)
 {
-    //表格值
-    QString txt = item(row, col)->text();
-
-    //字段特性
-    uint flags = mCols.at(col)->mFlags;
-
-    //文本
-    if ( (flags & bsffText) == bsffText )
-    {
-        return QStringLiteral("'%1'").arg(txt);
-    }
-
-    //日期
-    if ( (flags & bsffDate) == bsffDate )
-    {
-        QDate day = QDate::fromString(txt, "yyyy-MM-dd");
-        QTime ztime = QTime(0, 0, 0, 0);
-        QDateTime dt = QDateTime(day, ztime);
-        return QString::number(dt.toMSecsSinceEpoch() / 1000);
-    }
-
-    //布尔
-    if ( (flags & bsffBool) == bsffBool )
-    {
-        return QString();   //没法还原。反正这个函数只是用于“核对”窗口的追加条件，没有用到bool型。
-    }
-    //小数
-    else if ( (flags & bsffNumeric) == bsffNumeric )
-    {
-        return bsNumForSave(txt.toDouble());
-    }
-
-    return txt;
+    return sqlValueOfDisplay(cellText(row, col), mCols.at(col)->mFlags);
 }
 
 void BsGrid::setRowHeight(const int height)
@@ -1052,6 +1483,52 @@ void BsGrid::updateFooterSumCount(const bool checkFilter)
     }
 
     //逐行判断并统计
+    updateItemSumCount(checkFilter, &visibleRows);
+
+    //显示统计值
+    mpFooter->showAggs();
+    for ( int j = 0, jLen = mCols.length(); j < jLen; ++j )
+    {
+        //列头颜色（如果有筛选显示红色）
+        uint ft = mCols.at(j)->mFilterType;
+        QColor titleColor = (ft == bsftNone || ft == bsftContain) ? Qt::black : Qt::red;
+        model()->setHeaderData(j, Qt::Horizontal, QBrush(titleColor), Qt::ForegroundRole);
+
+        //单据需要知道合计金额
+        if ( !mForQuery && !checkFilter && mCols.at(j)->mFldName == QStringLiteral("actmoney") )
+            emit sheetSumMoneyChanged(mpFooter->item(0, j)->text());
+    }
+
+    updateFooterColWidths();
+
+    //筛选信号
+    if ( checkFilter )
+    {
+        if ( filterColCounts > 0 )
+        {
+            mFiltering = true;
+            setStyleSheet(mapMsg.value("css_grid_filtering"));
+            emit filterDone();
+        }
+
+        if ( filterColCounts == 0 )
+        {
+            mFiltering = false;
+            setStyleSheet(mapMsg.value("css_grid_readonly"));
+            emit filterEmpty();
+        }
+    }
+
+    //角标总行数及精确位置更新
+    mpCorner->setText(QString::number(visibleRows));
+    QTimer::singleShot(100, this, SLOT(adjustCornerPosition()));
+
+    //恢复光标
+    qApp->restoreOverrideCursor();
+}
+
+void BsGrid::updateItemSumCount(const bool checkFilter, int *visibleRows)
+{
     for ( int i = 0, iLen = rowCount(); i < iLen; ++i )
     {
         //可见性值最宽松开始
@@ -1129,76 +1606,31 @@ void BsGrid::updateFooterSumCount(const bool checkFilter)
         //过滤
         if ( visible )
         {
-            visibleRows++;
+            (*visibleRows)++;
             setRowHidden(i, false);
         }
         else {
             setRowHidden(i, true);
         }
     }
+}
 
-    //显示统计值
-    for ( int j = 0, jLen = mCols.length(); j < jLen; ++j )
-    {
-        //页脚显示
-        uint flags = mCols.at(j)->mFlags;
-        QString aggShow;
-        Qt::AlignmentFlag footAlign = Qt::AlignLeft;
-
-        if ( (flags & bsffAggCount) == bsffAggCount || (flags & bsffAggSum) == bsffAggSum )
-        {
-            if ( (flags & bsffAggCount) == bsffAggCount )
-            {
-                aggShow = QStringLiteral("<%1>").arg(mCols.at(j)->mCountSet.count());
-                footAlign = Qt::AlignCenter;
-            }
-
-            if ( (flags & bsffAggSum) == bsffAggSum )
-            {
-                aggShow = getDisplayTextOfIntData(mCols.at(j)->mAggValue, flags, mCols.at(j)->mLenDots);
-                footAlign = Qt::AlignRight;
-            }
-
-            mpFooter->item(0, j)->setText(aggShow);
-            mpFooter->item(0, j)->setTextAlignment(int(footAlign) | int(Qt::AlignVCenter));
-        }
-
-        //列头颜色（如果有筛选显示红色）
-        uint ft = mCols.at(j)->mFilterType;
-        QColor titleColor = (ft == bsftNone || ft == bsftContain) ? Qt::black : Qt::red;
-        model()->setHeaderData(j, Qt::Horizontal, QBrush(titleColor), Qt::ForegroundRole);
-
-        //单据需要知道合计金额
-        if ( !mForQuery && !checkFilter && mCols.at(j)->mFldName == QStringLiteral("actmoney") )
-            emit sheetSumMoneyChanged(aggShow);
-    }
-
-    updateFooterColWidths();
-
-    //筛选信号
-    if ( checkFilter )
-    {
-        if ( filterColCounts > 0 )
-        {
-            mFiltering = true;
-            setStyleSheet(mapMsg.value("css_grid_filtering"));
-            emit filterDone();
-        }
-
-        if ( filterColCounts == 0 )
-        {
-            mFiltering = false;
-            setStyleSheet(mapMsg.value("css_grid_readonly"));
-            emit filterEmpty();
-        }
-    }
+QString BsGrid::cellText(const int row, const int col) const
+{
+    QTableWidgetItem *it = item(row, col);
+    return ( it ) ? it->text() : QString();
+}
 
-    //角标总行数及精确位置更新
-    mpCorner->setText(QString::number(visibleRows));
-    QTimer::singleShot(100, this, SLOT(adjustCornerPosition()));
+void BsGrid::setCellText(const int row, const int col, const QString &text)
+{
+    QTableWidgetItem *it = item(row, col);
+    if ( it ) it->setText(text);
+}
 
-    //恢复光标
-    qApp->restoreOverrideCursor();
+void BsGrid::setCellIcon(const int row, const int col, const QIcon &icon)
+{
+    QTableWidgetItem *it = item(row, col);
+    if ( it ) it->setData(Qt::DecorationRole, ( icon.isNull() ) ? QVariant() : QVariant(icon));
 }
 
 void BsGrid::updateAllColTitles()
@@ -1426,34 +1858,7 @@ void BsGrid::itemDoubleClicked(QTableWidgetItem *item)
             return;
         }
 
-        QString imgFile = checkCargoImageFile(cargo);
-        if ( imgFile.isEmpty() ) {
-            QMessageBox::information(this, QString(), QStringLiteral("该货品暂无图片。"));
-            return;
-        }
-
-        QImage imgSrc(imgFile);
-        if ( imgSrc.height() > 300 ) {
-            imgSrc = imgSrc.scaled(QSize(300, 300), Qt::KeepAspectRatioByExpanding, Qt::SmoothTransformation);
-        }
-
-        QMdiArea* mdi = nullptr;
-        QObject* p = parent();
-        while ( p && !mdi) {
-            mdi = qobject_cast<QMdiArea*>(p);
-            if ( mdi ) break;
-            p = p->parent();
-        }
-
-        QLabel* lbl = new QLabel(mdi);
-        lbl->setPixmap(QPixmap::fromImage(imgSrc));
-        lbl->setWindowTitle(cargo);
-
-        if ( mdi ) {
-            QMdiSubWindow* sub = mdi->addSubWindow(lbl);
-            sub->setWindowFlags(sub->windowFlags()&~Qt::WindowMaximizeButtonHint&~Qt::WindowMinimizeButtonHint);
-        }
-        lbl->show();
+        showCargoImage(this, cargo);
     }
 }
 
@@ -1492,24 +1897,332 @@ void BsGrid::takeFilterInPicks(const QStringList &picks)
 
 
 // BsQueryGrid
-BsQueryGrid::BsQueryGrid(QWidget *parent) : BsGrid(parent, true, false)
+BsQueryGrid::BsQueryGrid(QWidget *parent) : QTableView(parent)
 {
-    setEditTriggers(QAbstractItemView::NoEditTriggers);
-    setAlternatingRowColors(true);
-    setStyleSheet(mapMsg.value("css_grid_readonly"));
-}
+    mRowHeight = 20;
+    mFiltering = false;
+    mSizerPrevCol = -1;
+    mSizerColCount = 0;
 
-void BsQueryGrid::doPrint(const QString &title, const QStringList &conPairs,
-                          const QString &printMan, const QString &printTime)
-{
-    //准备列宽数据
-    QList<QString> colWidths;
+    mpModel = new BsGridModel(&mCols, this);
+    setModel(mpModel);
 
-    int totalw = 0;
-    int lastCol = -1;
-    for ( int j = 0, jLen = mCols.length(); j < jLen; ++j )
-    {
-        BsField *col = mCols.at(j);
+    mpHeader = new BsHeader(this);
+    setHorizontalHeader(mpHeader);
+    verticalHeader()->setDefaultSectionSize(mRowHeight);     //页脚行高随此
+
+    mpFooter = new BsFooter(horizontalScrollBar(), this, &mCols);
+    connect(mpHeader, SIGNAL(sectionResized(int,int,int)), mpFooter, SLOT(headerSectionResized(int,int,int)));
+    connect(mpHeader, SIGNAL(sectionResized(int,int,int)), this, SLOT(updateFooterGeometry()));
+
+    mpPicker = new BsFilterSelector(this);
+    mpPicker->hide();
+
+    mpCorner = new QToolButton(this);
+    mpCorner->setToolButtonStyle(Qt::ToolButtonTextOnly);
+    mpCorner->setStyleSheet("color:#666; border-style:none; ");
+
+    mpMenu = new QMenu(this);
+    mpFilterIn      = mpMenu->addAction(mapMsg.value("menu_filter_in"), this, SLOT(filterIn()));
+    mpFilterOut     = mpMenu->addAction("O", this, SLOT(filterOut()));
+    mpMenu->addSeparator();
+    mpRestoreCol    = mpMenu->addAction(mapMsg.value("menu_filter_restore_col"), this, SLOT(filterRestoreCol()));
+    mpRestoreAll    = mpMenu->addAction(mapMsg.value("menu_filter_restore_all"), this, SLOT(filterRestoreAll()));
+
+    verticalHeader()->setStyleSheet("color:#999;");
+    verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+
+    setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOn);
+    horizontalScrollBar()->setStyleSheet(QLatin1String(".QScrollBar:horizontal {background:red; border-style:none;}"));
+
+    setSelectionBehavior(QAbstractItemView::SelectRows);
+    setSelectionMode(QAbstractItemView::SingleSelection);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+    setAlternatingRowColors(true);
+    setStyleSheet(mapMsg.value("css_grid_readonly"));
+
+    //点列头由BsGridModel::sort按原值排序
+    setSortingEnabled(true);
+
+    connect(mpPicker, SIGNAL(pickFinished(QStringList)), this, SLOT(takeFilterInPicks(QStringList)));
+}
+
+BsQueryGrid::~BsQueryGrid()
+{
+    delete mpFooter;
+
+    //模型随后才析构，先清空免得再取已删的列定义
+    mpModel->resetStore(BsGridStore(), -1, -1, -1, QStringList());
+    qDeleteAll(mCols);
+    mCols.clear();
+}
+
+void BsQueryGrid::loadData(const QString &sql, const QStringList &fldCnameDefines, const QString &useSizerType)
+{
+    //耗时等待光标
+    qApp->setOverrideCursor(Qt::WaitCursor);
+
+    //重置状态（先清模型再删列定义）
+    mpHeader->setSortIndicator(-1, Qt::AscendingOrder);
+    mpModel->resetStore(BsGridStore(), -1, -1, -1, QStringList());
+    qDeleteAll(mCols);
+    mCols.clear();
+    mFiltering = false;
+    mLoadSizerType = useSizerType;
+    QStringList regList = ( useSizerType.isEmpty() ) ? QStringList() : dsSizer->getSizerList(useSizerType);
+
+    //结果缓存存整个列式store。横排尺码列数随尺码品类，故品类计入键、尺码品类表计入依赖
+    QString cacheKey;
+    BsCacheStamp stamp;
+    BsGridStorePtr cached;
+    if ( BsResultCache::cacheable(sql) )
+    {
+        cacheKey = BsResultCache::keyOf(QStringLiteral("grid:%1").arg(useSizerType), sql);
+        cached = BsResultCache::fetchStore(cacheKey);
+        if ( !cached )
+        {
+            QStringList deps = BsResultCache::dependsOfSql(sql);
+            if ( !useSizerType.isEmpty() ) deps << QStringLiteral("sizertype");
+            stamp = BsResultCache::stampOf(deps);       //代次须在执行前取
+        }
+    }
+
+    //数据库执行（只向前游标，边取边填store，不留中间行）
+    BsGridStore store;
+    QStringList sqlFlds;
+    QSqlQuery qry;
+    qry.setForwardOnly(true);
+    qry.setNumericalPrecisionPolicy(QSql::LowPrecisionInt64);
+    if ( cached )
+    {
+        store = *cached;
+        sqlFlds = store.fields();
+    }
+    else
+    {
+        qry.exec(sql);
+        if ( qry.lastError().isValid() ) {
+            qDebug() << qry.lastError().text();
+            qDebug() << sql;
+        }
+        QSqlRecord rec = qry.record();
+        for ( int i = 0, iLen = rec.count(); i < iLen; ++i )
+            sqlFlds << rec.fieldName(i);
+    }
+
+    //根据数据库字段设置列
+    for ( int i = 0, iLen = sqlFlds.length(); i < iLen; ++i )
+        mCols << newQueryField(sqlFlds.at(i), fldCnameDefines);
+    applyUserFieldNames(mCols, userFieldTableKey(sql));
+
+    int sizerDataCol = sqlFlds.indexOf(QStringLiteral("sizers"));
+    int chkTimeCol = sqlFlds.indexOf(QStringLiteral("chktime"));
+    mSizerPrevCol = sizerDataCol;
+    mSizerColCount = 0;
+
+    //插入横排尺码列
+    if ( sizerDataCol > 0 )
+    {
+        mSizerColCount = regList.length();
+        Q_ASSERT(sqlFlds.indexOf(QStringLiteral("qty")) < sizerDataCol);
+        for ( int i = 1; i <= mSizerColCount; ++i )
+        {
+            //sz01开始的命名方式约定，不要变
+            BsField *fld = new BsField(QStringLiteral("sz%1").arg(i), QStringLiteral("*"),
+                                       bsffNumeric | bsffAggSum | bsffSizeUnit, 0, QString());
+            mCols.insert(mSizerPrevCol + i, fld);
+        }
+    }
+    if ( chkTimeCol > mSizerPrevCol )
+        chkTimeCol += mSizerColCount;
+
+    //填数据行并存入缓存（与表格共用一份，表格改值时才分离）
+    if ( !cached )
+    {
+        fillStore(qry, sizerDataCol, regList, &store);
+        store.setFields(sqlFlds);
+        if ( !cacheKey.isEmpty() && !qry.lastError().isValid() )
+            BsResultCache::storeStore(cacheKey, stamp, BsGridStorePtr(new BsGridStore(store)), store.byteSize());
+    }
+    mpModel->resetStore(store, chkTimeCol, getColumnIndexByFieldName(QStringLiteral("qty")),
+                        mSizerPrevCol, regList.mid(0, mSizerColCount));
+
+    //列隐藏
+    for ( int i = mCols.length() - 1; i >= 0; --i ) {
+        setColumnHidden(i, (mCols.at(i)->mFlags & bsffHideSys) || i == chkTimeCol );
+    }
+
+    //整理
+    mpFooter->initCols();
+    mpCorner->setText(QString());
+    if ( rowCount() > 0 )
+        updateFooterSumCount(false);
+
+    //恢复光标
+    qApp->restoreOverrideCursor();
+}
+
+void BsQueryGrid::fillStore(QSqlQuery &qry, const int sizerDataCol, const QStringList &regList, BsGridStore *store)
+{
+    store->resetColumns(mCols, 0);
+    int fldCount = qry.record().count();
+
+    for ( int r = 0; qry.next(); ++r )
+    {
+        store->appendRow();
+
+        for ( int i = 0; i < fldCount; ++i )
+        {
+            int idxCol = ( i <= mSizerPrevCol ) ? i : (i + mSizerColCount);
+            uint flags = mCols.at(idxCol)->mFlags;
+
+            if ( (flags & bsffText) == bsffText )
+            {
+                QString strV = qry.value(i).toString();
+                if ( i == sizerDataCol )
+                {
+                    strV = BsGrid::sizerTextSum(strV);  //查询的尺码明细经过GROUP_CONCAT后需要处理字符串重新整理统计
+
+                    //横排尺码列直接存数量原值，未登记尺码记为行附注
+                    QStringList badPairs;
+                    QStringList pairList = strV.split(QChar(10), QString::SkipEmptyParts);
+                    for ( int j = 0, jLen = pairList.length(); j < jLen; ++j )
+                    {
+                        QStringList pair = QString(pairList.at(j)).split(QChar(9));     //难免有空名的尺码，不能SkipEmptyParts
+                        Q_ASSERT(pair.length() == 2);
+                        qint64 qty = QString(pair.at(1)).toLongLong();
+                        int regIdx = regList.indexOf(pair.at(0));
+                        if ( regIdx >= 0 && regIdx < mSizerColCount )
+                            store->setInt(r, mSizerPrevCol + regIdx + 1, qty);
+                        else if ( qty != 0 )
+                            badPairs << QStringLiteral("%1\t%2").arg(pair.at(0)).arg(bsNumForRead(qty, 0));
+                    }
+                    if ( !badPairs.isEmpty() )
+                        store->setNote(r, badPairs.join(QChar(10)));
+                }
+                store->setText(r, idxCol, strV);
+            }
+            else if ( (flags & bsffInt) == bsffInt )
+            {
+                store->setInt(r, idxCol, qry.value(i).toLongLong());
+            }
+            else {
+                qDebug() << QStringLiteral("Fatal Error Warning: Don't design real type field.");
+                Q_ASSERT(1==2);
+            }
+        }
+    }
+    qry.finish();
+
+    //逐行追加的余量释放
+    store->squeeze();
+}
+
+void BsQueryGrid::saveColWidths(const QString &sub)
+{
+    saveColumnWidths(this, mCols, mTable + sub);
+}
+
+void BsQueryGrid::loadColWidths(const QString &sub)
+{
+    loadColumnWidths(this, mCols, mDenyFields, mTable + sub);
+}
+
+void BsQueryGrid::cancelAllFilters()
+{
+    filterRestoreAll();
+}
+
+QString BsQueryGrid::addCalcMoneyColByPrice(const QString &priceField)
+{
+    if ( rowCount() < 1 ) return QString();
+
+    //演算价格列名称
+    QString calcField = priceField;
+    calcField.replace(QStringLiteral("price"), QStringLiteral("money"));
+    int moneyDots = mapOption.value("dots_of_money").toInt();
+
+    //如果已经计算
+    if ( getColumnIndexByFieldName(calcField) >= 0 ) return QString();
+
+    //确保有货号列与数量列
+    int idxCargo = getColumnIndexByFieldName("cargo");
+    int idxQty = getColumnIndexByFieldName("qty");
+    int idxActMoney = getColumnIndexByFieldName("actmoney");
+    if ( idxCargo < 0 || idxQty < 0 ) {
+        return QStringLiteral("必须有货号列和数量列，才能演算。");
+    }
+    bool withMargin = priceField.startsWith("buy") && idxActMoney > 0;
+
+    //按store行演算原值（含筛选掉的行，取消筛选后仍有）
+    const BsGridStore &store = mpModel->store();
+    QVector<qint64> moneys(store.rowCount());
+    QVector<qint64> margins;
+    if ( withMargin ) margins.resize(store.rowCount());
+    for ( int r = 0, rLen = store.rowCount(); r < rLen; ++r ) {
+        QString cargo = store.textAt(r, idxCargo);
+        double qty = store.intAt(r, idxQty) / 10000.0;
+        double calcPrice = dsCargo->getValue(cargo, priceField).toDouble() / 10000.0;
+        double calcMoney = ( abs(qty) > 0.00001 && abs(calcPrice) > 0.00001 ) ? qty * calcPrice : 0.0;
+        moneys[r] = bsNumForSave(calcMoney).toLongLong();
+        if ( withMargin )
+            margins[r] = store.intAt(r, idxActMoney) - moneys.at(r);
+    }
+
+    //添加演算价格列
+    QStringList defs = mapMsg.value(QStringLiteral("fld_%1").arg(calcField)).split(QChar(9));
+    Q_ASSERT(defs.count() > 4);
+    BsField *bsCol = new BsField(calcField,
+                                 defs.at(0),
+                                 QString(defs.at(3)).toUInt(),
+                                 moneyDots,
+                                 defs.at(2));
+    mCols.insert(idxQty + 1, bsCol);
+    mpModel->insertStoreColumn(idxQty + 1);
+    mpModel->setColumnInts(idxQty + 1, moneys);
+
+    //如果是进货价而且还有实际金额列则再添加一个“毛利润”列
+    if ( withMargin ) {
+
+        //因为列有变动，需要重新取得
+        idxActMoney = getColumnIndexByFieldName("actmoney");
+
+        //添加毛利润列
+        QStringList defs = mapMsg.value(QStringLiteral("fld_buymargin")).split(QChar(9));
+        Q_ASSERT(defs.count() > 4);
+        BsField *bsCol = new BsField("buymargin",
+                                     defs.at(0),
+                                     QString(defs.at(3)).toUInt(),
+                                     moneyDots,
+                                     defs.at(2));
+        mCols.insert(idxActMoney + 1, bsCol);
+        mpModel->insertStoreColumn(idxActMoney + 1);
+        mpModel->setColumnInts(idxActMoney + 1, margins);
+    }
+
+    //整理
+    mpFooter->initCols();
+    updateFooterSumCount(false);
+
+    return QString();
+}
+
+QString BsQueryGrid::getSqlValueFromDisplay(const int row, const int col)
+{
+    return sqlValueOfDisplay(cellText(row, col), mCols.at(col)->mFlags);
+}
+
+void BsQueryGrid::doPrint(const QString &title, const QStringList &conPairs,
+                          const QString &printMan, const QString &printTime)
+{
+    //准备列宽数据
+    QList<QString> colWidths;
+
+    int totalw = 0;
+    int lastCol = -1;
+    for ( int j = 0, jLen = mCols.length(); j < jLen; ++j )
+    {
+        BsField *col = mCols.at(j);
         if ( (col->mFlags & bsffHideSys) != bsffHideSys )
         {
             totalw += columnWidth(j);
@@ -1574,30 +2287,26 @@ void BsQueryGrid::doPrint(const QString &title, const QStringList &conPairs,
     }
     html += QStringLiteral("</tr>");
 
-    //表数据行
-    int num = 0;
+    //表数据行（模型只含筛选后的行）
     for ( int i = 0, iLen = rowCount(); i < iLen; ++i )
     {
-        if ( ! isRowHidden(i) ) {
-            if ( (num % 2) == 0 )
-                html += QStringLiteral("<tr>");
-            else
-                html += QStringLiteral("<tr bgcolor='#e8e8e8'>");
+        if ( (i % 2) == 0 )
+            html += QStringLiteral("<tr>");
+        else
+            html += QStringLiteral("<tr bgcolor='#e8e8e8'>");
 
-            for ( int j = 0, jLen = mCols.length(); j < jLen; ++j )
-            {
-                uint flags = mCols.at(j)->mFlags;
-                QString prp = ((flags & bsffNumeric) == bsffNumeric)
-                        ? QStringLiteral("align='right' ")
-                        : QString();
-                if ( (flags & bsffHideSys) != bsffHideSys ) {
-                    html += QStringLiteral("<td %1>%2</td>").arg(prp).arg(item(i, j)->text());
-                }
+        for ( int j = 0, jLen = mCols.length(); j < jLen; ++j )
+        {
+            uint flags = mCols.at(j)->mFlags;
+            QString prp = ((flags & bsffNumeric) == bsffNumeric)
+                    ? QStringLiteral("align='right' ")
+                    : QString();
+            if ( (flags & bsffHideSys) != bsffHideSys ) {
+                html += QStringLiteral("<td %1>%2</td>").arg(prp).arg(cellText(i, j));
             }
-
-            html += QStringLiteral("</tr>");
-            num++;
         }
+
+        html += QStringLiteral("</tr>");
     }
 
     //合计行
@@ -1641,22 +2350,384 @@ void BsQueryGrid::doPrint(const QString &title, const QStringList &conPairs,
     }
 }
 
+QString BsQueryGrid::cellText(const int row, const int col) const
+{
+    return mpModel->displayText(mpModel->storeRow(row), col);
+}
+
+void BsQueryGrid::setCellText(const int row, const int col, const QString &text)
+{
+    mpModel->setStoreValue(row, col, text);
+}
+
+void BsQueryGrid::setCellIcon(const int row, const int col, const QIcon &icon)
+{
+    mpModel->setDecoration(row, col, icon);
+}
+
+BsField *BsQueryGrid::getFieldByName(const QString &name, int *colIdx)
+{
+    for ( int i = 0, iLen = mCols.length(); i < iLen; ++i )
+    {
+        if ( mCols.at(i)->mFldName == name )
+        {
+            if ( colIdx )
+                *colIdx = i;
+            return mCols.at(i);
+        }
+    }
+    return nullptr;
+}
+
+bool BsQueryGrid::inFiltering() const
+{
+    return mpModel->rowCount() < mpModel->store().rowCount();
+}
+
+QString BsQueryGrid::getFooterValueByField(const QString &fieldName)
+{
+    int idx = getColumnIndexByFieldName(fieldName);
+    return ( idx >= 0 ) ? mpFooter->item(0, idx)->text() : QString();
+}
+
+int BsQueryGrid::getColumnIndexByFieldName(const QString &fieldName)
+{
+    for ( int i = 0, iLen = mCols.length(); i < iLen; ++i )
+    {
+        if ( mCols.at(i)->mFldName.toLower() == fieldName.toLower() )
+            return i;
+    }
+    return -1;
+}
+
+int BsQueryGrid::rowCount() const
+{
+    return mpModel->rowCount();
+}
+
+int BsQueryGrid::columnCount() const
+{
+    return mpModel->columnCount();
+}
+
+int BsQueryGrid::currentRow() const
+{
+    return currentIndex().row();
+}
+
+int BsQueryGrid::currentColumn() const
+{
+    return currentIndex().column();
+}
+
+int BsQueryGrid::getRowHeight() const
+{
+    return mRowHeight;
+}
+
+void BsQueryGrid::showEvent(QShowEvent *e)
+{
+    QTableView::showEvent(e);
+    updateFooterGeometry();
+}
+
+void BsQueryGrid::resizeEvent(QResizeEvent *e)
+{
+    QTableView::resizeEvent(e);
+    updateFooterGeometry();
+}
+
+void BsQueryGrid::paintEvent(QPaintEvent *e)
+{
+    QTableView::paintEvent(e);
+    QPainter p(viewport());
+    p.setPen(QColor(216, 216, 216));
+    int x = 0;
+    for ( int i = 0, iLen = columnCount(); i < iLen; ++i )
+    {
+        x += columnWidth(i);
+        p.drawLine(x - 1, 0, x - 1, viewport()->height());
+    }
+}
+
+void BsQueryGrid::mousePressEvent(QMouseEvent *e)
+{
+    QTableView::mousePressEvent(e);
+
+    if ( e->button() != Qt::RightButton || !currentIndex().isValid() )
+        return;
+
+    BsField *col = mCols.at(currentColumn());
+    if ( (col->mFlags & bsffAggCount) != bsffAggCount )
+    {
+        emit shootHintMessage(mapMsg.value("i_this_col_cannot_filter"));
+        return;
+    }
+
+    mpFilterOut->setText(QStringLiteral("%1“%2”")
+                         .arg(mapMsg.value("menu_filter_out"))
+                         .arg(cellText(currentRow(), currentColumn())));
+    mpMenu->popup(e->globalPos());
+}
+
 void BsQueryGrid::mouseDoubleClickEvent(QMouseEvent *e)
 {
-    BsGrid::mouseDoubleClickEvent(e);
+    QTableView::mouseDoubleClickEvent(e);
 
     int row = currentRow();
     if ( rowCount() < 1 || row < 0 ) {
         return;
     }
 
+    //货号列弹图片
+    QString fldName = mCols.at(currentColumn())->mFldName;
+    if ( fldName == QStringLiteral("cargo") || fldName == QStringLiteral("hpcode") ) {
+        QString cargo = cellText(row, currentColumn());
+        if ( !cargo.isEmpty() )
+            showCargoImage(this, cargo);
+        return;
+    }
+
     int sheetNameCol = getColumnIndexByFieldName(QStringLiteral("sheetname"));
     int sheetIdCol = getColumnIndexByFieldName(QStringLiteral("sheetid"));
     if ( sheetNameCol < 0 || sheetIdCol < 0 ) {
         return;
     }
 
-    emit requestOpenSheet(item(row, sheetNameCol)->text().toLower(), item(row, sheetIdCol)->text().toInt());
+    emit requestOpenSheet(cellText(row, sheetNameCol).toLower(), cellText(row, sheetIdCol).toInt());
+}
+
+void BsQueryGrid::updateFooterSumCount(const bool checkFilter)
+{
+    //耗时过程
+    qApp->setOverrideCursor(Qt::WaitCursor);
+
+    const BsGridStore &store = mpModel->store();
+    int colCount = mCols.length();
+
+    //清空统计值，文本列筛选值先转为字典序号，数值列仍比显示文本（与筛选选项来源一致）
+    int filterColCounts = 0;
+    QVector<QSet<int> > filterIds(colCount);
+    for ( int j = 0; j < colCount; ++j )
+    {
+        BsField *bsCol = mCols.at(j);
+        bsCol->mCountSet.clear();
+        bsCol->mAggValue = 0;
+        if ( bsCol->mFilterType != bsftEqual && bsCol->mFilterType != bsftNotEqual )
+            continue;
+        filterColCounts++;
+        if ( store.isText(j) )
+        {
+            for ( int k = 0, kLen = bsCol->mFilterValue.length(); k < kLen; ++k )
+            {
+                int id = store.idOf(j, bsCol->mFilterValue.at(k));
+                if ( id >= 0 ) filterIds[j].insert(id);
+            }
+        }
+    }
+
+    //逐行判断并统计，计数列先收集不同原值，最后才转文本
+    QVector<QSet<int> > countIds(colCount);
+    QVector<QSet<qint64> > countInts(colCount);
+    QBitArray visible(store.rowCount(), true);
+    int visibleRows = 0;
+
+    for ( int r = 0, rLen = store.rowCount(); r < rLen; ++r )
+    {
+        //筛选可见性（bsftContain仅用于拣货辅助，查询表格不用）
+        bool rowVisible = true;
+        for ( int j = 0; j < colCount && filterColCounts > 0; ++j )
+        {
+            uint ft = mCols.at(j)->mFilterType;
+            if ( ft != bsftEqual && ft != bsftNotEqual )
+                continue;
+
+            bool hit = ( store.isText(j) )
+                    ? filterIds.at(j).contains(store.idAt(r, j))
+                    : mCols.at(j)->mFilterValue.contains(
+                          BsGrid::getDisplayTextOfIntData(store.intAt(r, j), mCols.at(j)->mFlags, mCols.at(j)->mLenDots));
+            if ( hit != ( ft == bsftEqual ) )
+            {
+                rowVisible = false;
+                break;
+            }
+        }
+
+        visible.setBit(r, rowVisible);
+        if ( !rowVisible )
+            continue;
+        visibleRows++;
+
+        //统计各列
+        for ( int j = 0; j < colCount; ++j )
+        {
+            uint flags = mCols.at(j)->mFlags;
+
+            if ( (flags & bsffAggCount) == bsffAggCount ) {
+                if ( store.isText(j) )
+                    countIds[j].insert(store.idAt(r, j));
+                else
+                    countInts[j].insert(store.intAt(r, j));
+            }
+
+            if ( (flags & bsffAggSum) == bsffAggSum ) {
+                mCols.at(j)->mAggValue += ( store.isText(j) ) ? store.textAt(r, j).toLongLong() : store.intAt(r, j);
+            }
+        }
+    }
+
+    for ( int j = 0; j < colCount; ++j )
+    {
+        BsField *bsCol = mCols.at(j);
+        foreach (int id, countIds.at(j))
+            bsCol->mCountSet.insert(store.dictText(j, id));
+        foreach (qint64 v, countInts.at(j))
+            bsCol->mCountSet.insert(BsGrid::getDisplayTextOfIntData(v, bsCol->mFlags, bsCol->mLenDots));
+    }
+
+    //筛选变动才重建显示行
+    if ( checkFilter )
+        mpModel->setVisible(visible);
+
+    //显示统计值，列头颜色随筛选
+    mpFooter->showAggs();
+    mpModel->updateHeaders();
+    for ( int i = 1; i < colCount; ++i ) {
+        if ( isColumnHidden(i) )
+            mpFooter->setColumnHidden(i, true);
+        else
+            mpFooter->setColumnWidth(i, columnWidth(i));
+    }
+
+    //筛选信号
+    if ( checkFilter )
+    {
+        mFiltering = ( filterColCounts > 0 );
+        setStyleSheet(mapMsg.value(( mFiltering ) ? "css_grid_filtering" : "css_grid_readonly"));
+        if ( mFiltering )
+            emit filterDone();
+        else
+            emit filterEmpty();
+    }
+
+    //角标总行数及精确位置更新
+    mpCorner->setText(QString::number(visibleRows));
+    QTimer::singleShot(100, this, SLOT(adjustCornerPosition()));
+
+    //恢复光标
+    qApp->restoreOverrideCursor();
+}
+
+void BsQueryGrid::filterIn()
+{
+    BsField *bsCol = mCols.at(currentColumn());
+
+    //预检查
+    if ( bsCol->mCountSet.count() < 2 )
+    {
+        QMessageBox msg;
+        msg.setText(mapMsg.value("i_cannot_filter_in_because_few"));
+        msg.exec();
+        return;
+    }
+
+    //准备list并排序
+    QStringList ls = bsCol->mCountSet.toList();
+    ls.sort(Qt::CaseInsensitive);
+    mpPicker->setPicks(ls, cellText(currentRow(), currentColumn()));
+
+    //显示选择
+    int y = horizontalHeader()->height();
+    QRect rect = visualRect(currentIndex());
+    QPoint pt = mapToGlobal(QPoint(rect.x() + verticalHeader()->width() + 1, y));
+    mpPicker->setWindowFlags(Qt::Popup | Qt::FramelessWindowHint);
+    mpPicker->setGeometry(pt.x(), pt.y() + 1, columnWidth(currentColumn()) - 1, height() - y - horizontalScrollBar()->height() - 2);
+    mpPicker->show();
+}
+
+void BsQueryGrid::filterOut()
+{
+    int colIdx = currentColumn();
+    BsField *bsCol = mCols.at(colIdx);
+
+    //预检查
+    if ( bsCol->mCountSet.count() < 2 )
+    {
+        QMessageBox msg;
+        msg.setText(mapMsg.value("i_cannot_filter_out_because_few"));
+        msg.exec();
+        return;
+    }
+
+    //如果该列本来不是剔除筛选的，则需要重新改变本列筛选类型
+    if ( bsftNotEqual != bsCol->mFilterType )
+    {
+        bsCol->mFilterType = bsftNotEqual;
+        bsCol->mFilterValue.clear();
+    }
+
+    //加入剔除值
+    bsCol->mFilterValue << cellText(currentRow(), colIdx);
+
+    //执行筛选
+    updateFooterSumCount(true);
+}
+
+void BsQueryGrid::filterRestoreCol()
+{
+    //取消本列筛选设置
+    int colIdx = currentColumn();
+    mCols.at(colIdx)->mFilterType = bsftNone;
+    mCols.at(colIdx)->mFilterValue.clear();
+
+    //执行筛选
+    updateFooterSumCount(true);
+}
+
+void BsQueryGrid::filterRestoreAll()
+{
+    //取消全部筛选设置
+    for ( int i = 0; i < mCols.count(); ++i )
+    {
+        mCols.at(i)->mFilterType = bsftNone;
+        mCols.at(i)->mFilterValue.clear();
+    }
+
+    //执行筛选
+    updateFooterSumCount(true);
+}
+
+void BsQueryGrid::adjustCornerPosition()
+{
+    mpCorner->setGeometry(1, 1, verticalHeader()->width() - 2, horizontalHeader()->height() - 2);
+}
+
+void BsQueryGrid::updateFooterGeometry()
+{
+    QScrollBar *bar = horizontalScrollBar();
+    int slideButtonSize = ( bar->maximum() > 0 ) ? bar->height() : 0;
+    int deltaW = (verticalScrollBar()->isVisible()) ? verticalScrollBar()->width() : 0;
+    int wt = width() - deltaW - 1;
+    if ( bar->maximum() > 0 )
+        wt -= 2 * slideButtonSize;
+    mpFooter->setGeometry(slideButtonSize, 0, wt, bar->height());
+    mpFooter->headerSectionResized(0, 0, columnWidth(0) - slideButtonSize);
+}
+
+void BsQueryGrid::takeFilterInPicks(const QStringList &picks)
+{
+    if ( !picks.isEmpty() )
+    {
+        BsField *bsCol = mCols.at(currentColumn());
+
+        //设置选中值
+        bsCol->mFilterType = bsftEqual;
+        bsCol->mFilterValue.clear();
+        bsCol->mFilterValue << picks;
+
+        //执行筛选
+        updateFooterSumCount(true);
+    }
 }
 
 
@@ -15,12 +15,15 @@
 #define SORT_TYPE_TEXT        1000
 
 
+
 /************************** win类与grid类继承层次完全一致 **************************/
 
 namespace BailiSoft {
 
 class BsWin;
 class BsGrid;
+class BsQueryGrid;
+struct BsCachedRows;
 class BsSqlListModel;
 class BsPickDelegate;
 
@@ -132,6 +135,101 @@ public:
     }
 };
 
+// BsGridStore
+//查询表格的列式数据，列号同BsQueryGrid::mCols。数值列存原整数，文本列存本列字典序号（相同文本只存一份）。
+//由查询结果逐行流式填入，不经中间行对象；显示文本由BsGridModel::data()按需格式化，排序、筛选、合计都直接用原值。
+//各列为隐式共享容器，整体复制只增引用计数，结果缓存与表格可共用一份，表格改值时才分离。
+class BsGridStore
+{
+public:
+    void clear();
+    void resetColumns(const QList<BsField*> &cols, const int rows);
+    void insertColumn(const int col, const bool isText);
+    void appendRow();                   //各列末尾补空值（文本为字典首项空文本）
+    void squeeze();                     //填完释放各列多余容量
+    int rowCount() const { return mRows; }
+    int columnCount() const { return mCols.length(); }
+    int byteSize() const;               //结果缓存估算用
+    bool isText(const int col) const { return mCols.at(col).text; }
+    qint64 intAt(const int row, const int col) const { return mCols.at(col).ints.at(row); }
+    int idAt(const int row, const int col) const { return mCols.at(col).ids.at(row); }
+    QString textAt(const int row, const int col) const { return mCols.at(col).dict.at(mCols.at(col).ids.at(row)); }
+    QString dictText(const int col, const int id) const { return mCols.at(col).dict.at(id); }
+    int idOf(const int col, const QString &text) const { return mCols.at(col).dictIndex.value(text, -1); }
+    void setInt(const int row, const int col, const qint64 value) { mCols[col].ints[row] = value; }
+    void setText(const int row, const int col, const QString &text);
+
+    //查询原字段名（缓存命中时据以重建列定义）
+    const QStringList &fields() const { return mFields; }
+    void setFields(const QStringList &fields) { mFields = fields; }
+
+    //行附注（登记外尺码数量）
+    QString noteAt(const int row) const { return mNotes.value(row); }
+    void setNote(const int row, const QString &note) { mNotes.insert(row, note); }
+
+    //按某列原值稳定排序（同值保持rows原次序）
+    QVector<int> sortedRows(const QVector<int> &rows, const int col, const Qt::SortOrder order) const;
+
+private:
+    struct Column {
+        bool                    text = false;
+        QVector<qint64>         ints;
+        QVector<int>            ids;
+        QStringList             dict;           //首项为空文本
+        QHash<QString, int>     dictIndex;
+    };
+    QVector<Column>     mCols;
+    QStringList         mFields;
+    QHash<int, QString> mNotes;
+    int                 mRows = 0;
+};
+
+// BsGridModel
+//查询表格模型。显示文本、对齐、图标、提示都在data()中由store原值即时生成，不建任何单元格对象。
+//mRows为当前显示行（筛选后、按排序次序）对应的store行号，视图行号即mRows下标。
+class BsGridModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    explicit BsGridModel(const QList<BsField*> *cols, QObject *parent);
+    int rowCount(const QModelIndex &parent = QModelIndex()) const;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const;
+    Qt::ItemFlags flags(const QModelIndex &index) const;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder);
+
+    void resetStore(const BsGridStore &store, const int chkTimeCol, const int qtyCol,
+                    const int sizerPrevCol, const QStringList &sizerTitles);
+    void setVisible(const QBitArray &visible);
+    const BsGridStore &store() const { return mStore; }
+    int storeRow(const int row) const { return mRows.at(row); }
+    QString displayText(const int storeRow, const int col) const;
+
+    //改值后通知视图
+    void setStoreValue(const int row, const int col, const QString &text);
+    void setDecoration(const int row, const int col, const QIcon &icon);
+    void insertStoreColumn(const int col);
+    void setColumnInts(const int col, const QVector<qint64> &values);  //按store行序
+    void updateHeaders();
+
+private:
+    void rebuildRows();
+
+    const QList<BsField*>       *mppCols;
+    BsGridStore                 mStore;
+    QVector<int>                mOrder;         //全部store行的当前排序次序
+    QVector<int>                mRows;          //mOrder中通过筛选的
+    QBitArray                   mVisible;       //store行是否通过筛选
+    QHash<quint64, QVariant>    mDecorations;   //(store行 << 16 | 列)另设的图标，无效值为已清除
+    QStringList                 mSizerTitles;   //查询只用一种尺码品类，横排尺码列头固定
+    int                         mSizerPrevCol;
+    int                         mChkTimeCol;
+    int                         mQtyCol;
+    QIcon                       mCheckIcon;
+    QIcon                       mErrorIcon;
+};
+
 // BsFilterSelector
 class BsFilterSelector : public QWidget
 {
@@ -156,8 +254,7 @@ class BsHeader : public QHeaderView
 {
     Q_OBJECT
 public:
-    explicit BsHeader(BsGrid *parent);
-    BsGrid  *mpGrid;
+    explicit BsHeader(QTableView *parent);
 };
 
 // BsFooter
@@ -165,10 +262,12 @@ class BsFooter : public QTableWidget
 {
     Q_OBJECT
 public:
-    explicit BsFooter(QWidget *parent, BsGrid *grid);
+    explicit BsFooter(QWidget *parent, QTableView *view, const QList<BsField*> *cols);
     void initCols();
     void hideAggText();
-    BsGrid  *mpGrid;
+    void showAggs();        //按各列mAggValue与mCountSet显示
+    QTableView              *mppView;
+    const QList<BsField*>   *mppCols;
 signals:
     void barcodeScanned(const QString &barcode);
 public slots:
@@ -202,8 +301,14 @@ public:
     int  getDataSizerColumnIdx() const;
     QString addCalcMoneyColByPrice(const QString &priceField);
 
-    QString getDisplayTextOfIntData(const qint64 intV, const uint flags, const int dots = 0);
+    static QString getDisplayTextOfIntData(const qint64 intV, const uint flags, const int dots = 0);
     QString getSqlValueFromDisplay(const int row, const int col);
+
+    //单元格取值与改值，与BsQueryGrid同名接口，供导出等两类表格共用的代码调用
+    QString cellText(const int row, const int col) const;
+    void setCellText(const int row, const int col, const QString &text);
+    void setCellIcon(const int row, const int col, const QIcon &icon);
+
     BsField *getFieldByName(const QString &name, int *colIdx = 0);
     bool noMoreVisibleRowsAfter(const int currentVisibleRow);
     bool noMoreVisibleColsAfter(const int currentVisibleCol);
@@ -263,6 +368,9 @@ protected:
     void updateFooterColWidths();
     void setSizerHCellsFromText(const int row,  const int qtyCol, const QString &sizersText, const QString &usingSizerType = QString());
 
+    void loadItemRows(const BsCachedRows &data, const int sizerDataCol, const int chkTimeCol, const bool joinCargoPinyin);
+    void updateItemSumCount(const bool checkFilter, int *visibleRows);
+
     BsFilterSelector    *mpPicker;
     QToolButton         *mpCorner;
 
@@ -289,6 +397,7 @@ protected:
     int                 mSizerColCount;
     QString             mLoadSizerType;
 
+
 private slots:
     void filterIn();
     void filterOut();
@@ -305,17 +414,93 @@ friend class BsFooter;
 
 
 // BsQueryGrid
-class BsQueryGrid : public BsGrid
+//查询表格。QTableView加BsGridModel，数据全在列式store，内存只随行数线性增长，不建单元格对象。
+//对外接口与BsGrid同名同义，行号均为显示行号（筛选掉的行不在其中）。
+class BsQueryGrid : public QTableView
 {
     Q_OBJECT
 public:
     explicit BsQueryGrid(QWidget *parent);
+    ~BsQueryGrid();
+
+    void loadData(const QString &sql, const QStringList &fldCnameDefines = QStringList(),
+                  const QString &useSizerType = QString());
+    void saveColWidths(const QString &sub = QString());
+    void loadColWidths(const QString &sub = QString());
+    void cancelAllFilters();
+    QString addCalcMoneyColByPrice(const QString &priceField);
+    QString getSqlValueFromDisplay(const int row, const int col);
     void doPrint(const QString &title, const QStringList &conPairs,
                  const QString &printMan, const QString &printTime);
+
+    QString cellText(const int row, const int col) const;
+    void setCellText(const int row, const int col, const QString &text);
+    void setCellIcon(const int row, const int col, const QIcon &icon);
+
+    BsField *getFieldByName(const QString &name, int *colIdx = 0);
+    bool inFiltering() const;
+    QString getFooterValueByField(const QString &fieldName);
+    int getColumnIndexByFieldName(const QString &fieldName);
+    int rowCount() const;
+    int columnCount() const;
+    int currentRow() const;
+    int currentColumn() const;
+    int getRowHeight() const;
+
+    //列宽设置分组名
+    QString                     mTable;
+
+    //与表格列完全一致，含横排尺码列，自new自delete
+    QList<BsField*>             mCols;
+
+    //权限禁显的字段
+    QStringList                 mDenyFields;
+
+    //打印调用，所以public
+    BsHeader            *mpHeader;
+    BsFooter            *mpFooter;
+
 signals:
+    void filterDone();
+    void filterEmpty();
+    void shootHintMessage(const QString &tip);
     void requestOpenSheet(const QString &sheetName, const int sheetId);
+
 protected:
+    void showEvent(QShowEvent *e);
+    void resizeEvent(QResizeEvent *e);
+    void paintEvent(QPaintEvent *e);
+    void mousePressEvent(QMouseEvent *e);
     void mouseDoubleClickEvent(QMouseEvent *e);
+
+private slots:
+    void filterIn();
+    void filterOut();
+    void filterRestoreCol();
+    void filterRestoreAll();
+    void adjustCornerPosition();
+    void updateFooterGeometry();
+    void takeFilterInPicks(const QStringList &picks);
+
+private:
+    void fillStore(QSqlQuery &qry, const int sizerDataCol, const QStringList &regList, BsGridStore *store);
+    void updateFooterSumCount(const bool checkFilter);
+
+    BsGridModel         *mpModel;
+    BsFilterSelector    *mpPicker;
+    QToolButton         *mpCorner;
+
+    QMenu               *mpMenu;
+    QAction             *mpFilterIn;
+    QAction             *mpFilterOut;
+    QAction             *mpRestoreCol;
+    QAction             *mpRestoreAll;
+
+    int                 mRowHeight;
+    bool                mFiltering;
+    int                 mSizerPrevCol;
+    int                 mSizerColCount;
+    QString             mLoadSizerType;
 };
 
 
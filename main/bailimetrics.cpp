@@ -0,0 +1,281 @@
+#include "bailimetrics.h"
+#include "bailishare.h"
+
+#define HISTO_SUB_BITS      4
+#define HISTO_SUB_COUNT     (1 << HISTO_SUB_BITS)
+#define HISTO_BUCKETS       (64 * HISTO_SUB_COUNT)
+
+namespace BailiSoft {
+
+// 延时直方图 =======================================================================
+BsLatencyHisto::BsLatencyHisto()
+{
+    mBuckets.fill(0, HISTO_BUCKETS);
+    mCount = 0;
+    mSum = 0;
+    mMax = 0;
+}
+
+void BsLatencyHisto::record(const qint64 usecs)
+{
+    qint64 v = (usecs < 0) ? 0 : usecs;
+    mBuckets[bucketOf(quint64(v))]++;
+    mCount++;
+    mSum += v;
+    if ( v > mMax ) mMax = v;
+}
+
+void BsLatencyHisto::clear()
+{
+    mBuckets.fill(0, HISTO_BUCKETS);
+    mCount = 0;
+    mSum = 0;
+    mMax = 0;
+}
+
+qint64 BsLatencyHisto::percentile(const double pct) const
+{
+    if ( mCount == 0 )
+        return 0;
+
+    qint64 target = qint64(mCount * pct / 100.0 + 0.5);
+    if ( target < 1 ) target = 1;
+
+    qint64 seen = 0;
+    for ( int i = 0; i < HISTO_BUCKETS; ++i ) {
+        seen += mBuckets.at(i);
+        if ( seen >= target ) {
+            //取桶中值，且不超过实测最大值
+            quint64 lower = lowerOf(i);
+            quint64 upper = (i + 1 < HISTO_BUCKETS) ? lowerOf(i + 1) : lower;
+            qint64 mid = qint64((lower + upper) / 2);
+            return (mid > mMax) ? mMax : mid;
+        }
+    }
+    return mMax;
+}
+
+int BsLatencyHisto::bucketOf(const quint64 value)
+{
+    //小于16的值一值一桶；之后每个2的幂区间按最高位后4位再分16桶
+    if ( value < HISTO_SUB_COUNT )
+        return int(value);
+
+    int msb = 63 - int(qCountLeadingZeroBits(value));
+    int shift = msb - HISTO_SUB_BITS;
+    int sub = int(value >> shift) & (HISTO_SUB_COUNT - 1);
+    int bucket = ((shift + 1) << HISTO_SUB_BITS) + sub;
+    return (bucket < HISTO_BUCKETS) ? bucket : HISTO_BUCKETS - 1;
+}
+
+quint64 BsLatencyHisto::lowerOf(const int bucket)
+{
+    if ( bucket < HISTO_SUB_COUNT )
+        return quint64(bucket);
+
+    int shift = (bucket >> HISTO_SUB_BITS) - 1;
+    int sub = bucket & (HISTO_SUB_COUNT - 1);
+    return quint64(HISTO_SUB_COUNT + sub) << shift;
+}
+
+
+// 网络服务运行统计单例 =======================================================================
+QMutex BsMetrics::mutex;
+BsMetrics* BsMetrics::instance = nullptr;
+
+void BsMetrics::recordRequest(const QString &reqType, const qint64 usecs)
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+    QMutexLocker locker(&mutex);
+    inst.mRequestHistos[reqType].record(usecs);
+    inst.mWindowHisto.record(usecs);
+}
+
+void BsMetrics::recordStage(const Stage stage, const qint64 usecs)
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+    QMutexLocker locker(&mutex);
+    inst.mStageHistos[stage].record(usecs);
+}
+
+void BsMetrics::recordBytesIn(const QByteArray &frontId, const qint64 bytes)
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+    QMutexLocker locker(&mutex);
+    FrontTraffic &traffic = inst.mFrontTraffics[frontId];
+    traffic.requests++;
+    traffic.bytesIn += bytes;
+}
+
+void BsMetrics::recordBytesOut(const QByteArray &frontId, const qint64 bytes)
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+    QMutexLocker locker(&mutex);
+    inst.mFrontTraffics[frontId].bytesOut += bytes;
+}
+
+void BsMetrics::recordQueueDepth(const int depth)
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+    QMutexLocker locker(&mutex);
+    inst.mQueueDepth = depth;
+    if ( depth > inst.mQueueDepthMax ) inst.mQueueDepthMax = depth;
+}
+
+void BsMetrics::reset()
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+    QMutexLocker locker(&mutex);
+    inst.mRequestHistos.clear();
+    for ( int i = 0; i < StageCount; ++i ) {
+        inst.mStageHistos[i].clear();
+    }
+    inst.mFrontTraffics.clear();
+    inst.mQueueDepth = 0;
+    inst.mQueueDepthMax = 0;
+    inst.mSince = QDateTime::currentDateTime();
+}
+
+qint64 BsMetrics::takeWindowP95()
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+    QMutexLocker locker(&mutex);
+    qint64 p95 = inst.mWindowHisto.percentile(95);
+    inst.mWindowHisto.clear();
+    return p95;
+}
+
+QStringList BsMetrics::snapshotHeaders()
+{
+    QStringList headers;
+    headers << QStringLiteral("项目") << QStringLiteral("计数") << QStringLiteral("均值ms")
+            << QStringLiteral("P50ms") << QStringLiteral("P95ms") << QStringLiteral("P99ms")
+            << QStringLiteral("最大ms") << QStringLiteral("备注");
+    return headers;
+}
+
+QList<QStringList> BsMetrics::snapshotRows()
+{
+    BsMetrics& inst = BsMetrics::getInstance();
+
+    //先拷贝，避免持锁查前端名
+    QMap<QString, BsLatencyHisto> reqHistos;
+    QList<BsLatencyHisto> stageHistos;
+    QHash<QByteArray, FrontTraffic> traffics;
+    int queueDepth, queueDepthMax;
+    {
+        QMutexLocker locker(&mutex);
+        reqHistos = inst.mRequestHistos;
+        for ( int i = 0; i < StageCount; ++i ) {
+            stageHistos << inst.mStageHistos[i];
+        }
+        traffics = inst.mFrontTraffics;
+        queueDepth = inst.mQueueDepth;
+        queueDepthMax = inst.mQueueDepthMax;
+    }
+
+    auto histoRow = [](const QString &name, const BsLatencyHisto &histo, const QString &remark) {
+        QStringList row;
+        row << name
+            << QString::number(histo.count())
+            << QString::number(histo.mean() / 1000.0, 'f', 2)
+            << QString::number(histo.percentile(50) / 1000.0, 'f', 2)
+            << QString::number(histo.percentile(95) / 1000.0, 'f', 2)
+            << QString::number(histo.percentile(99) / 1000.0, 'f', 2)
+            << QString::number(histo.maxValue() / 1000.0, 'f', 2)
+            << remark;
+        return row;
+    };
+
+    QList<QStringList> rows;
+
+    //请求类型
+    QMapIterator<QString, BsLatencyHisto> it(reqHistos);
+    while ( it.hasNext() ) {
+        it.next();
+        rows << histoRow(it.key(), it.value(), QStringLiteral("请求总耗时"));
+    }
+
+    //处理环节
+    for ( int i = 0; i < StageCount; ++i ) {
+        rows << histoRow(stageName(i), stageHistos.at(i), QStringLiteral("环节耗时"));
+    }
+
+    //队列
+    QStringList depthRow;
+    depthRow << QStringLiteral("待办队列") << QString::number(queueDepth)
+             << QString() << QString() << QString() << QString() << QString()
+             << QStringLiteral("当前深度%1，峰值%2").arg(queueDepth).arg(queueDepthMax);
+    rows << depthRow;
+
+    //前端流量
+    QHashIterator<QByteArray, FrontTraffic> ft(traffics);
+    while ( ft.hasNext() ) {
+        ft.next();
+        BsFronter *fronter = BsFronterMap::frontOfId(QString::fromLatin1(ft.key()));
+        QString name = (fronter) ? fronter->mName : QString::fromLatin1(ft.key());
+        QStringList row;
+        row << name << QString::number(ft.value().requests)
+            << QString() << QString() << QString() << QString() << QString()
+            << QStringLiteral("收%1KB 发%2KB")
+               .arg(ft.value().bytesIn / 1024.0, 0, 'f', 1)
+               .arg(ft.value().bytesOut / 1024.0, 0, 'f', 1);
+        rows << row;
+    }
+
+    return rows;
+}
+
+bool BsMetrics::dumpToFile(const QString &fileName)
+{
+    QFile file(fileName);
+    if ( !file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text) )
+        return false;
+
+    BsMetrics& inst = BsMetrics::getInstance();
+    QDateTime since;
+    {
+        QMutexLocker locker(&mutex);
+        since = inst.mSince;
+    }
+
+    QTextStream out(&file);
+    out.setCodec("UTF-8");
+    out << QStringLiteral("==== %1 (since %2) ====\n")
+           .arg(QDateTime::currentDateTime().toString(QStringLiteral("yyyy-MM-dd hh:mm:ss")))
+           .arg(since.toString(QStringLiteral("yyyy-MM-dd hh:mm:ss")));
+    out << snapshotHeaders().join(QChar('\t')) << "\n";
+    QList<QStringList> rows = snapshotRows();
+    for ( int i = 0, iLen = rows.length(); i < iLen; ++i ) {
+        out << rows.at(i).join(QChar('\t')) << "\n";
+    }
+    file.close();
+    return true;
+}
+
+BsMetrics &BsMetrics::getInstance()
+{
+    if (nullptr == instance) {
+        QMutexLocker locker(&mutex);
+        if (nullptr == instance) {
+            instance = new BsMetrics();
+            instance->mSince = QDateTime::currentDateTime();
+        }
+    }
+    return *instance;
+}
+
+QString BsMetrics::stageName(const int stage)
+{
+    switch ( stage ) {
+    case StageDecrypt:  return QStringLiteral("解密");
+    case StageUnzip:    return QStringLiteral("解压");
+    case StageHandle:   return QStringLiteral("SQL处理");
+    case StageZip:      return QStringLiteral("压缩");
+    case StageEncrypt:  return QStringLiteral("加密");
+    case StageWrite:    return QStringLiteral("网络写出");
+    default:            return QString();
+    }
+}
+
+}
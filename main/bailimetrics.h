@@ -0,0 +1,83 @@
+#ifndef BAILIMETRICS_H
+#define BAILIMETRICS_H
+
+#include <QtCore>
+
+namespace BailiSoft {
+
+// 延时直方图（HDR式对数线性分桶，单位微秒，每2倍区间16个子桶，相对误差约6%）=================
+class BsLatencyHisto
+{
+public:
+    BsLatencyHisto();
+
+    void record(const qint64 usecs);
+    void clear();
+    qint64 percentile(const double pct) const;
+    qint64 count() const { return mCount; }
+    qint64 maxValue() const { return mMax; }
+    qint64 mean() const { return (mCount > 0) ? mSum / mCount : 0; }
+
+private:
+    static int bucketOf(const quint64 value);
+    static quint64 lowerOf(const int bucket);
+
+    QVector<qint64>     mBuckets;
+    qint64              mCount;
+    qint64              mSum;
+    qint64              mMax;
+};
+
+
+// 网络服务运行统计单例 ============================================================================
+class BsMetrics
+{
+public:
+    enum Stage {
+        StageDecrypt,
+        StageUnzip,
+        StageHandle,    //SQL执行及buildSqlData
+        StageZip,
+        StageEncrypt,
+        StageWrite,     //BsSocketWriter入队至写出
+        StageCount
+    };
+
+    static void recordRequest(const QString &reqType, const qint64 usecs);
+    static void recordStage(const Stage stage, const qint64 usecs);
+    static void recordBytesIn(const QByteArray &frontId, const qint64 bytes);
+    static void recordBytesOut(const QByteArray &frontId, const qint64 bytes);
+    static void recordQueueDepth(const int depth);
+    static void reset();
+    static qint64 takeWindowP95();      //自上次调用以来全部请求的P95（微秒），取后清零，供线程池伸缩判断
+
+    //项目、计数、均值ms、P50ms、P95ms、P99ms、最大ms、备注
+    static QList<QStringList> snapshotRows();
+    static QStringList snapshotHeaders();
+    static bool dumpToFile(const QString &fileName);
+
+private:
+    static BsMetrics& getInstance();
+    static QString stageName(const int stage);
+
+    struct FrontTraffic {
+        qint64  requests = 0;
+        qint64  bytesIn = 0;
+        qint64  bytesOut = 0;
+    };
+
+    QMap<QString, BsLatencyHisto>       mRequestHistos;
+    BsLatencyHisto                      mWindowHisto;
+    BsLatencyHisto                      mStageHistos[StageCount];
+    QHash<QByteArray, FrontTraffic>     mFrontTraffics;
+    int                                 mQueueDepth = 0;
+    int                                 mQueueDepthMax = 0;
+    QDateTime                           mSince;
+
+    static QMutex                   mutex;
+    static BsMetrics *              instance;
+};
+
+}
+
+#endif // BAILIMETRICS_H
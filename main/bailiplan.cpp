@@ -0,0 +1,183 @@
+#include "bailiplan.h"
+
+#define PLAN_MAX_ENTRIES    300
+
+namespace BailiSoft {
+
+QMutex BsPlanAdvisor::mutex;
+QList<BsPlanEntry> BsPlanAdvisor::planEntries;
+QHash<QString, int> BsPlanAdvisor::shapeIndexes;
+
+void BsPlanAdvisor::capture(const QString &source, const QString &sql)
+{
+    //只记录查询类（含建临时表AS SELECT、INSERT...SELECT）
+    if ( sql.indexOf(QStringLiteral("select"), 0, Qt::CaseInsensitive) < 0 )
+        return;
+
+    QString shape = shapeOf(sql);
+    QMutexLocker locker(&mutex);
+    int idx = shapeIndexes.value(shape, -1);
+    if ( idx >= 0 ) {
+        planEntries[idx].sample = sql;
+        planEntries[idx].hits++;
+        return;
+    }
+    if ( planEntries.length() >= PLAN_MAX_ENTRIES )
+        return;
+
+    BsPlanEntry entry;
+    entry.source = source;
+    entry.shape = shape;
+    entry.sample = sql;
+    entry.hits = 1;
+    shapeIndexes.insert(shape, planEntries.length());
+    planEntries << entry;
+}
+
+QList<BsPlanEntry> BsPlanAdvisor::entries()
+{
+    QMutexLocker locker(&mutex);
+    return planEntries;
+}
+
+void BsPlanAdvisor::clear()
+{
+    QMutexLocker locker(&mutex);
+    planEntries.clear();
+    shapeIndexes.clear();
+}
+
+QList<BsPlanReport> BsPlanAdvisor::analyze(QSqlDatabase &db, QMap<QString, int> *indexUses)
+{
+    QList<BsPlanReport> reports;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+
+    //账册表及已有索引（含各索引字段序列，用于判断建议是否已被覆盖）
+    QSet<QString> bookTables;
+    QHash<QString, QList<QStringList> > tableIndexCols;
+    QMap<QString, int> uses;
+    qry.exec(QStringLiteral("select type, name, tbl_name from sqlite_master "
+                            "where type in ('table','index') and name not like 'sqlite_%';"));
+    QStringList indexNames, indexTables;
+    while ( qry.next() ) {
+        if ( qry.value(0).toString() == QStringLiteral("table") ) {
+            bookTables << qry.value(1).toString().toLower();
+        } else {
+            indexNames << qry.value(1).toString();
+            indexTables << qry.value(2).toString().toLower();
+        }
+    }
+    qry.finish();
+    for ( int i = 0, iLen = indexNames.length(); i < iLen; ++i ) {
+        QStringList cols;
+        qry.exec(QStringLiteral("PRAGMA index_info(%1);").arg(indexNames.at(i)));
+        while ( qry.next() ) {
+            cols << qry.value(2).toString().toLower();
+        }
+        qry.finish();
+        tableIndexCols[indexTables.at(i)] << cols;
+        uses.insert(indexNames.at(i), 0);
+    }
+
+    //逐条分析
+    QRegularExpression rePlan(QStringLiteral("^(SCAN|SEARCH)\\s+(?:TABLE\\s+)?(\\S+)(?:\\s+AS\\s+\\S+)?"
+                                             "(?:\\s+USING\\s+(AUTOMATIC\\s+)?(?:PARTIAL\\s+)?(?:COVERING\\s+)?INDEX\\s*(\\S*))?"));
+    QList<BsPlanEntry> list = entries();
+    for ( int i = 0, iLen = list.length(); i < iLen; ++i ) {
+        BsPlanReport report;
+        report.entry = list.at(i);
+
+        QString sql = report.entry.sample.trimmed();
+        qry.exec(QStringLiteral("EXPLAIN QUERY PLAN %1").arg(sql));
+        if ( qry.lastError().isValid() ) {
+            report.error = qry.lastError().text();
+            reports << report;
+            continue;
+        }
+        int detailCol = qry.record().count() - 1;
+        while ( qry.next() ) {
+            QString detail = qry.value(detailCol).toString();
+            report.details << detail;
+
+            QRegularExpressionMatch m = rePlan.match(detail);
+            if ( !m.hasMatch() )
+                continue;
+            QString table = m.captured(2).toLower();
+            if ( !bookTables.contains(table) )
+                continue;   //子查询、临时表等
+
+            bool automatic = !m.captured(3).isEmpty();
+            QString index = m.captured(4);
+            if ( !index.isEmpty() && !automatic ) {
+                if ( !report.usedIndexes.contains(index) )
+                    report.usedIndexes << index;
+                if ( uses.contains(index) )
+                    uses[index] += report.entry.hits;
+            }
+            else if ( automatic || m.captured(1) == QStringLiteral("SCAN") ) {
+                if ( !report.fullScans.contains(table) ) {
+                    report.fullScans << table;
+                    report.proposals << proposeIndexes(table, sql, tableIndexCols.value(table));
+                }
+            }
+        }
+        qry.finish();
+        report.proposals.removeDuplicates();
+        reports << report;
+    }
+
+    if ( indexUses ) *indexUses = uses;
+    return reports;
+}
+
+QString BsPlanAdvisor::shapeOf(const QString &sql)
+{
+    QString shape = sql.simplified();
+    shape.replace(QRegularExpression(QStringLiteral("'(?:[^']|'')*'")), QStringLiteral("?"));
+    shape.replace(QRegularExpression(QStringLiteral("\\b\\d+\\b")), QStringLiteral("?"));
+    return shape;
+}
+
+QStringList BsPlanAdvisor::proposeIndexes(const QString &table, const QString &sql,
+                                          const QList<QStringList> &existIndexCols)
+{
+    //等值过滤字段在前，范围字段（日期、审核时间）一个在后
+    QStringList eqCols, rangeCols;
+    if ( table.endsWith(QStringLiteral("dtl")) ) {
+        eqCols << QStringLiteral("cargo") << QStringLiteral("color");
+    } else {
+        eqCols << QStringLiteral("shop") << QStringLiteral("trader") << QStringLiteral("stype") << QStringLiteral("staff");
+        rangeCols << QStringLiteral("dated") << QStringLiteral("chktime");
+    }
+
+    auto usedInSql = [&sql](const QString &col) {
+        QRegularExpression re(QStringLiteral("\\b%1\\s*(=|<|>|\\bIN\\b|\\bLIKE\\b|\\bBETWEEN\\b)").arg(col),
+                              QRegularExpression::CaseInsensitiveOption);
+        return re.match(sql).hasMatch();
+    };
+
+    QStringList cols;
+    for ( int i = 0, iLen = eqCols.length(); i < iLen; ++i ) {
+        if ( usedInSql(eqCols.at(i)) ) cols << eqCols.at(i);
+    }
+    for ( int i = 0, iLen = rangeCols.length(); i < iLen; ++i ) {
+        if ( usedInSql(rangeCols.at(i)) ) {
+            cols << rangeCols.at(i);
+            break;
+        }
+    }
+    if ( cols.isEmpty() )
+        return QStringList();
+
+    //已有索引字段序列以此为前缀者即已覆盖
+    for ( int i = 0, iLen = existIndexCols.length(); i < iLen; ++i ) {
+        if ( existIndexCols.at(i).mid(0, cols.length()) == cols )
+            return QStringList();
+    }
+
+    return QStringList() << QStringLiteral("CREATE INDEX IF NOT EXISTS idxadv%1%2 ON %1(%3);")
+                            .arg(table, cols.join(QString()), cols.join(QChar(',')));
+}
+
+}
@@ -0,0 +1,52 @@
+#ifndef BAILIPLAN_H
+#define BAILIPLAN_H
+
+#include <QtCore>
+#include <QtSql>
+
+namespace BailiSoft {
+
+struct BsPlanEntry
+{
+    QString     source;         //来源（desk:表名、net等）
+    QString     shape;          //字面值替换为?后的语句形状，用作去重键
+    QString     sample;         //最近一次原始语句，用于EXPLAIN
+    int         hits = 0;
+};
+
+struct BsPlanReport
+{
+    BsPlanEntry     entry;
+    QStringList     details;        //EXPLAIN QUERY PLAN各行
+    QStringList     fullScans;      //全表扫描（或自动临时索引）的账册表
+    QStringList     usedIndexes;
+    QStringList     proposals;      //建议索引CREATE语句
+    QString         error;
+};
+
+// 查询计划记录与索引建议 ============================================================================
+// 各处生成的统计查询SQL按形状去重记录（有上限），工具窗口分析时逐条EXPLAIN QUERY PLAN，
+// 标出全表扫描，按语句中的过滤字段对该表提出复合索引建议，并汇总各索引实际被使用次数。
+class BsPlanAdvisor
+{
+public:
+    static void capture(const QString &source, const QString &sql);
+    static QList<BsPlanEntry> entries();
+    static void clear();
+
+    //indexUses返回各已有索引被计划使用次数（按记录次数加权，未用者为0）
+    static QList<BsPlanReport> analyze(QSqlDatabase &db, QMap<QString, int> *indexUses);
+
+private:
+    static QString shapeOf(const QString &sql);
+    static QStringList proposeIndexes(const QString &table, const QString &sql,
+                                      const QList<QStringList> &existIndexCols);
+
+    static QMutex                       mutex;
+    static QList<BsPlanEntry>           planEntries;
+    static QHash<QString, int>          shapeIndexes;
+};
+
+}
+
+#endif // BAILIPLAN_H
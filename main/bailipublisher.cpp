@@ -1,6 +1,8 @@
 #include "bailipublisher.h"
 #include "bailifunc.h"
 #include "bailicustom.h"
+#include "bailistore.h"
+#include "bailicatalog.h"
 
 #include <QtSql>
 #include <QNetworkAccessManager>
@@ -64,9 +66,7 @@ void BsPublisher::run()
         QString dbConnName = generateRandomString(8) + mDatabaseFile;
         {
             QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), dbConnName);
-            db.setDatabaseName(mDatabaseFile);
-            db.setConnectOptions("QSQLITE_OPEN_READONLY;");
-            if ( !db.open() ) {
+            if ( !openBookDatabase(db, mDatabaseFile, true) ) {
                 qDebug() << "conn database failed in web thread." << db.lastError() << mDatabaseFile;
                 break;
             }
@@ -99,35 +99,33 @@ void BsPublisher::run()
 
             //是否定过坐标
             qint64 x = 0, y = 0;
-            QString sql = QStringLiteral("select amgeo from shop where kname='%1';").arg(job.mShop);
-            qry.exec(sql);
-            if ( qry.next() ) {
-                QStringList pairs = qry.value(0).toString().split(QChar(','));
-                if ( pairs.length() == 2 ) {
-                    double fx = QString(pairs.at(0)).toDouble();
-                    double fy = QString(pairs.at(1)).toDouble();
-                    x = 1000000 * (fx + 0.00000001);
-                    y = 1000000 * (fy + 0.00000001);
-                }
+            BsCatalogPtr shops = BsCatalog::acquire(db, QStringLiteral("shop"));
+            QStringList pairs = shops->value(job.mShop, QStringLiteral("amgeo")).split(QChar(','));
+            if ( pairs.length() == 2 ) {
+                double fx = QString(pairs.at(0)).toDouble();
+                double fy = QString(pairs.at(1)).toDouble();
+                x = 1000000 * (fx + 0.00000001);
+                y = 1000000 * (fy + 0.00000001);
             }
             if ( x == 0 && y == 0 ) {
-                qry.finish();
                 continue;
             }
 
-            //本店全部标签库存
+            //本店全部标签库存（标签取自货品目录快照，不再联表）
+            BsCatalogPtr cargos = BsCatalog::acquire(db, QStringLiteral("cargo"));
             QMap<QString, QStringList> mapPubs;   //tag, cargos
-            sql = QStringLiteral("select b.amtag, a.cargo, sum(a.qty) as stock "
-                                 "from vi_stock as a "
-                                 "inner join cargo as b on a.cargo=b.hpcode "
-                                 "where a.shop='%1' and chktime>0 and length(b.amtag) > 0 "
-                                 "group by b.amtag, a.cargo "
-                                 "having sum(a.qty)>0;").arg(job.mShop);
+            QString sql = QStringLiteral("select cargo, sum(qty) as stock "
+                                         "from vi_stock "
+                                         "where shop='%1' and chktime>0 "
+                                         "group by cargo "
+                                         "having sum(qty)>0;").arg(job.mShop);
             qry.exec(sql);
             while ( qry.next() ) {
-                QString k = qry.value(0).toString();
+                QString cargo = qry.value(0).toString().trimmed();
+                QString k = cargos->value(cargo, QStringLiteral("amtag"));
+                if ( k.isEmpty() ) continue;
                 QStringList v = mapPubs.value(k);
-                v << qry.value(1).toString().trimmed();
+                v << cargo;
                 mapPubs.insert(k, v);
             }
             qry.finish();
@@ -153,14 +151,12 @@ void BsPublisher::run()
             else {
                 //仅提交本单涉及标签
                 QSet<QString> setRels;
-                sql = QStringLiteral("select b.amtag, sum(a.qty) as sumqty "
-                                     "from vi_%1 as a inner join cargo as b on a.cargo=b.hpcode "
-                                     "where a.sheetid=%2 and length(b.amtag)>0 "
-                                     "group by b.amtag;")
+                sql = QStringLiteral("select distinct cargo from vi_%1 where sheetid=%2;")
                         .arg(job.mRelSheetTable).arg(job.mRelSheetId);
                 qry.exec(sql);
                 while ( qry.next() ) {
-                    setRels.insert(qry.value(0).toString());
+                    QString tag = cargos->value(qry.value(0).toString().trimmed(), QStringLiteral("amtag"));
+                    if ( !tag.isEmpty() ) setRels.insert(tag);
                 }
                 qry.finish();
 
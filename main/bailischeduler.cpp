@@ -0,0 +1,244 @@
+#include "bailischeduler.h"
+
+namespace BailiSoft {
+
+//各通道权重：交互写 > 轻查询 > 聊天 > 重报表
+static const int laneWeights[BsLaneCount] = { 8, 4, 2, 1 };
+
+BsScheduler::BsScheduler()
+{
+    for ( int i = 0; i < BsLaneCount; ++i ) {
+        mLaneLimits[i] = 0;
+        mLaneRunnings[i] = 0;
+        mLaneCredits[i] = 0;
+    }
+}
+
+void BsScheduler::reset()
+{
+    QMutexLocker locker(&mMutex);
+    mOwnerQueues.clear();
+    mReadyOwners.clear();
+    mBusyOwners.clear();
+    for ( int i = 0; i < BsLaneCount; ++i ) {
+        mParkeds[i].clear();
+        mLaneRunnings[i] = 0;
+        mLaneCredits[i] = 0;
+    }
+    mPendings = 0;
+    mRetires = 0;
+    mStopping = false;
+}
+
+void BsScheduler::stop()
+{
+    QMutexLocker locker(&mMutex);
+    mStopping = true;
+    mTaskReady.wakeAll();
+    mPinnedReady.wakeAll();
+}
+
+//让任一空闲线程取到空任务而结束（线程池收缩用，专用线程不参与）
+void BsScheduler::retireOne()
+{
+    QMutexLocker locker(&mMutex);
+    mRetires++;
+    mTaskReady.wakeOne();
+}
+
+int BsScheduler::retiringCount()
+{
+    QMutexLocker locker(&mMutex);
+    return mRetires;
+}
+
+void BsScheduler::setLanes(const QList<int> &limits, const int pinnedLane)
+{
+    QMutexLocker locker(&mMutex);
+    for ( int i = 0; i < BsLaneCount; ++i ) {
+        mLaneLimits[i] = ( i < limits.length() && limits.at(i) > 0 ) ? limits.at(i) : 0;
+    }
+    mPinnedLane = ( pinnedLane >= 0 && pinnedLane < BsLaneCount ) ? pinnedLane : -1;
+}
+
+void BsScheduler::enqueue(const BsFrame &frame)
+{
+    QByteArray owner = ownerKeyOf(frame);
+
+    QMutexLocker locker(&mMutex);
+    QQueue<BsFrame> &queue = mOwnerQueues[owner];
+    queue.enqueue(frame);
+    mPendings++;
+
+    //该前端此前无待办且无人处理时才进入就绪队列，否则由处理线程完成后接续
+    if ( queue.length() == 1 && !mBusyOwners.contains(owner) ) {
+        mReadyOwners.enqueue(owner);
+        mTaskReady.wakeOne();
+    }
+}
+
+//task既是入参也是出参：入参为本线程上一任务（据此释放前端与通道名额），出参为新任务。
+//返回false表示服务停止或本线程被退役，线程应退出。
+bool BsScheduler::takeTask(BsTermTask *task, const int pinnedLane)
+{
+    QMutexLocker locker(&mMutex);
+
+    //释放上一任务
+    releaseTask(task);
+
+    forever {
+        if ( mStopping ) {
+            return false;
+        }
+
+        //专用线程只取本通道暂存任务
+        if ( pinnedLane >= 0 ) {
+            if ( !mParkeds[pinnedLane].isEmpty() ) {
+                *task = mParkeds[pinnedLane].dequeue();
+                task->admitted = true;
+                mLaneRunnings[pinnedLane]++;
+                mPendings--;
+                return true;
+            }
+            mPinnedReady.wait(&mMutex);
+            continue;
+        }
+
+        //退役
+        if ( mRetires > 0 ) {
+            mRetires--;
+            return false;
+        }
+
+        //已解码暂存任务优先（按权重轮转）
+        int lane = pickParkedLane();
+        if ( lane >= 0 ) {
+            *task = mParkeds[lane].dequeue();
+            task->admitted = true;
+            mLaneRunnings[lane]++;
+            mPendings--;
+            return true;
+        }
+
+        //新到帧
+        if ( !mReadyOwners.isEmpty() ) {
+            QByteArray owner = mReadyOwners.dequeue();
+            QQueue<BsFrame> &queue = mOwnerQueues[owner];
+            task->frame = queue.dequeue();
+            if ( queue.isEmpty() ) {
+                mOwnerQueues.remove(owner);
+            }
+            mBusyOwners.insert(owner);
+            mPendings--;
+            task->owner = owner;
+            return true;
+        }
+
+        //阻塞等任务
+        mTaskReady.wait(&mMutex);
+    }
+}
+
+//解码分类后申请通道名额。返回false表示任务已暂存（前端保持占用以保序），调用线程应去取别的任务。
+bool BsScheduler::admit(BsTermTask *task)
+{
+    QMutexLocker locker(&mMutex);
+
+    int lane = task->lane;
+    if ( lane < 0 || lane >= BsLaneCount ) {
+        return true;
+    }
+
+    bool toPinned = ( lane == mPinnedLane );
+    bool full = ( mLaneLimits[lane] > 0 && mLaneRunnings[lane] >= mLaneLimits[lane] );
+    if ( !toPinned && !full ) {
+        task->admitted = true;
+        mLaneRunnings[lane]++;
+        return true;
+    }
+
+    //暂存
+    mParkeds[lane].enqueue(*task);
+    mPendings++;
+    if ( toPinned )
+        mPinnedReady.wakeAll();
+
+    //调用线程交出任务但不释放前端
+    *task = BsTermTask();
+    return false;
+}
+
+int BsScheduler::pendingCount()
+{
+    QMutexLocker locker(&mMutex);
+    return mPendings;
+}
+
+//普通线程此刻能取走的任务数：就绪前端各一帧，加各通道名额内的暂存任务。
+//前端正忙排队的帧、通道满额或归专用线程的暂存任务，加线程也取不走，不计。
+int BsScheduler::dispatchableCount()
+{
+    QMutexLocker locker(&mMutex);
+    int count = mReadyOwners.length();
+    for ( int i = 0; i < BsLaneCount; ++i ) {
+        if ( i == mPinnedLane || mParkeds[i].isEmpty() )
+            continue;
+        int room = ( mLaneLimits[i] > 0 ) ? qMax(0, mLaneLimits[i] - mLaneRunnings[i]) : mParkeds[i].length();
+        count += qMin(room, mParkeds[i].length());
+    }
+    return count;
+}
+
+QByteArray BsScheduler::ownerKeyOf(const BsFrame &frame)
+{
+    //REQ帧头后16字节为前端ID，RPT报告不属于任何前端，共用保留键。key要长期保存，必须深拷贝。
+    return ( frame.startsWith("REQ") ) ? frame.copy(3, 16) : QByteArray(SCHED_RPT_OWNER);
+}
+
+//持锁调用
+void BsScheduler::releaseTask(BsTermTask *task)
+{
+    //通道名额
+    if ( task->admitted && task->lane >= 0 ) {
+        mLaneRunnings[task->lane]--;
+        if ( !mParkeds[task->lane].isEmpty() ) {
+            if ( task->lane == mPinnedLane )
+                mPinnedReady.wakeAll();
+            else
+                mTaskReady.wakeOne();
+        }
+    }
+
+    //前端（暂存交出后的空任务不占前端，不能误释放）
+    if ( !task->owner.isEmpty() && mBusyOwners.remove(task->owner) ) {
+        if ( !mOwnerQueues.value(task->owner).isEmpty() ) {
+            mReadyOwners.enqueue(task->owner);
+            mTaskReady.wakeOne();
+        }
+    }
+
+    *task = BsTermTask();
+}
+
+//持锁调用。平滑加权轮转：可取通道各加权重，取当前值最大者，再减去可取通道权重和。
+int BsScheduler::pickParkedLane()
+{
+    int picked = -1;
+    int totalWeight = 0;
+    for ( int i = 0; i < BsLaneCount; ++i ) {
+        if ( i == mPinnedLane || mParkeds[i].isEmpty() )
+            continue;
+        if ( mLaneLimits[i] > 0 && mLaneRunnings[i] >= mLaneLimits[i] )
+            continue;
+        mLaneCredits[i] += laneWeights[i];
+        totalWeight += laneWeights[i];
+        if ( picked < 0 || mLaneCredits[i] > mLaneCredits[picked] )
+            picked = i;
+    }
+    if ( picked >= 0 ) {
+        mLaneCredits[picked] -= totalWeight;
+    }
+    return picked;
+}
+
+}
@@ -0,0 +1,76 @@
+#ifndef BAILISCHEDULER_H
+#define BAILISCHEDULER_H
+
+#include <QtCore>
+#include "bailiframe.h"
+
+#define SCHED_RPT_OWNER     "RPT"       //RPT报告共用的前端键，非16字节不会与前端ID相同
+
+namespace BailiSoft {
+
+//请求调度通道（帧体加密，入队时无法区分，由terminator解码后按路由声明归类）
+enum BsTermLane {
+    BsLaneWrite,        //收银开单等交互写
+    BsLaneLookup,       //单据、货品、图片等轻查询
+    BsLaneReport,       //汇总统计等重报表
+    BsLaneChat,         //聊天与群管理
+    BsLaneCount
+};
+
+//调度任务（lane为-1表示新到未解码帧）
+struct BsTermTask
+{
+    BsFrame         frame;
+    QByteArray      owner;              //前端ID（RPT报告为SCHED_RPT_OWNER，空表示未占用前端）
+    int             lane = -1;
+    QString         pack;               //解码后的请求包，暂存再取时免重复解密解压
+    QElapsedTimer   timer;              //自解码开始计时，含暂存等待
+    bool            admitted = false;   //占用通道并发名额
+};
+
+// 终端任务调度器 ============================================================================
+// 所有BsTerminator共享一个调度器，任何空闲线程都可取走任一前端的待办帧，慢查询不再堵住其他线程的队列。
+// 同一前端的帧严格按到达顺序逐个执行（帧体加密，入队时无法区分请求类型，故按前端整体串行，
+// 这样BIZINSERT/BIZEDIT等写操作天然保序）。
+// 解码后各通道有并发上限，超限任务暂存到通道队列，释放名额时按权重轮转优先取出，
+// 重报表因此不会占满全部线程。某通道可指定一个专用线程，则该通道任务只由专用线程执行。
+class BsScheduler
+{
+public:
+    BsScheduler();
+
+    void reset();
+    void stop();
+    void retireOne();
+    int retiringCount();
+    void setLanes(const QList<int> &limits, const int pinnedLane);
+    void enqueue(const BsFrame &frame);
+    bool takeTask(BsTermTask *task, const int pinnedLane = -1);
+    bool admit(BsTermTask *task);
+    int pendingCount();
+    int dispatchableCount();
+
+private:
+    static QByteArray ownerKeyOf(const BsFrame &frame);
+    void releaseTask(BsTermTask *task);
+    int pickParkedLane();
+
+    QMutex                                  mMutex;
+    QWaitCondition                          mTaskReady;
+    QWaitCondition                          mPinnedReady;   //专用线程等待
+    QHash<QByteArray, QQueue<BsFrame> >     mOwnerQueues;   //key: frontId（RPT报告共用SCHED_RPT_OWNER）
+    QQueue<QByteArray>                      mReadyOwners;   //有待办且当前无线程在处理的前端
+    QSet<QByteArray>                        mBusyOwners;    //正有线程处理的前端
+    QQueue<BsTermTask>                      mParkeds[BsLaneCount];
+    int                                     mLaneLimits[BsLaneCount];   //0为不限
+    int                                     mLaneRunnings[BsLaneCount];
+    int                                     mLaneCredits[BsLaneCount];  //平滑加权轮转当前值
+    int                                     mPinnedLane = -1;
+    int                                     mPendings = 0;
+    int                                     mRetires = 0;     //待退役线程数（线程池收缩）
+    bool                                    mStopping = false;
+};
+
+}
+
+#endif // BAILISCHEDULER_H
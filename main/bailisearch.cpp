@@ -0,0 +1,119 @@
+#include "bailisearch.h"
+#include <algorithm>
+
+namespace BailiSoft {
+
+static inline quint32 gramKey(const QChar a, const QChar b)
+{
+    return (quint32(a.unicode()) << 16) | b.unicode();
+}
+
+void BsSearchIndex::build(const QStringList &codes, const QStringList &names, const QStringList &initials,
+                          const QVector<int> &sortedRows)
+{
+    mCodes.clear();
+    mNames.clear();
+    mInitials.clear();
+    mGrams.clear();
+
+    int count = codes.length();
+    mOrder.fill(0, count);
+    for ( int i = 0, iLen = sortedRows.length(); i < iLen; ++i ) {
+        mOrder[sortedRows.at(i)] = i;
+    }
+
+    for ( int row = 0; row < count; ++row ) {
+        mCodes << codes.at(row).toLower();
+        mNames << ( ( row < names.length() ) ? names.at(row).toLower() : QString() );
+        mInitials << ( ( row < initials.length() ) ? initials.at(row).toLower() : QString() );
+        addGrams(mCodes.at(row), row);
+        addGrams(mNames.at(row), row);
+        addGrams(mInitials.at(row), row);
+    }
+}
+
+//行号递增加入，故各倒排表有序且只需查末位去重
+void BsSearchIndex::addGrams(const QString &text, const int row)
+{
+    for ( int i = 0, iLen = text.length(); i < iLen; ++i ) {
+        QVector<int> &singles = mGrams[text.at(i).unicode()];
+        if ( singles.isEmpty() || singles.last() != row )
+            singles << row;
+
+        if ( i + 1 < iLen ) {
+            QVector<int> &pairs = mGrams[gramKey(text.at(i), text.at(i + 1))];
+            if ( pairs.isEmpty() || pairs.last() != row )
+                pairs << row;
+        }
+    }
+}
+
+int BsSearchIndex::score(const int row, const QString &lowerTerm) const
+{
+    const QString &code = mCodes.at(row);
+    if ( code == lowerTerm )                        return 0;
+    if ( code.startsWith(lowerTerm) )               return 1;
+    if ( mInitials.at(row).startsWith(lowerTerm) )  return 2;
+    if ( mNames.at(row).startsWith(lowerTerm) )     return 3;
+    if ( code.contains(lowerTerm) )                 return 4;
+    if ( mInitials.at(row).contains(lowerTerm) || mNames.at(row).contains(lowerTerm) )
+        return 5;
+    return -1;
+}
+
+QVector<int> BsSearchIndex::search(const QString &term, const int limit, bool *truncated,
+                                   const BsSearchFilter &filter) const
+{
+    QString lowerTerm = term.trimmed().toLower();
+    if ( truncated ) *truncated = false;
+    if ( lowerTerm.isEmpty() )
+        return QVector<int>();
+
+    //取最短倒排表作候选，任一字组无记录即无结果
+    const QVector<int> *shortest = nullptr;
+    int gramCount = ( lowerTerm.length() == 1 ) ? 1 : lowerTerm.length() - 1;
+    for ( int i = 0; i < gramCount; ++i ) {
+        quint32 key = ( lowerTerm.length() == 1 )
+                ? lowerTerm.at(0).unicode()
+                : gramKey(lowerTerm.at(i), lowerTerm.at(i + 1));
+        QHash<quint32, QVector<int> >::const_iterator it = mGrams.constFind(key);
+        if ( it == mGrams.constEnd() )
+            return QVector<int>();
+        if ( !shortest || it.value().length() < shortest->length() )
+            shortest = &it.value();
+    }
+
+    return ranked(*shortest, lowerTerm, limit, truncated, filter);
+}
+
+QVector<int> BsSearchIndex::refine(const QVector<int> &rows, const QString &term, const int limit,
+                                   bool *truncated, const BsSearchFilter &filter) const
+{
+    return ranked(rows, term.trimmed().toLower(), limit, truncated, filter);
+}
+
+QVector<int> BsSearchIndex::ranked(const QVector<int> &candidates, const QString &lowerTerm, const int limit,
+                                   bool *truncated, const BsSearchFilter &filter) const
+{
+    //分数在高位、排序位次在低位，一次排序；filter只对匹配行调用
+    QVector<QPair<qint64, int> > pairs;
+    for ( int i = 0, iLen = candidates.length(); i < iLen; ++i ) {
+        int row = candidates.at(i);
+        int s = score(row, lowerTerm);
+        if ( s >= 0 && ( !filter || filter(row) ) )
+            pairs << qMakePair((qint64(s) << 32) | quint32(mOrder.at(row)), row);
+    }
+
+    int keep = qBound(0, limit, pairs.length());
+    std::partial_sort(pairs.begin(), pairs.begin() + keep, pairs.end());
+
+    if ( truncated ) *truncated = ( pairs.length() > keep );
+    QVector<int> rows;
+    rows.reserve(keep);
+    for ( int i = 0; i < keep; ++i ) {
+        rows << pairs.at(i).second;
+    }
+    return rows;
+}
+
+}
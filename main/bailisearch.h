@@ -0,0 +1,49 @@
+#ifndef BAILISEARCH_H
+#define BAILISEARCH_H
+
+#include <QtCore>
+#include <functional>
+
+#define SEARCH_DEFAULT_LIMIT    500
+
+namespace BailiSoft {
+
+// 登记查找索引 ============================================================================
+// 对每行的编码、名称、拼音首字母（均转小写）建单字与二元字索引（倒排行号表），
+// 查找时取输入中倒排表最短的一组作候选，再逐个核对包含并打分：编码全等、编码前缀、
+// 首字母前缀、名称前缀、编码包含、其余包含依次靠前，同分按编码排序，至多返回limit行。
+// 调用方另有行限制（权限、可见性）时传入filter，在排序截断前剔除，免得截断后所剩不足limit行。
+typedef std::function<bool(const int row)> BsSearchFilter;     //返回false的行不计入结果
+
+class BsSearchIndex
+{
+public:
+    void build(const QStringList &codes, const QStringList &names, const QStringList &initials,
+               const QVector<int> &sortedRows);
+    bool isEmpty() const { return mCodes.isEmpty(); }
+
+    //返回行号，已按匹配程度排序；truncated返回是否因limit截断
+    QVector<int> search(const QString &term, const int limit = SEARCH_DEFAULT_LIMIT, bool *truncated = nullptr,
+                        const BsSearchFilter &filter = BsSearchFilter()) const;
+
+    //在上次结果内续查（输入在上次基础上追加时用，候选已很少）
+    QVector<int> refine(const QVector<int> &rows, const QString &term, const int limit = SEARCH_DEFAULT_LIMIT,
+                        bool *truncated = nullptr, const BsSearchFilter &filter = BsSearchFilter()) const;
+
+    int score(const int row, const QString &lowerTerm) const;   //不匹配返回-1
+
+private:
+    QVector<int> ranked(const QVector<int> &candidates, const QString &lowerTerm, const int limit,
+                        bool *truncated, const BsSearchFilter &filter) const;
+    void addGrams(const QString &text, const int row);
+
+    QStringList                     mCodes;
+    QStringList                     mNames;
+    QStringList                     mInitials;
+    QVector<int>                    mOrder;         //行号对应编码排序位次
+    QHash<quint32, QVector<int> >   mGrams;         //单字键为字符码，二元字键为两字符码拼合
+};
+
+}
+
+#endif // BAILISEARCH_H
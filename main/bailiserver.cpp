@@ -3,14 +3,29 @@
 #include "bailifunc.h"
 #include "bailishare.h"
 #include "bailidata.h"
+#include "bailimetrics.h"
+
+#define POOL_SCALE_INTERVAL     3000    //伸缩检查间隔毫秒
+#define POOL_GROW_P95_USECS     500000  //近期P95超过此值且有积压则扩容
+#define POOL_SHRINK_IDLE_TICKS  10      //连续空闲检查次数达到此值则退役一个线程
 
 namespace BailiSoft {
 
 BsServer::BsServer(QObject *parent) : QObject(parent)
 {
     mThreadCount = 3;
+    mMinThreads = 2;
+    mMaxThreads = 16;
+    mConnSeq = 0;
+    mPinnedLane = -1;
+    mIdleTicks = 0;
     mWorkings = 0;
 
+    mScaler.setInterval(POOL_SCALE_INTERVAL);
+    mScaler.setSingleShot(false);
+    mScaler.stop();
+    connect(&mScaler, SIGNAL(timeout()), this, SLOT(adjustPool()));
+
     mKeeper.setInterval(75000);   //服务器60秒超时后才真正下线，所以，得设置超过60秒
     mKeeper.setSingleShot(false);
     mKeeper.stop();
@@ -21,6 +36,13 @@ BsServer::BsServer(QObject *parent) : QObject(parent)
     mBeater.stop();
     connect(&mBeater, SIGNAL(timeout()), this, SLOT(sendBeating()));
 
+    mMetricsDumper.setInterval(60000);
+    mMetricsDumper.setSingleShot(false);
+    connect(&mMetricsDumper, SIGNAL(timeout()), this, SLOT(dumpMetrics()));
+    QSettings settings;
+    if ( settings.value(QStringLiteral("netMetricsDump")).toBool() )
+        mMetricsDumper.start();
+
     mpSocket = new QTcpSocket(this);
     mpSocket->setSocketOption(QAbstractSocket::KeepAliveOption, 1);
     connect(mpSocket, SIGNAL(connected()), this, SLOT(tcpConnected()));
@@ -28,6 +50,8 @@ BsServer::BsServer(QObject *parent) : QObject(parent)
     connect(mpSocket, SIGNAL(disconnected()), this, SLOT(tcpDisconnected()));
     connect(mpSocket, SIGNAL(error(QAbstractSocket::SocketError)),
             this, SLOT(tcpError(QAbstractSocket::SocketError)));
+
+    mpWriter = new BsSocketWriter(mpSocket, this);
 }
 
 BsServer::~BsServer()
@@ -37,14 +61,24 @@ BsServer::~BsServer()
 
 void BsServer::startServer(const QString &backerName, const QString &backerVcode, const int frontCount)
 {
-    //计算使用线程数量
-    int threads = frontCount / 100;
-    if ( threads < 3 )
-        mThreadCount = 3;
-    else if ( threads > 16 )
-        mThreadCount = 16;
-    else
-        mThreadCount = threads;
+    //线程池上下限（系统参数），启动线程数按前端数估算，之后按负载伸缩
+    int minThreads = mapOption.value(QStringLiteral("app_net_min_threads")).toInt();
+    int maxThreads = mapOption.value(QStringLiteral("app_net_max_threads")).toInt();
+    mMinThreads = ( minThreads > 0 ) ? qMin(minThreads, 64) : 2;
+    mMaxThreads = ( maxThreads > 0 ) ? qBound(mMinThreads, maxThreads, 64) : qMax(mMinThreads, 16);
+    mThreadCount = qBound(mMinThreads, frontCount / 100, mMaxThreads);
+
+    //请求通道并发上限与专用线程（系统参数）
+    //app_net_lane_limits依次为交互写、轻查询、重报表、聊天四类，逗号分隔，0为不限
+    mLaneLimits.clear();
+    QStringList limits = mapOption.value(QStringLiteral("app_net_lane_limits")).split(QChar(','));
+    for ( int i = 0; i < BsLaneCount; ++i ) {
+        mLaneLimits << ( (i < limits.length()) ? limits.at(i).trimmed().toInt() : 0 );
+    }
+    QStringList laneNames;
+    laneNames << QStringLiteral("交互写") << QStringLiteral("轻查询")
+              << QStringLiteral("重报表") << QStringLiteral("聊天");
+    mPinnedLane = laneNames.indexOf(mapOption.value(QStringLiteral("app_net_lane_pinned")).trimmed());
 
     //加载后台信息（基本参数与保密码）
     BsBackerInfo::loadUpdate(backerName, backerVcode);
@@ -65,9 +99,12 @@ void BsServer::startServer(const QString &backerName, const QString &backerVcode
 void BsServer::stopServer()
 {
     mBeater.stop();
+    mScaler.stop();
+    mScheduler.stop();
+    mpWriter->stop();   //解除背压等待，否则worker可能阻塞在post而无法结束
     for ( int i = 0, iLen = mThreads.length(); i < iLen; ++i ) {
         BsTerminator *worker = mThreads.at(i);
-        worker->taskStop();
+        worker->wait();
     }
     mThreads.clear();
 }
@@ -77,6 +114,17 @@ void BsServer::stopAutoKeeper()
     mKeeper.stop();
 }
 
+void BsServer::setMetricsDump(const bool dumpOn)
+{
+    if ( dumpOn )
+        mMetricsDumper.start();
+    else
+        mMetricsDumper.stop();
+
+    QSettings settings;
+    settings.setValue(QStringLiteral("netMetricsDump"), dumpOn);
+}
+
 bool BsServer::isRunning()
 {
     return mpSocket->state() == QAbstractSocket::ConnectedState;
@@ -180,8 +228,7 @@ void BsServer::tcpConnected()
     QByteArray reqData = backerId + backerId + epochBytes + randomBytes + vhash + dataLenBytes + frontsList;
 
     //清空缓存
-    mReadLen = 0;
-    mReading.clear();
+    mDecoder.clear();
 
     //保证写完
     const qint64 total = reqData.length();
@@ -206,70 +253,67 @@ void BsServer::tcpDisconnected()
 
 void BsServer::tcpReadReady()
 {
-    //读取数据
-    mReading += mpSocket->readAll();
+    //读取数据（增量解析，已取出的帧与接收缓存共享内存）
+    mDecoder.append(mpSocket->readAll());
 
     //理论上有可能包括多个任务数据，所以要用while
-    while ( mReading.length() >= mReadLen + 4 ) {
-
-        //取长度值
-        mReadLen = qFromBigEndian<qint32>(mReading.left(4).constData());
-
-        //收齐触发
-        if ( mReading.length() >= mReadLen + 4 ) {
-
-            //取出数据
-            QByteArray readyData = mReading.mid(4, mReadLen);
-            mReading = mReading.mid(mReadLen + 4);  //待下一循环处理后续数据
-            mReadLen = 0;
-
-            //公服不返回错误，有错误服务器会主动Close同时以日志方式记录错误；这里则会有SocketError触发结束。
-
-            //非请求性信息处理
-            if ( readyData.startsWith("OK") && readyData.length() == 18 ) {
+    BsFrame frame;
+    while ( mDecoder.takeFrame(&frame) ) {
+
+        //公服不返回错误，有错误服务器会主动Close同时以日志方式记录错误；这里则会有SocketError触发结束。
+
+        //非请求性信息处理
+        if ( frame.startsWith("OK") && frame.length() == 18 ) {
+
+            //检查公服反馈授权数（grantOffiShops and grantCustomers）
+            int respOffiShops = qFromBigEndian<qint32>(frame.constData() + 10);
+            int respCustomers = qFromBigEndian<qint32>(frame.constData() + 14);
+            if ( grantOffiShops > respOffiShops ||
+                 grantOffiShops + grantCustomers > respOffiShops + respCustomers ) {
+                mpSocket->disconnectFromHost();
+                emit startFailed(QStringLiteral("启动失败，请确保前端账号发放类型和数量都没超出购买授权！"));
+                return;
+            }
 
-                //检查公服反馈授权数（grantOffiShops and grantCustomers）
-                int respOffiShops = qFromBigEndian<qint32>(readyData.mid(10, 4));
-                int respCustomers = qFromBigEndian<qint32>(readyData.mid(14, 4));
-                if ( grantOffiShops > respOffiShops ||
-                     grantOffiShops + grantCustomers > respOffiShops + respCustomers ) {
-                    mpSocket->disconnectFromHost();
-                    emit startFailed(QStringLiteral("启动失败，请确保前端账号发放类型和数量都没超出购买授权！"));
-                    return;
+            //准备服务线程池
+            if ( mThreads.isEmpty() ) {
+                mWorkings = 0;
+                mScheduler.reset();
+                mScheduler.setLanes(mLaneLimits, mPinnedLane);
+                mpWriter->reset();
+                for ( int i = 0; i < mThreadCount; ++i ) {
+                    hireWorker();
                 }
-
-                //准备服务线程池
-                if ( mThreads.isEmpty() ) {
-                    mWorkings = 0;
-                    for ( int i = 0; i < mThreadCount; ++i ) {
-                        BsTerminator* worker = new BsTerminator(this, QStringLiteral("jydbconn%1").arg(i));
-                        connect(worker, SIGNAL(responseReady(QByteArray)), this, SLOT(queueSocketWrite(QByteArray)));
-                        connect(worker, SIGNAL(transferReady(QByteArray)), this, SLOT(queueSocketWrite(QByteArray)));
-                        connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
-                        connect(worker, SIGNAL(finished()), this, SLOT(workerFinished()));
-                        connect(worker, &BsTerminator::shopStockChanged, this, &BsServer::shopStockChanged);
-                        worker->start();
-                        mThreads << worker;
-                        mWorkings++;
-                    }
+                if ( mPinnedLane >= 0 ) {
+                    hireWorker(mPinnedLane);
                 }
+                mIdleTicks = 0;
+                mScaler.start();
+            }
 
-                //心跳启动
-                mBeater.start();
+            //心跳启动
+            mBeater.start();
 
-                //通知窗口
-                emit serverStarted(qFromBigEndian<qint64>(readyData.mid(2, 8)));
+            //通知窗口
+            emit serverStarted(qFromBigEndian<qint64>(frame.constData() + 2));
 
-                //继续等数据
-                continue;
-            }
+            //继续等数据
+            continue;
+        }
 
-            //分配线程处理
-            if ( readyData.length() > 3 ) {  //REQ开头或RPT开头
-                hireWorker()->taskAdd(readyData);
-            }
+        //交共享调度，由任一空闲线程处理
+        if ( frame.length() > 3 ) {  //REQ开头或RPT开头
+            mScheduler.enqueue(frame);
+            BsMetrics::recordQueueDepth(mScheduler.pendingCount());
         }
     }
+
+    //长度头非法，数据流已无法对齐，只能断开重连
+    if ( mDecoder.isCorrupt() ) {
+        qDebug() << "corrupt frame length, disconnecting.";
+        mDecoder.clear();
+        mpSocket->disconnectFromHost();
+    }
 }
 
 void BsServer::reconnectHost()
@@ -285,43 +329,54 @@ void BsServer::sendBeating()
 {
     //各类系统防火墙原因，心跳包机制不可少。否则稍过一会，就收不到QTcpSocket::readyRead信号。
     QByteArray beatData = QByteArray(4, '\0');
-    queueSocketWrite(beatData);
+    mpWriter->post(beatData);
 }
 
-void BsServer::queueSocketWrite(const QByteArray &toServerData)
+void BsServer::hireWorker(const int pinnedLane)
 {
-      //非法请求约定必须用空字节表示。既然非法，不要回复。
-    if ( toServerData.length() < 4 ) {
-        return;
-    }
+    BsTerminator* worker = new BsTerminator(this, QStringLiteral("jydbconn%1").arg(mConnSeq++),
+                                            &mScheduler, pinnedLane);
+    connect(worker, &BsTerminator::responseReady, mpWriter, &BsSocketWriter::post, Qt::DirectConnection);
+    connect(worker, &BsTerminator::transferReady, mpWriter, &BsSocketWriter::post, Qt::DirectConnection);
+    connect(worker, SIGNAL(finished()), this, SLOT(workerFinished()));     //先于deleteLater，以便从mThreads移除
+    connect(worker, SIGNAL(finished()), worker, SLOT(deleteLater()));
+    connect(worker, &BsTerminator::shopStockChanged, this, &BsServer::shopStockChanged);
+    worker->start();
+    mThreads << worker;
+    mWorkings++;
+}
 
-    //检查避免公服宕机
-    qint32 dataLen = qFromBigEndian<qint32>(toServerData.left(4).constData());
-    if ( dataLen != toServerData.length() - 4 ) {
+void BsServer::adjustPool()
+{
+    int pendings = mScheduler.dispatchableCount();     //暂存在满额通道或排在忙前端后的任务，加线程也取不走
+    int lives = mThreads.count() - mScheduler.retiringCount() - ((mPinnedLane >= 0) ? 1 : 0);   //专用线程不计
+    qint64 p95 = BsMetrics::takeWindowP95();
+
+    //扩容：积压多于线程数，或近期延时偏高且仍有积压
+    if ( pendings > lives || (pendings > 0 && p95 > POOL_GROW_P95_USECS) ) {
+        mIdleTicks = 0;
+        int adds = qMin(mMaxThreads - lives, qMax(1, (pendings - lives) / 2));
+        for ( int i = 0; i < adds; ++i ) {
+            hireWorker();
+        }
         return;
     }
 
-    //因为写由多线程触发，必须加锁
-    QMutexLocker locker(&mSendMutex);
-
-    //保证写完
-    int pos = 0;
-    int len = toServerData.length();
-    while ( pos < len ) {
-        qint64 written = mpSocket->write(toServerData.mid(pos));
-        if ( written >= 0 ) {
-            pos += written;
-        } else {
-            QSqlDatabase db = QSqlDatabase::database();
-            db.exec(QStringLiteral("insert into serverfail(timeid, faildata) values(%1, '%2');")
-                    .arg(QDateTime::currentMSecsSinceEpoch()).arg(QString(toServerData.toHex())));
-            return;
+    //收缩：持续无任何待办（含暂存），每次只退役一个
+    if ( mScheduler.pendingCount() == 0 ) {
+        mIdleTicks++;
+        if ( mIdleTicks >= POOL_SHRINK_IDLE_TICKS && lives > mMinThreads ) {
+            mScheduler.retireOne();
+            mIdleTicks = 0;
         }
+    } else {
+        mIdleTicks = 0;
     }
 }
 
 void BsServer::workerFinished()
 {
+    mThreads.removeAll(qobject_cast<BsTerminator*>(sender()));
     mWorkings--;
     if ( mWorkings == 0 ) {
         emit serverStopped();
@@ -331,16 +386,10 @@ void BsServer::workerFinished()
     }
 }
 
-BsTerminator *BsServer::hireWorker()
+void BsServer::dumpMetrics()
 {
-    //遍历取闲
-    for ( int i = 0, iLen = mThreads.length(); i < iLen; ++i ) {
-        if ( mThreads.at(i)->isIdle() ) {
-            return mThreads.at(i);
-        }
-    }
-    //无闲则随机
-    return mThreads.at( qrand() % mThreads.length() );
+    //服务运行统计定时追加到数据目录文本文件，便于事后分析
+    BsMetrics::dumpToFile(QStringLiteral("%1/netmetrics.log").arg(dataDir));
 }
 
 }
@@ -4,6 +4,7 @@
 #include <QtNetwork>
 #include <QThread>
 #include "bailiterminator.h"
+#include "bailiwriter.h"
 
 namespace BailiSoft {
 
@@ -18,6 +19,8 @@ public:
     void stopServer();
     void stopAutoKeeper();
     bool isRunning();
+    void setMetricsDump(const bool dumpOn);
+    bool metricsDumpOn() const { return mMetricsDumper.isActive(); }
 
 signals:
     void serverStarted(const qint64 licDate);
@@ -33,26 +36,35 @@ private slots:
     void tcpReadReady();
     void reconnectHost();
     void sendBeating();
-    void queueSocketWrite(const QByteArray &toServerData);
     void workerFinished();
+    void dumpMetrics();
+    void adjustPool();
 
 private:
-    BsTerminator*   hireWorker();
+    void hireWorker(const int pinnedLane = -1);
 
     QUrl                        mBailiSiteUrl;
     QString                     mTransferHost;
     quint16                     mTransferPort;
 
     QTcpSocket*                 mpSocket;
-    QMutex                      mSendMutex;
-    int                         mReadLen;   //收据长度头
-    QByteArray                  mReading;   //读缓存buffer
+    BsSocketWriter*             mpWriter;
+    BsFrameDecoder              mDecoder;   //读缓存及帧解析
 
+    BsScheduler                 mScheduler;
     QList<BsTerminator*>            mThreads;
-    int                         mThreadCount;
+    int                         mThreadCount;   //启动线程数
+    int                         mMinThreads;
+    int                         mMaxThreads;
+    int                         mConnSeq;       //jydbconnN连接名序号，只增不复用
+    int                         mIdleTicks;
+    QList<int>                  mLaneLimits;    //各通道并发上限
+    int                         mPinnedLane;    //有专用线程的通道，-1为无
     int                         mWorkings;
+    QTimer                      mScaler;        //线程池伸缩检查
     QTimer                      mKeeper;
     QTimer                      mBeater;
+    QTimer                      mMetricsDumper;
 };
 
 }
@@ -0,0 +1,156 @@
+#include "bailispecsum.h"
+
+namespace BailiSoft {
+
+/*
+    视图sizers明细字段数据格式：
+        \r\f负   码名\t数量 \n 码名\t数量 \n 码名\t数量 ...
+        \r\v正   码名\t数量 \n 码名\t数量 \n 码名\t数量 ...
+*/
+template <typename Func>
+static void eachSizerQty(const QString &sizers, Func func)
+{
+    const QChar *p = sizers.constData();
+    const int len = sizers.length();
+    bool minus = false;
+    int pos = 0;
+    while ( pos < len ) {
+        //段标志
+        if ( p[pos] == QChar('\r') ) {
+            if ( pos + 1 < len ) minus = ( p[pos + 1] == QChar('\f') );
+            pos += 2;
+            continue;
+        }
+
+        //一行：码名\t数量
+        int lineEnd = pos;
+        while ( lineEnd < len && p[lineEnd] != QChar('\n') && p[lineEnd] != QChar('\r') ) lineEnd++;
+        int tab = pos;
+        while ( tab < lineEnd && p[tab] != QChar('\t') ) tab++;
+        if ( tab < lineEnd ) {
+            qint64 qty = sizers.midRef(tab + 1, lineEnd - tab - 1).toLongLong();
+            func(sizers.midRef(pos, tab - pos), (minus) ? 0 - qty : qty);
+        }
+        pos = ( lineEnd < len && p[lineEnd] == QChar('\n') ) ? lineEnd + 1 : lineEnd;
+    }
+}
+
+BsSpecAggregator::BsSpecAggregator(const QSqlRecord &rec, const QString &limSizer)
+    : mLimSizer(limSizer), mSizerDim(-1), mIdxQty(-1)
+{
+    for ( int i = 0, iLen = rec.count(); i < iLen; ++i ) {
+        QString fname = rec.fieldName(i);
+        if ( fname.toLower() == QStringLiteral("qty") ) {
+            mIdxQty = i;
+            continue;
+        }
+        if ( fname == QStringLiteral("sizers") ) {
+            fname = QStringLiteral("sizer");
+            mSizerDim = mDimSources.length();
+        }
+        mFldNames << fname;
+        mDimSources << i;
+    }
+    mDicts.resize(mDimSources.length());
+    mDictValues.resize(mDimSources.length());
+}
+
+void BsSpecAggregator::addRow(const QSqlQuery &qry)
+{
+    const int width = mDimSources.length();
+    QVector<int> key(width);
+    for ( int d = 0; d < width; ++d ) {
+        if ( d != mSizerDim )
+            key[d] = internValue(d, qry.value(mDimSources.at(d)).toString());
+    }
+
+    eachSizerQty(qry.value(mDimSources.at(mSizerDim)).toString(), [&](const QStringRef &sizer, const qint64 qty) {
+        if ( !mLimSizer.isEmpty() && sizer != mLimSizer )
+            return;
+        key[mSizerDim] = internValue(mSizerDim, sizer.toString());
+        int group = mGroupIndexes.value(key, -1);
+        if ( group < 0 ) {
+            group = mGroupSums.length();
+            mGroupIndexes.insert(key, group);
+            mGroupKeys += key;
+            mGroupSums << 0;
+        }
+        mGroupSums[group] += qty;
+    });
+}
+
+QString BsSpecAggregator::result() const
+{
+    const int width = mDimSources.length();
+
+    //各维度字典值预排序得名次，组间比较只比整数
+    QVector<QVector<int> > ranks(width);
+    for ( int d = 0; d < width; ++d ) {
+        const QStringList &values = mDictValues.at(d);
+        QVector<int> order(values.length());
+        for ( int i = 0; i < order.length(); ++i ) order[i] = i;
+        std::sort(order.begin(), order.end(), [&values](const int a, const int b) {
+            return values.at(a) < values.at(b);
+        });
+        ranks[d].resize(order.length());
+        for ( int i = 0; i < order.length(); ++i ) ranks[d][order.at(i)] = i;
+    }
+
+    QVector<int> groups;
+    for ( int g = 0, gLen = mGroupSums.length(); g < gLen; ++g ) {
+        if ( mGroupSums.at(g) != 0 ) groups << g;
+    }
+    std::sort(groups.begin(), groups.end(), [&](const int a, const int b) {
+        for ( int d = 0; d < width; ++d ) {
+            int ra = ranks.at(d).at(mGroupKeys.at(a * width + d));
+            int rb = ranks.at(d).at(mGroupKeys.at(b * width + d));
+            if ( ra != rb ) return ra < rb;
+        }
+        return false;
+    });
+
+    //按buildSqlData格式输出
+    QString text = mFldNames.join(QChar('\t'));
+    text += QStringLiteral("\tqty");
+    for ( int i = 0, iLen = groups.length(); i < iLen; ++i ) {
+        const int g = groups.at(i);
+        text += QChar('\n');
+        for ( int d = 0; d < width; ++d ) {
+            text += mDictValues.at(d).at(mGroupKeys.at(g * width + d));
+            text += QChar('\t');
+        }
+        text += QString::number(mGroupSums.at(g));
+    }
+    return text;
+}
+
+QString BsSpecAggregator::mergeRowSizers(const QString &sizers)
+{
+    QMap<QString, qint64> mapSizers;
+    eachSizerQty(sizers, [&mapSizers](const QStringRef &sizer, const qint64 qty) {
+        mapSizers[sizer.toString()] += qty;
+    });
+
+    QStringList lstSizers;
+    QMapIterator<QString, qint64> it(mapSizers);
+    while ( it.hasNext() ) {
+        it.next();
+        lstSizers << QStringLiteral("%1:%2").arg(it.key()).arg(it.value());
+    }
+    return lstSizers.join(QChar(';'));
+}
+
+int BsSpecAggregator::internValue(const int dim, const QString &value)
+{
+    QHash<QString, int> &dict = mDicts[dim];
+    QHash<QString, int>::const_iterator it = dict.constFind(value);
+    if ( it != dict.constEnd() )
+        return it.value();
+
+    int code = mDictValues.at(dim).length();
+    dict.insert(value, code);
+    mDictValues[dim] << value;
+    return code;
+}
+
+}
@@ -0,0 +1,43 @@
+#ifndef BAILISPECSUM_H
+#define BAILISPECSUM_H
+
+#include <QtCore>
+#include <QtSql>
+
+namespace BailiSoft {
+
+// 尺码明细内存汇总 ============================================================================
+// 查询结果逐行送入，sizers列按码拆开，与其余非qty列一起作分组键，按组累加int64数量。
+// 各维度列值字典编码为整数，分组键即编码数组，不再拼临时表INSERT文本。
+// 结果按分组列排序、剔除合计为0的组，直接输出为buildSqlData同格式文本（qty列在末）。
+class BsSpecAggregator
+{
+public:
+    BsSpecAggregator(const QSqlRecord &rec, const QString &limSizer = QString());
+
+    bool isValid() const { return mSizerDim >= 0 && mIdxQty >= 0; }
+    void addRow(const QSqlQuery &qry);
+    QString result() const;
+
+    //单行多段合并，输出"码:数;码:数"（按码名排序）
+    static QString mergeRowSizers(const QString &sizers);
+
+private:
+    int internValue(const int dim, const QString &value);
+
+    QString                         mLimSizer;
+    QStringList                     mFldNames;      //输出列名，不含qty
+    QVector<int>                    mDimSources;    //各维度对应查询列序号
+    int                             mSizerDim;      //sizer维度位置
+    int                             mIdxQty;
+
+    QVector<QHash<QString, int> >   mDicts;         //各维度值 -> 编码
+    QVector<QStringList>            mDictValues;    //各维度编码 -> 值
+    QHash<QVector<int>, int>        mGroupIndexes;  //分组键 -> 组号
+    QVector<int>                    mGroupKeys;     //按组号平铺的分组键
+    QVector<qint64>                 mGroupSums;
+};
+
+}
+
+#endif // BAILISPECSUM_H
@@ -767,6 +767,143 @@ QString selectSheetJoinForStockSql(const QString &mainTable, const bool minus, c
 }
 
 
+// 库存账表（stock_balance）================================================================
+// 按（门店、货号、颜色）累计当前库存，由各单据主从表触发器随写入同一事务维护，读库存无需再汇总vi_stock。
+// sizers为与vi_stock相同格式的\r\v正\r\f负分段串，触发器只追加，由stockBalanceCompact()定期合并。
+// lastdated为曾计入该行的单据最大日期（只增不减），查询截止日早于它时须改用vi_stock逐单计算。
+// 按单据重建成功后才在bailiOption记下已建标记，标记缺失时（首次升级或重建失败）读库存仍用vi_stock。
+
+//返回该单据表影响库存的各方向：门店字段名及是否减库存（调拨单出方减、入方加）
+static QList<QPair<QString, bool> > stockLegsOfSheet(const QString &mainTable)
+{
+    QList<QPair<QString, bool> > legs;
+    if ( mainTable == QStringLiteral("dbd") ) {
+        legs << qMakePair(QStringLiteral("shop"), true);
+        legs << qMakePair(QStringLiteral("trader"), false);
+    }
+    else {
+        bool minus = ( mainTable == QStringLiteral("cgt") || mainTable == QStringLiteral("pff") ||
+                       mainTable == QStringLiteral("lsd") );
+        legs << qMakePair(QStringLiteral("shop"), minus);
+    }
+    return legs;
+}
+
+//明细单行计入或撤出（row为NEW或OLD），主表行不存在时两句均不影响任何行
+static QString stockBalanceRowSql(const QString &mainTable, const QString &shopFld, const bool minus,
+                                  const QString &row, const bool adding)
+{
+    bool positive = ( minus != adding );
+    QString mark = (positive) ? QStringLiteral("\r\v") : QStringLiteral("\r\f");
+    QString op = (positive) ? QStringLiteral("+") : QStringLiteral("-");
+    QString shopOf = QStringLiteral("(SELECT %1 FROM %2 WHERE sheetid=%3.parentid)").arg(shopFld, mainTable, row);
+    QString datedSet = (adding)
+            ? QStringLiteral(", lastdated=max(lastdated, (SELECT dated FROM %1 WHERE sheetid=%2.parentid))").arg(mainTable, row)
+            : QString();
+
+    QStringList sqls;
+    sqls << QStringLiteral("INSERT OR IGNORE INTO stock_balance(shop, cargo, color) "
+                           "SELECT %1, %2.cargo, %2.color FROM %3 WHERE sheetid=%2.parentid;")
+            .arg(shopFld, row, mainTable);
+    sqls << QStringLiteral("UPDATE stock_balance SET "
+                           "sizers=sizers || (CASE WHEN length(%1.sizers)>0 THEN '%2' || %1.sizers ELSE '' END), "
+                           "qty=qty%3ifnull(%1.qty, 0), actmoney=actmoney%3ifnull(%1.actmoney, 0), "
+                           "dismoney=dismoney%3ifnull(%1.dismoney, 0)%4 "
+                           "WHERE shop=%5 AND cargo=%1.cargo AND color=%1.color;")
+            .arg(row, mark, op, datedSet, shopOf);
+    return sqls.join(QChar(' '));
+}
+
+//主表行计入或撤出其全部明细（row为NEW或OLD）
+static QString stockBalanceSheetSql(const QString &mainTable, const QString &shopFld, const bool minus,
+                                    const QString &row, const bool adding)
+{
+    bool positive = ( minus != adding );
+    QString mark = (positive) ? QStringLiteral("\r\v") : QStringLiteral("\r\f");
+    QString op = (positive) ? QStringLiteral("+") : QStringLiteral("-");
+    QString dtlOf = QStringLiteral("FROM %1dtl WHERE parentid=%2.sheetid AND cargo=stock_balance.cargo "
+                                   "AND color=stock_balance.color").arg(mainTable, row);
+    QString datedSet = (adding)
+            ? QStringLiteral(", lastdated=max(lastdated, %1.dated)").arg(row)
+            : QString();
+
+    QStringList sqls;
+    sqls << QStringLiteral("INSERT OR IGNORE INTO stock_balance(shop, cargo, color) "
+                           "SELECT %1.%2, cargo, color FROM %3dtl WHERE parentid=%1.sheetid GROUP BY cargo, color;")
+            .arg(row, shopFld, mainTable);
+    sqls << QStringLiteral("UPDATE stock_balance SET "
+                           "sizers=sizers || ifnull((SELECT group_concat('%1' || sizers, '') %2 AND length(sizers)>0), ''), "
+                           "qty=qty%3(SELECT ifnull(sum(qty), 0) %2), "
+                           "actmoney=actmoney%3(SELECT ifnull(sum(actmoney), 0) %2), "
+                           "dismoney=dismoney%3(SELECT ifnull(sum(dismoney), 0) %2)%4 "
+                           "WHERE shop=%5.%6 AND EXISTS(SELECT 1 %2);")
+            .arg(mark, dtlOf, op, datedSet, row, shopFld);
+    return sqls.join(QChar(' '));
+}
+
+QStringList stockBalanceSqls()
+{
+    QStringList sqls;
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS stock_balance("
+                           "shop        TEXT NOT NULL, "
+                           "cargo       TEXT NOT NULL, "
+                           "color       TEXT NOT NULL, "
+                           "sizers      TEXT DEFAULT '', "
+                           "qty         INTEGER DEFAULT 0, "
+                           "actmoney    INTEGER DEFAULT 0, "
+                           "dismoney    INTEGER DEFAULT 0, "
+                           "lastdated   INTEGER DEFAULT 0, "
+                           "primary key(shop, cargo, color));");
+    sqls << QStringLiteral("CREATE INDEX IF NOT EXISTS idxstockbalancecargo ON stock_balance(cargo);");
+
+    QStringList tables;
+    tables << "syd" << "cgj" << "cgt" << "pff" << "pft" << "lsd" << "dbd";
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        QString table = tables.at(i);
+        QList<QPair<QString, bool> > legs = stockLegsOfSheet(table);
+
+        QStringList dtlIns, dtlDel, dtlUpd, sheetIns, sheetDel, sheetUpd, shopChanged;
+        QStringList dtlChanged;
+        dtlChanged << "parentid" << "cargo" << "color" << "sizers" << "qty" << "actmoney" << "dismoney";
+        for ( int j = 0, jLen = dtlChanged.length(); j < jLen; ++j ) {
+            dtlChanged[j] = QStringLiteral("NEW.%1 IS NOT OLD.%1").arg(dtlChanged.at(j));
+        }
+        for ( int j = 0, jLen = legs.length(); j < jLen; ++j ) {
+            QString shopFld = legs.at(j).first;
+            bool minus = legs.at(j).second;
+            dtlIns << stockBalanceRowSql(table, shopFld, minus, QStringLiteral("NEW"), true);
+            dtlDel << stockBalanceRowSql(table, shopFld, minus, QStringLiteral("OLD"), false);
+            dtlUpd << stockBalanceRowSql(table, shopFld, minus, QStringLiteral("OLD"), false)
+                   << stockBalanceRowSql(table, shopFld, minus, QStringLiteral("NEW"), true);
+            sheetIns << stockBalanceSheetSql(table, shopFld, minus, QStringLiteral("NEW"), true);
+            sheetDel << stockBalanceSheetSql(table, shopFld, minus, QStringLiteral("OLD"), false);
+            sheetUpd << stockBalanceSheetSql(table, shopFld, minus, QStringLiteral("OLD"), false)
+                     << stockBalanceSheetSql(table, shopFld, minus, QStringLiteral("NEW"), true);
+            shopChanged << QStringLiteral("NEW.%1 IS NOT OLD.%1").arg(shopFld);
+        }
+
+        //明细先于主表写入时（如盘点清零工具），由主表插入触发器一并计入；主表先删时同理
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_stock_%1dtl_ins AFTER INSERT ON %1dtl "
+                               "BEGIN %2 END;").arg(table, dtlIns.join(QChar(' ')));
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_stock_%1dtl_del AFTER DELETE ON %1dtl "
+                               "BEGIN %2 END;").arg(table, dtlDel.join(QChar(' ')));
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_stock_%1dtl_upd AFTER UPDATE ON %1dtl "
+                               "WHEN %2 "
+                               "BEGIN %3 END;").arg(table, dtlChanged.join(QStringLiteral(" OR ")),
+                                                   dtlUpd.join(QChar(' ')));
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_stock_%1_ins AFTER INSERT ON %1 "
+                               "BEGIN %2 END;").arg(table, sheetIns.join(QChar(' ')));
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_stock_%1_del AFTER DELETE ON %1 "
+                               "BEGIN %2 END;").arg(table, sheetDel.join(QChar(' ')));
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_stock_%1_upd AFTER UPDATE ON %1 "
+                               "WHEN %2 OR NEW.dated>OLD.dated "
+                               "BEGIN %3 END;").arg(table, shopChanged.join(QStringLiteral(" OR ")),
+                                                   sheetUpd.join(QChar(' ')));
+    }
+    return sqls;
+}
+
+
 QStringList sqliteInitSqls(const QString &bookName, const bool forImport)
 {
     QStringList sqls;
@@ -1000,10 +1137,796 @@ QStringList sqliteInitSqls(const QString &bookName, const bool forImport)
          << QStringLiteral("CREATE INDEX IF NOT EXISTS idxpftshop ON pft(shop);")
          << QStringLiteral("CREATE INDEX IF NOT EXISTS idxszdshop ON szd(shop);");
 
+    sqls << stockBalanceSqls();
+    sqls << periodSnapshotSqls();
+    sqls << regChangeLogSqls();
+
     return sqls;
 }
 
 
+//合并\r\v正\r\f负分段尺码串，按尺码首次出现顺序，返回单段\r\v串（全部为零时返回空串）
+static QString stockSizersMerged(const QString &sizers, QMap<QString, qint64> *sums = nullptr)
+{
+    QStringList names;
+    QHash<QString, qint64> values;
+    QStringList blocks = sizers.split(QChar('\r'), QString::SkipEmptyParts);
+    for ( int i = 0, iLen = blocks.length(); i < iLen; ++i ) {
+        QString block = blocks.at(i);
+        bool minus = block.at(0) == QChar('\f');
+        QStringList pairs = block.mid(1).split(QChar('\n'), QString::SkipEmptyParts);
+        for ( int j = 0, jLen = pairs.length(); j < jLen; ++j ) {
+            QStringList pair = QString(pairs.at(j)).split(QChar('\t'));
+            if ( pair.length() != 2 ) continue;
+            QString name = pair.at(0);
+            qint64 qty = QString(pair.at(1)).toLongLong();
+            if ( !values.contains(name) ) names << name;
+            values[name] += (minus) ? 0 - qty : qty;
+        }
+    }
+
+    QStringList merged;
+    for ( int i = 0, iLen = names.length(); i < iLen; ++i ) {
+        qint64 qty = values.value(names.at(i));
+        if ( qty != 0 ) {
+            merged << QStringLiteral("%1\t%2").arg(names.at(i)).arg(qty);
+            if ( sums ) sums->insert(names.at(i), qty);
+        }
+    }
+    return (merged.isEmpty()) ? QString() : QStringLiteral("\r\v") + merged.join(QChar('\n'));
+}
+
+int stockBalanceCompact(QSqlDatabase &db, const int minLength)
+{
+    QStringList keys;
+    QStringList sizersList;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+
+    //读与写同一事务，检查点线程定期合并时其间有单据提交则写入失败回滚，不会覆盖触发器新追加的分段
+    db.transaction();
+    qry.exec(QStringLiteral("select shop, cargo, color, sizers from stock_balance where length(sizers)>%1;").arg(minLength));
+    if ( qry.lastError().isValid() ) {
+        qDebug() << "stockBalanceCompact" << qry.lastError();
+        db.rollback();
+        return -1;
+    }
+    while ( qry.next() ) {
+        keys << qry.value(0).toString() << qry.value(1).toString() << qry.value(2).toString();
+        sizersList << stockSizersMerged(qry.value(3).toString());
+    }
+    qry.finish();
+    if ( sizersList.isEmpty() ) {
+        db.rollback();
+        return 0;
+    }
+
+    qry.prepare(QStringLiteral("update stock_balance set sizers=? where shop=? and cargo=? and color=?;"));
+    for ( int i = 0, iLen = sizersList.length(); i < iLen; ++i ) {
+        qry.addBindValue(sizersList.at(i));
+        qry.addBindValue(keys.at(3 * i));
+        qry.addBindValue(keys.at(3 * i + 1));
+        qry.addBindValue(keys.at(3 * i + 2));
+        if ( !qry.exec() ) {
+            qDebug() << "stockBalanceCompact" << qry.lastError();
+            db.rollback();
+            return -1;
+        }
+    }
+    db.commit();
+    return sizersList.length();
+}
+
+bool stockBalanceReady(QSqlDatabase &db)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("select vsetting from bailiOption where optcode='sys_stock_balance_built';"));
+    return qry.next() && qry.value(0).toString() == QStringLiteral("1");
+}
+
+QString stockBalanceRebuild(QSqlDatabase &db)
+{
+    //先撤标记，重建中途失败则读库存一律回退vi_stock
+    db.exec(QStringLiteral("delete from bailiOption where optcode='sys_stock_balance_built';"));
+    if ( db.lastError().isValid() )
+        return db.lastError().text();
+
+    QStringList sqls;
+    sqls << QStringLiteral("delete from stock_balance;");
+    sqls << QStringLiteral("insert into stock_balance(shop, cargo, color, sizers, qty, actmoney, dismoney, lastdated) "
+                           "select shop, cargo, color, ifnull(group_concat(sizers, ''), ''), ifnull(sum(qty), 0), "
+                           "ifnull(sum(actmoney), 0), ifnull(sum(dismoney), 0), ifnull(max(dated), 0) "
+                           "from vi_stock where shop is not null and cargo is not null and color is not null "
+                           "group by shop, cargo, color;");
+
+    db.transaction();
+    for ( int i = 0, iLen = sqls.length(); i < iLen; ++i ) {
+        db.exec(sqls.at(i));
+        if ( db.lastError().isValid() ) {
+            QString strErr = db.lastError().text();
+            db.rollback();
+            return strErr;
+        }
+    }
+    db.commit();
+
+    if ( stockBalanceCompact(db, 0) < 0 )
+        return QStringLiteral("stock_balance compact failed.");
+
+    db.exec(QStringLiteral("insert or replace into bailiOption(optcode, optname, vsetting, vdefault, vformat) values("
+                           "'sys_stock_balance_built', '库存账表已建', '1', '', '系统自动维护，请勿修改。');"));
+    if ( db.lastError().isValid() )
+        return db.lastError().text();
+
+    return QString();
+}
+
+int stockBalanceVerify(QSqlDatabase &db)
+{
+    struct Balance {
+        QMap<QString, qint64> sizers;
+        qint64 qty = 0;
+        qint64 actmoney = 0;
+        qint64 dismoney = 0;
+        bool operator==(const Balance &other) const {
+            return qty == other.qty && actmoney == other.actmoney && dismoney == other.dismoney &&
+                    sizers == other.sizers;
+        }
+    };
+
+    QHash<QString, Balance> ledger;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("select shop, cargo, color, sizers, qty, actmoney, dismoney from stock_balance;"));
+    if ( qry.lastError().isValid() ) {
+        qDebug() << "stockBalanceVerify" << qry.lastError();
+        return -1;
+    }
+    while ( qry.next() ) {
+        Balance bal;
+        stockSizersMerged(qry.value(3).toString(), &bal.sizers);
+        bal.qty = qry.value(4).toLongLong();
+        bal.actmoney = qry.value(5).toLongLong();
+        bal.dismoney = qry.value(6).toLongLong();
+        ledger.insert(QStringList({qry.value(0).toString(), qry.value(1).toString(), qry.value(2).toString()})
+                      .join(QChar('\t')), bal);
+    }
+    qry.finish();
+
+    int diffs = 0;
+    qry.exec(QStringLiteral("select shop, cargo, color, group_concat(sizers, ''), sum(qty), sum(actmoney), sum(dismoney) "
+                            "from vi_stock where shop is not null and cargo is not null and color is not null "
+                            "group by shop, cargo, color;"));
+    if ( qry.lastError().isValid() ) {
+        qDebug() << "stockBalanceVerify" << qry.lastError();
+        return -1;
+    }
+    while ( qry.next() ) {
+        Balance bal;
+        stockSizersMerged(qry.value(3).toString(), &bal.sizers);
+        bal.qty = qry.value(4).toLongLong();
+        bal.actmoney = qry.value(5).toLongLong();
+        bal.dismoney = qry.value(6).toLongLong();
+        QString key = QStringList({qry.value(0).toString(), qry.value(1).toString(), qry.value(2).toString()})
+                .join(QChar('\t'));
+        if ( !(ledger.take(key) == bal) ) {
+            qDebug() << "stockBalanceVerify mismatch:" << key;
+            diffs++;
+        }
+    }
+    qry.finish();
+
+    //账表有而单据已无的行，须全为零
+    QHashIterator<QString, Balance> it(ledger);
+    while ( it.hasNext() ) {
+        it.next();
+        if ( !(it.value() == Balance()) ) {
+            qDebug() << "stockBalanceVerify orphan:" << it.key();
+            diffs++;
+        }
+    }
+
+    return diffs;
+}
+
+
+// 期末快照（snap_xxx）===================================================================
+// 每个已结束自然月末一份库存、订单欠货、往来账余额，查询截止日之前最近的有效快照加其后单据增量即得余额，
+// 不必从建账第一张单据累计起。snap_period登记有效快照，单据增删改由触发器删去其日期及以后的登记，
+// 快照数据行不在触发器中删（避免每明细行一次大范围删除），待下次刷新时清理并按月重建。
+// 快照不区分审核，按审核状态查询时不用。
+
+//快照对应的原视图、快照表、类别（同表多种时区分）及列（维度在前，数值在后）
+static bool periodSnapshotDefine(const QString &viewName, QString *snapTable, QString *kind,
+                                 QStringList *keyCols, QStringList *valCols)
+{
+    if ( viewName == QStringLiteral("vi_stock") ) {
+        *snapTable = QStringLiteral("snap_stock");
+        *kind = QString();
+        *keyCols = QStringList({"shop", "cargo", "color"});
+        *valCols = QStringList({"sizers", "qty", "actmoney", "dismoney"});
+        return true;
+    }
+    if ( viewName == QStringLiteral("vi_cg_rest") || viewName == QStringLiteral("vi_pf_rest") ) {
+        *snapTable = QStringLiteral("snap_rest");
+        *kind = viewName.mid(3, 2);
+        *keyCols = QStringList({"trader", "cargo", "color"});
+        *valCols = QStringList({"sizers", "qty", "actmoney"});
+        return true;
+    }
+    if ( viewName == QStringLiteral("vi_cg_cash") || viewName == QStringLiteral("vi_pf_cash") ||
+         viewName == QStringLiteral("vi_xs_cash") ) {
+        *snapTable = QStringLiteral("snap_cash");
+        *kind = viewName.mid(3, 2);
+        *keyCols = QStringList({"trader"});
+        *valCols = QStringList({"sumqty", "summoney", "sumdis", "actpay", "actowe"});
+        return true;
+    }
+    return false;
+}
+
+static QStringList periodSnapshotViews()
+{
+    return QStringList({"vi_stock", "vi_cg_rest", "vi_pf_rest", "vi_cg_cash", "vi_pf_cash", "vi_xs_cash"});
+}
+
+QStringList periodSnapshotSqls()
+{
+    QStringList sqls;
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS snap_period("
+                           "snapdated   INTEGER PRIMARY KEY, "
+                           "builttime   INTEGER DEFAULT 0);");
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS snap_stock("
+                           "snapdated   INTEGER NOT NULL, "
+                           "shop        TEXT NOT NULL, "
+                           "cargo       TEXT NOT NULL, "
+                           "color       TEXT NOT NULL, "
+                           "sizers      TEXT DEFAULT '', "
+                           "qty         INTEGER DEFAULT 0, "
+                           "actmoney    INTEGER DEFAULT 0, "
+                           "dismoney    INTEGER DEFAULT 0, "
+                           "primary key(snapdated, shop, cargo, color));");
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS snap_rest("
+                           "snapdated   INTEGER NOT NULL, "
+                           "kind        TEXT NOT NULL, "
+                           "trader      TEXT NOT NULL, "
+                           "cargo       TEXT NOT NULL, "
+                           "color       TEXT NOT NULL, "
+                           "sizers      TEXT DEFAULT '', "
+                           "qty         INTEGER DEFAULT 0, "
+                           "actmoney    INTEGER DEFAULT 0, "
+                           "primary key(snapdated, kind, trader, cargo, color));");
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS snap_cash("
+                           "snapdated   INTEGER NOT NULL, "
+                           "kind        TEXT NOT NULL, "
+                           "trader      TEXT NOT NULL, "
+                           "sumqty      INTEGER DEFAULT 0, "
+                           "summoney    INTEGER DEFAULT 0, "
+                           "sumdis      INTEGER DEFAULT 0, "
+                           "actpay      INTEGER DEFAULT 0, "
+                           "actowe      INTEGER DEFAULT 0, "
+                           "primary key(snapdated, kind, trader));");
+
+    //失效触发器：日期、门店、客户及合计有变才影响快照（审核、备注等不影响）
+    QStringList mainChanged;
+    mainChanged << "dated" << "shop" << "trader" << "sumqty" << "summoney" << "sumdis" << "actpay" << "actowe";
+    for ( int j = 0, jLen = mainChanged.length(); j < jLen; ++j ) {
+        mainChanged[j] = QStringLiteral("NEW.%1 IS NOT OLD.%1").arg(mainChanged.at(j));
+    }
+    QStringList dtlChanged;
+    dtlChanged << "parentid" << "cargo" << "color" << "sizers" << "qty" << "actmoney" << "dismoney";
+    for ( int j = 0, jLen = dtlChanged.length(); j < jLen; ++j ) {
+        dtlChanged[j] = QStringLiteral("NEW.%1 IS NOT OLD.%1").arg(dtlChanged.at(j));
+    }
+
+    //作废单据dated置0，不计入任何快照，故0日期不得作为失效起点（否则清空全部快照）。
+    //触发器定义曾有修正，先删后建使老账册也换用新定义
+    QStringList tables;
+    tables << "cgd" << "cgj" << "cgt" << "pfd" << "pff" << "pft" << "lsd" << "dbd" << "syd";
+    QStringList suffixes({"_ins", "_del", "_upd", "dtl_ins", "dtl_del", "dtl_upd"});
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        QString table = tables.at(i);
+        for ( int j = 0, jLen = suffixes.length(); j < jLen; ++j ) {
+            sqls << QStringLiteral("DROP TRIGGER IF EXISTS trg_snap_%1%2;").arg(table, suffixes.at(j));
+        }
+        QString dtlDated = QStringLiteral("nullif((SELECT dated FROM %1 WHERE sheetid=%2.parentid), 0)");
+        sqls << QStringLiteral("CREATE TRIGGER trg_snap_%1_ins AFTER INSERT ON %1 WHEN NEW.dated>0 "
+                               "BEGIN DELETE FROM snap_period WHERE snapdated>=NEW.dated; END;").arg(table);
+        sqls << QStringLiteral("CREATE TRIGGER trg_snap_%1_del AFTER DELETE ON %1 WHEN OLD.dated>0 "
+                               "BEGIN DELETE FROM snap_period WHERE snapdated>=OLD.dated; END;").arg(table);
+        sqls << QStringLiteral("CREATE TRIGGER trg_snap_%1_upd AFTER UPDATE ON %1 "
+                               "WHEN (%2) AND (OLD.dated>0 OR NEW.dated>0) "
+                               "BEGIN DELETE FROM snap_period WHERE snapdated>="
+                               "CASE WHEN NEW.dated>0 AND OLD.dated>0 THEN min(OLD.dated, NEW.dated) "
+                               "WHEN NEW.dated>0 THEN NEW.dated ELSE OLD.dated END; END;")
+                .arg(table, mainChanged.join(QStringLiteral(" OR ")));
+        sqls << QStringLiteral("CREATE TRIGGER trg_snap_%1dtl_ins AFTER INSERT ON %1dtl "
+                               "BEGIN DELETE FROM snap_period WHERE snapdated>=%2; END;")
+                .arg(table, dtlDated.arg(table, QStringLiteral("NEW")));
+        sqls << QStringLiteral("CREATE TRIGGER trg_snap_%1dtl_del AFTER DELETE ON %1dtl "
+                               "BEGIN DELETE FROM snap_period WHERE snapdated>=%2; END;")
+                .arg(table, dtlDated.arg(table, QStringLiteral("OLD")));
+        sqls << QStringLiteral("CREATE TRIGGER trg_snap_%1dtl_upd AFTER UPDATE ON %1dtl WHEN %2 "
+                               "BEGIN DELETE FROM snap_period WHERE snapdated>=min(ifnull(%3, %4), ifnull(%4, %3)); END;")
+                .arg(table, dtlChanged.join(QStringLiteral(" OR ")),
+                     dtlDated.arg(table, QStringLiteral("OLD")), dtlDated.arg(table, QStringLiteral("NEW")));
+    }
+    return sqls;
+}
+
+//由上一快照（prevSnap为0时从头）加本月单据生成snapdated快照，调用方负责事务
+static QString periodSnapshotBuildOne(QSqlDatabase &db, const QString &viewName,
+                                      const qint64 prevSnap, const qint64 snapdated)
+{
+    QString snapTable, kind;
+    QStringList keyCols, valCols;
+    periodSnapshotDefine(viewName, &snapTable, &kind, &keyCols, &valCols);
+    QString kindCon = (kind.isEmpty()) ? QString() : QStringLiteral(" AND kind='%1'").arg(kind);
+
+    QStringList cols = keyCols + valCols;
+    QStringList aggs = keyCols;
+    QStringList nullCons;
+    for ( int i = 0, iLen = keyCols.length(); i < iLen; ++i ) {
+        nullCons << QStringLiteral("%1 IS NOT NULL").arg(keyCols.at(i));
+    }
+    for ( int i = 0, iLen = valCols.length(); i < iLen; ++i ) {
+        QString col = valCols.at(i);
+        aggs << ( (col == QStringLiteral("sizers"))
+                  ? QStringLiteral("ifnull(group_concat(sizers, ''), '')")
+                  : QStringLiteral("ifnull(sum(%1), 0)").arg(col) );
+    }
+
+    QString insCols = QStringLiteral("snapdated, ") + ((kind.isEmpty()) ? QString() : QStringLiteral("kind, "))
+            + cols.join(QStringLiteral(", "));
+    QString insHead = QStringLiteral("%1, ").arg(snapdated) + ((kind.isEmpty()) ? QString() : QStringLiteral("'%1', ").arg(kind));
+
+    QStringList sqls;
+    sqls << QStringLiteral("DELETE FROM %1 WHERE snapdated=%2%3;").arg(snapTable).arg(snapdated).arg(kindCon);
+    sqls << QStringLiteral("INSERT INTO %1(%2) SELECT %3%4 FROM ("
+                           "SELECT %5 FROM %1 WHERE snapdated=%6%7 "
+                           "UNION ALL SELECT %5 FROM %8 WHERE dated>%6 AND dated<=%9"
+                           ") WHERE %10 GROUP BY %11;")
+            .arg(snapTable, insCols, insHead, aggs.join(QStringLiteral(", ")), cols.join(QStringLiteral(", ")))
+            .arg(prevSnap).arg(kindCon, viewName).arg(snapdated)
+            .arg(nullCons.join(QStringLiteral(" AND ")), keyCols.join(QStringLiteral(", ")));
+
+    QSqlQuery qry(db);
+    for ( int i = 0, iLen = sqls.length(); i < iLen; ++i ) {
+        qry.exec(sqls.at(i));
+        if ( qry.lastError().isValid() ) {
+            qDebug() << sqls.at(i);
+            return qry.lastError().text();
+        }
+    }
+
+    //合并尺码分段，去全零行
+    if ( valCols.contains(QStringLiteral("sizers")) ) {
+        QList<QVariantList> keyVals;
+        QStringList sizersList;
+        qry.setForwardOnly(true);
+        qry.exec(QStringLiteral("SELECT %1, sizers FROM %2 WHERE snapdated=%3%4 AND length(sizers)>0;")
+                 .arg(keyCols.join(QStringLiteral(", ")), snapTable).arg(snapdated).arg(kindCon));
+        while ( qry.next() ) {
+            QVariantList vals;
+            for ( int i = 0, iLen = keyCols.length(); i < iLen; ++i ) {
+                vals << qry.value(i);
+            }
+            keyVals << vals;
+            sizersList << stockSizersMerged(qry.value(keyCols.length()).toString());
+        }
+        qry.finish();
+
+        QStringList keyCons;
+        for ( int i = 0, iLen = keyCols.length(); i < iLen; ++i ) {
+            keyCons << QStringLiteral("%1=?").arg(keyCols.at(i));
+        }
+        QSqlQuery upd(db);
+        upd.prepare(QStringLiteral("UPDATE %1 SET sizers=? WHERE snapdated=%2%3 AND %4;")
+                    .arg(snapTable).arg(snapdated).arg(kindCon, keyCons.join(QStringLiteral(" AND "))));
+        for ( int i = 0, iLen = sizersList.length(); i < iLen; ++i ) {
+            upd.addBindValue(sizersList.at(i));
+            for ( int j = 0, jLen = keyVals.at(i).length(); j < jLen; ++j ) {
+                upd.addBindValue(keyVals.at(i).at(j));
+            }
+            if ( !upd.exec() )
+                return upd.lastError().text();
+        }
+    }
+
+    QStringList zeroCons;
+    for ( int i = 0, iLen = valCols.length(); i < iLen; ++i ) {
+        zeroCons << ( (valCols.at(i) == QStringLiteral("sizers"))
+                      ? QStringLiteral("sizers=''")
+                      : QStringLiteral("%1=0").arg(valCols.at(i)) );
+    }
+    qry.exec(QStringLiteral("DELETE FROM %1 WHERE snapdated=%2%3 AND %4;")
+             .arg(snapTable).arg(snapdated).arg(kindCon, zeroCons.join(QStringLiteral(" AND "))));
+    if ( qry.lastError().isValid() )
+        return qry.lastError().text();
+
+    return QString();
+}
+
+QString periodSnapshotRefresh(QSqlDatabase &db)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+
+    //清理已失效快照行
+    QStringList snapTables({"snap_stock", "snap_rest", "snap_cash"});
+    for ( int i = 0, iLen = snapTables.length(); i < iLen; ++i ) {
+        qry.exec(QStringLiteral("DELETE FROM %1 WHERE snapdated NOT IN (SELECT snapdated FROM snap_period);")
+                 .arg(snapTables.at(i)));
+        if ( qry.lastError().isValid() )
+            return qry.lastError().text();
+    }
+
+    //已有有效快照
+    QSet<qint64> valids;
+    qry.exec(QStringLiteral("SELECT snapdated FROM snap_period;"));
+    while ( qry.next() ) {
+        valids << qry.value(0).toLongLong();
+    }
+    qry.finish();
+
+    //最早单据月份
+    qint64 minDated = 0;
+    QStringList tables({"cgd", "cgj", "cgt", "pfd", "pff", "pft", "lsd", "dbd", "syd"});
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        qry.exec(QStringLiteral("SELECT min(dated) FROM %1 WHERE dated>0;").arg(tables.at(i)));
+        if ( qry.next() && !qry.value(0).isNull() ) {
+            qint64 dated = qry.value(0).toLongLong();
+            if ( minDated == 0 || dated < minDated ) minDated = dated;
+        }
+        qry.finish();
+    }
+    if ( minDated == 0 )
+        return QString();
+
+    //逐个已结束月份，快照键为该月最后一秒（本地时间）
+    QDate thisMonth = QDate::currentDate();
+    thisMonth = QDate(thisMonth.year(), thisMonth.month(), 1);
+    QDate month = QDateTime::fromMSecsSinceEpoch(minDated * 1000).date();
+    month = QDate(month.year(), month.month(), 1);
+
+    qint64 prevSnap = 0;
+    QStringList views = periodSnapshotViews();
+    for ( ; month < thisMonth; month = month.addMonths(1) ) {
+        qint64 snapdated = QDateTime(month.addMonths(1)).toMSecsSinceEpoch() / 1000 - 1;
+        if ( valids.contains(snapdated) ) {
+            prevSnap = snapdated;
+            continue;
+        }
+
+        db.transaction();
+        QString strErr;
+        for ( int i = 0, iLen = views.length(); i < iLen && strErr.isEmpty(); ++i ) {
+            strErr = periodSnapshotBuildOne(db, views.at(i), prevSnap, snapdated);
+        }
+        if ( strErr.isEmpty() ) {
+            qry.exec(QStringLiteral("INSERT OR REPLACE INTO snap_period(snapdated, builttime) VALUES(%1, %2);")
+                     .arg(snapdated).arg(QDateTime::currentMSecsSinceEpoch() / 1000));
+            if ( qry.lastError().isValid() ) strErr = qry.lastError().text();
+        }
+        if ( !strErr.isEmpty() ) {
+            db.rollback();
+            return strErr;
+        }
+        db.commit();
+        prevSnap = snapdated;
+    }
+
+    return QString();
+}
+
+qint64 periodSnapshotBefore(QSqlDatabase &db, const qint64 datee)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("SELECT max(snapdated) FROM snap_period WHERE snapdated<=%1;").arg(datee));
+    qint64 snapdated = ( qry.next() ) ? qry.value(0).toLongLong() : 0;
+    qry.finish();
+    return snapdated;
+}
+
+QString periodSnapshotSource(QSqlDatabase &db, const QString &viewName, const qint64 datee)
+{
+    QString snapTable, kind;
+    QStringList keyCols, valCols;
+    if ( !periodSnapshotDefine(viewName, &snapTable, &kind, &keyCols, &valCols) )
+        return QString();
+
+    qint64 snapdated = periodSnapshotBefore(db, datee);
+    if ( snapdated <= 0 )
+        return QString();
+
+    //快照行dated取快照键，调用方原有的dated<=截止日条件对两部分都成立
+    QString cols = (keyCols + valCols).join(QStringLiteral(", "));
+    QString kindCon = (kind.isEmpty()) ? QString() : QStringLiteral(" AND kind='%1'").arg(kind);
+    return QStringLiteral("(SELECT %1 AS dated, %2 FROM %3 WHERE snapdated=%1%4 "
+                          "UNION ALL SELECT dated, %2 FROM %5 WHERE dated>%1 AND dated<=%6) AS %5")
+            .arg(snapdated).arg(cols, snapTable, kindCon, viewName).arg(datee);
+}
+
+
+// 尺码数量规范子表（xxxdtlsizer）=========================================================
+// 每明细行每尺码一行，由明细表触发器随写入同步拆分，供分尺码统计直接按尺码GROUP BY，免去逐码INSTR切串。
+// 拆分借助SQLite的json_each表值函数，非法串（含其他控制字符）不拆，不影响单据保存。
+
+//把sizers文本转为JSON数组表达式：["码名","数量","码名","数量",...]
+static QString sizersJsonExp(const QString &col)
+{
+    QString json = QStringLiteral("('[\"' || replace(replace(replace(replace(%1, '\\', '\\\\'), '\"', '\\\"'), "
+                                  "char(9), '\",\"'), char(10), '\",\"') || '\"]')").arg(col);
+    return QStringLiteral("(CASE WHEN json_valid(%1) THEN %1 ELSE '[]' END)").arg(json);
+}
+
+//拆分明细行尺码（触发器中row为NEW、fromDtl为空；批量初始化时row为别名、fromDtl为明细表）
+static QString sizerSplitSelectSql(const QString &row, const QString &fromDtl = QString())
+{
+    QString json = sizersJsonExp(QStringLiteral("%1.sizers").arg(row));
+    QString from = (fromDtl.isEmpty()) ? QString() : QStringLiteral("%1 AS %2, ").arg(fromDtl, row);
+    return QStringLiteral("SELECT %1.parentid, %1.rowtime, sa.value, sum(CAST(sq.value AS INTEGER)) "
+                          "FROM %2json_each(%3) AS sa JOIN json_each(%3) AS sq ON sq.key=sa.key+1 "
+                          "WHERE (sa.key % 2)=0 GROUP BY %1.parentid, %1.rowtime, sa.value")
+            .arg(row, from, json);
+}
+
+//分尺码视图单元，列同vi_xxx_attr或vi_stock_attr，但以sizer、qty（已含正负）代替sizers及金额
+static QString selectSheetSizerSql(const QString &mainTable, const bool minus, const bool stSwitch, const bool forStockk)
+{
+    QString sheetName = mainTable.toUpper();
+    if ( forStockk && mainTable == QStringLiteral("dbd") )
+        sheetName = ( stSwitch ) ? "DBJ" : "DBC";
+
+    QStringList fs;
+    fs << QStringLiteral("'%1' AS sheetname").arg(sheetName);
+    fs << QStringLiteral("%1.sheetid").arg(mainTable);
+    fs << QStringLiteral("%1.dated").arg(mainTable);
+    fs << QStringLiteral("%1.chktime").arg(mainTable);
+    fs << ((stSwitch) ? QStringLiteral("%1.trader AS shop").arg(mainTable) : QStringLiteral("%1.shop").arg(mainTable));
+    if ( !forStockk ) {
+        fs << QStringLiteral("%1.proof").arg(mainTable);
+        fs << QStringLiteral("%1.stype").arg(mainTable);
+        fs << QStringLiteral("%1.staff").arg(mainTable);
+        fs << ((stSwitch) ? QStringLiteral("%1.shop AS trader").arg(mainTable) : QStringLiteral("%1.trader").arg(mainTable));
+    }
+    fs << QStringLiteral("%1dtl.cargo").arg(mainTable);
+    fs << QStringLiteral("%1dtl.color").arg(mainTable);
+    fs << QStringLiteral("%1dtlsizer.sizer").arg(mainTable);
+    fs << ((minus) ? QStringLiteral("(0-%1dtlsizer.qty) AS qty").arg(mainTable) : QStringLiteral("%1dtlsizer.qty").arg(mainTable));
+    fs << QStringLiteral("cargo.hpname");
+    fs << QStringLiteral("cargo.colortype");
+    fs << QStringLiteral("cargo.sizertype");
+    fs << QStringLiteral("cargo.setprice");
+    fs << QStringLiteral("cargo.unit");
+    for ( int i = 1; i <= 6; ++i ) {
+        fs << QStringLiteral("cargo.attr%1").arg(i);
+    }
+
+    //注意不要加分号，因为别处要UNION ALL
+    return QStringLiteral("SELECT %1 FROM %2 JOIN %2dtl ON %2.sheetid=%2dtl.parentid "
+                          "JOIN %2dtlsizer ON %2dtlsizer.parentid=%2dtl.parentid AND %2dtlsizer.rowtime=%2dtl.rowtime "
+                          "LEFT JOIN cargo ON cargo.hpcode=%2dtl.cargo")
+            .arg(fs.join(QChar(44)), mainTable);
+}
+
+QStringList sizerDetailUpgradeSqls(QSqlDatabase &db)
+{
+    QStringList sqls;
+
+    //检查JSON函数支持（Qt自带SQLite版本较老时没有）
+    QSqlQuery qry(db);
+    qry.exec(QStringLiteral("select count(*) from json_each('[1]');"));
+    if ( qry.lastError().isValid() ) {
+        qDebug() << "sizerDetailUpgradeSqls: json not supported.";
+        return sqls;
+    }
+    qry.finish();
+
+    bool fresh = getExistsFieldsOfTable(QStringLiteral("syddtlsizer"), db).isEmpty();
+
+    QStringList tables;
+    tables << "cgd" << "cgj" << "cgt" << "pfd" << "pff" << "pft" << "lsd" << "dbd" << "syd";
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        QString table = tables.at(i);
+        sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS %1dtlsizer("
+                               "parentid    INTEGER NOT NULL, "
+                               "rowtime     INTEGER NOT NULL, "
+                               "sizer       TEXT NOT NULL, "
+                               "qty         INTEGER DEFAULT 0, "
+                               "primary key(parentid, rowtime, sizer));").arg(table);
+
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_sizer_%1dtl_ins AFTER INSERT ON %1dtl BEGIN "
+                               "DELETE FROM %1dtlsizer WHERE parentid=NEW.parentid AND rowtime=NEW.rowtime; "
+                               "INSERT INTO %1dtlsizer(parentid, rowtime, sizer, qty) %2; END;")
+                .arg(table, sizerSplitSelectSql(QStringLiteral("NEW")));
+
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_sizer_%1dtl_del AFTER DELETE ON %1dtl BEGIN "
+                               "DELETE FROM %1dtlsizer WHERE parentid=OLD.parentid AND rowtime=OLD.rowtime; END;")
+                .arg(table);
+
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_sizer_%1dtl_upd AFTER UPDATE ON %1dtl "
+                               "WHEN NEW.parentid IS NOT OLD.parentid OR NEW.rowtime IS NOT OLD.rowtime "
+                               "OR NEW.sizers IS NOT OLD.sizers BEGIN "
+                               "DELETE FROM %1dtlsizer WHERE parentid=OLD.parentid AND rowtime=OLD.rowtime; "
+                               "DELETE FROM %1dtlsizer WHERE parentid=NEW.parentid AND rowtime=NEW.rowtime; "
+                               "INSERT INTO %1dtlsizer(parentid, rowtime, sizer, qty) %2; END;")
+                .arg(table, sizerSplitSelectSql(QStringLiteral("NEW")));
+
+        if ( fresh ) {
+            sqls << QStringLiteral("INSERT INTO %1dtlsizer(parentid, rowtime, sizer, qty) %2;")
+                    .arg(table, sizerSplitSelectSql(QStringLiteral("d"), QStringLiteral("%1dtl").arg(table)));
+        }
+    }
+
+    //分尺码视图
+    QStringList sheets;
+    sheets << "cgj" << "cgt" << "pff" << "pft" << "lsd" << "syd" << "dbd";
+    for ( int i = 0, iLen = sheets.length(); i < iLen; ++i ) {
+        sqls << QStringLiteral("CREATE VIEW IF NOT EXISTS vi_%1_sizer AS %2;")
+                .arg(sheets.at(i), selectSheetSizerSql(sheets.at(i), false, false, false));
+    }
+    sqls << QStringLiteral("CREATE VIEW IF NOT EXISTS vi_dbr_sizer AS %1;")
+            .arg(selectSheetSizerSql("dbd", false, true, false));
+
+    QStringList stockUnits;
+    stockUnits << selectSheetSizerSql("syd", false, false, true)
+               << selectSheetSizerSql("cgj", false, false, true)
+               << selectSheetSizerSql("cgt", true, false, true)
+               << selectSheetSizerSql("pff", true, false, true)
+               << selectSheetSizerSql("pft", false, false, true)
+               << selectSheetSizerSql("lsd", true, false, true);
+    sqls << QStringLiteral("CREATE VIEW IF NOT EXISTS vi_stock_nodb_sizer AS %1;")
+            .arg(stockUnits.join(QStringLiteral(" UNION ALL ")));
+
+    stockUnits << selectSheetSizerSql("dbd", true, false, true)
+               << selectSheetSizerSql("dbd", false, true, true);
+    sqls << QStringLiteral("CREATE VIEW IF NOT EXISTS vi_stock_sizer AS %1;")
+            .arg(stockUnits.join(QStringLiteral(" UNION ALL ")));
+
+    return sqls;
+}
+
+QStringList indexMigrationSqls(QSqlDatabase &db)
+{
+    QStringList sqls;
+
+    QSqlQuery qry(db);
+    qry.exec(QStringLiteral("PRAGMA user_version;"));
+    int version = ( qry.next() ) ? qry.value(0).toInt() : 0;
+    qry.finish();
+
+    QStringList tables;
+    tables << "cgd" << "cgj" << "cgt" << "pfd" << "pff" << "pft" << "lsd" << "dbd" << "syd" << "szd";
+
+    //v1：统计查询常用过滤字段（日期、客户+日期、审核时间、明细货号+色号）
+    if ( version < 1 ) {
+        for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+            QString table = tables.at(i);
+            sqls << QStringLiteral("CREATE INDEX IF NOT EXISTS idx%1dated ON %1(dated);").arg(table)
+                 << QStringLiteral("CREATE INDEX IF NOT EXISTS idx%1traderdated ON %1(trader, dated);").arg(table)
+                 << QStringLiteral("CREATE INDEX IF NOT EXISTS idx%1chktime ON %1(chktime);").arg(table);
+            if ( table != QStringLiteral("szd") )
+                sqls << QStringLiteral("CREATE INDEX IF NOT EXISTS idx%1dtlcargo ON %1dtl(cargo, color);").arg(table);
+        }
+        sqls << QStringLiteral("ANALYZE;");
+    }
+
+    //新增版本步骤在此追加，并同步修改下面版本号
+    if ( !sqls.isEmpty() )
+        sqls << QStringLiteral("PRAGMA user_version=%1;").arg(BOOK_INDEX_VERSION);
+
+    return sqls;
+}
+
+
+//同步给前端的登记表及其主键字段
+static QList<QPair<QString, QString> > regChangeLogTables()
+{
+    QList<QPair<QString, QString> > tables;
+    tables << qMakePair(QStringLiteral("barcoderule"), QStringLiteral("barcodexp"))
+           << qMakePair(QStringLiteral("sizertype"), QStringLiteral("tname"))
+           << qMakePair(QStringLiteral("colortype"), QStringLiteral("tname"))
+           << qMakePair(QStringLiteral("cargo"), QStringLiteral("hpcode"))
+           << qMakePair(QStringLiteral("shop"), QStringLiteral("kname"))
+           << qMakePair(QStringLiteral("customer"), QStringLiteral("kname"))
+           << qMakePair(QStringLiteral("supplier"), QStringLiteral("kname"))
+           << qMakePair(QStringLiteral("staff"), QStringLiteral("kname"))
+           << qMakePair(QStringLiteral("subject"), QStringLiteral("kname"));
+    return tables;
+}
+
+QStringList regChangeLogSqls()
+{
+    QStringList sqls;
+
+    //AUTOINCREMENT保证序号删除后也不重用
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS reg_changelog("
+                           "seq         INTEGER PRIMARY KEY AUTOINCREMENT, "
+                           "tname       TEXT NOT NULL, "
+                           "kname       TEXT NOT NULL, "
+                           "op          INTEGER NOT NULL, "      //1增改，2删除
+                           "uptime      INTEGER DEFAULT 0);");
+    sqls << QStringLiteral("CREATE INDEX IF NOT EXISTS idxregchangelog ON reg_changelog(tname, seq);");
+    //删除键同步时按（表、键）查有无更晚记录，压缩时按（表、键）取最大序号
+    sqls << QStringLiteral("CREATE INDEX IF NOT EXISTS idxregchangelogkey ON reg_changelog(tname, kname, seq);");
+    sqls << QStringLiteral("CREATE TABLE IF NOT EXISTS reg_changefloor("
+                           "id          INTEGER PRIMARY KEY CHECK(id=1), "
+                           "floorseq    INTEGER DEFAULT 0);");
+
+    QList<QPair<QString, QString> > tables = regChangeLogTables();
+    for ( int i = 0, iLen = tables.length(); i < iLen; ++i ) {
+        QString table = tables.at(i).first;
+        QString key = tables.at(i).second;
+        QString logExp = QStringLiteral("INSERT INTO reg_changelog(tname, kname, op, uptime) "
+                                        "SELECT '%1', %2.%3, %4, strftime('%s','now') %5;");
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_reglog_%1_ins AFTER INSERT ON %1 "
+                               "BEGIN %2 END;")
+                .arg(table, logExp.arg(table, QStringLiteral("NEW"), key, QStringLiteral("1"), QString()));
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_reglog_%1_del AFTER DELETE ON %1 "
+                               "BEGIN %2 END;")
+                .arg(table, logExp.arg(table, QStringLiteral("OLD"), key, QStringLiteral("2"), QString()));
+
+        //主键改名（如批量改货号）时旧键记删除
+        sqls << QStringLiteral("CREATE TRIGGER IF NOT EXISTS trg_reglog_%1_upd AFTER UPDATE ON %1 "
+                               "BEGIN %2 %3 END;")
+                .arg(table,
+                     logExp.arg(table, QStringLiteral("OLD"), key, QStringLiteral("2"),
+                                QStringLiteral("WHERE OLD.%1 IS NOT NEW.%1").arg(key)),
+                     logExp.arg(table, QStringLiteral("NEW"), key, QStringLiteral("1"), QString()));
+    }
+
+    return sqls;
+}
+
+qint64 regChangeLogSeq(QSqlDatabase &db)
+{
+    QSqlQuery qry(db);
+    qry.exec(QStringLiteral("SELECT seq FROM sqlite_sequence WHERE name='reg_changelog';"));
+    qint64 seq = ( qry.next() ) ? qry.value(0).toLongLong() : 0;
+    qry.finish();
+    return seq;
+}
+
+qint64 regChangeLogFloor(QSqlDatabase &db)
+{
+    QSqlQuery qry(db);
+    qry.exec(QStringLiteral("SELECT floorseq FROM reg_changefloor WHERE id=1;"));
+    qint64 seq = ( qry.next() ) ? qry.value(0).toLongLong() : 0;
+    qry.finish();
+    return seq;
+}
+
+QString regChangeLogCompact(QSqlDatabase &db, const int keepDays)
+{
+    //同一键只留最新一条；过期删除记录清掉并抬高下限，上次序号低于下限的前端改为全量
+    qint64 cutoff = QDateTime::currentSecsSinceEpoch() - 24 * 3600 * qint64(keepDays);
+    QStringList sqls;
+    sqls << QStringLiteral("DELETE FROM reg_changelog WHERE seq NOT IN "
+                           "(SELECT max(seq) FROM reg_changelog GROUP BY tname, kname);")
+         << QStringLiteral("INSERT OR REPLACE INTO reg_changefloor(id, floorseq) "
+                           "SELECT 1, max(ifnull((SELECT floorseq FROM reg_changefloor WHERE id=1), 0), "
+                           "ifnull((SELECT max(seq) FROM reg_changelog WHERE op=2 AND uptime<%1), 0));").arg(cutoff)
+         << QStringLiteral("DELETE FROM reg_changelog WHERE op=2 AND uptime<%1;").arg(cutoff);
+
+    QSqlQuery qry(db);
+    if ( !qry.exec(QStringLiteral("BEGIN IMMEDIATE;")) )
+        return qry.lastError().text();
+    for ( int i = 0, iLen = sqls.length(); i < iLen; ++i ) {
+        if ( !qry.exec(sqls.at(i)) ) {
+            QString strErr = qry.lastError().text();
+            db.rollback();
+            return strErr;
+        }
+    }
+    if ( !db.commit() )
+        return db.lastError().text();
+    return QString();
+}
+
+
 QVariant readValueFromSqliteFile(const QString &sql, const QString &sqliteFile)
 {
     //注意：要保证bookFile的路径必须已经创建好，但文件却不能存在。否则，QSqlDatabase.open()会产生“out of memory”错误。
@@ -1083,6 +2006,30 @@ QString setValueToSqliteFile(const QStringList &sqls, const QString &sqliteFile)
     return strErr;
 }
 
+//表达式（去掉引号内文字后）所用标识符是否都在fields中；函数名与常用关键字不算，认不出的一律当作列
+bool sqlExpsOnlyUseFields(const QStringList &exps, const QStringList &fields)
+{
+    static const QSet<QString> keywords = QSet<QString>({"and", "or", "not", "in", "is", "null", "like", "glob",
+                                                         "between", "as", "case", "when", "then", "else", "end",
+                                                         "distinct", "integer", "text", "real", "escape"});
+    QRegularExpression reQuoted(QStringLiteral("'[^']*'"));
+    QRegularExpression reIdent(QStringLiteral("\\b([A-Za-z_][A-Za-z0-9_]*)\\b(\\s*\\()?"));
+    for ( int i = 0, iLen = exps.length(); i < iLen; ++i ) {
+        QString exp = exps.at(i);
+        exp.replace(reQuoted, QStringLiteral("''"));
+        QRegularExpressionMatchIterator it = reIdent.globalMatch(exp);
+        while ( it.hasNext() ) {
+            QRegularExpressionMatch m = it.next();
+            QString ident = m.captured(1).toLower();
+            if ( !m.captured(2).isEmpty() || keywords.contains(ident) )
+                continue;
+            if ( !fields.contains(ident) )
+                return false;
+        }
+    }
+    return true;
+}
+
 QStringList getExistsFieldsOfTable(const QString &table, QSqlDatabase &db)
 {
     QSqlQuery qry(db);
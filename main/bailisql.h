@@ -8,9 +8,33 @@ namespace BailiSoft {
 
 extern QStringList sqliteInitSqls(const QString &bookName, const bool forImport);
 
+extern QStringList stockBalanceSqls();
+extern QString stockBalanceRebuild(QSqlDatabase &db);    //成功后记下已建标记
+extern bool stockBalanceReady(QSqlDatabase &db);          //已建标记在，库存账表可直接读
+extern int stockBalanceVerify(QSqlDatabase &db);        //返回与vi_stock不一致的行数，-1出错
+extern int stockBalanceCompact(QSqlDatabase &db, const int minLength);
+
+extern QStringList periodSnapshotSqls();
+extern QString periodSnapshotRefresh(QSqlDatabase &db);       //补建各已结束月份的缺失快照，成功返回空串
+extern qint64 periodSnapshotBefore(QSqlDatabase &db, const qint64 datee);
+//快照+增量数据源子查询（别名为原视图名），不支持该视图或无可用快照时返回空串
+extern QString periodSnapshotSource(QSqlDatabase &db, const QString &viewName, const qint64 datee);
+
+extern QStringList sizerDetailUpgradeSqls(QSqlDatabase &db);   //不支持JSON函数时返回空
+
+#define BOOK_INDEX_VERSION  1
+extern QStringList indexMigrationSqls(QSqlDatabase &db);      //按PRAGMA user_version补建索引，已最新时返回空
+
+#define REG_TOMBSTONE_KEEP_DAYS     90
+extern QStringList regChangeLogSqls();                  //登记变更日志表及各登记表触发器
+extern qint64 regChangeLogSeq(QSqlDatabase &db);        //当前最大变更序号
+extern qint64 regChangeLogFloor(QSqlDatabase &db);      //可增量同步的最低序号，低于此须全量
+extern QString regChangeLogCompact(QSqlDatabase &db, const int keepDays);
+
 extern QVariant readValueFromSqliteFile(const QString &sql, const QString &sqliteFile = QString());
 extern QString setValueToSqliteFile(const QStringList &sqls, const QString &sqliteFile = QString());
 extern QStringList getExistsFieldsOfTable(const QString &table, QSqlDatabase &db);
+extern bool sqlExpsOnlyUseFields(const QStringList &exps, const QStringList &fields);
 
 }
 
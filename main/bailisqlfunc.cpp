@@ -0,0 +1,288 @@
+#include "bailisqlfunc.h"
+
+#ifdef BAILI_SQLITE_FUNCS
+#include <sqlite3.h>
+#endif
+
+namespace BailiSoft {
+
+static QMutex               sizerFuncMutex;
+static QSet<QString>        sizerFuncConns;     //已注册的连接名
+
+#ifdef BAILI_SQLITE_FUNCS
+
+typedef QPair<QByteArray, qint64>   SizerQty;
+
+//解析尺码串（可为明细原串，或带\r\v正\r\f负标志的多段串），同名码合并，按首次出现顺序追加到*pairs
+static void parseSizers(const char *p, const int len, QVector<SizerQty> *pairs)
+{
+    QHash<QByteArray, int> indexes;
+    for ( int i = 0; i < pairs->size(); ++i ) {
+        indexes.insert(pairs->at(i).first, i);
+    }
+
+    bool minus = false;
+    int pos = 0;
+    while ( pos < len ) {
+        //段标志
+        if ( p[pos] == '\r' ) {
+            if ( pos + 1 < len ) minus = ( p[pos + 1] == '\f' );
+            pos += 2;
+            continue;
+        }
+
+        //一行：码名\t数量
+        int lineEnd = pos;
+        while ( lineEnd < len && p[lineEnd] != '\n' && p[lineEnd] != '\r' ) lineEnd++;
+        int tab = pos;
+        while ( tab < lineEnd && p[tab] != '\t' ) tab++;
+        if ( tab < lineEnd ) {
+            QByteArray name(p + pos, tab - pos);
+            qint64 qty = QByteArray(p + tab + 1, lineEnd - tab - 1).toLongLong();
+            if ( minus ) qty = 0 - qty;
+            int idx = indexes.value(name, -1);
+            if ( idx < 0 ) {
+                indexes.insert(name, pairs->size());
+                pairs->append(qMakePair(name, qty));
+            } else {
+                (*pairs)[idx].second += qty;
+            }
+        }
+        pos = ( lineEnd < len && p[lineEnd] == '\n' ) ? lineEnd + 1 : lineEnd;
+    }
+}
+
+static void parseSizersValue(sqlite3_value *value, QVector<SizerQty> *pairs)
+{
+    const char *p = reinterpret_cast<const char*>(sqlite3_value_text(value));
+    if ( p ) parseSizers(p, sqlite3_value_bytes(value), pairs);
+}
+
+
+// sizer_qty ============================================================================
+static void sizerQtyFunc(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    Q_UNUSED(argc)
+    const char *p = reinterpret_cast<const char*>(sqlite3_value_text(argv[0]));
+    const char *n = reinterpret_cast<const char*>(sqlite3_value_text(argv[1]));
+    if ( !p || !n ) {
+        sqlite3_result_int64(ctx, 0);
+        return;
+    }
+    QVector<SizerQty> pairs;
+    parseSizers(p, sqlite3_value_bytes(argv[0]), &pairs);
+    QByteArray name(n, sqlite3_value_bytes(argv[1]));
+    for ( int i = 0; i < pairs.size(); ++i ) {
+        if ( pairs.at(i).first == name ) {
+            sqlite3_result_int64(ctx, pairs.at(i).second);
+            return;
+        }
+    }
+    sqlite3_result_int64(ctx, 0);
+}
+
+
+// sizer_sum ============================================================================
+static void sizerSumStep(sqlite3_context *ctx, int argc, sqlite3_value **argv)
+{
+    Q_UNUSED(argc)
+    QVector<SizerQty> **pp = static_cast<QVector<SizerQty>**>(sqlite3_aggregate_context(ctx, sizeof(void*)));
+    if ( !pp ) {
+        sqlite3_result_error_nomem(ctx);
+        return;
+    }
+    if ( !*pp ) *pp = new QVector<SizerQty>();
+    parseSizersValue(argv[0], *pp);
+}
+
+static void sizerSumFinal(sqlite3_context *ctx)
+{
+    QVector<SizerQty> **pp = static_cast<QVector<SizerQty>**>(sqlite3_aggregate_context(ctx, 0));
+    QByteArray merged;
+    if ( pp && *pp ) {
+        const QVector<SizerQty> &pairs = **pp;
+        for ( int i = 0; i < pairs.size(); ++i ) {
+            if ( pairs.at(i).second != 0 ) {
+                merged.append( (merged.isEmpty()) ? "\r\v" : "\n" );
+                merged.append(pairs.at(i).first).append('\t').append(QByteArray::number(pairs.at(i).second));
+            }
+        }
+        delete *pp;
+        *pp = nullptr;
+    }
+    sqlite3_result_text(ctx, merged.constData(), merged.size(), SQLITE_TRANSIENT);
+}
+
+
+// sizer_each ===========================================================================
+struct SizerEachCursor {
+    sqlite3_vtab_cursor     base;       //必须为首成员
+    QVector<SizerQty>       pairs;
+    int                     pos;
+};
+
+static int sizerEachConnect(sqlite3 *db, void *, int, const char *const *, sqlite3_vtab **ppVtab, char **)
+{
+    int rc = sqlite3_declare_vtab(db, "CREATE TABLE x(sizer TEXT, qty INTEGER, sizers HIDDEN)");
+    if ( rc != SQLITE_OK ) return rc;
+    sqlite3_vtab *vtab = static_cast<sqlite3_vtab*>(sqlite3_malloc(sizeof(sqlite3_vtab)));
+    if ( !vtab ) return SQLITE_NOMEM;
+    memset(vtab, 0, sizeof(sqlite3_vtab));
+    *ppVtab = vtab;
+    return SQLITE_OK;
+}
+
+static int sizerEachDisconnect(sqlite3_vtab *vtab)
+{
+    sqlite3_free(vtab);
+    return SQLITE_OK;
+}
+
+static int sizerEachBestIndex(sqlite3_vtab *, sqlite3_index_info *info)
+{
+    //必须以参数（隐藏列sizers等值约束）调用，否则不可用
+    for ( int i = 0; i < info->nConstraint; ++i ) {
+        const sqlite3_index_info::sqlite3_index_constraint &con = info->aConstraint[i];
+        if ( con.iColumn == 2 && con.op == SQLITE_INDEX_CONSTRAINT_EQ ) {
+            if ( !con.usable ) return SQLITE_CONSTRAINT;
+            info->aConstraintUsage[i].argvIndex = 1;
+            info->aConstraintUsage[i].omit = 1;
+            info->idxNum = 1;
+            info->estimatedCost = 10;
+            info->estimatedRows = 10;
+            return SQLITE_OK;
+        }
+    }
+    info->idxNum = 0;
+    info->estimatedCost = 1e99;
+    return SQLITE_OK;
+}
+
+static int sizerEachOpen(sqlite3_vtab *, sqlite3_vtab_cursor **ppCursor)
+{
+    SizerEachCursor *cur = new SizerEachCursor();
+    memset(&cur->base, 0, sizeof(sqlite3_vtab_cursor));
+    cur->pos = 0;
+    *ppCursor = &cur->base;
+    return SQLITE_OK;
+}
+
+static int sizerEachClose(sqlite3_vtab_cursor *cursor)
+{
+    delete reinterpret_cast<SizerEachCursor*>(cursor);
+    return SQLITE_OK;
+}
+
+static int sizerEachFilter(sqlite3_vtab_cursor *cursor, int idxNum, const char *, int argc, sqlite3_value **argv)
+{
+    SizerEachCursor *cur = reinterpret_cast<SizerEachCursor*>(cursor);
+    cur->pairs.clear();
+    cur->pos = 0;
+    if ( idxNum == 1 && argc > 0 )
+        parseSizersValue(argv[0], &cur->pairs);
+    return SQLITE_OK;
+}
+
+static int sizerEachNext(sqlite3_vtab_cursor *cursor)
+{
+    reinterpret_cast<SizerEachCursor*>(cursor)->pos++;
+    return SQLITE_OK;
+}
+
+static int sizerEachEof(sqlite3_vtab_cursor *cursor)
+{
+    SizerEachCursor *cur = reinterpret_cast<SizerEachCursor*>(cursor);
+    return cur->pos >= cur->pairs.size();
+}
+
+static int sizerEachColumn(sqlite3_vtab_cursor *cursor, sqlite3_context *ctx, int col)
+{
+    SizerEachCursor *cur = reinterpret_cast<SizerEachCursor*>(cursor);
+    const SizerQty &pair = cur->pairs.at(cur->pos);
+    if ( col == 0 )
+        sqlite3_result_text(ctx, pair.first.constData(), pair.first.size(), SQLITE_TRANSIENT);
+    else if ( col == 1 )
+        sqlite3_result_int64(ctx, pair.second);
+    else
+        sqlite3_result_null(ctx);
+    return SQLITE_OK;
+}
+
+static int sizerEachRowid(sqlite3_vtab_cursor *cursor, sqlite3_int64 *rowid)
+{
+    *rowid = reinterpret_cast<SizerEachCursor*>(cursor)->pos;
+    return SQLITE_OK;
+}
+
+//xCreate为空即仅可作表值函数直接使用（eponymous-only）；其余成员各SQLite版本不一，运行时赋值
+static sqlite3_module sizerEachModule;
+
+static void initSizerEachModule()
+{
+    if ( sizerEachModule.xConnect )
+        return;
+    sizerEachModule.xConnect = sizerEachConnect;
+    sizerEachModule.xBestIndex = sizerEachBestIndex;
+    sizerEachModule.xDisconnect = sizerEachDisconnect;
+    sizerEachModule.xOpen = sizerEachOpen;
+    sizerEachModule.xClose = sizerEachClose;
+    sizerEachModule.xFilter = sizerEachFilter;
+    sizerEachModule.xNext = sizerEachNext;
+    sizerEachModule.xEof = sizerEachEof;
+    sizerEachModule.xColumn = sizerEachColumn;
+    sizerEachModule.xRowid = sizerEachRowid;
+}
+
+#endif  //BAILI_SQLITE_FUNCS
+
+
+bool registerSizerFunctions(QSqlDatabase &db)
+{
+    //同名连接关闭重开后须重新注册，先清除旧登记
+    QMutexLocker locker(&sizerFuncMutex);
+    sizerFuncConns.remove(db.connectionName());
+
+#ifdef BAILI_SQLITE_FUNCS
+    QVariant v = db.driver()->handle();
+    if ( !v.isValid() || qstrcmp(v.typeName(), "sqlite3*") != 0 )
+        return false;
+    sqlite3 *handle = *static_cast<sqlite3 **>(v.data());
+    if ( !handle )
+        return false;
+
+    //发布时误带Qt原版qsqlite插件（自带另一份SQLite）则不能混用，按源码标识核对
+    QSqlQuery qry(db);
+    qry.exec(QStringLiteral("select sqlite_source_id();"));
+    QString driverSource = ( qry.next() ) ? qry.value(0).toString() : QString();
+    qry.finish();
+    if ( driverSource != QString::fromLatin1(sqlite3_sourceid()) ) {
+        qDebug() << "registerSizerFunctions: driver sqlite" << driverSource << "differs from linked" << sqlite3_sourceid();
+        return false;
+    }
+
+    initSizerEachModule();
+
+    const int flags = SQLITE_UTF8 | SQLITE_DETERMINISTIC;
+    bool ok = sqlite3_create_function(handle, "sizer_qty", 2, flags, nullptr, sizerQtyFunc, nullptr, nullptr) == SQLITE_OK
+            && sqlite3_create_function(handle, "sizer_sum", 1, flags, nullptr, nullptr, sizerSumStep, sizerSumFinal) == SQLITE_OK
+            && sqlite3_create_module(handle, "sizer_each", &sizerEachModule, nullptr) == SQLITE_OK;
+    if ( !ok ) {
+        qDebug() << "registerSizerFunctions failed:" << sqlite3_errmsg(handle);
+        return false;
+    }
+
+    sizerFuncConns.insert(db.connectionName());
+    return true;
+#else
+    Q_UNUSED(db)
+    return false;
+#endif
+}
+
+bool hasSizerFunctions(const QSqlDatabase &db)
+{
+    QMutexLocker locker(&sizerFuncMutex);
+    return sizerFuncConns.contains(db.connectionName());
+}
+
+}
@@ -0,0 +1,19 @@
+#ifndef BAILISQLFUNC_H
+#define BAILISQLFUNC_H
+
+#include <QtCore>
+#include <QtSql>
+
+namespace BailiSoft {
+
+// 尺码明细SQLite扩展函数 =====================================================================
+// sizer_qty(sizers, name)  取某尺码数量（\r\f段取负）
+// sizer_sum(sizers)        聚合，合并各正负分段为单段\r\v串（零数量码略去）
+// sizer_each(sizers)       表值函数，逐码返回(sizer, qty)，同名码已合并
+// 直接向QSQLITE驱动的连接句柄注册，仅驱动使用共享SQLite库时编入（见BailiR17Server.pro）；未编入或注册失败返回false，各处按原SQL执行。
+extern bool registerSizerFunctions(QSqlDatabase &db);
+extern bool hasSizerFunctions(const QSqlDatabase &db);
+
+}
+
+#endif // BAILISQLFUNC_H
@@ -0,0 +1,168 @@
+#include "bailistmt.h"
+#include "bailistore.h"
+#include "bailicache.h"
+
+#define COMMIT_BUSY_RETRIES     3
+#define COMMIT_RETRY_SLEEP_MS   50
+
+namespace BailiSoft {
+
+QMutex BsStmtCache::mutex;
+QHash<QString, QHash<QString, QSqlQuery*> > BsStmtCache::connStmts;
+
+QSqlQuery *BsStmtCache::statement(QSqlDatabase &db, const QString &sql)
+{
+    //值从不拼入SQL文本，语句形状只随表名字段名变化，数量有限，故不设淘汰
+    QMutexLocker locker(&mutex);
+    QHash<QString, QSqlQuery*> &stmts = connStmts[db.connectionName()];
+    QSqlQuery *qry = stmts.value(sql);
+    if ( qry )
+        return qry;
+
+    qry = new QSqlQuery(db);
+    qry->setForwardOnly(true);
+    if ( !qry->prepare(sql) ) {
+        qDebug() << qry->lastError().text();
+        qDebug() << sql;
+        delete qry;
+        return nullptr;
+    }
+    stmts.insert(sql, qry);
+    return qry;
+}
+
+bool BsStmtCache::exec(QSqlDatabase &db, const BsBoundSql &stmt, QString *errText, bool *busy)
+{
+    //无绑定值者多为含字面值的旧式SQL，形状不定，不入缓存
+    if ( stmt.binds.isEmpty() ) {
+        QSqlQuery qry(db);
+        qry.exec(stmt.sql);
+        if ( qry.lastError().isValid() ) {
+            qDebug() << qry.lastError().text();
+            qDebug() << stmt.sql;
+            if ( errText ) *errText = qry.lastError().text();
+            if ( busy ) *busy = isSqliteBusyError(qry.lastError());
+            return false;
+        }
+        return true;
+    }
+
+    QSqlQuery *qry = statement(db, stmt.sql);
+    if ( !qry ) {
+        if ( errText ) *errText = QStringLiteral("prepare failed");
+        return false;
+    }
+
+    for ( int i = 0, iLen = stmt.binds.length(); i < iLen; ++i ) {
+        const QVariant &v = stmt.binds.at(i);
+        //空QString绑定为NULL，而表字段约定为text default ''，故转为空串
+        if ( v.type() == QVariant::String && v.isNull() )
+            qry->bindValue(i, QStringLiteral(""));
+        else
+            qry->bindValue(i, v);
+    }
+
+    bool ok = qry->exec();
+    if ( !ok ) {
+        qDebug() << qry->lastError().text();
+        qDebug() << stmt.sql << stmt.binds;
+        if ( errText ) *errText = qry->lastError().text();
+        if ( busy ) *busy = isSqliteBusyError(qry->lastError());
+    }
+    qry->finish();
+    return ok;
+}
+
+QString BsStmtCache::commit(QSqlDatabase &db, const QList<BsBoundSql> &stmts)
+{
+    BsCheckpointer::touch();
+
+    //BEGIN IMMEDIATE先取写锁（等待时限见连接选项），避免读锁升级写锁时直接BUSY；仍BUSY则稍候整体重试
+    for ( int attempt = 1; ; ++attempt ) {
+        bool retry = ( attempt < COMMIT_BUSY_RETRIES );
+
+        QSqlQuery begin(db);
+        if ( !begin.exec(QStringLiteral("BEGIN IMMEDIATE;")) ) {
+            if ( retry && isSqliteBusyError(begin.lastError()) ) {
+                QThread::msleep(COMMIT_RETRY_SLEEP_MS * attempt);
+                continue;
+            }
+            qDebug() << begin.lastError().text();
+            return begin.lastError().text();
+        }
+        begin.finish();
+
+        QString errText;
+        bool busy = false;
+        int i = 0;
+        for ( int iLen = stmts.length(); i < iLen; ++i ) {
+            if ( !exec(db, stmts.at(i), &errText, &busy) )
+                break;
+        }
+        if ( i == stmts.length() ) {
+            if ( db.commit() ) {
+                for ( int j = 0, jLen = stmts.length(); j < jLen; ++j )
+                    BsResultCache::bumpSql(stmts.at(j).sql);
+                return QString();
+            }
+            errText = db.lastError().text();
+            busy = isSqliteBusyError(db.lastError());
+        }
+        db.rollback();
+
+        if ( retry && busy ) {
+            QThread::msleep(COMMIT_RETRY_SLEEP_MS * attempt);
+            continue;
+        }
+        return ( i < stmts.length() )
+                ? QStringLiteral("%1\n%2").arg(errText, stmts.at(i).sql)
+                : errText;
+    }
+}
+
+void BsStmtCache::release(const QString &connectionName)
+{
+    QMutexLocker locker(&mutex);
+    QHash<QString, QSqlQuery*> stmts = connStmts.take(connectionName);
+    qDeleteAll(stmts);
+}
+
+QString BsStmtCache::insertSql(const QString &table, const QStringList &fields)
+{
+    QStringList marks;
+    for ( int i = 0, iLen = fields.length(); i < iLen; ++i ) {
+        marks << QStringLiteral("?");
+    }
+    return QStringLiteral("insert into %1(%2) values(%3);")
+            .arg(table, fields.join(QStringLiteral(", ")), marks.join(QChar(',')));
+}
+
+QString BsStmtCache::updateSql(const QString &table, const QStringList &fields, const QStringList &keyFields)
+{
+    QStringList sets;
+    for ( int i = 0, iLen = fields.length(); i < iLen; ++i ) {
+        sets << QStringLiteral("%1=?").arg(fields.at(i));
+    }
+    QStringList keys;
+    for ( int i = 0, iLen = keyFields.length(); i < iLen; ++i ) {
+        keys << QStringLiteral("%1=?").arg(keyFields.at(i));
+    }
+    return ( keys.isEmpty() )
+            ? QStringLiteral("update %1 set %2;").arg(table, sets.join(QStringLiteral(", ")))
+            : QStringLiteral("update %1 set %2 where %3;")
+              .arg(table, sets.join(QStringLiteral(", ")), keys.join(QStringLiteral(" and ")));
+}
+
+QString BsStmtCache::selectSql(const QString &table, const QStringList &fields, const QStringList &keyFields)
+{
+    QStringList keys;
+    for ( int i = 0, iLen = keyFields.length(); i < iLen; ++i ) {
+        keys << QStringLiteral("%1=?").arg(keyFields.at(i));
+    }
+    return ( keys.isEmpty() )
+            ? QStringLiteral("select %1 from %2;").arg(fields.join(QStringLiteral(", ")), table)
+            : QStringLiteral("select %1 from %2 where %3;")
+              .arg(fields.join(QStringLiteral(", ")), table, keys.join(QStringLiteral(" and ")));
+}
+
+}
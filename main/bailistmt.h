@@ -0,0 +1,49 @@
+#ifndef BAILISTMT_H
+#define BAILISTMT_H
+
+#include <QtCore>
+#include <QtSql>
+
+namespace BailiSoft {
+
+//带绑定值的SQL（sql中用?占位，binds按序对应；binds为空时即普通SQL）
+struct BsBoundSql
+{
+    BsBoundSql() {}
+    BsBoundSql(const QString &s) : sql(s) {}
+    BsBoundSql(const QString &s, const QVariantList &b) : sql(s), binds(b) {}
+
+    QString         sql;
+    QVariantList    binds;
+};
+
+// 预编译语句缓存 ============================================================================
+// 按连接名分别缓存，键为带?占位的SQL文本（即语句形状），同形状语句只prepare一次，之后只绑定执行。
+// 缓存的QSqlQuery属于其连接所在线程，取用者须与连接同线程；连接关闭或移除前须调用release()。
+class BsStmtCache
+{
+public:
+    //取得已prepare的语句，失败返回nullptr。返回对象由缓存持有，查询类读完后应finish()
+    static QSqlQuery *statement(QSqlDatabase &db, const QString &sql);
+
+    //绑定执行，出错返回false并记录qDebug，errText非空时填出错信息，busy非空时填是否锁冲突
+    static bool exec(QSqlDatabase &db, const BsBoundSql &stmt, QString *errText = nullptr, bool *busy = nullptr);
+
+    //事务批量执行，成功返回空串，失败回滚并返回出错信息（同sqliteCommit约定），锁冲突时整体重试
+    static QString commit(QSqlDatabase &db, const QList<BsBoundSql> &stmts);
+
+    static void release(const QString &connectionName);
+
+    //常用语句形状
+    static QString insertSql(const QString &table, const QStringList &fields);
+    static QString updateSql(const QString &table, const QStringList &fields, const QStringList &keyFields);
+    static QString selectSql(const QString &table, const QStringList &fields, const QStringList &keyFields);
+
+private:
+    static QMutex                                       mutex;
+    static QHash<QString, QHash<QString, QSqlQuery*> >  connStmts;
+};
+
+}
+
+#endif // BAILISTMT_H
@@ -0,0 +1,250 @@
+#include "bailistore.h"
+#include "bailisqlfunc.h"
+#include "bailisql.h"
+
+#define BOOK_BUSY_TIMEOUT_MS        5000
+#define BOOK_CACHE_KIB              8000            //每连接页缓存（负值pragma，单位KiB）
+#define BOOK_MMAP_BYTES             268435456       //256MB
+#define BOOK_WAL_AUTOCHECK_PAGES    4000            //自动检查点兜底阈值，日常由BsCheckpointer处理
+
+#define CHECKPOINT_INTERVAL_MS      10000
+#define CHECKPOINT_QUIET_MS         5000
+#define CHECKPOINT_FORCE_BYTES      (32 * 1024 * 1024)
+#define REGLOG_COMPACT_SECS         (24 * 3600)
+#define SNAPSHOT_REFRESH_SECS       3600
+#define STOCK_COMPACT_SECS          3600
+#define STOCK_COMPACT_MIN_LENGTH    4096            //尺码分段串超过此长度才合并
+
+namespace BailiSoft {
+
+static bool isNetworkBookFile(const QString &bookFile)
+{
+    return bookFile.contains(QStringLiteral("//")) || bookFile.contains(QStringLiteral("\\\\"));
+}
+
+static void execPragma(QSqlDatabase &db, const QString &pragma)
+{
+    QSqlQuery qry(db);
+    qry.exec(pragma);
+    if ( qry.lastError().isValid() ) {
+        qDebug() << qry.lastError().text();
+        qDebug() << pragma;
+    }
+    qry.finish();
+}
+
+bool openBookDatabase(QSqlDatabase &db, const QString &bookFile, const bool readOnly)
+{
+    bool networkFile = isNetworkBookFile(bookFile);
+
+    QString options = QStringLiteral("QSQLITE_BUSY_TIMEOUT=%1;QSQLITE_ENABLE_REGEXP").arg(BOOK_BUSY_TIMEOUT_MS);
+    if ( readOnly )
+        options += QStringLiteral(";QSQLITE_OPEN_READONLY");
+    db.setConnectOptions(options);
+    db.setDatabaseName(bookFile);
+    if ( !db.open() )
+        return false;
+
+    //日志模式记录在文件中，只需可写连接设置；切换需短暂独占，失败不影响使用
+    if ( !readOnly ) {
+        if ( networkFile ) {
+            execPragma(db, QStringLiteral("PRAGMA journal_mode=DELETE;"));
+        } else {
+            execPragma(db, QStringLiteral("PRAGMA journal_mode=WAL;"));
+            execPragma(db, QStringLiteral("PRAGMA synchronous=NORMAL;"));
+            execPragma(db, QStringLiteral("PRAGMA wal_autocheckpoint=%1;").arg(BOOK_WAL_AUTOCHECK_PAGES));
+        }
+    }
+
+    execPragma(db, QStringLiteral("PRAGMA cache_size=-%1;").arg(BOOK_CACHE_KIB));
+    execPragma(db, QStringLiteral("PRAGMA temp_store=MEMORY;"));
+    if ( !networkFile )
+        execPragma(db, QStringLiteral("PRAGMA mmap_size=%1;").arg(BOOK_MMAP_BYTES));
+
+    registerSizerFunctions(db);
+    return true;
+}
+
+bool sqliteCheckpoint(QSqlDatabase &db, const bool truncate)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec( (truncate)
+              ? QStringLiteral("PRAGMA wal_checkpoint(TRUNCATE);")
+              : QStringLiteral("PRAGMA wal_checkpoint(PASSIVE);") );
+    if ( qry.lastError().isValid() ) {
+        qDebug() << "checkpoint: " << qry.lastError().text();
+        return false;
+    }
+
+    //返回行：busy, -wal总页数, 已检查点页数（非WAL模式时为0,-1,-1）
+    bool done = true;
+    if ( qry.next() ) {
+        done = ( qry.value(0).toInt() == 0 );
+    }
+    qry.finish();
+    return done;
+}
+
+bool isSqliteBusyError(const QSqlError &err)
+{
+    //SQLITE_BUSY 5, SQLITE_LOCKED 6
+    QString code = err.nativeErrorCode();
+    return code == QStringLiteral("5") || code == QStringLiteral("6");
+}
+
+static QMutex       watchMutex;
+static QString      watchBookFile;
+
+void watchBookChanges(const QString &bookFile)
+{
+    QMutexLocker locker(&watchMutex);
+    watchBookFile = ( isNetworkBookFile(bookFile) ) ? bookFile : QString();
+}
+
+qint64 bookChangeCounter()
+{
+    QString bookFile;
+    {
+        QMutexLocker locker(&watchMutex);
+        bookFile = watchBookFile;
+    }
+    if ( bookFile.isEmpty() )
+        return 0;
+
+    //文件头偏移24起4字节大端为变更计数
+    QFile f(bookFile);
+    if ( !f.open(QIODevice::ReadOnly) )
+        return -1;
+    QByteArray head = f.read(28);
+    f.close();
+    if ( head.length() < 28 )
+        return -1;
+    return qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(head.constData() + 24));
+}
+
+
+// 检查点调度线程 ============================================================================
+QAtomicInteger<qint64> BsCheckpointer::lastActivity(0);
+
+void BsCheckpointer::bookLogin(const QString &dbfile)
+{
+    QMutexLocker locker(&mMutex);
+    mDatabaseFile = dbfile;
+    mCondition.wakeOne();
+}
+
+void BsCheckpointer::stopWait()
+{
+    {
+        QMutexLocker locker(&mMutex);
+        mStopping = true;
+        mCondition.wakeOne();
+    }
+    wait();
+}
+
+void BsCheckpointer::touch()
+{
+    lastActivity.store(QDateTime::currentMSecsSinceEpoch());
+}
+
+void BsCheckpointer::run()
+{
+    forever {
+        //等待登录账册
+        QString dbFile;
+        {
+            QMutexLocker locker(&mMutex);
+            while ( !mStopping && mDatabaseFile.isEmpty() ) {
+                mCondition.wait(&mMutex);
+            }
+            if ( mStopping )
+                break;
+            dbFile = mDatabaseFile;
+        }
+
+        QString connName = QStringLiteral("bscheckpointconn");
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connName);
+            if ( openBookDatabase(db, dbFile) ) {
+                execPragma(db, QStringLiteral("PRAGMA busy_timeout=1000;"));     //检查点不宜久等
+                //网络账册为回滚日志模式，无检查点可做，只做其余定时维护
+                bool networkFile = isNetworkBookFile(dbFile);
+                QString walFile = ( networkFile ) ? QString() : dbFile + QStringLiteral("-wal");
+                mRegLogCompacted = 0;
+                mSnapshotRefreshed = 0;
+                mStockCompacted = 0;
+
+                forever {
+                    bool bookChanged;
+                    {
+                        QMutexLocker locker(&mMutex);
+                        if ( !mStopping && mDatabaseFile == dbFile )
+                            mCondition.wait(&mMutex, CHECKPOINT_INTERVAL_MS);
+                        bookChanged = mStopping || mDatabaseFile != dbFile;
+                    }
+
+                    //换账册或退出前截断，使账册文件自身完整（便于随后复制备份）
+                    if ( bookChanged ) {
+                        if ( !networkFile )
+                            sqliteCheckpoint(db, true);
+                        break;
+                    }
+
+                    checkpointTick(db, walFile);
+                }
+            } else {
+                qDebug() << "open database failed in checkpoint thread." << db.lastError();
+                QMutexLocker locker(&mMutex);
+                if ( mDatabaseFile == dbFile )
+                    mDatabaseFile.clear();
+            }
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(connName);
+    }
+}
+
+void BsCheckpointer::checkpointTick(QSqlDatabase &db, const QString &walFile)
+{
+    qint64 idleMs = QDateTime::currentMSecsSinceEpoch() - lastActivity.load();
+
+    //登记变更日志每天安静时压缩一次，忙则下次再试
+    qint64 nowSecs = QDateTime::currentSecsSinceEpoch();
+    if ( idleMs >= CHECKPOINT_QUIET_MS && nowSecs - mRegLogCompacted >= REGLOG_COMPACT_SECS ) {
+        QString strErr = regChangeLogCompact(db, REG_TOMBSTONE_KEEP_DAYS);
+        if ( strErr.isEmpty() )
+            mRegLogCompacted = nowSecs;
+        else
+            qDebug() << "regChangeLogCompact" << strErr;
+    }
+
+    //期末快照被改动历史单据的触发器作废后，安静时逐月补建，跨月后也由此生成上月快照
+    if ( idleMs >= CHECKPOINT_QUIET_MS && nowSecs - mSnapshotRefreshed >= SNAPSHOT_REFRESH_SECS ) {
+        QString strErr = periodSnapshotRefresh(db);
+        if ( strErr.isEmpty() )
+            mSnapshotRefreshed = nowSecs;
+        else
+            qDebug() << "periodSnapshotRefresh" << strErr;
+    }
+
+    //库存账表触发器只追加尺码分段，安静时合并过长的行，免得长期不重新登录时越积越长
+    if ( idleMs >= CHECKPOINT_QUIET_MS && nowSecs - mStockCompacted >= STOCK_COMPACT_SECS ) {
+        if ( stockBalanceCompact(db, STOCK_COMPACT_MIN_LENGTH) >= 0 )
+            mStockCompacted = nowSecs;
+    }
+
+    qint64 walSize = ( walFile.isEmpty() ) ? 0 : QFileInfo(walFile).size();
+    if ( walSize <= 0 )
+        return;
+
+    if ( idleMs >= CHECKPOINT_QUIET_MS ) {
+        sqliteCheckpoint(db, true);
+    }
+    else if ( walSize >= CHECKPOINT_FORCE_BYTES ) {
+        sqliteCheckpoint(db, false);
+    }
+}
+
+}
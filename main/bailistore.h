@@ -0,0 +1,58 @@
+#ifndef BAILISTORE_H
+#define BAILISTORE_H
+
+#include <QtCore>
+#include <QtSql>
+#include <QThread>
+
+namespace BailiSoft {
+
+//打开账册连接：连接选项、WAL日志模式、缓存与mmap等pragma统一在此设置，并注册尺码扩展函数。
+//网络共享路径上的账册不能用WAL（依赖共享内存），仍用回滚日志模式。
+extern bool openBookDatabase(QSqlDatabase &db, const QString &bookFile, const bool readOnly = false);
+
+//WAL检查点，truncate为true时等读者退出后截断-wal文件（复制账册文件前须调用）
+extern bool sqliteCheckpoint(QSqlDatabase &db, const bool truncate);
+
+extern bool isSqliteBusyError(const QSqlError &err);
+
+//网络共享账册可被其他电脑上的实例写入，进程内各表写入代次反映不到。登录时登记账册文件，
+//网络账册（回滚日志模式，每次提交递增文件头变更计数）由bookChangeCounter()读出该计数，
+//本地账册不登记恒返回0，读取失败返回-1。
+extern void watchBookChanges(const QString &bookFile);
+extern qint64 bookChangeCounter();
+
+// 检查点调度线程 ============================================================================
+// 各连接自动检查点阈值调大，日常由本线程在安静时（一段时间无读写活动）截断式检查点，
+// -wal增长过大时不等安静也做一次被动检查点，避免写事务提交时顺带做检查点的延时。
+// 安静时机顺带每天压缩一次登记变更日志，每小时补建一次缺失的期末快照、合并一次库存账表过长的尺码分段。
+// 网络账册不用WAL，不做检查点，但这些定时维护照做（安静只按本机活动判断）。
+class BsCheckpointer : public QThread
+{
+    Q_OBJECT
+public:
+    BsCheckpointer(QObject *parent) : QThread(parent) {}
+
+    void bookLogin(const QString &dbfile);
+    void stopWait();
+
+    static void touch();    //记录读写活动时间，供判断安静时机
+
+private:
+    void run() override;
+    void checkpointTick(QSqlDatabase &db, const QString &walFile);
+
+    QString                 mDatabaseFile;
+    qint64                  mRegLogCompacted = 0;
+    qint64                  mSnapshotRefreshed = 0;
+    qint64                  mStockCompacted = 0;
+    bool                    mStopping = false;
+    QMutex                  mMutex;
+    QWaitCondition          mCondition;
+
+    static QAtomicInteger<qint64>   lastActivity;
+};
+
+}
+
+#endif // BAILISTORE_H
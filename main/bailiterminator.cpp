@@ -4,91 +4,91 @@
 #include "bailifunc.h"
 #include "bailiwins.h"
 #include "bailishare.h"
+#include "bailimetrics.h"
+#include "bailicrypto.h"
+#include "bailiflight.h"
+#include "bailistore.h"
+#include "bailisql.h"
+#include "bailispecsum.h"
+#include "bailiplan.h"
+#include "bailicache.h"
+#include "bailicatalog.h"
 #include "third/tinyAES/aes.hpp"
 
 #include <QtSql>
 
 namespace BailiSoft {
 
-BsTerminator::BsTerminator(QObject *parent, const QString &databaseConnectionName) : QThread(parent)
+BsTerminator::BsTerminator(QObject *parent, const QString &databaseConnectionName, BsScheduler *scheduler,
+                           const int pinnedLane)
+    : QThread(parent), mppScheduler(scheduler), mPinnedLane(pinnedLane)
 {
     mDatabaseConnectionName = databaseConnectionName;
+    mpCipher = BsAesCipher::create();
 }
 
-void BsTerminator::taskAdd(const QByteArray &fromServerData)
+BsTerminator::~BsTerminator()
 {
-    QMutexLocker locker(&mTransactionMutex);
-    mTransactions.enqueue(fromServerData);
-    mTransactionAdded.wakeOne();
-}
-
-void BsTerminator::taskStop()
-{
-    mTransactions.enqueue(QByteArray());    //约定空数据结束
-    mTransactionAdded.wakeOne();
-    wait();
-}
-
-bool BsTerminator::isIdle()
-{
-    return mTransactions.isEmpty();
+    delete mpCipher;
 }
 
 void BsTerminator::run()
 {
-    //准备
-    {
-        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), mDatabaseConnectionName);
-        db.setConnectOptions("QSQLITE_ENABLE_REGEXP");
-        db.setDatabaseName(loginFile);
-        if ( !db.open() ) {
-            qDebug() << "open database failed in net thread.";
-            return;
-        }
-    }
-
-    //循环工作
+    //循环工作（数据库连接在取到第一个任务时才打开，线程池扩容出的线程不必空占连接）
+    BsTermTask task;        //任务上下文，下次取任务时交还调度器以释放前端与通道占用
+    QElapsedTimer stageTimer;
     forever {
-        //接收数据
-        QByteArray fromServerData;
-
-        //检查事务队列
-        {
-            //加锁（花括号解锁）
-            QMutexLocker locker(&mTransactionMutex);
-
-            //阻塞等事务
-            if (mTransactions.isEmpty())
-                mTransactionAdded.wait(&mTransactionMutex);
-
-            //取出事务
-            fromServerData = mTransactions.dequeue();
-            if (fromServerData.isEmpty()) {
-                break;
+        //阻塞等事务（共享调度，返回false结束）
+        if ( !mppScheduler->takeTask(&task, mPinnedLane) ) {
+            break;
+        }
+        const BsFrame &fromServerData = task.frame;
+
+        //准备（重试也须经openBookDatabase，不能靠QSqlDatabase::database()自动打开，否则缺WAL等设置）
+        QSqlDatabase bookDb = QSqlDatabase::database(mDatabaseConnectionName, false);
+        if ( !bookDb.isOpen() ) {
+            if ( !bookDb.isValid() )
+                bookDb = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), mDatabaseConnectionName);
+            if ( !openBookDatabase(bookDb, loginFile) ) {
+                qDebug() << "open database failed in net thread.";
+                continue;   //丢弃本任务，取到下一任务时再重试打开
             }
         }
 
+        BsCheckpointer::touch();
+
         //报告只是记录即可
-        if ( fromServerData.left(3) == QStringLiteral("RPT") ) {
-            checkRecordTransReport(fromServerData.mid(3));
+        if ( fromServerData.startsWith("RPT") ) {
+            checkRecordTransReport(fromServerData.view(3));
             continue;
         }
 
         //取得请求用户BsFronter*
-        BsFronter *requester = BsFronterMap::frontOfId(fromServerData.mid(3, 16));  //exclude header REQ
+        BsFronter *requester = BsFronterMap::frontOfId(QString::fromLatin1(task.owner));  //调度器已取出REQ后16字节
         if ( ! requester ) {
             qDebug() << "Invalid net requester";
             continue;
         }
 
-        //解密
-        QByteArray baDes = dataDecrypt(fromServerData.mid(19));
+        //新到帧先解码分类，按通道限额决定立即执行还是暂存；暂存过的任务再取出时已解码
+        if ( task.lane < 0 ) {
+            task.timer.start();
+            stageTimer.start();
+            BsMetrics::recordBytesIn(task.owner, fromServerData.length());
+
+            //解密
+            QByteArray baDes = dataDecrypt(fromServerData.view(19));
+            BsMetrics::recordStage(BsMetrics::StageDecrypt, stageTimer.nsecsElapsed() / 1000);
+            stageTimer.start();
 
-        //解压
-        QByteArray baUnz = dataUnzip(baDes);
+            //解压
+            QByteArray baUnz = dataUnzip(baDes);
+            BsMetrics::recordStage(BsMetrics::StageUnzip, stageTimer.nsecsElapsed() / 1000);
 
-        //转码
-        QString strPack = QString::fromUtf8(baUnz);
+            //转码
+            task.pack = QString::fromUtf8(baUnz);
+        }
+        QString strPack = task.pack;
 
         //解包
         QStringList packFields = strPack.split(QChar('\f'));
@@ -99,113 +99,63 @@ void BsTerminator::run()
             continue;
         }
 
-        //准备
+        //分派（路由表一次哈希查找，字段数、老板权限与请求门槛由路由声明统一检查）
         QString reqType = packFields.at(0);
-        QString respContent;
-        QStringList transToIds;
-        qint64 msgId = 0;
-
-        //SQL
-        if ( reqType == QStringLiteral("LOGIN") )
-            respContent = reqLogin(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYSHEET") )
-            respContent = reqQrySheet(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYPICK") )
-            respContent = reqQryPick(strPack, requester);
-
-        if ( reqType == QStringLiteral("BIZOPEN") )
-            respContent = reqBizOpen(strPack, requester);
-
-        if ( reqType == QStringLiteral("BIZEDIT") )
-            respContent = reqBizEdit(strPack, requester);
-
-        if ( reqType == QStringLiteral("BIZDELETE") )
-            respContent = reqBizDelete(strPack, requester);
-
-        if ( reqType == QStringLiteral("BIZINSERT") )
-            respContent = reqBizInsert(strPack, requester);
-
-        if ( reqType == QStringLiteral("FEEINSERT") )
-            respContent = reqFeeInsert(strPack, requester);
-
-        if ( reqType == QStringLiteral("REGINSERT") )
-            respContent = reqRegInsert(strPack, requester);
-
-        if ( reqType == QStringLiteral("REGCARGO") )
-            respContent = reqRegCargo(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYSUMM") )
-            respContent = reqQrySumm(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYCASH") )
-            respContent = reqQryCash(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYREST") )
-            respContent = reqQryRest(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYSTOCK") )
-            respContent = reqQryStock(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYVIEW") )
-            respContent = reqQryView(strPack, requester);
-
-        if ( reqType == QStringLiteral("GETOBJECT") )
-            respContent = reqQryObject(strPack, requester);
-
-        if ( reqType == QStringLiteral("GETIMAGE") )
-            respContent = reqQryImage(strPack, requester);
-
-        if ( reqType == QStringLiteral("QRYPRINTOWE") )
-            respContent = reqQryPrintOwe(strPack, requester);
-
-        if ( reqType == QStringLiteral("MESSAGE") && packFields.length() == 6 ) {
-            QString sendTo = packFields.at(4);
-            QString recName = (sendTo.length() == 16)
-                    ? BsFronterMap::frontOfId(sendTo)->mName
-                    : BsMeetingMap::meetingOfId(sendTo.toLongLong())->mMeetName;
-            respContent = reqMessage(strPack, requester, recName, &msgId);
-            transToIds = getMessageReceiverIds(sendTo, requester);
-            if ( msgId == 0 ) {
-                continue;   //这是msglog微秒主键重复冲突，几无可能的事件，丢弃没问题。
-            }
+        const BsTermRoute route = routeTable().value(reqType);
+        if ( !route.handler || (route.bossOnly && !requester->mBosss) ) {
+            qDebug() << "Bad request: " << reqType << " fields: " << packFields.length();
+            continue;
         }
+        bool fieldsShort = ( packFields.length() < route.minFields );
 
-        //老板管理
-        if ( requester->mBosss ) {
-
-            //建群
-            if ( reqType == QStringLiteral("GRPCREATE") && packFields.length() > 3 ) {
-                respContent = reqGrpCreate(strPack);
-                transToIds = calcNamesToIds(QString(packFields.at(4)).split(QChar('\t')));
-            }
-
-            //群改名
-            if ( reqType == QStringLiteral("GRPRENAME") && packFields.length() > 2 ) {
-                respContent = reqGrpRename(strPack);
-                transToIds = BsMeetingMap::memberIdsOfMeet(QString(packFields.at(2)).toLongLong());
-            }
-
-            //解散群
-            if ( reqType == QStringLiteral("GRPDISMISS") && packFields.length() > 2 ) {
-                transToIds = BsMeetingMap::memberIdsOfMeet(QString(packFields.at(2)).toLongLong());  //注意要在删除前获取
-                respContent = reqGrpDismiss(strPack);
-            }
-
-            //拉人
-            if ( reqType == QStringLiteral("GRPINVITE") && packFields.length() > 3 ) {
-                respContent = reqGrpInvite(strPack);
-                transToIds = BsMeetingMap::memberIdsOfMeet(QString(packFields.at(2)).toLongLong());
-                transToIds << calcNamesToIds(QString(packFields.at(3)).split(QChar('\t')));
+        //通道准入（超限或归专用线程的暂存，本线程去取别的任务）
+        if ( task.lane < 0 ) {
+            task.lane = route.lane;
+            if ( !mppScheduler->admit(&task) ) {
+                continue;
             }
+        }
 
-            //踢人
-            if ( reqType == QStringLiteral("GRPKICKOFF") && packFields.length() > 2 ) {
-                transToIds = BsMeetingMap::memberIdsOfMeet(QString(packFields.at(2)).toLongLong());  //注意要在踢人前获取
-                respContent = reqGrpKickoff(strPack);
+        BsTermRequest req;
+        req.pack = strPack;
+        req.fields = packFields;
+        req.requester = requester;
+        stageTimer.start();
+        QString respContent;
+        QString denied;
+        if ( route.permit && !fieldsShort ) {
+            //同各处理函数，门槛按去单引号后的参数判断
+            QString spack = strPack;
+            spack.replace(QChar(39), QChar(8217));  //禁止单引号
+            denied = route.permit(requester, spack.split(QChar('\f')));
+        }
+        if ( fieldsShort ) {
+            //同各处理函数参数数量错误的回复（只有说明）
+            respContent = QStringLiteral("参数数量错误");
+        }
+        else if ( !denied.isEmpty() ) {
+            //同各处理函数拒绝格式：类型、请求ID、说明
+            respContent = QStringList({packFields.at(0), packFields.at(1), denied}).join(QChar('\f'));
+        }
+        else if ( route.shareLogType > 0 ) {
+            //只读查询合并：参数（除请求ID）与权限指纹相同且正在执行的，等其结果换上本请求ID
+            QString flightKey = QStringLiteral("%1\f%2\f%3")
+                    .arg(reqType, QStringList(packFields.mid(2)).join(QChar('\f')), permitPrint(requester));
+            QString sharedResp;
+            if ( BsSingleFlight::join(flightKey, &sharedResp) ) {
+                respContent = shareResponseFor(sharedResp, packFields.at(1));
+                serverLog(requester->mName, route.shareLogType,
+                          QStringLiteral("%1 （合并）").arg(QStringList(packFields.mid(2)).join(QChar(' ')).simplified()));
+            } else {
+                respContent = route.handler(this, req);
+                BsSingleFlight::finish(flightKey, respContent);
             }
+        } else {
+            respContent = route.handler(this, req);
         }
+        BsMetrics::recordStage(BsMetrics::StageHandle, stageTimer.nsecsElapsed() / 1000);
+        QStringList transToIds = req.transToIds;
+        qint64 msgId = req.msgId;
 
         //没有约定头部从而没有处理结果，因此要么是因为没有正确解密，要么是因为格式违反约定
         if ( respContent.isEmpty() ) {
@@ -214,10 +164,14 @@ void BsTerminator::run()
         }
 
         //压缩（此时requester->versionDate已经过reqLogin函数的重新赋值）
-        QByteArray baZip = dataDozip(respContent.toUtf8(), requester->versionDate < 20200920);
+        stageTimer.start();
+        QByteArray baZip = dataDozip(respContent, requester->versionDate < 20200920);
+        BsMetrics::recordStage(BsMetrics::StageZip, stageTimer.nsecsElapsed() / 1000);
+        stageTimer.start();
 
         //加密
         QByteArray baEnc = dataEncrypt(baZip);
+        BsMetrics::recordStage(BsMetrics::StageEncrypt, stageTimer.nsecsElapsed() / 1000);
 
         //回复
         int packLen = 1                 //R、G、M 类型，公服使用
@@ -236,12 +190,14 @@ void BsTerminator::run()
         pack += frontsCountBytes;
         pack += requester->mFrontId;
         pack += baEnc;
+        BsMetrics::recordRequest(reqType, task.timer.nsecsElapsed() / 1000);
+        BsMetrics::recordBytesOut(task.owner, pack.length());
         emit responseReady(pack);
 
         //转发
         if ( ! transToIds.isEmpty() ) {
 
-            QByteArray transData = fromServerData.mid(19);
+            QByteArray transData = fromServerData.view(19);
             QByteArray msgIdBytes = QByteArray(8, '\0');
             qToBigEndian<quint64>(quint64(msgId), msgIdBytes.data());
             int packLen = 1                             //R、G、M 类型，公服使用
@@ -266,11 +222,257 @@ void BsTerminator::run()
 
     //结束
     if ( QSqlDatabase::database(mDatabaseConnectionName, false).isValid() ) {
+        BsStmtCache::release(mDatabaseConnectionName);
         QSqlDatabase::removeDatabase(mDatabaseConnectionName);
     }
 }
 
 
+//路由门槛 ================================================================================
+//请求级权限在路由表中声明（各处理函数不再各自检查），拒绝时run()照处理函数格式回复说明。
+//需查库或由编辑内部调用也要守的（如删单按原单绑定、开单行值绑定）仍在处理函数内。
+static QString permitAction(const BsFronter *user, const QString &table, const QString &action,
+                            const QString &denied = QStringLiteral("没有该项操作权限"))
+{
+    return ( BsFronterMap::actionAllow(user, table, action) ) ? QString() : denied;
+}
+
+static QString permitSheetOpen(const BsFronter *user, const QStringList &fields)
+{
+    return permitAction(user, fields.at(2).toLower().trimmed(), QStringLiteral("open"));
+}
+
+static QString permitSheetUpd(const BsFronter *user, const QStringList &fields)
+{
+    return permitAction(user, fields.at(2).toLower().trimmed(), QStringLiteral("upd"));
+}
+
+static QString permitSheetDel(const BsFronter *user, const QStringList &fields)
+{
+    return permitAction(user, fields.at(2).toLower().trimmed(), QStringLiteral("del"));
+}
+
+static QString permitSheetNew(const BsFronter *user, const QStringList &fields)
+{
+    return permitAction(user, fields.at(2).toLower().trimmed(), QStringLiteral("new"));
+}
+
+//2: tname  5: shop  6: trader
+static QString permitQrySheet(const BsFronter *user, const QStringList &fields)
+{
+    QString denied = permitSheetOpen(user, fields);
+    if ( !denied.isEmpty() )
+        return denied;
+
+    QString shop = fields.at(5).trimmed();
+    QString trader = fields.at(6).trimmed();
+    if ( !user->bindShop.isEmpty() && shop != user->bindShop && trader != user->bindShop )
+        return QStringLiteral("Illegal shop bind.");
+    if ( !user->bindTrader.isEmpty() && trader != user->bindTrader )
+        return QStringLiteral("Illegal trader bind.");
+    return QString();
+}
+
+static QString permitStockQty(const BsFronter *user, const QStringList &)
+{
+    return permitAction(user, QStringLiteral("vistock"), QStringLiteral("qty"), QStringLiteral("无此查询权限"));
+}
+
+static QString permitViewQty(const BsFronter *user, const QStringList &)
+{
+    return permitAction(user, QStringLiteral("viall"), QStringLiteral("qty"), QStringLiteral("无此查询权限"));
+}
+
+//2: shop \t staff \t remark
+static QString permitFeeShop(const BsFronter *user, const QStringList &fields)
+{
+    if ( !user->bindShop.isEmpty() && QString(fields.at(2)).split(QChar('\t')).at(0) != user->bindShop )
+        return QStringLiteral("没有该项操作权限");
+    return QString();
+}
+
+//2: customer或supplier  3: insert或update  5: 字段  6: 值。字段值格式错由处理函数回复
+static QString permitRegTrader(const BsFronter *user, const QStringList &fields)
+{
+    if ( QString(fields.at(5)).split(QChar('\t')).length() != QString(fields.at(6)).split(QChar('\t')).length() )
+        return QString();
+    QString tname = fields.at(2).trimmed().toLower();
+    bool neww = ( fields.at(3).trimmed().toLower() == QStringLiteral("insert") );
+    return permitAction(user, tname, ( neww ) ? QStringLiteral("new") : QStringLiteral("upd"));
+}
+
+//2: kvalue，空为新增
+static QString permitRegCargo(const BsFronter *user, const QStringList &fields)
+{
+    return permitAction(user, QStringLiteral("cargo"),
+                        ( fields.at(2).trimmed().isEmpty() ) ? QStringLiteral("new") : QStringLiteral("upd"));
+}
+
+//2: customer或supplier  3: 查找值。缺查询信息由处理函数回复
+static QString permitObject(const BsFronter *user, const QStringList &fields)
+{
+    if ( fields.at(2).isEmpty() || fields.at(3).isEmpty() )
+        return QString();
+    return permitAction(user, fields.at(2).toLower(), QStringLiteral("open"));
+}
+
+//2: pf、xs或cg。非法表名由处理函数回复
+static QString permitPrintOwe(const BsFronter *user, const QStringList &fields)
+{
+    QString tname = fields.at(2).toLower().trimmed();
+    if ( tname != QStringLiteral("pf") && tname != QStringLiteral("xs") && tname != QStringLiteral("cg") )
+        return QString();
+    return permitAction(user, QStringLiteral("vi%1cash").arg(tname), QStringLiteral("owe"),
+                        QStringLiteral("无此查询权限"));
+}
+
+const QHash<QString, BsTermRoute> &BsTerminator::routeTable()
+{
+    //静态路由表（C++11保证局部静态初始化线程安全，各工作线程共用）
+    static const QHash<QString, BsTermRoute> routes = [] {
+        QHash<QString, BsTermRoute> map;
+        auto add = [&map](const QString &reqType, BsTermHandler handler,
+                          const int minFields, const bool bossOnly, const int lane, BsTermPermit permit) {
+            BsTermRoute route;
+            route.handler = handler;
+            route.minFields = minFields;
+            route.bossOnly = bossOnly;
+            route.lane = lane;
+            route.permit = permit;
+            map.insert(reqType, route);
+        };
+
+        //SQL
+        add(QStringLiteral("LOGIN"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqLogin(r.pack, r.requester); }, 3, false, BsLaneWrite, nullptr);
+        add(QStringLiteral("QRYSHEET"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQrySheet(r.pack, r.requester); }, 10, false, BsLaneLookup, permitQrySheet);
+        add(QStringLiteral("QRYPICK"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryPick(r.pack, r.requester); }, 7, false, BsLaneLookup, permitStockQty);
+        add(QStringLiteral("BIZOPEN"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqBizOpen(r.pack, r.requester); }, 4, false, BsLaneLookup, permitSheetOpen);
+        add(QStringLiteral("BIZEDIT"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqBizEdit(r.pack, r.requester); }, 6, false, BsLaneWrite, permitSheetUpd);
+        add(QStringLiteral("BIZDELETE"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqBizDelete(r.pack, r.requester); }, 4, false, BsLaneWrite, permitSheetDel);
+        add(QStringLiteral("BIZINSERT"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqBizInsert(r.pack, r.requester); }, 5, false, BsLaneWrite, permitSheetNew);
+        add(QStringLiteral("FEEINSERT"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqFeeInsert(r.pack, r.requester); }, 4, false, BsLaneWrite, permitFeeShop);
+        add(QStringLiteral("REGINSERT"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqRegInsert(r.pack, r.requester); }, 7, false, BsLaneWrite, permitRegTrader);
+        add(QStringLiteral("REGCARGO"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqRegCargo(r.pack, r.requester); }, 5, false, BsLaneWrite, permitRegCargo);
+        add(QStringLiteral("QRYSUMM"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQrySumm(r.pack, r.requester); }, 11, false, BsLaneReport, nullptr);
+        add(QStringLiteral("QRYCASH"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryCash(r.pack, r.requester); }, 11, false, BsLaneReport, nullptr);
+        add(QStringLiteral("QRYREST"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryRest(r.pack, r.requester); }, 11, false, BsLaneReport, nullptr);
+        add(QStringLiteral("QRYSTOCK"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryStock(r.pack, r.requester); }, 11, false, BsLaneLookup, permitStockQty);
+        add(QStringLiteral("QRYVIEW"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryView(r.pack, r.requester); }, 11, false, BsLaneReport, permitViewQty);
+        add(QStringLiteral("GETOBJECT"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryObject(r.pack, r.requester); }, 4, false, BsLaneLookup, permitObject);
+        add(QStringLiteral("QRYCARGO"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryCargo(r.pack, r.requester); }, 3, false, BsLaneLookup, nullptr);
+        add(QStringLiteral("GETIMAGE"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryImage(r.pack, r.requester); }, 3, false, BsLaneLookup, nullptr);
+        add(QStringLiteral("QRYPRINTOWE"), [](BsTerminator *t, BsTermRequest &r) {
+            return t->reqQryPrintOwe(r.pack, r.requester); }, 5, false, BsLaneLookup, permitPrintOwe);
+
+        //聊天
+        add(QStringLiteral("MESSAGE"), [](BsTerminator *t, BsTermRequest &r) -> QString {
+            if ( r.fields.length() != 6 )
+                return QString();
+            QString sendTo = r.fields.at(4);
+            QString recName;
+            if ( sendTo.length() == 16 ) {
+                BsFronter *receiver = BsFronterMap::frontOfId(sendTo);
+                if ( receiver ) recName = receiver->mName;
+            } else {
+                BsMeeting *meeting = BsMeetingMap::meetingOfId(sendTo.toLongLong());
+                if ( meeting ) recName = meeting->mMeetName;
+            }
+            QString resp = t->reqMessage(r.pack, r.requester, recName, &r.msgId);
+            if ( r.msgId == 0 ) {
+                return QString();   //这是msglog微秒主键重复冲突，几无可能的事件，丢弃没问题。
+            }
+            r.transToIds = t->getMessageReceiverIds(sendTo, r.requester);
+            return resp; }, 6, false, BsLaneChat, nullptr);
+
+        //老板管理——建群
+        add(QStringLiteral("GRPCREATE"), [](BsTerminator *t, BsTermRequest &r) -> QString {
+            QString resp = t->reqGrpCreate(r.pack);
+            r.transToIds = t->calcNamesToIds(QString(r.fields.at(4)).split(QChar('\t')));
+            return resp; }, 5, true, BsLaneChat, nullptr);
+
+        //老板管理——群改名
+        add(QStringLiteral("GRPRENAME"), [](BsTerminator *t, BsTermRequest &r) -> QString {
+            QString resp = t->reqGrpRename(r.pack);
+            r.transToIds = BsMeetingMap::memberIdsOfMeet(QString(r.fields.at(2)).toLongLong());
+            return resp; }, 4, true, BsLaneChat, nullptr);
+
+        //老板管理——解散群
+        add(QStringLiteral("GRPDISMISS"), [](BsTerminator *t, BsTermRequest &r) -> QString {
+            r.transToIds = BsMeetingMap::memberIdsOfMeet(QString(r.fields.at(2)).toLongLong());  //注意要在删除前获取
+            return t->reqGrpDismiss(r.pack); }, 3, true, BsLaneChat, nullptr);
+
+        //老板管理——拉人
+        add(QStringLiteral("GRPINVITE"), [](BsTerminator *t, BsTermRequest &r) -> QString {
+            QString resp = t->reqGrpInvite(r.pack);
+            r.transToIds = BsMeetingMap::memberIdsOfMeet(QString(r.fields.at(2)).toLongLong());
+            r.transToIds << t->calcNamesToIds(QString(r.fields.at(3)).split(QChar('\t')));
+            return resp; }, 6, true, BsLaneChat, nullptr);
+
+        //老板管理——踢人
+        add(QStringLiteral("GRPKICKOFF"), [](BsTerminator *t, BsTermRequest &r) -> QString {
+            r.transToIds = BsMeetingMap::memberIdsOfMeet(QString(r.fields.at(2)).toLongLong());  //注意要在踢人前获取
+            return t->reqGrpKickoff(r.pack); }, 4, true, BsLaneChat, nullptr);
+
+        //只读查询可合并同请求（值为合并者日志类型，同各处理函数serverLog）
+        map[QStringLiteral("QRYSUMM")].shareLogType = 5;
+        map[QStringLiteral("QRYCASH")].shareLogType = 6;
+        map[QStringLiteral("QRYREST")].shareLogType = 7;
+        map[QStringLiteral("QRYSTOCK")].shareLogType = 8;
+        map[QStringLiteral("QRYVIEW")].shareLogType = 9;
+
+        return map;
+    }();
+    return routes;
+}
+
+//影响查询结果的用户属性（actionAllow所据权限值及绑定限制），相同者可共享结果
+QString BsTerminator::permitPrint(const BsFronter *fronter)
+{
+    if ( fronter->mBosss )
+        return QStringLiteral("boss%1").arg(int(fronter->mDeskPass.isEmpty()));
+
+    QStringList rights;
+    QMapIterator<QString, uint> it(fronter->rightMap);
+    while ( it.hasNext() ) {
+        it.next();
+        rights << QString::number(it.value(), 16);
+    }
+    QStringList prints;
+    prints << fronter->bindShop << fronter->bindTrader << fronter->limCargoExp
+           << QStringLiteral("%1%2%3%4").arg(int(fronter->canRett)).arg(int(fronter->canLott))
+              .arg(int(fronter->canBuyy)).arg(int(fronter->mDeskPass.isEmpty()))
+           << rights.join(QChar(','));
+    return prints.join(QChar('\t'));
+}
+
+//共享结果第1字段换为本请求ID（协议约定返回ID同请求ID）
+QString BsTerminator::shareResponseFor(const QString &sharedResp, const QString &reqId)
+{
+    int p0 = sharedResp.indexOf(QChar('\f'));
+    int p1 = ( p0 >= 0 ) ? sharedResp.indexOf(QChar('\f'), p0 + 1) : -1;
+    if ( p1 < 0 )
+        return sharedResp;
+    return sharedResp.left(p0 + 1) + reqId + sharedResp.mid(p1);
+}
+
 QStringList BsTerminator::getMessageReceiverIds(const QString &chatTo, BsFronter *sender)
 {
     //接受方表
@@ -310,30 +512,17 @@ QByteArray BsTerminator::dataDecrypt(const QByteArray &data)
         return QByteArray();
 
     //Header block is IV data, so buffLen minus one block size.
-    size_t buffLen = size_t(data.length()) - AES_BLOCKLEN;
-    uint8_t iv[ AES_BLOCKLEN ];
-    memcpy(iv, data.left(AES_BLOCKLEN).constData(), AES_BLOCKLEN);
-    struct AES_ctx ctx;
+    int buffLen = data.length() - AES_BLOCKLEN;
+    const uint8_t *iv = reinterpret_cast<const uint8_t *>(data.constData());
 
-    //malloc memory
-    void *heap = malloc(buffLen);
-    uint8_t *buff = reinterpret_cast<uint8_t *>(heap);
-    memcpy(buff, data.mid(AES_BLOCKLEN).constData(), buffLen);
+    //一次拷贝进结果缓存后原地解密
+    QByteArray result(buffLen, Qt::Uninitialized);
+    uint8_t *buff = reinterpret_cast<uint8_t *>(result.data());
+    memcpy(buff, data.constData() + AES_BLOCKLEN, size_t(buffLen));
 
-    //tinyAES does not throw exception, but return empty result.
-    try {
-        //Flutter's encrypt package uses PKCS7 padding which just as tinyAES.
-        AES_init_ctx_iv(&ctx, BsBackerInfo::getCryptionKey(), iv);
-        AES_CBC_decrypt_buffer(&ctx, buff, uint32_t(buffLen));
-    }
-    catch (...) {
-        buff[0] = 0;
-    }
-
-    //deep copy then free
-    QByteArray result = QByteArray(reinterpret_cast<char*>(buff), int(buffLen));
-    free(heap);
-    heap = nullptr;
+    //Flutter's encrypt package uses PKCS7 padding which just as tinyAES.
+    mpCipher->setKey(BsBackerInfo::getCryptionKey());
+    mpCipher->decryptCbc(iv, buff, size_t(buffLen));
     return result;
 }
 
@@ -348,29 +537,24 @@ QByteArray BsTerminator::dataEncrypt(const QByteArray &data)
     int dataLen = data.length();
     int padding = AES_BLOCKLEN - (dataLen % AES_BLOCKLEN);
     int buffLen = dataLen + padding;
-    struct AES_ctx ctx;
-
-    //malloc memory
-    void *heap = malloc(AES_BLOCKLEN + size_t(buffLen));                     //Prepending header block of IV data
-    uint8_t *buff = reinterpret_cast<uint8_t *>(heap);
 
-    memset(buff + AES_BLOCKLEN + dataLen, padding, size_t(padding));            //PKCS7 padding
-    memcpy(buff, generateRandomBytes(AES_BLOCKLEN).constData(), AES_BLOCKLEN);  //prepend IV header
-    memcpy(buff + AES_BLOCKLEN, data.constData(), size_t(dataLen));             //data
+    //结果缓存一次分配：IV头 + 数据 + PKCS7填充，原地加密
+    QByteArray result(AES_BLOCKLEN + buffLen, Qt::Uninitialized);
+    uint8_t *head = reinterpret_cast<uint8_t *>(result.data());
+    uint8_t *buff = head + AES_BLOCKLEN;
 
-    AES_init_ctx_iv(&ctx, BsBackerInfo::getCryptionKey(), buff);
-    AES_CBC_encrypt_buffer(&ctx, buff + AES_BLOCKLEN, uint32_t(buffLen));       //第三参数应为buffLen，而不是dataLen！
+    memcpy(head, generateRandomBytes(AES_BLOCKLEN).constData(), AES_BLOCKLEN);  //prepend IV header
+    memcpy(buff, data.constData(), size_t(dataLen));                            //data
+    memset(buff + dataLen, padding, size_t(padding));                           //PKCS7 padding
 
-    //deep copy then free
-    QByteArray result = QByteArray(reinterpret_cast<char*>(buff), AES_BLOCKLEN + buffLen);
-    free(heap);
-    heap = nullptr;
+    mpCipher->setKey(BsBackerInfo::getCryptionKey());
+    mpCipher->encryptCbc(head, buff, size_t(buffLen));      //长度应为buffLen，而不是dataLen！
     return result;
 }
 
-QByteArray BsTerminator::dataDozip(const QByteArray &data, const bool removeLenHead)
+QByteArray BsTerminator::dataDozip(const QString &text, const bool removeLenHead)
 {
-    return (removeLenHead) ? qCompress(data).mid(4) : qCompress(data);         //结果带有4字节长度头
+    return mZipper.compress(text, !removeLenHead);     //同qCompress格式，老前端不带4字节长度头
 }
 
 QByteArray BsTerminator::dataUnzip(const QByteArray &data)
@@ -391,100 +575,55 @@ QString BsTerminator::buildSpecHSum(const QString &sql)
         为节省流量，特在服务端处理好合计。视图sizers明细字段数据格式：
             \r\f负   码名\t数量 \n 码名\t数量 \n 码名\t数量 ...
             \r\v正   码名\t数量 \n 码名\t数量 \n 码名\t数量 ...
+        各行sizers合并为"码:数;码:数"，其余列原样，逐行直接输出。
     */
 
-    QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
-    QSqlQuery qry(db);
+    QString cacheKey = ( BsResultCache::cacheable(sql) )
+            ? BsResultCache::keyOf(QStringLiteral("net:hsum"), sql) : QString();
+    QString cached;
+    if ( !cacheKey.isEmpty() && BsResultCache::fetchText(cacheKey, &cached) )
+        return cached;
+    BsCacheStamp stamp = BsResultCache::stampOf(BsResultCache::dependsOfSql(sql));
+
+    QSqlQuery qry(QSqlDatabase::database(mDatabaseConnectionName));
     qry.setForwardOnly(true);
     qry.exec(sql);
+    bool failed = qry.lastError().isValid();
+    if ( failed ) {
+        qDebug() << qry.lastError().text();
+        qDebug() << sql;
+    }
+    BsPlanAdvisor::capture(QStringLiteral("net"), sql);
 
     //列定义
     QSqlRecord rec = qry.record();
     int fcount = rec.count();
     int idxSizers = rec.indexOf(QStringLiteral("sizers"));
     int idxQty = rec.indexOf(QStringLiteral("qty"));
-    Q_ASSERT(idxSizers >= 0 && idxQty >= 0);
-    QStringList fldNames;
-    QStringList fldDefines;
+    if ( idxSizers < 0 || idxQty < 0 ) {
+        return QStringLiteral("Fatal error when buildSpecHSum");
+    }
+    QStringList flds;
     for ( int i = 0; i < fcount; ++i ) {
-        QString fname = rec.fieldName(i);
-        bool fldQtyy = (fname.toLower() == QStringLiteral("qty"));
-        QString dtype = (fldQtyy) ? QStringLiteral("integer default 0") : QStringLiteral("text default ''");
-        fldNames << fname;
-        fldDefines << QStringLiteral("%1 %2").arg(fname).arg(dtype);
+        flds << rec.fieldName(i);
     }
-    Q_ASSERT(fldNames.length() >= 2);
-    QString fldNamesSql = fldNames.join(QChar(','));
-    QString fldDefineSql = fldDefines.join(QChar(','));
-    QString batchPattern = QStringLiteral("insert into tmpnetspecpick(%1) values(%2);");
-
-    QStringList batches;
-    batches << QStringLiteral("drop table if exists temp.tmpnetspecpick;");
-    batches << QStringLiteral("create temp table tmpnetspecpick(%1);").arg(fldDefineSql);
+    QString text = flds.join(QChar('\t'));
 
     //行值
     while ( qry.next() ) {
-        QStringList fldValues;
+        text += QChar('\n');
         for ( int i = 0; i < fcount; ++i ) {
-            if ( i == idxSizers )
-                fldValues << QStringLiteral("__sizer__");
-            else
-                fldValues << QStringLiteral("'%1'").arg(qry.value(i).toString());
-        }
-        QString valuesPattern = fldValues.join(QChar(','));
-
-        QMap<QString, qint64>   mapSizers;
-        QStringList sizersList = qry.value(idxSizers).toString().split(QChar('\r'));
-
-        for ( int i = 0, iLen = sizersList.length(); i < iLen; ++i ) {
-            QString sizers = sizersList.at(i);
-            if ( sizers.length() > 4 ) {
-                bool minuss = sizers.at(0) == QChar('\f');
-                QStringList pairs = sizers.mid(1).split(QChar('\n'));
-                for ( int j = 0, jLen = pairs.length(); j < jLen; ++j ) {
-                    QStringList pair = QString(pairs.at(j)).split(QChar('\t'));
-                    QString sizer = pair.at(0);
-                    qint64 qty = (minuss)
-                            ? (0 - QString(pair.at(1)).toLongLong())
-                            : QString(pair.at(1)).toLongLong();
-                    qint64 existSum = ( mapSizers.contains(sizer) ) ? mapSizers.value(sizer) : 0;
-                    mapSizers.insert(sizer, existSum + qty );
-                }
-            }
-        }
-        QStringList lstSizers;
-        QMapIterator<QString, qint64> it(mapSizers);
-        while ( it.hasNext() ) {
-            it.next();
-            QString sizer = it.key();
-            qint64 qty = it.value();
-            lstSizers << QStringLiteral("%1:%2").arg(sizer).arg(qty);
+            if ( i > 0 ) text += QChar('\t');
+            text += ( i == idxSizers )
+                    ? BsSpecAggregator::mergeRowSizers(qry.value(i).toString())
+                    : qry.value(i).toString();
         }
-        QString sumedSizers = lstSizers.join(QChar(';'));
-
-        QString values = valuesPattern;
-        values.replace(QStringLiteral("__sizer__"), QStringLiteral("'%1'").arg(sumedSizers));
-        batches << batchPattern.arg(fldNamesSql).arg(values);
     }
     qry.finish();
 
-    //临时表生成与执行
-    db.transaction();
-    for ( int i = 0, iLen = batches.length(); i < iLen; ++i ) {
-        QString line = batches.at(i);
-        db.exec(line);
-        if ( db.lastError().isValid() ) {
-            qDebug() << db.lastError().text();
-            qDebug() << line;
-            db.rollback();
-            return QString();
-        }
-    }
-    db.commit();
-
-    //按正常方式构造返回
-    QString lastSql = QStringLiteral("select %1 from tmpnetspecpick;").arg(fldNames.join(QChar(',')));
-    return buildSqlData(lastSql);
+    if ( !cacheKey.isEmpty() && !failed )
+        BsResultCache::storeText(cacheKey, stamp, text);
+    return text;
 }
 
 QString BsTerminator::buildSpecVSum(const QString &sql, const QString &limSizer)
@@ -493,141 +632,65 @@ QString BsTerminator::buildSpecVSum(const QString &sql, const QString &limSizer)
         为节省流量，特在服务端处理好合计。视图sizers明细字段数据格式：
             \r\f负   码名\t数量 \n 码名\t数量 \n 码名\t数量 ...
             \r\v正   码名\t数量 \n 码名\t数量 \n 码名\t数量 ...
+        按码拆开后与其余列分组内存累计，见BsSpecAggregator。
     */
 
-    QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
-    QSqlQuery qry(db);
+    QString cacheKey = ( BsResultCache::cacheable(sql) )
+            ? BsResultCache::keyOf(QStringLiteral("net:vsum:%1").arg(limSizer), sql) : QString();
+    QString cached;
+    if ( !cacheKey.isEmpty() && BsResultCache::fetchText(cacheKey, &cached) )
+        return cached;
+    BsCacheStamp stamp = BsResultCache::stampOf(BsResultCache::dependsOfSql(sql));
+
+    QSqlQuery qry(QSqlDatabase::database(mDatabaseConnectionName));
     qry.setForwardOnly(true);
     qry.exec(sql);
+    bool failed = qry.lastError().isValid();
+    if ( failed ) {
+        qDebug() << qry.lastError().text();
+        qDebug() << sql;
+    }
+    BsPlanAdvisor::capture(QStringLiteral("net"), sql);
 
-    //列定义
-    QSqlRecord rec = qry.record();
-    int fcount = rec.count();
-    int idxSizers = rec.indexOf(QStringLiteral("sizers"));
-    int idxQty = rec.indexOf(QStringLiteral("qty"));
-    //Q_ASSERT(idxSizers >= 0 && idxQty >= 0);
-    if ( idxSizers < 0 || idxQty < 0 ) {
+    BsSpecAggregator aggregator(qry.record(), limSizer);
+    if ( !aggregator.isValid() ) {
         return QStringLiteral("Fatal error when buildSpecVSum");
     }
-    QStringList fldNames;
-    QStringList fldDefines;
-    QStringList fldSels;
-    for ( int i = 0; i < fcount; ++i ) {
-        QString fname = rec.fieldName(i);
-        bool fldQtyy = (fname.toLower() == QStringLiteral("qty"));
-        QString dtype = (fldQtyy) ? QStringLiteral("integer default 0") : QStringLiteral("text default ''");
-        if ( fname == QStringLiteral("sizers") )
-            fname = QStringLiteral("sizer");
-        fldNames << fname;
-        fldDefines << QStringLiteral("%1 %2").arg(fname).arg(dtype);
-        if ( !fldQtyy ) {
-            fldSels << fname;
-        }
-    }
-    QString fldNamesSql = fldNames.join(QChar(','));
-    QString fldDefineSql = fldDefines.join(QChar(','));
-    QString batchPattern = QStringLiteral("insert into tmpnetspecqry(%1) values(%2);");
 
-    QStringList batches;
-    batches << QStringLiteral("drop table if exists temp.tmpnetspecqry;");
-    batches << QStringLiteral("create temp table tmpnetspecqry(%1);").arg(fldDefineSql);
-
-    //行值
     while ( qry.next() ) {
-        QStringList fldValues;
-        for ( int i = 0; i < fcount; ++i ) {
-            if ( i == idxSizers )
-                fldValues << QStringLiteral("__sizer__");
-            else if ( i == idxQty )
-                fldValues << QStringLiteral("__qty__");
-            else
-                fldValues << QStringLiteral("'%1'").arg(qry.value(i).toString());
-        }
-        QString valuesPattern = fldValues.join(QChar(','));
-
-        QStringList sizersList = qry.value(idxSizers).toString().split(QChar('\r'));
-        for ( int i = 0, iLen = sizersList.length(); i < iLen; ++i ) {
-            QString sizers = sizersList.at(i);
-            if ( sizers.length() > 4 ) {
-                bool minuss = sizers.at(0) == QChar('\f');
-                QStringList pairs = sizers.mid(1).split(QChar('\n'));
-                for ( int j = 0, jLen = pairs.length(); j < jLen; ++j ) {
-                    QStringList pair = QString(pairs.at(j)).split(QChar('\t'));
-                    QString sizer = pair.at(0);
-                    QString szqty = pair.at(1);
-                    if ( limSizer.isEmpty() || sizer == limSizer ) {
-                        qint64 qty = (minuss) ? 0 - szqty.toLongLong() : szqty.toLongLong();
-                        QString values = valuesPattern;
-                        values.replace(QStringLiteral("__sizer__"), QStringLiteral("'%1'").arg(sizer))
-                                .replace(QStringLiteral("__qty__"), QString::number(qty));
-                        batches << batchPattern
-                                   .arg(fldNamesSql)
-                                   .arg(values);
-                    }
-                }
-            }
-        }
+        aggregator.addRow(qry);
     }
     qry.finish();
 
-    //临时表生成与执行
-    db.transaction();
-    for ( int i = 0, iLen = batches.length(); i < iLen; ++i ) {
-        QString line = batches.at(i);
-        db.exec(line);
-        if ( db.lastError().isValid() ) {
-            qDebug() << db.lastError().text();
-            qDebug() << line;
-            db.rollback();
-            return QString();
-        }
-    }
-    db.commit();
-
-    //按正常方式构造返回
-    QString lastSels = fldSels.join(QChar(','));
-    QString lastSql = ( fldSels.length() > 0 )
-            ? QStringLiteral("select %1, sum(tmpnetspecqry.qty) as qty "
-                             "from tmpnetspecqry "
-                             "group by %1 "
-                             "having sum(tmpnetspecqry.qty)<>0;").arg(lastSels)
-            : QStringLiteral("select sum(tmpnetspecqry.qty) as qty "
-                             "from tmpnetspecqry;");
-    return buildSqlData(lastSql);
+    QString text = aggregator.result();
+    if ( !cacheKey.isEmpty() && !failed )
+        BsResultCache::storeText(cacheKey, stamp, text);
+    return text;
 }
 
 QString BsTerminator::buildSqlData(const QString &sql, const char replaceTabChar, const char replaceLineChar)
 {
-    QStringList rows;
-    QSqlQuery qry(QSqlDatabase::database(mDatabaseConnectionName));
-    qry.setForwardOnly(true);
-    qry.exec(sql);
-    if ( qry.lastError().isValid() ) {
-        qDebug() << qry.lastError().text();
-        qDebug() << sql;
-    }
+    //行值经结果缓存（与桌面查询共用），输出格式每次现拼
+    BsCachedRowsPtr data = BsResultCache::selectRows(QSqlDatabase::database(mDatabaseConnectionName), sql,
+                                                     QSql::HighPrecision, QStringLiteral("rows"));
+    BsPlanAdvisor::capture(QStringLiteral("net"), sql);
 
     //列名
-    QSqlRecord rec = qry.record();
-    int fcount = rec.count();
-    QStringList flds;
-    for ( int i = 0; i < fcount; ++i ) {
-        flds << rec.fieldName(i);
-    }
-    rows << flds.join(QChar('\t'));
+    QStringList rows;
+    rows << data->fields.join(QChar('\t'));
 
     //行值
-    while ( qry.next() ) {
+    for ( int r = 0, rLen = data->rows.length(); r < rLen; ++r ) {
+        const QVariantList &vals = data->rows.at(r);
         QStringList cols;
-        for ( int i = 0; i < fcount; ++i ) {
-            QString fvalue = qry.value(i).toString();
+        for ( int i = 0, iLen = vals.length(); i < iLen; ++i ) {
+            QString fvalue = vals.at(i).toString();
             if ( replaceTabChar ) fvalue.replace(QChar('\t'), QChar(replaceTabChar));
             if ( replaceLineChar ) fvalue.replace(QChar('\n'), QChar(replaceLineChar));
             cols << fvalue;
         }
         rows << cols.join(QChar('\t'));
     }
-    qry.finish();
 
     //返回行格式
     return rows.join(QChar('\n'));
@@ -662,16 +725,12 @@ void BsTerminator::checkRecordTransReport(const QByteArray &rptData)
 void BsTerminator::serverLog(const QString &reqMan, const int reqType, const QString &reqInfo)
 {
     QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
-    QString content = reqInfo;
-    content.replace(QChar(39), QChar(8217));
-    QString sql = QStringLiteral("insert into serverlog(reqtime, reqman, reqtype, reqinfo) "
-                                 "values(%1, '%2', %3, '%4');")
-            .arg(QDateTime::currentMSecsSinceEpoch()).arg(reqMan).arg(reqType).arg(content);
-    db.exec(sql);
-    if ( db.lastError().isValid() ) {
-        qDebug() << db.lastError().text();
-        qDebug() << sql;
-    }
+    static const QString sql = BsStmtCache::insertSql(QStringLiteral("serverlog"), QStringList()
+                                                      << QStringLiteral("reqtime") << QStringLiteral("reqman")
+                                                      << QStringLiteral("reqtype") << QStringLiteral("reqinfo"));
+    QVariantList binds;
+    binds << QDateTime::currentMSecsSinceEpoch() << reqMan << reqType << reqInfo;
+    BsStmtCache::exec(db, BsBoundSql(sql, binds));
 }
 
 /*$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$ 协议通用参数 $$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$$
@@ -692,6 +751,7 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
 /*  【REQUEST】
         2：请求时间EpochMilliSeconds，0表示新登录，需返回全部登记；正数时间则只需返回该时间以后有更新的登记。
         3: 前端类型————mobile或desk
+        4：上次所得登记变更序号（新版前端传，0表示需全量；不传时仍按请求时间）
 
     【RESPONSE】
         2：barcodeRule 值行表...\n...\n...（\n \t）首行字段名
@@ -711,6 +771,8 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
         16: 离线消息
         17: 价格政策（迭代升级增加都放在此后）
         18: 总经理账号名称
+        19：登记变更序号（前端保存，下次登录传回）
+        20：已删除登记 值行表 tname\tkname（仅增量时有内容）
 */
 
     //移除危险字符，并拆解参数
@@ -727,10 +789,33 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
     respList << params.at(0);
     respList << params.at(1);
 
-    //请求时间（用于节省流量）
+    //请求时间（老版前端用于节省流量）
     qint64 reqEpoch = QString(params.at(2)).toULongLong() / 1000;
     qint64 conEpoch = reqEpoch - 3600 * 24 * 2;  //提前2天，确保时间误差不会漏反馈（允许多反馈）
-    QString uptimeExp = (reqEpoch) ? QStringLiteral(" where uptime>=%1 ").arg(conEpoch) : QString();
+
+    //登记变更序号：只返回上次序号之后增改的登记及删除的键；序号为0或低于日志压缩下限时全量
+    QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
+    bool seqSync = params.length() > 4;
+    qint64 lastSeq = ( seqSync ) ? QString(params.at(4)).toLongLong() : 0;
+    qint64 nowSeq = regChangeLogSeq(db);    //先取序号，其后的变动下次再发（允许多发）
+    bool deltaSync = seqSync && lastSeq > 0 && lastSeq <= nowSeq && lastSeq >= regChangeLogFloor(db);
+
+    //各登记表变动条件
+    auto changedCon = [&](const QString &table, const QString &keyFld) -> QString {
+        if ( deltaSync )
+            return QStringLiteral("%1 in (select kname from reg_changelog where tname='%2' and seq>%3)")
+                    .arg(keyFld, table).arg(lastSeq);
+        if ( !seqSync && reqEpoch > 0 )
+            return QStringLiteral("uptime>=%1").arg(conEpoch);
+        return QString();
+    };
+    auto whereExp = [](const QStringList &cons) -> QString {
+        QStringList exps;
+        for ( int i = 0, iLen = cons.length(); i < iLen; ++i ) {
+            if ( !cons.at(i).isEmpty() ) exps << cons.at(i);
+        }
+        return ( exps.isEmpty() ) ? QString() : QStringLiteral(" where %1 ").arg(exps.join(QStringLiteral(" and ")));
+    };
 
     //前端类型
     if ( params.length() > 3 ) {
@@ -769,27 +854,25 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
     respList << buildSqlData(QStringLiteral("select "
                                                 "barcodexp,sizermiddlee, barcodemark "
                                                 "from barcoderule %1;")
-                             .arg(uptimeExp));
+                             .arg(whereExp({changedCon(QStringLiteral("barcoderule"), QStringLiteral("barcodexp"))})));
 
     //sizertype
     respList << buildSqlData(QStringLiteral("select "
                                                 "tname, namelist, codelist "
                                                 "from sizertype %1;")
-                             .arg(uptimeExp));
+                             .arg(whereExp({changedCon(QStringLiteral("sizertype"), QStringLiteral("tname"))})));
 
     //colortype
     respList << buildSqlData(QStringLiteral("select "
                                                 "tname, namelist, codelist "
                                                 "from colortype %1;")
-                             .arg(uptimeExp));
+                             .arg(whereExp({changedCon(QStringLiteral("colortype"), QStringLiteral("tname"))})));
 
     //cargo
     QStringList cargoWhereExps;
     if ( ! user->limCargoExp.isEmpty() ) cargoWhereExps << QStringLiteral("cargo like '%1'").arg(user->limCargoExp);
-    if ( reqEpoch > 0 ) cargoWhereExps << QStringLiteral("uptime>=%1 ").arg(conEpoch);
-    QString cargoWhere = (cargoWhereExps.length() > 0)
-            ? QStringLiteral("where %1").arg(cargoWhereExps.join(QStringLiteral(" and ")))
-            : QString();
+    cargoWhereExps << changedCon(QStringLiteral("cargo"), QStringLiteral("hpcode"));
+    QString cargoWhere = whereExp(cargoWhereExps);
     respList << buildSqlData(QStringLiteral("select "
                                                 "%1 "
                                                 "from cargo %2;")
@@ -798,14 +881,14 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
     //shop
     respList << buildSqlData(QStringLiteral("select kname, regdis, regman, regaddr, regtele "
                                                 "from shop %1;")
-                             .arg(uptimeExp));
+                             .arg(whereExp({changedCon(QStringLiteral("shop"), QStringLiteral("kname"))})));
 
     //customer
     if ( user->bindTrader.isEmpty() && user->canLott ) {
         respList << buildSqlData(QStringLiteral("select kname, regdis, regman, regaddr, regtele "
-                                                "from customer "
-                                                "where uptime>=%1 and kname not like '1__________';")
-                                 .arg(reqEpoch - 3600 * 24 * 2));  //手机1字头11位数字
+                                                "from customer %1;")
+                                 .arg(whereExp({changedCon(QStringLiteral("customer"), QStringLiteral("kname")),
+                                                QStringLiteral("kname not like '1__________'")})));  //手机1字头11位数字
     }
     else {
         respList << QString();
@@ -814,9 +897,9 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
     //supplier
     if ( user->bindTrader.isEmpty() && user->canBuyy ) {
         respList << buildSqlData(QStringLiteral("select kname, regdis, regman, regaddr, regtele "
-                                                "from supplier "
-                                                "where uptime>=%1 and kname not like '1__________';")
-                                 .arg(reqEpoch - 3600 * 24 * 2));  //手机1字头11位数字
+                                                "from supplier %1;")
+                                 .arg(whereExp({changedCon(QStringLiteral("supplier"), QStringLiteral("kname")),
+                                                QStringLiteral("kname not like '1__________'")})));  //手机1字头11位数字
     }
     else {
         respList << QString();
@@ -826,15 +909,13 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
     respList << buildSqlData(QStringLiteral("select "
                                             "kname "
                                             "from staff %1;")
-                             .arg(uptimeExp));
+                             .arg(whereExp({changedCon(QStringLiteral("staff"), QStringLiteral("kname"))})));
 
     //subject（此处虽然设计返回，但目前为止前端事实上接收加载，但收支单只提交备注，并没有使用）
     QStringList subjectWhereExps;
     if ( ! user->mBosss ) subjectWhereExps << QStringLiteral("adminboss=0");
-    if ( reqEpoch > 0 ) subjectWhereExps << QStringLiteral("uptime>=%1 ").arg(conEpoch);
-    QString subjectWhere = (subjectWhereExps.length() > 0)
-            ? QStringLiteral("where %1").arg(subjectWhereExps.join(QStringLiteral(" and ")))
-            : QString();
+    subjectWhereExps << changedCon(QStringLiteral("subject"), QStringLiteral("kname"));
+    QString subjectWhere = whereExp(subjectWhereExps);
     respList << buildSqlData(QStringLiteral("select kname as hpcode from subject %1;")
                             .arg(subjectWhere));
 
@@ -851,7 +932,8 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
                                                 "select vsetting from bailioption where optcode='stypes_szd'"));
 
     //其他选项（注意与前台协议顺序）
-    QString logoPlace = (reqEpoch > 0) ? QStringLiteral("'' as ") : QString();  //节省流量
+    bool syncedBefore = ( seqSync ) ? deltaSync : ( reqEpoch > 0 );
+    QString logoPlace = (syncedBefore) ? QStringLiteral("'' as ") : QString();  //节省流量
     respList << buildSqlData(QStringLiteral("select optcode, vsetting from bailioption where optcode='dots_of_qty' union all "
                                                 "select optcode, vsetting from bailioption where optcode='dots_of_price' union all "
                                                 "select optcode, vsetting from bailioption where optcode='dots_of_money' union all "
@@ -902,7 +984,7 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
                                             "from msglog a inner join msgfail b on a.msgid=b.msgid "
                                             "where b.tofrontid='%1';").arg(user->mFrontId));
     QString sql = QStringLiteral("delete from msgfail where tofrontid='%1';").arg(user->mFrontId);
-    QSqlDatabase::database(mDatabaseConnectionName).exec(sql);
+    db.exec(sql);
 
     //价格政策
     if ( user->bindTrader.isEmpty() ) {
@@ -916,6 +998,27 @@ QString BsTerminator::reqLogin(const QString &packstr, BsFronter *user)
     //总经理账号
     respList << bossAccount;
 
+    //登记变更序号
+    respList << QString::number(nowSeq);
+
+    //已删除登记（其后未再增回的键；无权接收的客户供应商不发）
+    if ( deltaSync ) {
+        QStringList denyTables;
+        if ( !(user->bindTrader.isEmpty() && user->canLott) ) denyTables << QStringLiteral("'customer'");
+        if ( !(user->bindTrader.isEmpty() && user->canBuyy) ) denyTables << QStringLiteral("'supplier'");
+        QString denyCon = ( denyTables.isEmpty() )
+                ? QString()
+                : QStringLiteral("and tname not in (%1) ").arg(denyTables.join(QChar(',')));
+        respList << buildSqlData(QStringLiteral("select tname, kname from reg_changelog a "
+                                                "where seq>%1 and op=2 %2"
+                                                "and not exists(select 1 from reg_changelog b "
+                                                "where b.tname=a.tname and b.kname=a.kname and b.seq>a.seq);")
+                                 .arg(lastSeq).arg(denyCon));
+    }
+    else {
+        respList << QString();
+    }
+
     //日志
     serverLog(user->mName, 1, QString::number(reqEpoch));
 
@@ -972,26 +1075,6 @@ QString BsTerminator::reqQrySheet(const QString &packstr, const BsFronter *user)
     QDateTime dateb = QDateTime(dateOfFormattedText(datebText, '-'));
     QDateTime datee = QDateTime(dateOfFormattedText(dateeText, '-'));
 
-    //权限
-    if ( ! BsFronterMap::actionAllow(user, tname, QStringLiteral("open")) ) {
-        respList << QStringLiteral("没有该项操作权限");
-        return respList.join(QChar('\f'));
-    }
-
-    if ( ! user->bindShop.isEmpty() ) {
-        if ( shop != user->bindShop && trader != user->bindShop ) {
-            respList << QStringLiteral("Illegal shop bind.");
-            return respList.join(QChar('\f'));
-        }
-    }
-
-    if ( ! user->bindTrader.isEmpty() ) {
-        if ( trader != user->bindTrader ) {
-            respList << QStringLiteral("Illegal trader bind.");
-            return respList.join(QChar('\f'));
-        }
-    }
-
     QStringList limExps;
     limExps << QStringLiteral("(dated between %1 and %2)")
              .arg(dateb.toSecsSinceEpoch()).arg(datee.toSecsSinceEpoch());
@@ -1075,13 +1158,6 @@ QString BsTerminator::reqQryPick(const QString &packstr, const BsFronter *user)
     QDateTime datee = QDateTime(dateOfFormattedText(dateeText, '-'));
     int checkk = QString(params.at(6)).trimmed().toInt();
 
-    //按权限取值
-    QString viRightKey = QStringLiteral("vistock");
-    if ( ! BsFronterMap::actionAllow(user, viRightKey, QStringLiteral("qty")) ) {
-        respList << QStringLiteral("无此查询权限");
-        return respList.join(QChar('\f'));
-    }
-
     //限定范围
     QStringList limExps;
     if ( dateeText.length() >= 8 )
@@ -1173,12 +1249,6 @@ QString BsTerminator::reqBizOpen(const QString &packstr, const BsFronter *user)
     QString tname = QString(params.at(2)).toLower().trimmed();
     qint64 sheetid = QString(params.at(3)).trimmed().toLongLong();
 
-    //权限
-    if ( ! BsFronterMap::actionAllow(user, tname, QStringLiteral("open")) ) {
-        respList << QStringLiteral("没有该项操作权限");
-        return respList.join(QChar('\f'));
-    }
-
     //主表
     QString limitMain = QStringLiteral("where sheetid=%1").arg(sheetid);
 
@@ -1251,14 +1321,8 @@ QString BsTerminator::reqBizEdit(const QString &packstr, const BsFronter *user)
     QString tname = QString(params.at(2)).toLower().trimmed();
     qint64 sheetid = QString(params.at(3)).trimmed().toLongLong();
 
-    //权限
-    if ( ! BsFronterMap::actionAllow(user, tname, QStringLiteral("upd")) ) {
-        respList << QStringLiteral("没有该项操作权限");
-        return respList.join(QChar('\f'));
-    }
-
     //sqls
-    QStringList batches;
+    QList<BsBoundSql> batches;
 
     //取得全删sqls
     QStringList delParams;
@@ -1266,13 +1330,11 @@ QString BsTerminator::reqBizEdit(const QString &packstr, const BsFronter *user)
     delParams << params.at(1);
     delParams << params.at(2);
     delParams << params.at(3);
-    QString delResult = reqBizDelete(delParams.join(QChar('\f')), user, true);  //第三参数重要
-    QStringList delSqls = delResult.split(QChar('\f'));
-    if ( delSqls.length() != 3 || delSqls.at(0) != QStringLiteral("OK") ) {
+    QString delResult = reqBizDelete(delParams.join(QChar('\f')), user, &batches);  //第三参数重要
+    if ( delResult != QStringLiteral("OK") || batches.length() != 2 ) {
         respList << QStringLiteral("全删处理错误");
         return respList.join(QChar('\f'));
     }
-    batches << delSqls.mid(1);
 
     //取得全添sqls
     QStringList insParams;
@@ -1281,9 +1343,10 @@ QString BsTerminator::reqBizEdit(const QString &packstr, const BsFronter *user)
     insParams << params.at(2);
     insParams << params.at(4);
     insParams << params.at(5);
-    QString insResult = reqBizInsert(insParams.join(QChar('\f')), user, sheetid);  //第三参数重要
+    QList<BsBoundSql> insBatches;
+    QString insResult = reqBizInsert(insParams.join(QChar('\f')), user, sheetid, &insBatches);  //第三、四参数重要
     QStringList insSqls = insResult.split(QChar('\f'));
-    if ( insSqls.length() < 7 || insSqls.at(0) != QStringLiteral("OK") ) {
+    if ( insSqls.length() != 7 || insSqls.at(0) != QStringLiteral("OK") ) {
         respList << QStringLiteral("全增处理错误");
         return respList.join(QChar('\f'));
     }
@@ -1294,23 +1357,14 @@ QString BsTerminator::reqBizEdit(const QString &packstr, const BsFronter *user)
     qint64 dmnySum = QString(insSqls.at(4)).toLongLong();
     qint64 actpayValue = QString(insSqls.at(5)).toLongLong();
     qint64 uptimeValue = QString(insSqls.at(6)).toLongLong();
-    batches << insSqls.mid(7);
+    batches << insBatches;
 
     //执行
     QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
-    db.transaction();
-    for ( int i = 0, iLen = batches.length(); i < iLen; ++i ) {
-        QString line = batches.at(i);
-        db.exec(line);
-        if ( db.lastError().isValid() ) {
-            qDebug() << db.lastError().text();
-            qDebug() << line;
-            db.rollback();
-            respList << QStringLiteral("事务失败");
-            return respList.join(QChar('\f'));
-        }
+    if ( !BsStmtCache::commit(db, batches).isEmpty() ) {
+        respList << QStringLiteral("事务失败");
+        return respList.join(QChar('\f'));
     }
-    db.commit();
 
     //日志
     serverLog(user->mName, 2, QStringLiteral("%1改: %2-%3 %4件 %5~%6元")
@@ -1332,7 +1386,7 @@ QString BsTerminator::reqBizEdit(const QString &packstr, const BsFronter *user)
 
 
 //only desk client
-QString BsTerminator::reqBizDelete(const QString &packstr, const BsFronter *user, const bool sqlsForEdit)
+QString BsTerminator::reqBizDelete(const QString &packstr, const BsFronter *user, QList<BsBoundSql> *editBatches)
 {
 /*  【REQUEST】
         2：单据主表名
@@ -1364,32 +1418,33 @@ QString BsTerminator::reqBizDelete(const QString &packstr, const BsFronter *user
     QString tname = QString(params.at(2)).toLower().trimmed();
     qint64 sheetid = QString(params.at(3)).trimmed().toLongLong();
 
-    //权限
-    if ( ! sqlsForEdit ) {
-        if ( ! BsFronterMap::actionAllow(user, tname, QStringLiteral("del")) ) {
-            respList << QStringLiteral("没有该项操作权限");
-            return respList.join(QChar('\f'));
-        }
-    }
-
     QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
-    QSqlQuery qry(db);
-    qry.setForwardOnly(true);
-    qry.setNumericalPrecisionPolicy(QSql::LowPrecisionInt64);
-    qry.exec(QStringLiteral("SELECT shop, trader FROM %1 WHERE sheetid=%2;").arg(tname).arg(sheetid));
-    if ( qry.lastError().isValid() ) {
+    QSqlQuery *pBindQry = BsStmtCache::statement(db, BsStmtCache::selectSql(
+                                                     tname,
+                                                     QStringList() << QStringLiteral("shop") << QStringLiteral("trader"),
+                                                     QStringList() << QStringLiteral("sheetid")));
+    if ( !pBindQry ) {
         respList << QStringLiteral("服务器意外故障");
         return respList.join(QChar('\f'));
     }
-    if ( qry.next() ) {
+    pBindQry->bindValue(0, sheetid);
+    if ( !pBindQry->exec() ) {
+        respList << QStringLiteral("服务器意外故障");
+        return respList.join(QChar('\f'));
+    }
+    bool sheetFound = pBindQry->next();
+    QString sheetShop = ( sheetFound ) ? pBindQry->value(0).toString() : QString();
+    QString sheetTrader = ( sheetFound ) ? pBindQry->value(1).toString() : QString();
+    pBindQry->finish();
+    if ( sheetFound ) {
         if ( ! user->bindShop.isEmpty() ) {
-            if ( qry.value(0).toString() != user->bindShop ) {
+            if ( sheetShop != user->bindShop ) {
                 respList << QStringLiteral("Illegal shop bind.");
                 return respList.join(QChar('\f'));
             }
         }
         if ( ! user->bindTrader.isEmpty() ) {
-            if ( qry.value(1).toString() != user->bindTrader ) {
+            if ( sheetTrader != user->bindTrader ) {
                 respList << QStringLiteral("Illegal trader bind.");
                 return respList.join(QChar('\f'));
             }
@@ -1398,37 +1453,31 @@ QString BsTerminator::reqBizDelete(const QString &packstr, const BsFronter *user
 
     //sqls
     qint64 delAsUpdtime = QDateTime::currentSecsSinceEpoch();
-    QStringList sqls;
-    if ( sqlsForEdit ) {
-        sqls << QStringLiteral("delete from %1 where sheetid=%2;").arg(tname).arg(sheetid);
+    QList<BsBoundSql> sqls;
+    if ( editBatches ) {
+        sqls << BsBoundSql(QStringLiteral("delete from %1 where sheetid=?;").arg(tname),
+                           QVariantList() << sheetid);
     } else {
-        sqls << QStringLiteral("update %1 set dated=0, proof='', stype='', staff='', shop='', trader='', remark='', "
-                               "sumqty=0, summoney=0, sumdis=0, actpay=0, actowe=0, upman='%2', uptime='%3' "
-                               "where sheetid=%4;").arg(tname).arg(user->mName).arg(delAsUpdtime).arg(sheetid);
+        sqls << BsBoundSql(QStringLiteral("update %1 set dated=0, proof='', stype='', staff='', shop='', trader='', remark='', "
+                                          "sumqty=0, summoney=0, sumdis=0, actpay=0, actowe=0, upman=?, uptime=? "
+                                          "where sheetid=?;").arg(tname),
+                           QVariantList() << user->mName << delAsUpdtime << sheetid);
     }
 
-    sqls << QStringLiteral("delete from %1dtl where parentid=%2;").arg(tname).arg(sheetid);
+    sqls << BsBoundSql(QStringLiteral("delete from %1dtl where parentid=?;").arg(tname),
+                       QVariantList() << sheetid);
 
     //特殊调用
-    if ( sqlsForEdit ) {
-        sqls.prepend(QStringLiteral("OK"));
-        return sqls.join(QChar('\f'));
+    if ( editBatches ) {
+        *editBatches << sqls;
+        return QStringLiteral("OK");
     }
 
     //执行
-    db.transaction();
-    for ( int i = 0, iLen = sqls.length(); i < iLen; ++i ) {
-        QString line = sqls.at(i);
-        db.exec(line);
-        if ( db.lastError().isValid() ) {
-            qDebug() << db.lastError().text();
-            qDebug() << line;
-            db.rollback();
-            respList << QStringLiteral("事务失败");
-            return respList.join(QChar('\f'));
-        }
+    if ( !BsStmtCache::commit(db, sqls).isEmpty() ) {
+        respList << QStringLiteral("事务失败");
+        return respList.join(QChar('\f'));
     }
-    db.commit();
 
     //日志
     serverLog(user->mName, 2, QStringLiteral("%1删: %2").arg(tname).arg(sheetid));
@@ -1444,7 +1493,8 @@ QString BsTerminator::reqBizDelete(const QString &packstr, const BsFronter *user
 
 
 //BOTH desk and mobile 由于考虑到手机端，明细行是一码一码的
-QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user, const qint64 updSheetId)
+QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user, const qint64 updSheetId,
+                                  QList<BsBoundSql> *editBatches)
 {
 /*  【REQUEST】
         2：单据主表名
@@ -1486,13 +1536,7 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
     qint64 uptimeValue = QDateTime::currentSecsSinceEpoch();
     qint64 datedValue = QDateTime(QDate::currentDate()).toSecsSinceEpoch();  //必须为0点时
 
-    //权限
-    if ( updSheetId == 0 ) {  //updSheetId参数专为reqBizEdit调用设计，为0表示新增
-        if ( ! BsFronterMap::actionAllow(user, tname, QStringLiteral("new")) ) {
-            respList << QStringLiteral("没有该项操作权限");
-            return respList.join(QChar('\f'));
-        }
-    }
+    //绑定（新增权限由路由门槛检查；reqBizEdit内部调用也须守绑定，故留此）
     if ( ! user->bindShop.isEmpty() ) {
         if ( shopValue != user->bindShop ) {
             respList << QStringLiteral("Illegal shop bind.");
@@ -1508,9 +1552,6 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
 
     //备用
     QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
-    QSqlQuery qry(db);
-    qry.setForwardOnly(true);
-    qry.setNumericalPrecisionPolicy(QSql::LowPrecisionInt64);
 
     //新sheetid
     int sheetId;
@@ -1518,27 +1559,27 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
         sheetId = updSheetId;
     }
     else {
-        qry.exec(QStringLiteral("SELECT seq FROM sqlite_sequence WHERE name='%1';").arg(tname));
-        if ( qry.lastError().isValid() ) {
+        QSqlQuery *pSeqQry = BsStmtCache::statement(db, QStringLiteral("SELECT seq FROM sqlite_sequence WHERE name=?;"));
+        if ( !pSeqQry ) {
             respList << QStringLiteral("服务器意外故障");
             return respList.join(QChar('\f'));
         }
-        if ( qry.next() )
-            sheetId = qry.value(0).toInt() + 1;
+        pSeqQry->bindValue(0, tname);
+        if ( !pSeqQry->exec() ) {
+            respList << QStringLiteral("服务器意外故障");
+            return respList.join(QChar('\f'));
+        }
+        if ( pSeqQry->next() )
+            sheetId = pSeqQry->value(0).toInt() + 1;
         else
             sheetId = 1;
-        qry.finish();
+        pSeqQry->finish();
     }
 
-    //准备标牌价字典
-    QMap<QString, qint64> setPriceMap;
-    if ( dLines.length() > 0 ) {
-        qry.exec(QStringLiteral("select hpcode, setprice from cargo;"));
-        while ( qry.next() ) {
-            setPriceMap.insert(qry.value(0).toString(), qry.value(1).toLongLong());
-        }
-        qry.finish();
-    }
+    //标牌价取自货品目录快照
+    BsCatalogPtr cargos;
+    if ( dLines.length() > 0 )
+        cargos = BsCatalog::acquire(db, QStringLiteral("cargo"));
 
     //合并同款同色同价行，并求出总数量总金额
     qint64 dqtySum = 0;
@@ -1569,10 +1610,16 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
     }
     std::sort(rowList.begin(), rowList.end());
 
-    //sqls
-    QStringList batches;
+    //sqls（绑定值执行，同表语句形状相同，走预编译缓存）
+    QList<BsBoundSql> batches;
 
     //从表sql
+    static const QStringList dfields = QStringList()
+            << QStringLiteral("parentid") << QStringLiteral("rowtime") << QStringLiteral("cargo")
+            << QStringLiteral("color") << QStringLiteral("sizers") << QStringLiteral("qty")
+            << QStringLiteral("price") << QStringLiteral("discount") << QStringLiteral("actmoney")
+            << QStringLiteral("dismoney") << QStringLiteral("rowmark");
+    const QString dtlInsertSql = BsStmtCache::insertSql(tname + QStringLiteral("dtl"), dfields);
     qint64 mkeyRowTime = QDateTime::currentMSecsSinceEpoch();
     qint64 ddisSum = 0;
     foreach (QString row, rowList) {
@@ -1604,7 +1651,7 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
         QString rowCargo = rowCargoColorPrices.at(0);
         QString rowColor = rowCargoColorPrices.at(1);
         qint64 rowPrice = QString(rowCargoColorPrices.at(2)).toLongLong();
-        qint64 setPrice = setPriceMap.value(rowCargo);
+        qint64 setPrice = cargos->value(rowCargo, QStringLiteral("setprice")).toLongLong();
         if ( setPrice == 0 ) setPrice = 999999999999;
         qint64 discount = 10000 * rowPrice / setPrice;
         qint64 actmoney = rowPrice * rowQty / 10000;
@@ -1612,57 +1659,59 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
         ddisSum += dismoney;
 
         //sql
-        const QString dfields = QStringLiteral("parentid, rowtime, cargo, color, sizers, qty, "
-                                               "price, discount, actmoney, dismoney, rowmark");
-        QStringList dvalues;
-        dvalues << QString::number(sheetId);
-        dvalues << QString::number(mkeyRowTime++);
-        dvalues << QStringLiteral("'%1'").arg(rowCargo);
-        dvalues << QStringLiteral("'%1'").arg(rowColor);
-        dvalues << QStringLiteral("'%1'").arg(sizers.join(QChar('\n')));
-        dvalues << QString::number(rowQty);
-        dvalues << QString::number(rowPrice);
-        dvalues << QString::number(discount);
-        dvalues << QString::number(actmoney);
-        dvalues << QString::number(dismoney);
-        dvalues << QStringLiteral("'%1'").arg(rowmark);  //版本升级加的rowmark
-
-        batches << QStringLiteral("insert into %1dtl(%2) values(%3);")
-                   .arg(tname).arg(dfields).arg(dvalues.join(QChar(',')));
+        QVariantList dvalues;
+        dvalues << sheetId;
+        dvalues << mkeyRowTime++;
+        dvalues << rowCargo;
+        dvalues << rowColor;
+        dvalues << sizers.join(QChar('\n'));
+        dvalues << rowQty;
+        dvalues << rowPrice;
+        dvalues << discount;
+        dvalues << actmoney;
+        dvalues << dismoney;
+        dvalues << rowmark;  //版本升级加的rowmark
+
+        batches << BsBoundSql(dtlInsertSql, dvalues);
     }
 
     //主表sqls
-    const QString mfields = QStringLiteral("sheetid, dated, shop, trader, stype, staff, remark, "
-                                           "sumqty, summoney, sumdis, actpay, actowe, upman, uptime");
-    QStringList mvalues;
-    mvalues << QString::number(sheetId);
-    mvalues << QString::number(datedValue);
-    mvalues << QStringLiteral("'%1'").arg(shopValue);
-    mvalues << QStringLiteral("'%1'").arg(traderValue);
-    mvalues << QStringLiteral("'%1'").arg(stypeValue);
-    mvalues << QStringLiteral("'%1'").arg(staffValue);
-    mvalues << QStringLiteral("'%1'").arg(remarkValue);
-    mvalues << QString::number(dqtySum);
-    mvalues << QString::number(dmnySum);
-    mvalues << QString::number(ddisSum);
-    mvalues << QString::number(actpayValue);
-    mvalues << QString::number(dmnySum - actpayValue);
-    mvalues << QStringLiteral("'%1'").arg(user->mName);
-    mvalues << QString::number(uptimeValue);
-
-    batches << QStringLiteral("insert into %1(%2) values(%3);")
-            .arg(tname).arg(mfields).arg(mvalues.join(QChar(',')));
+    static const QStringList mfields = QStringList()
+            << QStringLiteral("sheetid") << QStringLiteral("dated") << QStringLiteral("shop")
+            << QStringLiteral("trader") << QStringLiteral("stype") << QStringLiteral("staff")
+            << QStringLiteral("remark") << QStringLiteral("sumqty") << QStringLiteral("summoney")
+            << QStringLiteral("sumdis") << QStringLiteral("actpay") << QStringLiteral("actowe")
+            << QStringLiteral("upman") << QStringLiteral("uptime");
+    QVariantList mvalues;
+    mvalues << sheetId;
+    mvalues << datedValue;
+    mvalues << shopValue;
+    mvalues << traderValue;
+    mvalues << stypeValue;
+    mvalues << staffValue;
+    mvalues << remarkValue;
+    mvalues << dqtySum;
+    mvalues << dmnySum;
+    mvalues << ddisSum;
+    mvalues << actpayValue;
+    mvalues << dmnySum - actpayValue;
+    mvalues << user->mName;
+    mvalues << uptimeValue;
+
+    batches << BsBoundSql(BsStmtCache::insertSql(tname, mfields), mvalues);
 
     //针对reqBizEdit的特殊调用传递的特殊参数
     if ( updSheetId > 0 ) {
-        batches.prepend(QString::number(uptimeValue));
-        batches.prepend(QString::number(actpayValue));
-        batches.prepend(QString::number(dmnySum));
-        batches.prepend(QString::number(dqtySum));
-        batches.prepend(traderValue);
-        batches.prepend(shopValue);
-        batches.prepend(QStringLiteral("OK"));
-        return batches.join(QChar('\f'));       //由reqBizEdit二次处理
+        if ( editBatches ) *editBatches << batches;
+        QStringList editParams;
+        editParams << QStringLiteral("OK");
+        editParams << shopValue;
+        editParams << traderValue;
+        editParams << QString::number(dqtySum);
+        editParams << QString::number(dmnySum);
+        editParams << QString::number(actpayValue);
+        editParams << QString::number(uptimeValue);
+        return editParams.join(QChar('\f'));       //由reqBizEdit二次处理
     }
 
     //收支自动记账
@@ -1683,7 +1732,10 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
             }
             if (inSum == exSum && finRel->checkValuesAssign(tname, inv, exv)) {
                 QString proof = QStringLiteral("%1-%2").arg(tname.toUpper()).arg(sheetId, 8, 10, QChar('0'));
-                batches << finRel->qryBatchSqls(tname, datedValue, proof, shopValue, traderValue);
+                QStringList tallySqls = finRel->qryBatchSqls(tname, datedValue, proof, shopValue, traderValue);
+                for ( int i = 0, iLen = tallySqls.length(); i < iLen; ++i ) {
+                    batches << BsBoundSql(tallySqls.at(i));
+                }
             } else {
                 respList << QStringLiteral("Auto tally failed.");
                 return respList.join(QChar('\f'));
@@ -1692,19 +1744,10 @@ QString BsTerminator::reqBizInsert(const QString &packstr, const BsFronter *user
     }
 
     //执行
-    db.transaction();
-    for ( int i = 0, iLen = batches.length(); i < iLen; ++i ) {
-        QString line = batches.at(i);
-        db.exec(line);
-        if ( db.lastError().isValid() ) {
-            qDebug() << db.lastError().text();
-            qDebug() << line;
-            db.rollback();
-            respList << QStringLiteral("事务失败");
-            return respList.join(QChar('\f'));
-        }
+    if ( !BsStmtCache::commit(db, batches).isEmpty() ) {
+        respList << QStringLiteral("事务失败");
+        return respList.join(QChar('\f'));
     }
-    db.commit();
 
     //通知库存变动
     if ( tname == QStringLiteral("cgj") ||
@@ -1777,14 +1820,6 @@ QString BsTerminator::reqFeeInsert(const QString &packstr, const BsFronter *user
     qint64 uptimeValue = QDateTime::currentMSecsSinceEpoch() / 1000;
     qint64 datedValue = QDateTime(QDate::currentDate()).toMSecsSinceEpoch() / 1000;
 
-    //权限
-    if ( ! user->bindShop.isEmpty() ) {
-        if ( shopValue != user->bindShop ) {
-            respList << QStringLiteral("没有该项操作权限");
-            return respList.join(QChar('\f'));
-        }
-    }
-
     //新sheetid
     int sheetId;
     QSqlQuery qry(db);
@@ -1856,6 +1891,7 @@ QString BsTerminator::reqFeeInsert(const QString &packstr, const BsFronter *user
         }
     }
     db.commit();
+    BsResultCache::bump(QStringLiteral("szd"));
 
     //日志
     serverLog(user->mName, 3, QStringLiteral("%1-%2 ￥%3")
@@ -1912,13 +1948,6 @@ QString BsTerminator::reqRegInsert(const QString &packstr, const BsFronter *user
         return respList.join(QChar('\f'));
     }
 
-    //权限
-    QString actName = (neww) ? QStringLiteral("new") : QStringLiteral("upd");
-    if ( ! BsFronterMap::actionAllow(user, tname, actName) ) {
-        respList << QStringLiteral("没有该项操作权限");
-        return respList.join(QChar('\f'));
-    }
-
     //sql
     QString sql;
     if ( neww ) {
@@ -1965,6 +1994,7 @@ QString BsTerminator::reqRegInsert(const QString &packstr, const BsFronter *user
         respList << ((neww) ? QStringLiteral("登记失败") : QStringLiteral("更改失败"));
         return respList.join(QChar('\f'));
     }
+    BsResultCache::bumpSql(sql);
 
     //日志
     QString logRegAction = (neww) ? QStringLiteral("添") : QStringLiteral("改");
@@ -2016,13 +2046,6 @@ QString BsTerminator::reqRegCargo(const QString &packstr, const BsFronter *user)
         return respList.join(QChar('\f'));
     }
 
-    //权限
-    QString actName = (kvalue.isEmpty()) ? QStringLiteral("new") : QStringLiteral("upd");
-    if ( ! BsFronterMap::actionAllow(user, QStringLiteral("cargo"), actName) ) {
-        respList << QStringLiteral("没有该项操作权限");
-        return respList.join(QChar('\f'));
-    }
-
     //sql
     QString sql;
     if ( kvalue.isEmpty() ) {
@@ -2066,6 +2089,7 @@ QString BsTerminator::reqRegCargo(const QString &packstr, const BsFronter *user)
         respList << ((kvalue.isEmpty()) ? QStringLiteral("登记失败") : QStringLiteral("更改失败"));
         return respList.join(QChar('\f'));
     }
+    BsResultCache::bumpSql(sql);
 
     //日志
     QString logRegAction = (kvalue.isEmpty()) ? QStringLiteral("添") : QStringLiteral("改");
@@ -2231,6 +2255,8 @@ QString BsTerminator::reqQryCash(const QString &packstr, const BsFronter *user)
     respList << params.at(0);
     respList << params.at(1);
 
+    QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
+
     //参数解析预备
     QString tname = QString(params.at(2)).toLower().trimmed();
     //QString shop = QString(params.at(3)).trimmed();
@@ -2277,10 +2303,18 @@ QString BsTerminator::reqQryCash(const QString &packstr, const BsFronter *user)
     if ( checkk == 2 )
         limExps << QStringLiteral("chktime=0");
 
+    //不分审核时用截止日前最近月末快照加其后增量
+    QString viewName = QStringLiteral("vi_%1_cash").arg(tname);
+    QString fromSource = ( checkk == 0 )
+            ? periodSnapshotSource(db, viewName, datee.toMSecsSinceEpoch() / 1000)
+            : QString();
+    if ( fromSource.isEmpty() )
+        fromSource = viewName;
+
     //sql
-    QString sql = QStringLiteral("select %1 from vi_%2_cash where %3;")
+    QString sql = QStringLiteral("select %1 from %2 where %3;")
             .arg(vfields.join(QChar(',')))
-            .arg(tname)
+            .arg(fromSource)
             .arg(limExps.join(QStringLiteral(" and ")));
 
     //db execute
@@ -2388,10 +2422,18 @@ QString BsTerminator::reqQryRest(const QString &packstr, const BsFronter *user)
     if ( checkk == 2 )
         limExps << QStringLiteral("chktime=0");
 
+    //不分审核时用截止日前最近月末快照加其后增量（子查询别名同视图名，上面带表名的字段照用）
+    QString viewName = QStringLiteral("vi_%1_rest").arg(tname);
+    QString fromSource = ( checkk == 0 )
+            ? periodSnapshotSource(db, viewName, datee.toMSecsSinceEpoch() / 1000)
+            : QString();
+    if ( fromSource.isEmpty() )
+        fromSource = viewName;
+
     //sql
-    QString sql = QStringLiteral("select %1 from vi_%2_rest where %3 group by %4 %5;")
+    QString sql = QStringLiteral("select %1 from %2 where %3 group by %4 %5;")
             .arg(vfields.join(QChar(',')))
-            .arg(tname)
+            .arg(fromSource)
             .arg(limExps.join(QStringLiteral(" and ")))
             .arg(gfields)
             .arg(having);
@@ -2457,13 +2499,8 @@ QString BsTerminator::reqQryStock(const QString &packstr, const BsFronter *user)
     QDateTime datee = QDateTime(dateOfFormattedText(QString(params.at(9)).trimmed(), '-'));
     int checkk = QString(params.at(10)).trimmed().toInt();
 
-    //按权限取值
+    //按权限取值（查询权已由路由门槛检查）
     QString viRightKey = QStringLiteral("vistock");
-    if ( ! BsFronterMap::actionAllow(user, viRightKey, QStringLiteral("qty")) ) {
-        respList << QStringLiteral("无此查询权限");
-        return respList.join(QChar('\f'));
-    }
-
     QStringList vfields;
     QStringList gfields;
     QString having;
@@ -2500,22 +2537,22 @@ QString BsTerminator::reqQryStock(const QString &packstr, const BsFronter *user)
         //色码都指定————返回该色所有码（色在后面limExps中限定）
         if ( !color.isEmpty() && !sizer.isEmpty() ) {
             sumSpecc = true;
-            vfields << QStringLiteral("group_concat(vi_stock.sizers, '') as sizers")
-                    << QStringLiteral("sum(vi_stock.qty) as qty");
+            vfields << QStringLiteral("group_concat(sizers, '') as sizers")
+                    << QStringLiteral("sum(qty) as qty");
         }
         //只指定了颜色————返回该色所有码（色在后面limExps中限定）
         else if ( !color.isEmpty() ) {
             sumSpecc = true;
-            vfields << QStringLiteral("group_concat(vi_stock.sizers, '') as sizers")
-                    << QStringLiteral("sum(vi_stock.qty) as qty");
+            vfields << QStringLiteral("group_concat(sizers, '') as sizers")
+                    << QStringLiteral("sum(qty) as qty");
         }
         //只指定了尺码————返回全部色码明细
         else if ( !sizer.isEmpty() ) {
             sumSpecc = true;
             vfields << QStringLiteral("color");
             gfields << QStringLiteral("color");
-            vfields << QStringLiteral("group_concat(vi_stock.sizers, '') as sizers")
-                    << QStringLiteral("sum(vi_stock.qty) as qty");
+            vfields << QStringLiteral("group_concat(sizers, '') as sizers")
+                    << QStringLiteral("sum(qty) as qty");
         }
         //色码都没指定
         else {
@@ -2523,24 +2560,22 @@ QString BsTerminator::reqQryStock(const QString &packstr, const BsFronter *user)
             //所有店————返回各店数量，不区分明细（前面vfields和gfields已经区分shop了）
             if ( shop.isEmpty() ) {
                 sumSpecc = false;
-                vfields << QStringLiteral("sum(vi_stock.qty) as qty");
-                having = QStringLiteral("having sum(vi_stock.qty)<>0");
+                vfields << QStringLiteral("sum(qty) as qty");
+                having = QStringLiteral("having sum(qty)<>0");
             }
             //指定店————返回全部色码明细
             else {
                 sumSpecc = true;
                 vfields << QStringLiteral("color");
                 gfields << QStringLiteral("color");
-                vfields << QStringLiteral("group_concat(vi_stock.sizers, '') as sizers")
-                        << QStringLiteral("sum(vi_stock.qty) as qty");
+                vfields << QStringLiteral("group_concat(sizers, '') as sizers")
+                        << QStringLiteral("sum(qty) as qty");
             }
         }
     }
 
     //限定范围
     QStringList limExps;
-    limExps << QStringLiteral("dated <= %1").arg(datee.toMSecsSinceEpoch() / 1000);
-
     if ( ! shop.isEmpty() )
         limExps << QStringLiteral("shop='%1'").arg(shop);
 
@@ -2550,16 +2585,49 @@ QString BsTerminator::reqQryStock(const QString &packstr, const BsFronter *user)
     if ( ! color.isEmpty() )
         limExps << QStringLiteral("color='%1'").arg(color);
 
-    if ( checkk == 1 )
-        limExps << QStringLiteral("chktime<>0");
+    //账表已建成、不分审核且范围内没有晚于截止日的单据时，直接读库存账表，否则仍按vi_stock逐单累计
+    qint64 dateeSecs = datee.toMSecsSinceEpoch() / 1000;
+    bool useBalance = false;
+    QSqlDatabase stockDb = QSqlDatabase::database(mDatabaseConnectionName);
+    if ( checkk == 0 && stockBalanceReady(stockDb) ) {
+        QStringList lateExps = limExps;
+        lateExps << QStringLiteral("lastdated > %1").arg(dateeSecs);
+        QSqlQuery qry(stockDb);
+        qry.setForwardOnly(true);
+        qry.exec(QStringLiteral("select 1 from stock_balance where %1 limit 1;")
+                 .arg(lateExps.join(QStringLiteral(" and "))));
+        useBalance = !qry.lastError().isValid() && !qry.next();
+    }
 
-    if ( checkk == 2 )
-        limExps << QStringLiteral("chktime=0");
+    //否则不分审核时用截止日前最近月末快照加其后增量
+    QString stockSource = QStringLiteral("vi_stock");
+    if ( useBalance ) {
+        stockSource = QStringLiteral("stock_balance");
+    }
+    else if ( checkk == 0 ) {
+        QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
+        QString snapSource = periodSnapshotSource(db, stockSource, dateeSecs);
+        if ( !snapSource.isEmpty() )
+            stockSource = snapSource;
+    }
+
+    if ( ! useBalance ) {
+        limExps << QStringLiteral("dated <= %1").arg(dateeSecs);
+
+        if ( checkk == 1 )
+            limExps << QStringLiteral("chktime<>0");
+
+        if ( checkk == 2 )
+            limExps << QStringLiteral("chktime=0");
+    }
 
     //sql
-    QString sql = QStringLiteral("select %1 from vi_stock where %2")
+    QString sql = QStringLiteral("select %1 from %2")
               .arg(vfields.join(QChar(',')))
-              .arg(limExps.join(QStringLiteral(" and ")));
+              .arg(stockSource);
+    if ( !limExps.isEmpty() ) {
+        sql += QStringLiteral(" where %1").arg(limExps.join(QStringLiteral(" and ")));
+    }
     if ( !gfields.isEmpty() ) {
         sql += QStringLiteral(" group by %1 %2").arg(gfields.join(QChar(','))).arg(having);
     }
@@ -2625,10 +2693,20 @@ QString BsTerminator::reqQryView(const QString &packstr, const BsFronter *user)
 
     //前置权限数据加载
     QSqlDatabase db = QSqlDatabase::database(mDatabaseConnectionName);
-    if ( !BsFronterMap::actionAllow(user, QStringLiteral("viall"), QStringLiteral("qty")) ) {
-        respList << QStringLiteral("无此查询权限");
+
+    //结果缓存（参数即键，各项所涉均为库存类单据）
+    QString cacheKey = BsResultCache::keyOf(QStringLiteral("net:view"),
+                                            QStringList({shop, cargo, dateb.toString(Qt::ISODate),
+                                                         datee.toString(Qt::ISODate), QString::number(checkk)})
+                                            .join(QChar(31)));
+    QString cached;
+    if ( BsResultCache::fetchText(cacheKey, &cached) ) {
+        serverLog(user->mName, 9, QStringLiteral("%1 （%2）").arg(shop).arg(cargo));
+        respList << cached;
+        respList << QStringLiteral("OK");
         return respList.join(QChar('\f'));
     }
+    BsCacheStamp stamp = BsResultCache::stampOf(BsResultCache::dependsOf(QStringLiteral("vi_stock")));
 
     //条件Exp
     QString qcSideCon = QStringLiteral("and dated < %1").arg(dateb.toMSecsSinceEpoch() / 1000);
@@ -2748,7 +2826,9 @@ QString BsTerminator::reqQryView(const QString &packstr, const BsFronter *user)
         flds << pairs.at(i).first;
         vals << QString::number(pairs.at(i).second);
     }
-    respList << QStringLiteral("%1\n%2").arg(flds.join(QChar('\t'))).arg(vals.join(QChar('\t')));
+    QString text = QStringLiteral("%1\n%2").arg(flds.join(QChar('\t'))).arg(vals.join(QChar('\t')));
+    BsResultCache::storeText(cacheKey, stamp, text);
+    respList << text;
 
     //return
     respList << QStringLiteral("OK");
@@ -2789,12 +2869,6 @@ QString BsTerminator::reqQryObject(const QString &packstr, const BsFronter *user
         return respList.join(QChar('\f'));
     }
 
-    //权限
-    if ( ! BsFronterMap::actionAllow(user, tname, QStringLiteral("open")) ) {
-        respList << QStringLiteral("没有该项操作权限");
-        return respList.join(QChar('\f'));
-    }
-
     //sql
     QString sql = QStringLiteral("select kname, regdis, regman, regtele, regaddr "
                                  "from %1 where kname='%2' or regtele='%2';")
@@ -2813,6 +2887,104 @@ QString BsTerminator::reqQryObject(const QString &packstr, const BsFronter *user
 }
 
 
+//BOTH desk and mobile
+QString BsTerminator::reqQryCargo(const QString &packstr, const BsFronter *user)
+{
+    /*===========================================查询（货品查找）======================================
+    【REQUEST】
+        2：查找值           //货号、品名或拼音首字母片段
+        3：最多行数         //可省，不超过SEARCH_DEFAULT_LIMIT
+
+    【RESPONSE】
+        2：货品行（字段同登录货品数据，已按匹配程度排序）
+        3：是否截断（1截断，0全部） */
+
+    //移除危险字符，并拆解参数
+    QString spack = packstr;
+    spack.replace(QChar(39), QChar(8217));  //禁止单引号
+    QStringList params = spack.split(QChar('\f'));
+
+    //前置检查
+    QStringList respList;
+    if ( params.length() != 3 && params.length() != 4 ) {
+        respList << QStringLiteral("参数数量错误");
+        return respList.join(QChar('\f'));
+    }
+    respList << params.at(0);
+    respList << params.at(1);
+
+    //参数解析预备
+    QString term = QString(params.at(2)).trimmed();
+    int limit = ( params.length() > 3 ) ? QString(params.at(3)).toInt() : SEARCH_DEFAULT_LIMIT;
+    if ( limit <= 0 || limit > SEARCH_DEFAULT_LIMIT ) limit = SEARCH_DEFAULT_LIMIT;
+    if ( term.isEmpty() ) {
+        respList << QStringLiteral("无查询信息");
+        return respList.join(QChar('\f'));
+    }
+
+    //货号限制同登录（like式样转正则）
+    QRegularExpression limRe;
+    bool limited = ! user->limCargoExp.isEmpty();
+    if ( limited ) {
+        QString pattern;
+        for ( int i = 0, iLen = user->limCargoExp.length(); i < iLen; ++i ) {
+            QChar c = user->limCargoExp.at(i);
+            if ( c == QChar('%') )      pattern += QStringLiteral(".*");
+            else if ( c == QChar('_') ) pattern += QChar('.');
+            else                        pattern += QRegularExpression::escape(QString(c));
+        }
+        limRe.setPattern(QStringLiteral("^%1$").arg(pattern));
+        limRe.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+    }
+
+    //查找索引随货品目录快照共用，无需查库；货号限制在排序截断前剔除
+    BsCatalogPtr cargos = BsCatalog::acquire(QSqlDatabase::database(mDatabaseConnectionName), QStringLiteral("cargo"));
+    BsSearchFilter permitted;
+    if ( limited )
+        permitted = [&limRe, &cargos](const int row) { return limRe.match(cargos->keyAt(row)).hasMatch(); };
+    bool truncated = false;
+    QVector<int> found = cargos->searchIndex().search(term, limit, &truncated, permitted);
+
+    //货号敏感字段同登录
+    QStringList flds({"hpcode", "hpname", "sizertype", "colortype", "unit", "setprice",
+                      "buyprice", "lotprice", "retprice"});
+    QVector<int> cols;
+    for ( int i = 0, iLen = flds.length(); i < iLen; ++i ) {
+        QString fld = flds.at(i);
+        bool masked = ( fld == QStringLiteral("buyprice") && !user->canBuyy ) ||
+                ( fld == QStringLiteral("lotprice") && !user->canLott ) ||
+                ( fld == QStringLiteral("retprice") && !user->canRett );
+        cols << ( ( masked ) ? -1 : cargos->colOf(fld) );
+    }
+
+    QStringList rows;
+    rows << flds.join(QChar('\t'));
+    for ( int r = 0, rLen = found.length(); r < rLen; ++r ) {
+        int row = found.at(r);
+        QStringList vals;
+        for ( int i = 0, iLen = cols.length(); i < iLen; ++i ) {
+            int col = cols.at(i);
+            if ( col < 0 )
+                vals << ( ( i > 5 ) ? QStringLiteral("0") : QString() );
+            else
+                vals << cargos->textAt(row, col).replace(QChar('\t'), QChar(32)).replace(QChar('\n'), QChar(32));
+        }
+        rows << vals.join(QChar('\t'));
+    }
+
+    //output
+    respList << rows.join(QChar('\n'));
+    respList << QString::number(int(truncated));
+
+    //日志
+    serverLog(user->mName, 10, term);
+
+    //return
+    respList << QStringLiteral("OK");
+    return respList.join(QChar('\f'));
+}
+
+
 //BOTH desk and mobile
 QString BsTerminator::reqQryImage(const QString &packstr, const BsFronter *user)
 {
@@ -2939,13 +3111,6 @@ QString BsTerminator::reqQryPrintOwe(const QString &packstr, const BsFronter *us
         return respList.join(QChar('\f'));
     }
 
-    //按权限取值
-    QString viRightKey = QStringLiteral("vi%1cash").arg(tname);
-    if ( ! BsFronterMap::actionAllow(user, viRightKey, QStringLiteral("owe")) ) {
-        respList << QStringLiteral("无此查询权限");
-        return respList.join(QChar('\f'));
-    }
-
     //限定范围
     QStringList limExps;
     if ( trader.isEmpty() ) {
@@ -3,17 +3,46 @@
 
 #include <QThread>
 #include "bailishare.h"
+#include "bailischeduler.h"
+#include "bailizip.h"
+#include "bailistmt.h"
 
 namespace BailiSoft {
 
+class BsTerminator;
+class BsAesCipher;
+
+//请求上下文（run()解包后交各处理函数，处理函数可回填转发对象与消息ID）
+struct BsTermRequest
+{
+    QString         pack;
+    QStringList     fields;
+    BsFronter*      requester = nullptr;
+    QStringList     transToIds;
+    qint64          msgId = 0;
+};
+
+typedef QString (*BsTermHandler)(BsTerminator *terminator, BsTermRequest &req);
+typedef QString (*BsTermPermit)(const BsFronter *user, const QStringList &fields);     //返回拒绝说明，空为准许
+
+//请求路由（各请求类型在此声明所需字段数与权限，新请求类型只需登记路由，不必改动run()）
+struct BsTermRoute
+{
+    BsTermHandler   handler = nullptr;
+    int             minFields = 2;
+    bool            bossOnly = false;
+    BsTermPermit    permit = nullptr;       //请求级门槛（操作权、绑定门店客户），run()按去单引号后的参数统一检查
+    int             lane = BsLaneLookup;    //BsTermLane，调度通道
+    int             shareLogType = 0;       //非0表示只读查询可合并同请求，值为合并者serverLog类型
+};
+
 class BsTerminator : public QThread
 {
     Q_OBJECT
 public:
-    BsTerminator(QObject *parent, const QString &databaseConnectionName);
-    void taskAdd(const QByteArray &fromServerData);
-    void taskStop();
-    bool isIdle();
+    BsTerminator(QObject *parent, const QString &databaseConnectionName, BsScheduler *scheduler,
+                 const int pinnedLane = -1);
+    ~BsTerminator();
     void run();
 
 signals:
@@ -22,12 +51,17 @@ signals:
     void shopStockChanged(const QString &shop, const QString &relSheet, const int relId);
 
 private:
+    static const QHash<QString, BsTermRoute> &routeTable();
+
+    static QString permitPrint(const BsFronter *fronter);
+    static QString shareResponseFor(const QString &sharedResp, const QString &reqId);
+
     QStringList getMessageReceiverIds(const QString &chatTo, BsFronter *sender);
     QStringList calcNamesToIds(const QStringList &names);
 
     QByteArray dataDecrypt(const QByteArray &data);
     QByteArray dataEncrypt(const QByteArray &data);
-    QByteArray dataDozip(const QByteArray &data, const bool removeLenHead = false);
+    QByteArray dataDozip(const QString &text, const bool removeLenHead = false);
     QByteArray dataUnzip(const QByteArray &data);
     QString buildSpecHSum(const QString &sql);
     QString buildSpecVSum(const QString &sql, const QString &limSizer = QString());
@@ -45,9 +79,10 @@ private:
     QString reqQryPick(const QString &packstr, const BsFronter *user);      //only desk client
     QString reqBizOpen(const QString &packstr, const BsFronter *user);      //only desk client
     QString reqBizEdit(const QString &packstr, const BsFronter *user);      //only desk client
-    QString reqBizDelete(const QString &packstr, const BsFronter *user, const bool sqlsForEdit = false);    //only desk client 第三参数为复用设计
+    QString reqBizDelete(const QString &packstr, const BsFronter *user, QList<BsBoundSql> *editBatches = nullptr);    //only desk client 第三参数为复用设计
 
-    QString reqBizInsert(const QString &packstr, const BsFronter *user, const qint64 updSheetId = 0);  //第三参数为复用设计
+    QString reqBizInsert(const QString &packstr, const BsFronter *user, const qint64 updSheetId = 0,
+                         QList<BsBoundSql> *editBatches = nullptr);  //第三、四参数为复用设计
     QString reqFeeInsert(const QString &packstr, const BsFronter *user);
     QString reqRegInsert(const QString &packstr, const BsFronter *user);
     QString reqRegCargo(const QString &packstr, const BsFronter *user);
@@ -57,6 +92,7 @@ private:
     QString reqQryStock(const QString &packstr, const BsFronter *user);
     QString reqQryView(const QString &packstr, const BsFronter *user);
     QString reqQryObject(const QString &packstr, const BsFronter *user);
+    QString reqQryCargo(const QString &packstr, const BsFronter *user);
     QString reqQryNewPush(const QString &packstr, const BsFronter *user);
     QString reqQryImage(const QString &packstr, const BsFronter *user);
     QString reqQryPrintOwe(const QString &packstr, const BsFronter *user);
@@ -70,9 +106,10 @@ private:
 
     QString mDatabaseConnectionName;
 
-    QQueue<QByteArray>              mTransactions;
-    QMutex                          mTransactionMutex;
-    QWaitCondition                  mTransactionAdded;
+    BsScheduler*                    mppScheduler;
+    int                             mPinnedLane;    //专用线程所服务的通道，-1为普通线程
+    BsAesCipher*                    mpCipher;       //本线程专用，AES-NI或tinyAES
+    BsZipStream                     mZipper;        //本线程专用，复用deflate上下文
 };
 
 }
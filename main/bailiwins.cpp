@@ -7,6 +7,11 @@
 #include "bailicustom.h"
 #include "baililabel.h"
 #include "bailidialog.h"
+#include "bailisql.h"
+#include "bailisqlfunc.h"
+#include "bailiplan.h"
+#include "bailiarchive.h"
+#include "bailicache.h"
 #include "comm/bsflowlayout.h"
 #include "comm/pinyincode.h"
 #include "misc/bsimportregdlg.h"
@@ -406,6 +411,17 @@ void BsWin::setQuickDate(const QString &periodName, BsFldBox *dateB, BsFldBox *d
 }
 
 void BsWin::exportGrid(const BsGrid *grid, const QStringList headerPairs)
+{
+    exportTableView(grid, grid->mCols, grid->mpFooter, headerPairs);
+}
+
+void BsWin::exportGrid(const BsQueryGrid *grid, const QStringList headerPairs)
+{
+    exportTableView(grid, grid->mCols, grid->mpFooter, headerPairs);
+}
+
+void BsWin::exportTableView(const QTableView *grid, const QList<BsField*> &fields, const QTableWidget *footer,
+                            const QStringList headerPairs)
 {
     //用户选择文件位置及命名
     QString deskPath = QStandardPaths::locate(QStandardPaths::DesktopLocation, QString(), QStandardPaths::LocateDirectory);
@@ -428,23 +444,25 @@ void BsWin::exportGrid(const BsGrid *grid, const QStringList headerPairs)
     rows << headerPairs;
 
     //列名
+    const QAbstractItemModel *model = grid->model();
     QStringList cols;
-    for ( int j = 0, jLen = grid->columnCount(); j < jLen; ++j ) {
+    for ( int j = 0, jLen = model->columnCount(); j < jLen; ++j ) {
         if ( ! grid->isColumnHidden(j) )
-            cols << grid->model()->headerData(j, Qt::Horizontal).toString();
+            cols << model->headerData(j, Qt::Horizontal).toString();
     }
     rows << cols.join(QChar(44));
 
     //数据
-    for ( int i = 0, iLen = grid->rowCount(); i < iLen; ++i ) {
+    for ( int i = 0, iLen = model->rowCount(); i < iLen; ++i ) {
         if ( ! grid->isRowHidden(i) ) {
             QStringList cols;
-            for ( int j = 0, jLen = grid->columnCount(); j < jLen; ++j ) {
+            for ( int j = 0, jLen = model->columnCount(); j < jLen; ++j ) {
                 if ( ! grid->isColumnHidden(j) ) {
-                    if ( grid->item(i, j) ) {
-                        uint flag = grid->mCols.at(j)->mFlags;
+                    QVariant v = model->index(i, j).data();     //无单元格时为无效值
+                    if ( v.isValid() ) {
+                        uint flag = fields.at(j)->mFlags;
+                        QString txt = v.toString();
                         if ( (flag & bsffText) == bsffText ) {
-                            QString txt = grid->item(i, j)->text();
                             if (txt.indexOf(QChar(44)) >= 0) {
                                 txt = txt.replace(QChar(34), QChar(96));
                                 cols << QStringLiteral("\"\t%1\"").arg(txt);
@@ -452,7 +470,7 @@ void BsWin::exportGrid(const BsGrid *grid, const QStringList headerPairs)
                                 cols << QChar(9) + txt;
                             }
                         } else {
-                            cols << grid->item(i, j)->text();
+                            cols << txt;
                         }
                     } else {
                         cols << QString();
@@ -464,12 +482,12 @@ void BsWin::exportGrid(const BsGrid *grid, const QStringList headerPairs)
     }
 
     //合计
-    if ( grid->mpFooter && grid->columnCount() == grid->mpFooter->columnCount() ) {
+    if ( footer && model->columnCount() == footer->columnCount() ) {
         QStringList cols;
-        for ( int j = 0, jLen = grid->columnCount(); j < jLen; ++j ) {
+        for ( int j = 0, jLen = model->columnCount(); j < jLen; ++j ) {
             if ( ! grid->isColumnHidden(j) ) {
-                bool fldCargoo = (grid->mCols.at(j)->mFldName == QStringLiteral("cargo"));
-                QString footerText = (grid->mpFooter->item(0, j)) ? grid->mpFooter->item(0, j)->text() : QString();
+                bool fldCargoo = (fields.at(j)->mFldName == QStringLiteral("cargo"));
+                QString footerText = (footer->item(0, j)) ? footer->item(0, j)->text() : QString();
                 QString txt = ( j == 0 && (fldCargoo || footerText.indexOf(QChar('>')) > 0) )
                         ? mapMsg.value("word_total")
                         : footerText;
@@ -1165,7 +1183,6 @@ BsQryWin::BsQryWin(QWidget *parent, const QString &name, const QStringList &fiel
 
     //表格
     mpQryGrid = new BsQueryGrid(this);
-    mpGrid = mpQryGrid;
 
     //总布局
     QVBoxLayout *layBody = new QVBoxLayout(mpBody);
@@ -1251,7 +1268,7 @@ void BsQryWin::doToolExport()
     foreach (QString pair, mLabelPairs ) {
         headPairs << pair.replace(QChar(9), QChar(44));
     }
-    exportGrid(mpGrid, headPairs);
+    exportGrid(mpQryGrid, headPairs);
 }
 
 void BsQryWin::clickQuickPeriod()
@@ -1382,12 +1399,12 @@ void BsQryWin::clickHistory()
     if ( winCash ) {
         keyFld = "trader";
         int idx = mpQryGrid->getColumnIndexByFieldName(keyFld);
-        keyVal = (idx >= 0) ? mpQryGrid->item(mpQryGrid->currentRow(), idx)->text() : mpConTrader->mpEditor->getDataValue();
+        keyVal = (idx >= 0) ? mpQryGrid->cellText(mpQryGrid->currentRow(), idx) : mpConTrader->mpEditor->getDataValue();
     }
     else {
         keyFld = ( mMainTable.contains("szd") ) ? "subject" : "cargo";
         int idx = mpQryGrid->getColumnIndexByFieldName(keyFld);
-        keyVal = (idx >= 0) ? mpQryGrid->item(mpQryGrid->currentRow(), idx)->text() : mpConCargo->mpEditor->getDataValue();
+        keyVal = (idx >= 0) ? mpQryGrid->cellText(mpQryGrid->currentRow(), idx) : mpConCargo->mpEditor->getDataValue();
     }
 
     //对账关联门店或欠款单位
@@ -1398,12 +1415,12 @@ void BsQryWin::clickHistory()
         if ( winRest ) {
             relKeyFld = "trader";
             int idx = mpQryGrid->getColumnIndexByFieldName(relKeyFld);
-            relKeyVal = (idx >= 0) ? mpQryGrid->item(mpQryGrid->currentRow(), idx)->text() : mpConTrader->mpEditor->getDataValue();
+            relKeyVal = (idx >= 0) ? mpQryGrid->cellText(mpQryGrid->currentRow(), idx) : mpConTrader->mpEditor->getDataValue();
         }
         else if ( winStock ) {
             relKeyFld = "shop";
             int idx = mpQryGrid->getColumnIndexByFieldName(relKeyFld);
-            relKeyVal = (idx >= 0) ? mpQryGrid->item(mpQryGrid->currentRow(), idx)->text() : mpConShop->mpEditor->getDataValue();
+            relKeyVal = (idx >= 0) ? mpQryGrid->cellText(mpQryGrid->currentRow(), idx) : mpConShop->mpEditor->getDataValue();
         }
     }
 
@@ -1498,7 +1515,7 @@ void BsQryWin::clickHistory()
         uint colf = bsCol->mFlags;
         if ( (colf & bsffAggSum) != bsffAggSum && (colf & bsffCargoRel) != bsffCargoRel &&
              (colf & bsffBool) != bsffBool && bsCol->mFldName != QStringLiteral("sizers") ) {
-            QString showValue = mpQryGrid->item(mpQryGrid->currentRow(), i)->text();
+            QString showValue = mpQryGrid->cellText(mpQryGrid->currentRow(), i);
             QString sqlValue = mpQryGrid->getSqlValueFromDisplay(mpQryGrid->currentRow(), i);
             cons << QStringLiteral("%1=%2").arg(bsCol->mFldName).arg(sqlValue);
             labelPairs.prepend(QStringLiteral("%1\t%2").arg(bsCol->mFldCnName).arg(showValue));
@@ -1822,8 +1839,60 @@ QStringList BsQryWin::getSizersQtySplitSql(const QStringList &selExps,
                                            const QString &tmpTableName,
                                            const bool forStockk)            //仅用于进销存一览
 {
-    QStringList unionUnitSqls;
     QStringList sizerNames = dsSizer->getSizerList(sizerType);
+
+    //有尺码数量规范子表时，直接从对应分尺码视图取（vi_xxx_attr对应vi_xxx_sizer，数量已含正负）。
+    //分尺码视图没有金额价格、库存单元也没有客户类型等列，所选或条件用到其没有的列时仍走下面拆串
+    QString sizerSource = fromSource;
+    if ( sizerSource.endsWith(QStringLiteral("_attr")) )
+        sizerSource.chop(5);
+    sizerSource += QStringLiteral("_sizer");
+    QSqlDatabase defdb = QSqlDatabase::database();
+    QStringList sizerFields = getExistsFieldsOfTable(sizerSource, defdb);
+    if ( !sizerFields.isEmpty() && sqlExpsOnlyUseFields(selExps + conExps, sizerFields) ) {
+        QStringList names;
+        foreach (QString sizerName, sizerNames) {
+            if ( !sizerName.isEmpty() )
+                names << QStringLiteral("'%1'").arg(sizerName);
+        }
+        QStringList cons;
+        cons << conExps;
+        cons << QStringLiteral("sizer IN (%1)").arg(names.join(QChar(44)));
+
+        QStringList uSels;
+        uSels << selExps;
+        uSels << QStringLiteral("sizer") << QStringLiteral("qty");
+
+        QStringList sqls;
+        sqls << QStringLiteral("DROP TABLE IF EXISTS temp.%1;").arg(tmpTableName);
+        sqls << QStringLiteral("CREATE TEMP TABLE %1 AS SELECT %2 FROM %3 WHERE %4;")
+                .arg(tmpTableName, uSels.join(QChar(44)), sizerSource, cons.join(QStringLiteral(" AND ")));
+        return sqls;
+    }
+
+    //有尺码扩展函数时，一次表值拆码（带\r\f负标志的库存视图同样适用）
+    if ( hasSizerFunctions(QSqlDatabase::database()) ) {
+        QStringList names;
+        foreach (QString sizerName, sizerNames) {
+            if ( !sizerName.isEmpty() )
+                names << QStringLiteral("'%1'").arg(sizerName);
+        }
+        QStringList cons;
+        cons << conExps;
+        cons << QStringLiteral("e.sizer IN (%1)").arg(names.join(QChar(44)));
+
+        QStringList uSels;
+        uSels << selExps;
+        uSels << QStringLiteral("e.sizer AS sizer") << QStringLiteral("e.qty AS qty");
+
+        QStringList sqls;
+        sqls << QStringLiteral("DROP TABLE IF EXISTS temp.%1;").arg(tmpTableName);
+        sqls << QStringLiteral("CREATE TEMP TABLE %1 AS SELECT %2 FROM %3, sizer_each(%3.sizers) AS e WHERE %4;")
+                .arg(tmpTableName, uSels.join(QChar(44)), fromSource, cons.join(QStringLiteral(" AND ")));
+        return sqls;
+    }
+
+    QStringList unionUnitSqls;
     foreach (QString sizerName, sizerNames) {
         if ( !sizerName.isEmpty() ) {
             QStringList uSels;
@@ -1939,6 +2008,25 @@ QString BsQryWin::prepairViewAllData(const QSet<QString> &setSel,
             ? QStringLiteral("tmp_%1_%2").arg(qmTable).arg(loginer)
             : qmTable;
 
+    //仅按日期、货号、门店限定时，期末库存用截止日前最近月末快照加其后增量（快照不分审核、不含单据其他字段）
+    if ( !mpSizerCheckor->isChecked() ) {
+        QStringList snapKeys;
+        snapKeys << "dateb" << "datee" << "cargo" << "shop";
+        bool snapUsable = true;
+        QMapIterator<QString, QString> it(mapRangeCon);
+        while ( it.hasNext() ) {
+            it.next();
+            if ( !snapKeys.contains(it.key()) ) snapUsable = false;
+        }
+        if ( snapUsable ) {
+            QSqlDatabase db = QSqlDatabase::database();
+            QString snapSource = periodSnapshotSource(db, QStringLiteral("vi_stock"),
+                                                      mpConDateE->mpEditor->getDataValue().toLongLong());
+            if ( !snapSource.isEmpty() )
+                fromStockSource = snapSource;
+        }
+    }
+
     QString whereStockSql = ( mpSizerCheckor->isChecked() )
             ? QString()
             : QStringLiteral("WHERE %1").arg(qmCons.join(" AND "));
@@ -2026,6 +2114,9 @@ QString BsQryWin::prepairViewAllData(const QSet<QString> &setSel,
     }
 
     //批量执行
+    for ( int i = 0, iLen = sqls.length(); i < iLen; ++i ) {
+        BsPlanAdvisor::capture(QStringLiteral("desk:%1").arg(mMainTable), sqls.at(i));
+    }
     QString strErr = sqliteCommit(sqls);
     if ( !strErr.isEmpty() )
         return QString();
@@ -2112,6 +2203,13 @@ QString BsQryWin::doSqliteQuery()
         mapRangeCon.insert("chktime", currentChkConVal);
     }
 
+    //起始日（无起始日的余额类为截止日）伸入已归档年份时挂接归档库，否则卸下
+    qint64 reachDated = mapRangeCon.value(( mapRangeCon.contains("dateb") ) ? "dateb" : "datee").toLongLong();
+    QSqlDatabase archDb = QSqlDatabase::database();
+    QString archErr = BsArchive::attachFor(archDb, reachDated);
+    if ( !archErr.isEmpty() )
+        return archErr;
+
 
     //统计角度
     QSet<QString>   setSel;
@@ -2302,6 +2400,7 @@ QString BsQryWin::doSqliteQuery()
             .arg(selExps.join(QChar(44))).arg(mFromSource).arg(whereSql).arg(grpSql).arg(havSql).arg(orderSql);
 
     //刷新表格
+    BsPlanAdvisor::capture(QStringLiteral("desk:%1").arg(mMainTable), sql);
     QString useSizerType = ( mpConSizerType ) ? mpConSizerType->mpEditor->getDataValue() : QString();
     mpQryGrid->loadData(sql, cnameDefines, useSizerType);
 
@@ -3377,7 +3476,7 @@ BsAbstractSheetWin::BsAbstractSheetWin(QWidget *parent, const QString &name, con
 
     mpFindGrid = new BsQueryGrid(this);
     mpFindGrid->setStatusTip(mapMsg.value("i_sheet_query_open_tip"));
-    connect(mpFindGrid, SIGNAL(itemDoubleClicked(QTableWidgetItem*)), this, SLOT(doubleClickOpenSheet(QTableWidgetItem*)));
+    connect(mpFindGrid, SIGNAL(doubleClicked(QModelIndex)), this, SLOT(doubleClickOpenSheet(QModelIndex)));
 
     mpPnlOpener = new QWidget(this);
     mpPnlOpener->setStyleSheet(QLatin1String(".QWidget{background-color:#eeeeeb;}"));
@@ -3901,6 +4000,7 @@ void BsAbstractSheetWin::doCheck()
     if ( qry.lastError().isValid() )
         QMessageBox::information(this, QString(), mapMsg.value("i_check_sheet_failed"));
     else {
+        BsResultCache::bump(mMainTable);
         mpAcMainEdit->setEnabled(false);
         mpAcMainDel->setEnabled(false);
         mpAcMainCheck->setEnabled(false);
@@ -4209,6 +4309,7 @@ void BsAbstractSheetWin::clickToolUnCheck()
     if ( qry.lastError().isValid() )
         QMessageBox::information(this, QString(), mapMsg.value("i_uncheck_sheet_failed"));
     else {
+        BsResultCache::bump(mMainTable);
         mpAcMainEdit->setEnabled(true);
         mpAcMainDel->setEnabled(true);
         mpAcMainCheck->setEnabled(true);
@@ -4257,10 +4358,10 @@ void BsAbstractSheetWin::clickCancelOpenPage()
         mpPnlPayOwe->show();
 }
 
-void BsAbstractSheetWin::doubleClickOpenSheet(QTableWidgetItem *item)
+void BsAbstractSheetWin::doubleClickOpenSheet(const QModelIndex &index)
 {
-    if ( item ) {
-        openSheet(mpFindGrid->item(item->row(), 0)->text().toInt());
+    if ( index.isValid() ) {
+        openSheet(mpFindGrid->cellText(index.row(), 0).toInt());
     }
 }
 
@@ -4350,6 +4451,7 @@ bool BsAbstractSheetWin::autoRecordFinance()
         }
     }
     db.commit();
+    BsResultCache::bump(QStringLiteral("szd"));
 
     return true;
 }
@@ -4735,7 +4837,7 @@ void BsSheetCargoWin::doSyncFindGrid()
 
     int row = -1;
     for ( int i = 0, iLen = mpFindGrid->rowCount(); i < iLen; ++i ) {
-        if ( mpFindGrid->item(i, sheetIdCol)->text().toInt() == mCurrentSheetId ) {
+        if ( mpFindGrid->cellText(i, sheetIdCol).toInt() == mCurrentSheetId ) {
             row = i;
             break;
         }
@@ -4745,44 +4847,44 @@ void BsSheetCargoWin::doSyncFindGrid()
 
     int datedCol = mpFindGrid->getColumnIndexByFieldName("dated");
     if ( datedCol > 0 )
-        mpFindGrid->item(row, datedCol)->setText(getPrintValue("dated"));
+        mpFindGrid->setCellText(row, datedCol, getPrintValue("dated"));
 
     int stypeCol = mpFindGrid->getColumnIndexByFieldName("stype");
     if ( stypeCol > 0 )
-        mpFindGrid->item(row, stypeCol)->setText(getPrintValue("stype"));
+        mpFindGrid->setCellText(row, stypeCol, getPrintValue("stype"));
 
     int staffCol = mpFindGrid->getColumnIndexByFieldName("staff");
     if ( staffCol > 0 )
-        mpFindGrid->item(row, staffCol)->setText(getPrintValue("staff"));
+        mpFindGrid->setCellText(row, staffCol, getPrintValue("staff"));
 
     int shopCol = mpFindGrid->getColumnIndexByFieldName("shop");
     if ( shopCol > 0 )
-        mpFindGrid->item(row, shopCol)->setText(getPrintValue("shop"));
+        mpFindGrid->setCellText(row, shopCol, getPrintValue("shop"));
 
     int traderCol = mpFindGrid->getColumnIndexByFieldName("trader");
     if ( traderCol > 0 )
-        mpFindGrid->item(row, traderCol)->setText(getPrintValue("trader"));
+        mpFindGrid->setCellText(row, traderCol, getPrintValue("trader"));
 
     int qtyCol = mpFindGrid->getColumnIndexByFieldName("sumqty");
     if ( qtyCol > 0 )
-        mpFindGrid->item(row, qtyCol)->setText(getPrintValue("sumqty"));
+        mpFindGrid->setCellText(row, qtyCol, getPrintValue("sumqty"));
 
     int mnyCol = mpFindGrid->getColumnIndexByFieldName("summoney");
     if ( mnyCol > 0 )
-        mpFindGrid->item(row, mnyCol)->setText(getPrintValue("summoney"));
+        mpFindGrid->setCellText(row, mnyCol, getPrintValue("summoney"));
 
     int payCol = mpFindGrid->getColumnIndexByFieldName("actpay");
     if ( payCol > 0 )
-        mpFindGrid->item(row, payCol)->setText(getPrintValue("actpay"));
+        mpFindGrid->setCellText(row, payCol, getPrintValue("actpay"));
 
     int oweCol = mpFindGrid->getColumnIndexByFieldName("actowe");
     if ( oweCol > 0 )
-        mpFindGrid->item(row, oweCol)->setText(getPrintValue("actowe"));
+        mpFindGrid->setCellText(row, oweCol, getPrintValue("actowe"));
 
     if (mpCheckMark->getDataCheckedValue()) {
-        mpFindGrid->item(row, sheetIdCol)->setData(Qt::DecorationRole, QIcon(":/icon/check.png"));
+        mpFindGrid->setCellIcon(row, sheetIdCol, QIcon(":/icon/check.png"));
     } else {
-        mpFindGrid->item(row, sheetIdCol)->setData(Qt::DecorationRole, QVariant());
+        mpFindGrid->setCellIcon(row, sheetIdCol, QIcon());
     }
 }
 
@@ -5271,7 +5373,7 @@ void BsSheetFinanceWin::doSyncFindGrid()
 
     int row = -1;
     for ( int i = 0, iLen = mpFindGrid->rowCount(); i < iLen; ++i ) {
-        if ( mpFindGrid->item(i, sheetIdCol)->text().toInt() == mCurrentSheetId ) {
+        if ( mpFindGrid->cellText(i, sheetIdCol).toInt() == mCurrentSheetId ) {
             row = i;
             break;
         }
@@ -5281,28 +5383,28 @@ void BsSheetFinanceWin::doSyncFindGrid()
 
     int datedCol = mpFindGrid->getColumnIndexByFieldName("dated");
     if ( datedCol > 0 )
-        mpFindGrid->item(row, datedCol)->setText(getPrintValue("dated"));
+        mpFindGrid->setCellText(row, datedCol, getPrintValue("dated"));
 
     int stypeCol = mpFindGrid->getColumnIndexByFieldName("stype");
     if ( stypeCol > 0 )
-        mpFindGrid->item(row, stypeCol)->setText(getPrintValue("stype"));
+        mpFindGrid->setCellText(row, stypeCol, getPrintValue("stype"));
 
     int staffCol = mpFindGrid->getColumnIndexByFieldName("staff");
     if ( staffCol > 0 )
-        mpFindGrid->item(row, staffCol)->setText(getPrintValue("staff"));
+        mpFindGrid->setCellText(row, staffCol, getPrintValue("staff"));
 
     int shopCol = mpFindGrid->getColumnIndexByFieldName("shop");
     if ( shopCol > 0 )
-        mpFindGrid->item(row, shopCol)->setText(getPrintValue("shop"));
+        mpFindGrid->setCellText(row, shopCol, getPrintValue("shop"));
 
     int traderCol = mpFindGrid->getColumnIndexByFieldName("trader");
     if ( traderCol > 0 )
-        mpFindGrid->item(row, traderCol)->setText(getPrintValue("trader"));
+        mpFindGrid->setCellText(row, traderCol, getPrintValue("trader"));
 
     if (mpCheckMark->getDataCheckedValue()) {
-        mpFindGrid->item(row, sheetIdCol)->setData(Qt::DecorationRole, QIcon(":/icon/check.png"));
+        mpFindGrid->setCellIcon(row, sheetIdCol, QIcon(":/icon/check.png"));
     } else {
-        mpFindGrid->item(row, sheetIdCol)->setData(Qt::DecorationRole, QVariant());
+        mpFindGrid->setCellIcon(row, sheetIdCol, QIcon());
     }
 }
 
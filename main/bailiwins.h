@@ -67,6 +67,7 @@ public:
     QString table() const { return mMainTable; }
     void setQuickDate(const QString &periodName, BsFldBox *dateB, BsFldBox *dateE, QToolButton *button);
     void exportGrid(const BsGrid* grid, const QStringList headerPairs = QStringList());
+    void exportGrid(const BsQueryGrid* grid, const QStringList headerPairs = QStringList());
     QString pairTextToHtml(const QStringList &pairs, const bool lastRed = false);
     bool getOptValueByOptName(const QString &optName);
 
@@ -140,6 +141,8 @@ private slots:
 private:
     void loadAllOptionSettings();
     void saveAllOptionSettings();
+    void exportTableView(const QTableView *grid, const QList<BsField*> &fields, const QTableWidget *footer,
+                         const QStringList headerPairs);
 };
 
 
@@ -456,7 +459,7 @@ private slots:
     void clickQuickPeriod();
     void clickExecuteQuery();
     void clickCancelOpenPage();
-    void doubleClickOpenSheet(QTableWidgetItem *item);
+    void doubleClickOpenSheet(const QModelIndex &index);
 
 private:
     void savedReconcile(const int sheetId, const qint64 uptime);
@@ -0,0 +1,136 @@
+#include "bailiwriter.h"
+#include "bailimetrics.h"
+
+#include <QtSql>
+
+#define WRITER_QUEUE_HIGH       (16 * 1024 * 1024)  //待发队列上限，超过则post阻塞
+#define WRITER_SOCKET_HIGH      (1024 * 1024)       //socket发送缓存上限，超过则暂停flush
+
+namespace BailiSoft {
+
+BsSocketWriter::BsSocketWriter(QTcpSocket *socket, QObject *parent)
+    : QObject(parent), mppSocket(socket)
+{
+    connect(mppSocket, SIGNAL(bytesWritten(qint64)), this, SLOT(socketBytesWritten(qint64)));
+}
+
+void BsSocketWriter::post(const QByteArray &toServerData)
+{
+    //非法请求约定必须用空字节表示。既然非法，不要回复。
+    if ( toServerData.length() < 4 ) {
+        return;
+    }
+
+    //检查避免公服宕机
+    qint32 dataLen = qFromBigEndian<qint32>(toServerData.constData());
+    if ( dataLen != toServerData.length() - 4 ) {
+        return;
+    }
+
+    QMutexLocker locker(&mMutex);
+
+    //背压（主线程自己不能等，否则无人flush）
+    if ( QThread::currentThread() != thread() ) {
+        while ( !mStopping && mQueuedBytes > WRITER_QUEUE_HIGH ) {
+            mSpaceReady.wait(&mMutex);
+        }
+    }
+    if ( mStopping ) {
+        return;
+    }
+
+    if ( mFrames.isEmpty() ) {
+        mOldestTimer.start();
+    }
+    mFrames.enqueue(toServerData);
+    mQueuedBytes += toServerData.length();
+
+    //已有flush在排队则不必重复投递，届时一并写出
+    if ( !mFlushPosted ) {
+        mFlushPosted = true;
+        QMetaObject::invokeMethod(this, "flush", Qt::QueuedConnection);
+    }
+}
+
+void BsSocketWriter::reset()
+{
+    QMutexLocker locker(&mMutex);
+    mFrames.clear();
+    mQueuedBytes = 0;
+    mFlushPosted = false;
+    mStopping = false;
+}
+
+void BsSocketWriter::stop()
+{
+    QMutexLocker locker(&mMutex);
+    mStopping = true;
+    mFrames.clear();
+    mQueuedBytes = 0;
+    mSpaceReady.wakeAll();
+}
+
+void BsSocketWriter::flush()
+{
+    //socket发送缓存过多，等bytesWritten再来（mFlushPosted保持为真，post不再重复投递）
+    if ( mppSocket->bytesToWrite() > WRITER_SOCKET_HIGH ) {
+        return;
+    }
+
+    //整批取出
+    QQueue<QByteArray> frames;
+    qint64 totalBytes;
+    qint64 waitUsecs;
+    {
+        QMutexLocker locker(&mMutex);
+        frames.swap(mFrames);
+        totalBytes = mQueuedBytes;
+        waitUsecs = ( frames.isEmpty() ) ? 0 : mOldestTimer.nsecsElapsed() / 1000;
+        mQueuedBytes = 0;
+        mFlushPosted = false;
+        mSpaceReady.wakeAll();
+    }
+    if ( frames.isEmpty() ) {
+        return;
+    }
+
+    //合并一次写出
+    QByteArray batch;
+    if ( frames.length() == 1 ) {
+        batch = frames.first();
+    } else {
+        batch.reserve(int(totalBytes));
+        for ( int i = 0, iLen = frames.length(); i < iLen; ++i ) {
+            batch += frames.at(i);
+        }
+    }
+
+    qint64 written = mppSocket->write(batch);
+    if ( written != batch.length() ) {
+        QSqlDatabase db = QSqlDatabase::database();
+        for ( int i = 0, iLen = frames.length(); i < iLen; ++i ) {
+            db.exec(QStringLiteral("insert into serverfail(timeid, faildata) values(%1, '%2');")
+                    .arg(QDateTime::currentMSecsSinceEpoch()).arg(QString(frames.at(i).toHex())));
+        }
+        return;
+    }
+
+    BsMetrics::recordStage(BsMetrics::StageWrite, waitUsecs);
+}
+
+void BsSocketWriter::socketBytesWritten(const qint64 bytes)
+{
+    Q_UNUSED(bytes);
+
+    //背压暂停期间积压的帧在socket缓存降下后继续写出
+    bool pending;
+    {
+        QMutexLocker locker(&mMutex);
+        pending = mFlushPosted && !mFrames.isEmpty();
+    }
+    if ( pending && mppSocket->bytesToWrite() <= WRITER_SOCKET_HIGH ) {
+        flush();
+    }
+}
+
+}
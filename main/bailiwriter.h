@@ -0,0 +1,40 @@
+#ifndef BAILIWRITER_H
+#define BAILIWRITER_H
+
+#include <QtNetwork>
+
+namespace BailiSoft {
+
+// 上行写出器 ============================================================================
+// 各BsTerminator线程直接post()待发帧（多生产者单消费者队列，不经过主线程事件逐个排队），
+// 主线程一次flush()把积压帧合并成一个缓存写入socket，聊天群发等突发小包不再一帧一写。
+// socket发送缓存或本队列积压过多时施加背压：flush暂停待bytesWritten后继续，post阻塞待有空间。
+class BsSocketWriter : public QObject
+{
+    Q_OBJECT
+public:
+    BsSocketWriter(QTcpSocket *socket, QObject *parent = Q_NULLPTR);
+
+    void post(const QByteArray &toServerData);      //任何线程可调用
+    void reset();
+    void stop();
+
+private slots:
+    void flush();
+    void socketBytesWritten(const qint64 bytes);
+
+private:
+    QTcpSocket*             mppSocket;
+
+    QMutex                  mMutex;
+    QWaitCondition          mSpaceReady;
+    QQueue<QByteArray>      mFrames;
+    qint64                  mQueuedBytes = 0;
+    QElapsedTimer           mOldestTimer;       //本批最早入队时刻，计flush延时
+    bool                    mFlushPosted = false;
+    bool                    mStopping = false;
+};
+
+}
+
+#endif // BAILIWRITER_H
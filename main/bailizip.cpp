@@ -0,0 +1,131 @@
+#include "bailizip.h"
+
+#ifdef Q_OS_WIN
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#define ZIP_TEXT_CHUNK      32768           //每段转UTF-8的字符数
+#define ZIP_OUT_RESERVE     16384           //输出缓存最小剩余空间
+#define ZIP_FAST_THRESHOLD  (256 * 1024)    //超过此字符数用最快压缩级别
+
+namespace BailiSoft {
+
+BsZipStream::BsZipStream()
+{
+    const int levels[2] = { Z_DEFAULT_COMPRESSION, Z_BEST_SPEED };
+    for ( int i = 0; i < 2; ++i ) {
+        z_stream *zs = new z_stream;
+        memset(zs, 0, sizeof(z_stream));
+        mReadys[i] = ( deflateInit(zs, levels[i]) == Z_OK );
+        mpStreams[i] = zs;
+    }
+    mCurrent = 0;
+    mFailed = false;
+    mWithLenHead = true;
+    mOutUsed = 0;
+    mTotalIn = 0;
+}
+
+BsZipStream::~BsZipStream()
+{
+    for ( int i = 0; i < 2; ++i ) {
+        z_stream *zs = static_cast<z_stream*>(mpStreams[i]);
+        if ( mReadys[i] )
+            deflateEnd(zs);
+        delete zs;
+    }
+}
+
+void BsZipStream::begin(const bool withLenHead, const int sizeHint)
+{
+    mCurrent = ( sizeHint > ZIP_FAST_THRESHOLD ) ? 1 : 0;
+    mFailed = !mReadys[mCurrent];
+    if ( !mFailed )
+        mFailed = ( deflateReset(static_cast<z_stream*>(mpStreams[mCurrent])) != Z_OK );
+
+    mWithLenHead = withLenHead;
+    mTotalIn = 0;
+    mOut = QByteArray();
+    mOut.resize(qMax(ZIP_OUT_RESERVE, sizeHint / 3 + 64));
+    mOutUsed = ( withLenHead ) ? 4 : 0;     //长度头最后回填
+}
+
+bool BsZipStream::feed(const QString &text)
+{
+    int pos = 0;
+    int len = text.length();
+    while ( pos < len && !mFailed ) {
+        int n = qMin(ZIP_TEXT_CHUNK, len - pos);
+        //不拆开代理对
+        if ( pos + n < len && text.at(pos + n - 1).isHighSurrogate() )
+            n--;
+        QByteArray utf8 = text.midRef(pos, n).toUtf8();
+        feed(utf8.constData(), utf8.length());
+        pos += n;
+    }
+    return !mFailed;
+}
+
+bool BsZipStream::feed(const char *data, const int len)
+{
+    if ( mFailed || len <= 0 )
+        return !mFailed;
+    mTotalIn += quint32(len);
+    return deflateInput(data, len, false);
+}
+
+QByteArray BsZipStream::finish()
+{
+    if ( !mFailed )
+        deflateInput(nullptr, 0, true);
+    if ( mFailed )
+        return QByteArray();
+
+    mOut.resize(mOutUsed);
+    if ( mWithLenHead )
+        qToBigEndian<quint32>(mTotalIn, mOut.data());
+
+    QByteArray result = mOut;
+    mOut = QByteArray();
+    return result;
+}
+
+QByteArray BsZipStream::compress(const QString &text, const bool withLenHead)
+{
+    begin(withLenHead, text.length());
+    feed(text);
+    return finish();
+}
+
+bool BsZipStream::deflateInput(const char *data, const int len, const bool finishing)
+{
+    z_stream *zs = static_cast<z_stream*>(mpStreams[mCurrent]);
+    zs->next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+    zs->avail_in = uInt(len);
+
+    forever {
+        //保证输出空间
+        if ( mOut.length() - mOutUsed < ZIP_OUT_RESERVE ) {
+            mOut.resize(mOut.length() * 2);
+        }
+        zs->next_out = reinterpret_cast<Bytef*>(mOut.data() + mOutUsed);
+        zs->avail_out = uInt(mOut.length() - mOutUsed);
+
+        int ret = deflate(zs, ( finishing ) ? Z_FINISH : Z_NO_FLUSH);
+        mOutUsed = mOut.length() - int(zs->avail_out);
+
+        if ( ret == Z_STREAM_END )
+            return true;
+        if ( ret != Z_OK && ret != Z_BUF_ERROR ) {
+            mFailed = true;
+            return false;
+        }
+        //未收尾时，输入已用完且输出未填满即可返回
+        if ( !finishing && zs->avail_in == 0 && zs->avail_out > 0 )
+            return true;
+    }
+}
+
+}
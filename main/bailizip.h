@@ -0,0 +1,41 @@
+#ifndef BAILIZIP_H
+#define BAILIZIP_H
+
+#include <QtCore>
+
+namespace BailiSoft {
+
+// 响应压缩流 ============================================================================
+// 输出与qCompress()完全相同（可选4字节大端原长头 + zlib流），前端无需改动。
+// 每个BsTerminator线程持有一个，deflate上下文复用（deflateReset），不再每次分配约256KB工作区；
+// 文本分段转UTF-8边转边压，不再整体生成UTF-8副本，老前端去长度头也不再mid()整体复制。
+// 大响应自动改用最快压缩级别，CPU换少量体积。
+class BsZipStream
+{
+public:
+    BsZipStream();
+    ~BsZipStream();
+
+    void begin(const bool withLenHead, const int sizeHint = 0);
+    bool feed(const QString &text);
+    bool feed(const char *data, const int len);
+    QByteArray finish();
+
+    QByteArray compress(const QString &text, const bool withLenHead);
+
+private:
+    bool deflateInput(const char *data, const int len, const bool finishing);
+
+    void*       mpStreams[2];   //z_stream，默认级别与最快级别各一，避免头文件依赖zlib
+    bool        mReadys[2];
+    int         mCurrent;
+    bool        mFailed;
+    bool        mWithLenHead;
+    QByteArray  mOut;
+    int         mOutUsed;
+    quint32     mTotalIn;
+};
+
+}
+
+#endif // BAILIZIP_H
@@ -5,8 +5,11 @@
 #include "bailigrid.h"
 #include "bailifunc.h"
 #include "bailishare.h"
+#include "bailisql.h"
 #include "bailiserver.h"
 #include "bailipublisher.h"
+#include "bailistore.h"
+#include "bailibackup.h"
 #include "bsmain.h"
 #include "dialog/bsloginguide.h"
 #include "dialog/bssetpassword.h"
@@ -23,6 +26,8 @@
 #include "tools/bsbarcodemaker.h"
 #include "tools/bslabeldesigner.h"
 #include "tools/bstoolstockreset.h"
+#include "tools/bstoolindexadvisor.h"
+#include "tools/bstoolarchive.h"
 #ifdef Q_OS_WIN
 #include "admin_sales/lxsalesmanage.h"
 #endif
@@ -120,6 +125,10 @@ BsMain::BsMain(QWidget *parent) : QMainWindow(parent)
 
     QMenu *mnTool = mnbar->addMenu(mapMsg.value("main_tool"));
     mpMenuToolStockReset = mnTool->addAction(mapMsg.value("menu_stock_reset"), this, SLOT(openToolStockReset()));
+    mpMenuToolStockBalance = mnTool->addAction(mapMsg.value("menu_stock_balance"), this, SLOT(openToolStockBalance()));
+    mpMenuToolIndexAdvisor = mnTool->addAction(mapMsg.value("menu_index_advisor"), this, SLOT(openToolIndexAdvisor()));
+    mpMenuToolBackupNow = mnTool->addAction(mapMsg.value("menu_backup_now"), this, SLOT(openToolBackupNow()));
+    mpMenuToolArchive = mnTool->addAction(mapMsg.value("menu_archive_years"), this, SLOT(openToolArchive()));
     mpMenuToolBatchCheck = mnTool->addAction(mapMsg.value("menu_batch_check"), this, SLOT(openToolBatchCheck()));
     mpMenuToolBatchEdit = mnTool->addAction(mapMsg.value("menu_batch_edit"), this, SLOT(openToolBatchEdit()));
     mpMenuToolBarcodeMaker = mnTool->addAction(mapMsg.value("menu_barcode_maker"), this, SLOT(openToolBarcodeMaker()));
@@ -182,6 +191,14 @@ BsMain::BsMain(QWidget *parent) : QMainWindow(parent)
     mpSentinel = new BsPublisher(this);
     mpSentinel->start();
 
+    //WAL检查点
+    mpCheckpointer = new BsCheckpointer(this);
+    mpCheckpointer->start();
+
+    //在线备份
+    mpBackuper = new BsBackupService(this);
+    mpBackuper->start();
+
     //开启登录向导
     QTimer::singleShot(100, this, SLOT(openLoginGuide()));
 }
@@ -364,6 +381,15 @@ void BsMain::openLoginGuide()
 
         //库存同步
         mpSentinel->bookLogin(loginFile);
+
+        //检查点调度
+        mpCheckpointer->bookLogin(loginFile);
+
+        //网络账册他处写入监视（结果缓存与登记目录据以失效）
+        watchBookChanges(loginFile);
+
+        //在线备份
+        mpBackuper->bookLogin(loginFile, loginBook);
     }
     else if ( loginer.isEmpty() ) {
         close();
@@ -385,13 +411,15 @@ void BsMain::closeEvent(QCloseEvent *event)
     QEventLoop loop;
     connect(mpSentinel, SIGNAL(finished()), &loop, SLOT(quit()));
     loop.exec();
+    mpBackuper->stopWait();
+    mpCheckpointer->stopWait();
 
-    //自动备份
+    //退出时补一次备份（在线复制，不再直接拷贝可能正被写入的账册文件）
     if ( !loginBook.isEmpty() && !loginFile.contains("//") && !loginFile.contains("\\\\") ) {
-        QDir bakDir(backupDir);
-        QString bakFile = bakDir.absoluteFilePath(QStringLiteral("%1.bak").arg(loginBook));
-        if ( QFile::exists(bakFile) ) QFile::remove(bakFile);
-        QFile::copy(loginFile, bakFile);
+        QSqlDatabase defaultdb = QSqlDatabase::database();
+        sqliteCheckpoint(defaultdb, true);
+        QString strErr = BsBackupService::backupBook(loginFile, loginBook);
+        if ( !strErr.isEmpty() ) qDebug() << "backupBook" << strErr;
     }
 }
 
@@ -986,6 +1014,84 @@ void BsMain::openToolStockReset()
     dlg.exec();
 }
 
+void BsMain::openToolStockBalance()
+{
+    if ( ! loginAsAdminOrBoss ) {
+        QMessageBox::information(this, QString(), QStringLiteral("没有权限！"));
+        return;
+    }
+
+    QSqlDatabase db = QSqlDatabase::database();
+    qApp->setOverrideCursor(Qt::WaitCursor);
+    int diffs = stockBalanceVerify(db);
+    qApp->restoreOverrideCursor();
+
+    if ( diffs == 0 ) {
+        stockBalanceCompact(db, 0);
+        QMessageBox::information(this, QString(), QStringLiteral("库存账表与全部单据核对一致。"));
+        return;
+    }
+
+    QString hint = (diffs > 0)
+            ? QStringLiteral("库存账表有%1行与单据累计不一致，是否按全部单据重建？").arg(diffs)
+            : QStringLiteral("库存账表读取出错，是否按全部单据重建？");
+    if ( QMessageBox::question(this, QString(), hint, QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes )
+        return;
+
+    qApp->setOverrideCursor(Qt::WaitCursor);
+    QString strErr = stockBalanceRebuild(db);
+    qApp->restoreOverrideCursor();
+
+    if ( strErr.isEmpty() )
+        QMessageBox::information(this, QString(), QStringLiteral("库存账表重建完成。"));
+    else
+        QMessageBox::information(this, QString(), QStringLiteral("重建不成功：%1").arg(strErr));
+}
+
+void BsMain::openToolIndexAdvisor()
+{
+    if ( ! loginAsAdminOrBoss ) {
+        QMessageBox::information(this, QString(), QStringLiteral("没有权限！"));
+        return;
+    }
+
+    QAction *act = qobject_cast<QAction*>(QObject::sender());
+    Q_ASSERT(act);
+    BsToolIndexAdvisor dlg(this);
+    dlg.setWindowTitle(act->text());
+    dlg.exec();
+}
+
+void BsMain::openToolBackupNow()
+{
+    if ( ! loginAsAdminOrBoss ) {
+        QMessageBox::information(this, QString(), QStringLiteral("没有权限！"));
+        return;
+    }
+
+    mpBackuper->backupNow();
+    QMessageBox::information(this, QString(), QStringLiteral("已在后台开始备份，备份集位于：\n%1")
+                             .arg(QDir(backupDir).absoluteFilePath(loginBook)));
+}
+
+void BsMain::openToolArchive()
+{
+    if ( ! loginAsAdminOrBoss ) {
+        QMessageBox::information(this, QString(), QStringLiteral("没有权限！"));
+        return;
+    }
+
+    //归档删改大量单据并重建查询视图，须先关闭各窗口
+    if ( ! questionCloseAllSubWin() )
+        return;
+
+    QAction *act = qobject_cast<QAction*>(QObject::sender());
+    Q_ASSERT(act);
+    BsToolArchive dlg(this);
+    dlg.setWindowTitle(act->text());
+    dlg.exec();
+}
+
 void BsMain::openToolBarcodeMaker()
 {
     if ( ! checkRaiseSubWin("tool_barcodemaker") ) {
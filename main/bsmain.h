@@ -11,6 +11,8 @@ namespace BailiSoft {
 class BsMdiArea;
 class BsServer;
 class BsPublisher;
+class BsCheckpointer;
+class BsBackupService;
 
 class BsMain : public QMainWindow
 {
@@ -88,6 +90,10 @@ private slots:
     void openToolBatchEdit();
     void openToolBatchCheck();
     void openToolStockReset();
+    void openToolStockBalance();
+    void openToolIndexAdvisor();
+    void openToolBackupNow();
+    void openToolArchive();
     void openToolBarcodeMaker();
     void openToolLabelDesigner();
 
@@ -158,6 +164,10 @@ private:
     QAction* mpMenuQryMaxAlarm;
 
     QAction* mpMenuToolStockReset;
+    QAction* mpMenuToolStockBalance;
+    QAction* mpMenuToolIndexAdvisor;
+    QAction* mpMenuToolBackupNow;
+    QAction* mpMenuToolArchive;
     QAction* mpMenuToolBatchEdit;
     QAction* mpMenuToolBatchCheck;
     QAction* mpMenuToolBarcodeMaker;
@@ -171,6 +181,8 @@ private:
 
     BsServer*           mpServer;
     BsPublisher*       mpSentinel;
+    BsCheckpointer*    mpCheckpointer;
+    BsBackupService*   mpBackuper;
 };
 
 }
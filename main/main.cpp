@@ -1,6 +1,7 @@
 #include "bailicode.h"
 #include "bailidata.h"
 #include "bailicustom.h"
+#include "bailibackup.h"
 #include "bsmain.h"
 #include "dialog/lxwelcome.h"
 //#include "misc/bsdebug.h"       //release调试结束后应注释掉
@@ -31,6 +32,15 @@ int main(int argc, char *argv[])
     BailiSoft::initWinTableNames();
     BailiSoft::initMapMsg();
 
+    //命令行恢复账册：BailiR17 --restore 备份集文件 [账册文件]（账册文件缺省为备份时的原文件）
+    int restoreAt = a.arguments().indexOf(QStringLiteral("--restore"));
+    if ( restoreAt > 0 && restoreAt + 1 < a.arguments().length() ) {
+        QString bookFile = ( restoreAt + 2 < a.arguments().length() ) ? a.arguments().at(restoreAt + 2) : QString();
+        QString strErr = BailiSoft::BsBackupService::restoreSet(a.arguments().at(restoreAt + 1), bookFile);
+        QMessageBox::information(nullptr, QString(), ( strErr.isEmpty() ) ? QStringLiteral("账册恢复完成。") : strErr);
+        return ( strErr.isEmpty() ) ? 0 : 3;
+    }
+
     //授权检测
     BailiSoft::checkLicenseDog();
 
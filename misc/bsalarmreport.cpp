@@ -2,6 +2,7 @@
 #include "main/bailigrid.h"
 #include "main/bailicode.h"
 #include "main/bailidata.h"
+#include "main/bailisqlfunc.h"
 
 namespace BailiSoft {
 
@@ -55,56 +56,81 @@ void BsAlarmReport::reloadAlarm()
     sqls << QStringLiteral("DROP TABLE IF EXISTS temp.%1;").arg(tmpTableCargo);
     sqls << QStringLiteral("CREATE TEMP TABLE %1 AS SELECT DISTINCT cargo FROM stockalarm;").arg(tmpTableCargo);
 
-    //库存分拆创建入池
-    QStringList stockUnionUnitSqls;
     QStringList sizerNames = dsSizer->getWholeUniqueNames();
-    foreach (QString sizerName, sizerNames) {
-        if ( !sizerName.isEmpty() ) {
-            stockUnionUnitSqls << QStringLiteral("SELECT cargo, color, '%1' AS sizer, "
-                                                 "(CASE SUBSTR(sizers,2,1) WHEN '\v' THEN "
-                                                 "(CASE WHEN INSTR(sizers,'%2')>2 THEN "
-                                                 "CAST(SUBSTR(sizers,INSTR(sizers,'%2')+%3,"
-                                                 "INSTR(SUBSTR(sizers,INSTR(sizers,'%2'))||'\n','\n')-"
-                                                 "INSTR(SUBSTR(sizers,INSTR(sizers,'%2')),'\t')-1) AS INTEGER) "
-                                                 "ELSE 0 END) ELSE "
-                                                 "(CASE WHEN INSTR(sizers,'%2')>2 THEN "
-                                                 "-1*CAST(SUBSTR(sizers,INSTR(sizers,'%2')+%3,"
-                                                 "INSTR(SUBSTR(sizers,INSTR(sizers,'%2'))||'\n','\n')-"
-                                                 "INSTR(SUBSTR(sizers,INSTR(sizers,'%2')),'\t')-1) AS INTEGER) "
-                                                 "ELSE 0 END) "
-                                                 "END) AS stock, 0 AS limqty "
-                                                 "FROM vi_stock_nodb WHERE cargo IN "
-                                                 "(SELECT cargo FROM %4) ")  //这里不能加分号
-                                  .arg(sizerName).arg(sizerName + QChar(9)).arg(sizerName.length() + 1).arg(tmpTableCargo);
+
+    //有尺码扩展函数时各一句拆码入池，否则逐码UNION切串
+    if ( hasSizerFunctions(QSqlDatabase::database()) ) {
+        QStringList names;
+        foreach (QString sizerName, sizerNames) {
+            if ( !sizerName.isEmpty() )
+                names << QStringLiteral("'%1'").arg(sizerName);
         }
+        QString nameList = names.join(QChar(44));
+        QString limFld = ( mAlarmType == bssatMin ) ? QStringLiteral("minsizers") : QStringLiteral("maxsizers");
+
+        sqls << QStringLiteral("DROP TABLE IF EXISTS temp.%1;").arg(tmpTablePool);
+        sqls << QStringLiteral("CREATE TEMP TABLE %1 AS "
+                               "SELECT s.cargo AS cargo, s.color AS color, e.sizer AS sizer, e.qty AS stock, 0 AS limqty "
+                               "FROM vi_stock_nodb AS s, sizer_each(s.sizers) AS e "
+                               "WHERE s.cargo IN (SELECT cargo FROM %2) AND e.sizer IN (%3);")
+                .arg(tmpTablePool, tmpTableCargo, nameList);
+        sqls << QStringLiteral("INSERT INTO %1(cargo, color, sizer, stock, limqty) "
+                               "SELECT a.cargo, a.color, e.sizer, 0, e.qty "
+                               "FROM stockalarm AS a, sizer_each(a.%2) AS e "
+                               "WHERE e.sizer IN (%3);")
+                .arg(tmpTablePool, limFld, nameList);
     }
-    sqls << QStringLiteral("DROP TABLE IF EXISTS temp.%1;").arg(tmpTablePool);
-    sqls << QStringLiteral("CREATE TEMP TABLE %1 AS %2;")
-            .arg(tmpTablePool).arg(stockUnionUnitSqls.join(QStringLiteral(" UNION ALL ")));
-
-    //设置分拆入池(stockalarm表没有重复项，后面SUM没有问题)
-    foreach (QString sizerName, sizerNames) {
-        if ( !sizerName.isEmpty() ) {
-            if ( mAlarmType == bssatMin )
-                sqls << QStringLiteral("INSERT INTO %1(cargo, color, sizer, stock, limqty) "
-                                       "SELECT cargo, color, '%2' AS sizer, 0 AS stock, "
-                                       "(CASE WHEN INSTR(minsizers,'%3')>0 THEN "
-                                       "CAST(SUBSTR(minsizers,INSTR(minsizers,'%3')+%4,"
-                                       "INSTR(SUBSTR(minsizers,INSTR(minsizers,'%3'))||'\n','\n')-"
-                                       "INSTR(SUBSTR(minsizers,INSTR(minsizers,'%3')),'\t')-1) AS INTEGER) "
-                                       "ELSE 0 END) AS limqty "
-                                       "FROM stockalarm; ")
-                        .arg(tmpTablePool).arg(sizerName).arg(sizerName + QChar(9)).arg(sizerName.length() + 1);
-            else
-                sqls << QStringLiteral("INSERT INTO %1(cargo, color, sizer, stock, limqty) "
-                                       "SELECT cargo, color, '%2' AS sizer, 0 AS stock, "
-                                       "(CASE WHEN INSTR(maxsizers,'%3')>0 THEN "
-                                       "CAST(SUBSTR(maxsizers,INSTR(maxsizers,'%3')+%4,"
-                                       "INSTR(SUBSTR(maxsizers,INSTR(maxsizers,'%3'))||'\n','\n')-"
-                                       "INSTR(SUBSTR(maxsizers,INSTR(maxsizers,'%3')),'\t')-1) AS INTEGER) "
-                                       "ELSE 0 END) AS limqty "
-                                       "FROM stockalarm; ")
-                        .arg(tmpTablePool).arg(sizerName).arg(sizerName + QChar(9)).arg(sizerName.length() + 1);
+    else {
+        //库存分拆创建入池
+        QStringList stockUnionUnitSqls;
+        foreach (QString sizerName, sizerNames) {
+            if ( !sizerName.isEmpty() ) {
+                stockUnionUnitSqls << QStringLiteral("SELECT cargo, color, '%1' AS sizer, "
+                                                     "(CASE SUBSTR(sizers,2,1) WHEN '\v' THEN "
+                                                     "(CASE WHEN INSTR(sizers,'%2')>2 THEN "
+                                                     "CAST(SUBSTR(sizers,INSTR(sizers,'%2')+%3,"
+                                                     "INSTR(SUBSTR(sizers,INSTR(sizers,'%2'))||'\n','\n')-"
+                                                     "INSTR(SUBSTR(sizers,INSTR(sizers,'%2')),'\t')-1) AS INTEGER) "
+                                                     "ELSE 0 END) ELSE "
+                                                     "(CASE WHEN INSTR(sizers,'%2')>2 THEN "
+                                                     "-1*CAST(SUBSTR(sizers,INSTR(sizers,'%2')+%3,"
+                                                     "INSTR(SUBSTR(sizers,INSTR(sizers,'%2'))||'\n','\n')-"
+                                                     "INSTR(SUBSTR(sizers,INSTR(sizers,'%2')),'\t')-1) AS INTEGER) "
+                                                     "ELSE 0 END) "
+                                                     "END) AS stock, 0 AS limqty "
+                                                     "FROM vi_stock_nodb WHERE cargo IN "
+                                                     "(SELECT cargo FROM %4) ")  //这里不能加分号
+                                      .arg(sizerName).arg(sizerName + QChar(9)).arg(sizerName.length() + 1).arg(tmpTableCargo);
+            }
+        }
+        sqls << QStringLiteral("DROP TABLE IF EXISTS temp.%1;").arg(tmpTablePool);
+        sqls << QStringLiteral("CREATE TEMP TABLE %1 AS %2;")
+                .arg(tmpTablePool).arg(stockUnionUnitSqls.join(QStringLiteral(" UNION ALL ")));
+
+        //设置分拆入池(stockalarm表没有重复项，后面SUM没有问题)
+        foreach (QString sizerName, sizerNames) {
+            if ( !sizerName.isEmpty() ) {
+                if ( mAlarmType == bssatMin )
+                    sqls << QStringLiteral("INSERT INTO %1(cargo, color, sizer, stock, limqty) "
+                                           "SELECT cargo, color, '%2' AS sizer, 0 AS stock, "
+                                           "(CASE WHEN INSTR(minsizers,'%3')>0 THEN "
+                                           "CAST(SUBSTR(minsizers,INSTR(minsizers,'%3')+%4,"
+                                           "INSTR(SUBSTR(minsizers,INSTR(minsizers,'%3'))||'\n','\n')-"
+                                           "INSTR(SUBSTR(minsizers,INSTR(minsizers,'%3')),'\t')-1) AS INTEGER) "
+                                           "ELSE 0 END) AS limqty "
+                                           "FROM stockalarm; ")
+                            .arg(tmpTablePool).arg(sizerName).arg(sizerName + QChar(9)).arg(sizerName.length() + 1);
+                else
+                    sqls << QStringLiteral("INSERT INTO %1(cargo, color, sizer, stock, limqty) "
+                                           "SELECT cargo, color, '%2' AS sizer, 0 AS stock, "
+                                           "(CASE WHEN INSTR(maxsizers,'%3')>0 THEN "
+                                           "CAST(SUBSTR(maxsizers,INSTR(maxsizers,'%3')+%4,"
+                                           "INSTR(SUBSTR(maxsizers,INSTR(maxsizers,'%3'))||'\n','\n')-"
+                                           "INSTR(SUBSTR(maxsizers,INSTR(maxsizers,'%3')),'\t')-1) AS INTEGER) "
+                                           "ELSE 0 END) AS limqty "
+                                           "FROM stockalarm; ")
+                            .arg(tmpTablePool).arg(sizerName).arg(sizerName + QChar(9)).arg(sizerName.length() + 1);
+            }
         }
     }
 
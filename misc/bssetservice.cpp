@@ -5,6 +5,7 @@
 #include "main/bailifunc.h"
 #include "main/bailishare.h"
 #include "main/bailiserver.h"
+#include "main/bailimetrics.h"
 
 #define RUNNING_HINT  "为保持服务不会中断，请将电脑省电模式设为“从不”。"
 #define STOPPING_HINT "本网络服务安全性远高于传统ERP类系统架构，系统代码已经完全开源，请放心开启网络服务功能。"
@@ -215,10 +216,53 @@ BsSetService::BsSetService(QWidget *parent, BsServer *netServer) : QTabWidget(pa
     layChat->addWidget(mpPnlChatCon);
     layChat->addWidget(mpGrdChat, 1);
 
+    //运行统计页
+    mpStatsBtnReset = new QPushButton(QStringLiteral("清零"), this);
+    connect(mpStatsBtnReset, SIGNAL(clicked(bool)), this, SLOT(clickStatsReset()));
+
+    mpStatsChkDump = new QCheckBox(QStringLiteral("每分钟追加记录到数据目录netmetrics.log文件"), this);
+    mpStatsChkDump->setChecked(mppServer->metricsDumpOn());
+    connect(mpStatsChkDump, SIGNAL(clicked(bool)), this, SLOT(clickStatsDump(bool)));
+
+    QWidget *pnlStatsCon = new QWidget(this);
+    QHBoxLayout *layStatsCon = new QHBoxLayout(pnlStatsCon);
+    layStatsCon->setContentsMargins(0, 0, 0, 0);
+    layStatsCon->addWidget(mpStatsBtnReset);
+    layStatsCon->addSpacing(30);
+    layStatsCon->addWidget(mpStatsChkDump);
+    layStatsCon->addStretch();
+
+    QStringList statsFlds = BsMetrics::snapshotHeaders();
+    mpGrdStats = new QTableWidget(this);
+    mpGrdStats->setColumnCount(statsFlds.length());
+    mpGrdStats->setHorizontalHeaderLabels(statsFlds);
+    mpGrdStats->horizontalHeader()->setStretchLastSection(true);
+    mpGrdStats->horizontalHeader()->setStyleSheet("QHeaderView{border-style:none; border-bottom:1px solid silver;} ");
+    mpGrdStats->setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    mpGrdStats->verticalHeader()->setDefaultSectionSize(24);
+    mpGrdStats->verticalHeader()->setStyleSheet("color:#999;");
+    mpGrdStats->verticalHeader()->setSectionResizeMode(QHeaderView::Fixed);
+    mpGrdStats->setSelectionBehavior(QAbstractItemView::SelectRows);
+    mpGrdStats->setSelectionMode(QAbstractItemView::SingleSelection);
+    mpGrdStats->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mpGrdStats->setAlternatingRowColors(true);
+    mpGrdStats->setStyleSheet(mapMsg.value("css_grid_readonly"));
+
+    mpPnlStats = new QWidget(this);
+    QVBoxLayout *layStats = new QVBoxLayout(mpPnlStats);
+    layStats->addWidget(pnlStatsCon);
+    layStats->addWidget(mpGrdStats, 1);
+
+    mStatsTicker.setInterval(2000);
+    mStatsTicker.setSingleShot(false);
+    connect(&mStatsTicker, SIGNAL(timeout()), this, SLOT(refreshStats()));
+    mStatsTicker.start();
+
     //布局
     addTab(mpPnlSvr,  QStringLiteral("服务开关"));
     addTab(mpPnlLog,  QStringLiteral("用户日志"));
     addTab(mpPnlChat, QStringLiteral("沟通记录"));
+    addTab(mpPnlStats, QStringLiteral("运行统计"));
 
     //加载用户选择表
     mBossIndex = -1;
@@ -516,4 +560,38 @@ void BsSetService::serviceStopped()
     mTicker.start();
 }
 
+void BsSetService::refreshStats()
+{
+    //仅当前页可见时刷新
+    if ( currentWidget() != mpPnlStats )
+        return;
+
+    QList<QStringList> rows = BsMetrics::snapshotRows();
+    mpGrdStats->setRowCount(rows.length());
+    for ( int i = 0, iLen = rows.length(); i < iLen; ++i ) {
+        const QStringList &row = rows.at(i);
+        for ( int j = 0, jLen = qMin(row.length(), mpGrdStats->columnCount()); j < jLen; ++j ) {
+            QTableWidgetItem *it = mpGrdStats->item(i, j);
+            if ( !it ) {
+                it = new QTableWidgetItem();
+                if ( j > 0 && j < jLen - 1 )
+                    it->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+                mpGrdStats->setItem(i, j, it);
+            }
+            it->setText(row.at(j));
+        }
+    }
+}
+
+void BsSetService::clickStatsReset()
+{
+    BsMetrics::reset();
+    refreshStats();
+}
+
+void BsSetService::clickStatsDump(const bool checked)
+{
+    mppServer->setMetricsDump(checked);
+}
+
 }
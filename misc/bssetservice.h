@@ -31,6 +31,9 @@ private slots:
     void waitRestartTick();
     void serviceStarted(const qint64 licEpochDate);
     void serviceStopped();
+    void refreshStats();
+    void clickStatsReset();
+    void clickStatsDump(const bool checked);
 
 private:
     QWidget*            mpPnlSvr;
@@ -59,7 +62,13 @@ private:
     QPushButton*                mpChatBtnQry;
     QTableWidget*           mpGrdChat;
 
+    QWidget*            mpPnlStats;
+    QPushButton*            mpStatsBtnReset;
+    QCheckBox*              mpStatsChkDump;
+    QTableWidget*           mpGrdStats;
+
     QTimer          mTicker;
+    QTimer          mStatsTicker;
 
     BsServer*       mppServer;
     int             mBossIndex;
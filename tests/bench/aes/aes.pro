@@ -0,0 +1,17 @@
+#AES-128-CBC后端基准：AES-NI与tinyAES加解密吞吐对比，另核对NIST向量与两后端互相还原
+CONFIG += console
+CONFIG -= app_bundle qt
+
+TEMPLATE = app
+TARGET = benchaes
+
+INCLUDEPATH += $$PWD/../../.. $$PWD/../../../main
+
+HEADERS += \
+    ../../../main/bailicrypto.h \
+    ../../../third/tinyAES/aes.h
+
+SOURCES += \
+    ../../../main/bailicrypto.cpp \
+    ../../../third/tinyAES/aes.c \
+    main.cpp
@@ -0,0 +1,139 @@
+#include "bailicrypto.h"
+#include "third/tinyAES/aes.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+using namespace BailiSoft;
+
+// AES-128-CBC后端基准 ============================================================================
+// 按终端报文常见大小（64B、1KB、16KB、256KB）各加解密约mbytes MB，分别计时：
+//   A tinyAES（BsAesCipherTiny同样调用，AES-NI不可用时的回退）
+//   B BsAesCipher::create()所选后端（支持AES-NI的CPU上为硬件实现）
+// 计时前先核对：两者对NIST SP 800-38A F.2.1向量的密文一致，随机数据互相加解密还原。
+// 用法：benchaes [mbytes]
+
+static const uint8_t nistKey[16] = { 0x2b, 0x7e, 0x15, 0x16, 0x28, 0xae, 0xd2, 0xa6,
+                                     0xab, 0xf7, 0x15, 0x88, 0x09, 0xcf, 0x4f, 0x3c };
+static const uint8_t nistIv[16] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+                                    0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f };
+static const uint8_t nistPlain[64] = {
+    0x6b, 0xc1, 0xbe, 0xe2, 0x2e, 0x40, 0x9f, 0x96, 0xe9, 0x3d, 0x7e, 0x11, 0x73, 0x93, 0x17, 0x2a,
+    0xae, 0x2d, 0x8a, 0x57, 0x1e, 0x03, 0xac, 0x9c, 0x9e, 0xb7, 0x6f, 0xac, 0x45, 0xaf, 0x8e, 0x51,
+    0x30, 0xc8, 0x1c, 0x46, 0xa3, 0x5c, 0xe4, 0x11, 0xe5, 0xfb, 0xc1, 0x19, 0x1a, 0x0a, 0x52, 0xef,
+    0xf6, 0x9f, 0x24, 0x45, 0xdf, 0x4f, 0x9b, 0x17, 0xad, 0x2b, 0x41, 0x7b, 0xe6, 0x6c, 0x37, 0x10 };
+static const uint8_t nistCipher[64] = {
+    0x76, 0x49, 0xab, 0xac, 0x81, 0x19, 0xb2, 0x46, 0xce, 0xe9, 0x8e, 0x9b, 0x12, 0xe9, 0x19, 0x7d,
+    0x50, 0x86, 0xcb, 0x9b, 0x50, 0x72, 0x19, 0xee, 0x95, 0xdb, 0x11, 0x3a, 0x91, 0x76, 0x78, 0xb2,
+    0x73, 0xbe, 0xd6, 0xb8, 0xe3, 0xc1, 0x74, 0x3b, 0x71, 0x16, 0xe6, 0x9e, 0x22, 0x22, 0x95, 0x16,
+    0x3f, 0xf1, 0xca, 0xa1, 0x68, 0x1f, 0xac, 0x09, 0x12, 0x0e, 0xca, 0x30, 0x75, 0x86, 0xe1, 0xa7 };
+
+static void tinyEncrypt(struct AES_ctx *ctx, const uint8_t *iv, uint8_t *buff, const size_t len)
+{
+    AES_ctx_set_iv(ctx, iv);
+    AES_CBC_encrypt_buffer(ctx, buff, uint32_t(len));
+}
+
+static void tinyDecrypt(struct AES_ctx *ctx, const uint8_t *iv, uint8_t *buff, const size_t len)
+{
+    AES_ctx_set_iv(ctx, iv);
+    AES_CBC_decrypt_buffer(ctx, buff, uint32_t(len));
+}
+
+static bool checkBackends(BsAesCipher *cipher)
+{
+    struct AES_ctx ctx;
+    AES_init_ctx(&ctx, nistKey);
+    cipher->setKey(nistKey);
+
+    uint8_t a[64], b[64];
+    memcpy(a, nistPlain, 64);
+    memcpy(b, nistPlain, 64);
+    tinyEncrypt(&ctx, nistIv, a, 64);
+    cipher->encryptCbc(nistIv, b, 64);
+    if ( memcmp(a, nistCipher, 64) != 0 || memcmp(b, nistCipher, 64) != 0 ) {
+        printf("NIST vector mismatch\n");
+        return false;
+    }
+    cipher->decryptCbc(nistIv, b, 64);
+    if ( memcmp(b, nistPlain, 64) != 0 ) {
+        printf("NIST vector decrypt mismatch\n");
+        return false;
+    }
+
+    //随机长度、随机数据，甲加乙解、乙加甲解
+    srand(20240101);
+    std::vector<uint8_t> plain, buff;
+    for ( int round = 0; round < 200; ++round ) {
+        size_t len = size_t(16 * (1 + rand() % 256));
+        plain.resize(len);
+        for ( size_t i = 0; i < len; ++i ) plain[i] = uint8_t(rand());
+        uint8_t iv[16];
+        for ( int i = 0; i < 16; ++i ) iv[i] = uint8_t(rand());
+
+        buff = plain;
+        cipher->encryptCbc(iv, buff.data(), len);
+        tinyDecrypt(&ctx, iv, buff.data(), len);
+        bool ok = ( buff == plain );
+        tinyEncrypt(&ctx, iv, buff.data(), len);
+        cipher->decryptCbc(iv, buff.data(), len);
+        if ( !ok || buff != plain ) {
+            printf("round trip mismatch, length %d\n", int(len));
+            return false;
+        }
+    }
+    return true;
+}
+
+static double mbPerSec(const size_t bytes, const std::chrono::steady_clock::time_point &start)
+{
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return ( secs > 0 ) ? bytes / 1048576.0 / secs : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    int mbytes = ( argc > 1 ) ? atoi(argv[1]) : 64;
+    if ( mbytes <= 0 ) mbytes = 64;
+
+    BsAesCipher *cipher = BsAesCipher::create();
+    if ( !checkBackends(cipher) ) {
+        delete cipher;
+        return 1;
+    }
+    printf("backend checks passed, selected backend %s, %d MB per case\n", cipher->backendName(), mbytes);
+
+    struct AES_ctx ctx;
+    AES_init_ctx(&ctx, nistKey);
+    cipher->setKey(nistKey);
+
+    const size_t sizes[] = { 64, 1024, 16 * 1024, 256 * 1024 };
+    for ( size_t size : sizes ) {
+        size_t count = size_t(mbytes) * 1048576 / size;
+        size_t total = count * size;
+        std::vector<uint8_t> buff(size, 0x5a);
+
+        auto start = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) tinyEncrypt(&ctx, nistIv, buff.data(), size);
+        double encA = mbPerSec(total, start);
+        start = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) tinyDecrypt(&ctx, nistIv, buff.data(), size);
+        double decA = mbPerSec(total, start);
+
+        start = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) cipher->encryptCbc(nistIv, buff.data(), size);
+        double encB = mbPerSec(total, start);
+        start = std::chrono::steady_clock::now();
+        for ( size_t i = 0; i < count; ++i ) cipher->decryptCbc(nistIv, buff.data(), size);
+        double decB = mbPerSec(total, start);
+
+        printf("%7d bytes  A tinyAES enc %8.1f dec %8.1f MB/s   B %-8s enc %8.1f dec %8.1f MB/s\n",
+               int(size), encA, decA, cipher->backendName(), encB, decB);
+    }
+
+    delete cipher;
+    return 0;
+}
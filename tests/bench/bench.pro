@@ -0,0 +1,12 @@
+#性能基准（独立控制台程序，不随主程序发布）：qmake tests/bench/bench.pro && make，逐个运行各子目录程序
+TEMPLATE = subdirs
+
+SUBDIRS += \
+    sizerfunc \
+    walcheckpoint \
+    search \
+    frame \
+    aes \
+    specsum \
+    periodsnap \
+    gridstore
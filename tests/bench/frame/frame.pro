@@ -0,0 +1,18 @@
+#上行帧解析基准：BsFrameDecoder与原mid()做法对比，另核对任意切块与垃圾输入
+QT += core
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = benchframe
+
+INCLUDEPATH += $$PWD/../../../main
+
+HEADERS += \
+    ../../../main/bailiframe.h
+
+SOURCES += \
+    ../../../main/bailiframe.cpp \
+    main.cpp
@@ -0,0 +1,240 @@
+#include "bailiframe.h"
+
+#include <QCoreApplication>
+#include <climits>
+#include <cstdio>
+
+using namespace BailiSoft;
+
+// 上行帧解析基准 ============================================================================
+// 生成frames个帧（多为几十到几百字节的请求，间有64KB的大包）拼成字节流，按几种方式切块到达：
+// 1460字节（一个TCP段）、64KB（一次读满）、随机1至8192字节，各跑rounds遍计时：
+//   A 原做法：累加到接收缓存，每帧mid()取出数据、再mid()重建剩余缓存
+//   B BsFrameDecoder
+// 计时前先核对：整段、上述切法及随机1至7字节的碎切（多个随机种子）下，B取出的帧与原数据逐字节相同，
+// 提前取出保留的帧在其后追加数据后仍不变；再喂随机垃圾、负长度头、超大长度头，须不崩溃、不越界，
+// 负长度头须标为损坏。
+// 用法：benchframe [frames] [rounds]
+
+#define SPLIT_WHOLE         0
+#define SPLIT_SEGMENT       1
+#define SPLIT_READ          2
+#define SPLIT_RANDOM        3
+#define SPLIT_TINY          4
+
+static quint32 nextRandom(quint32 *seed)
+{
+    *seed = *seed * 1103515245u + 12345u;
+    return *seed >> 8;
+}
+
+static QByteArray frameHead(const qint32 len)
+{
+    uchar head[4];
+    qToBigEndian<qint32>(len, head);
+    return QByteArray(reinterpret_cast<const char *>(head), 4);
+}
+
+static QByteArray makeStream(const int frames, QList<QByteArray> *payloads)
+{
+    quint32 seed = 20240101;
+    QByteArray stream;
+    for ( int i = 0; i < frames; ++i ) {
+        int len = ( i % 997 == 996 ) ? 65536 : int(20 + nextRandom(&seed) % 400);
+        QByteArray payload(len, Qt::Uninitialized);
+        for ( int j = 0; j < len; ++j ) {
+            payload[j] = char((i * 31 + j) & 0xff);
+        }
+        stream.append(frameHead(len));
+        stream.append(payload);
+        payloads->append(payload);
+    }
+    return stream;
+}
+
+static QList<QByteArray> splitStream(const QByteArray &stream, const int mode, quint32 seed)
+{
+    QList<QByteArray> chunks;
+    int pos = 0;
+    while ( pos < stream.length() ) {
+        int len;
+        if ( mode == SPLIT_WHOLE )
+            len = stream.length();
+        else if ( mode == SPLIT_SEGMENT )
+            len = 1460;
+        else if ( mode == SPLIT_READ )
+            len = 65536;
+        else if ( mode == SPLIT_RANDOM )
+            len = int(1 + nextRandom(&seed) % 8192);
+        else
+            len = int(1 + nextRandom(&seed) % 7);
+        chunks << stream.mid(pos, len);
+        pos += len;
+    }
+    return chunks;
+}
+
+//原做法（BsServer::tcpReadReady改用BsFrameDecoder之前）
+static int midParse(const QList<QByteArray> &chunks, qint64 *bytes)
+{
+    QByteArray reading;
+    int frames = 0;
+    for ( int i = 0, iLen = chunks.length(); i < iLen; ++i ) {
+        reading += chunks.at(i);
+        while ( reading.length() >= 4 ) {
+            int len = qFromBigEndian<qint32>(reading.left(4).constData());
+            if ( reading.length() < len + 4 )
+                break;
+            QByteArray readyData = reading.mid(4, len);
+            reading = reading.mid(len + 4);
+            *bytes += readyData.length();
+            frames++;
+        }
+    }
+    return frames;
+}
+
+static int decoderParse(const QList<QByteArray> &chunks, qint64 *bytes)
+{
+    BsFrameDecoder decoder;
+    BsFrame frame;
+    int frames = 0;
+    for ( int i = 0, iLen = chunks.length(); i < iLen; ++i ) {
+        decoder.append(chunks.at(i));
+        while ( decoder.takeFrame(&frame) ) {
+            *bytes += frame.length();
+            frames++;
+        }
+    }
+    return frames;
+}
+
+static bool checkSplits(const QByteArray &stream, const QList<QByteArray> &payloads)
+{
+    for ( int mode = SPLIT_WHOLE; mode <= SPLIT_TINY; ++mode ) {
+        int seeds = ( mode == SPLIT_RANDOM || mode == SPLIT_TINY ) ? 20 : 1;
+        for ( int s = 1; s <= seeds; ++s ) {
+            QList<BsFrame> keptFrames;
+            QList<int> keptIndexes;
+            BsFrameDecoder decoder;
+            BsFrame frame;
+            int n = 0;
+            QList<QByteArray> chunks = splitStream(stream, mode, quint32(s));
+            for ( int i = 0, iLen = chunks.length(); i < iLen; ++i ) {
+                decoder.append(chunks.at(i));
+                while ( decoder.takeFrame(&frame) ) {
+                    if ( n >= payloads.length() || frame.view() != payloads.at(n) ) {
+                        printf("split mode %d seed %d: frame %d differs\n", mode, s, n);
+                        return false;
+                    }
+                    if ( n % 50 == 0 ) {
+                        keptFrames << frame;
+                        keptIndexes << n;
+                    }
+                    n++;
+                }
+            }
+            if ( n != payloads.length() || decoder.isCorrupt() ) {
+                printf("split mode %d seed %d: %d of %d frames\n", mode, s, n, payloads.length());
+                return false;
+            }
+            for ( int i = 0, iLen = keptFrames.length(); i < iLen; ++i ) {
+                if ( keptFrames.at(i).view() != payloads.at(keptIndexes.at(i)) ) {
+                    printf("split mode %d seed %d: kept frame %d changed\n", mode, s, keptIndexes.at(i));
+                    return false;
+                }
+            }
+        }
+    }
+    return true;
+}
+
+static bool checkGarbage()
+{
+    quint32 seed = 7;
+    for ( int round = 0; round < 2000; ++round ) {
+        BsFrameDecoder decoder;
+        BsFrame frame;
+        qint64 fed = 0;
+        int chunkCount = int(1 + nextRandom(&seed) % 20);
+        for ( int c = 0; c < chunkCount; ++c ) {
+            QByteArray junk(int(1 + nextRandom(&seed) % 300), Qt::Uninitialized);
+            for ( int i = 0; i < junk.length(); ++i ) {
+                junk[i] = char(nextRandom(&seed));
+            }
+            //部分垃圾以小长度头开头，能凑成帧
+            if ( junk.length() >= 4 && nextRandom(&seed) % 10 < 3 )
+                junk.replace(0, 4, frameHead(qint32(nextRandom(&seed) % 256)));
+            decoder.append(junk);
+            fed += junk.length();
+            while ( decoder.takeFrame(&frame) ) {
+                if ( frame.length() < 0 || frame.length() > fed - 4 || frame.copy().length() != frame.length() ) {
+                    printf("garbage round %d: frame length %d of %lld fed\n", round, frame.length(), fed);
+                    return false;
+                }
+            }
+        }
+    }
+
+    BsFrame frame;
+    BsFrameDecoder negative;
+    negative.append(frameHead(-5) + QByteArray("abc"));
+    if ( negative.takeFrame(&frame) || !negative.isCorrupt() ) {
+        printf("negative length head not rejected\n");
+        return false;
+    }
+
+    //声称近2GB的长度头不得照此预分配，也不得取出帧
+    BsFrameDecoder huge;
+    huge.append(frameHead(INT_MAX - 8) + QByteArray("x"));
+    huge.append(QByteArray("yz"));
+    if ( huge.takeFrame(&frame) || huge.isCorrupt() ) {
+        printf("huge length head mishandled\n");
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int frames = ( argc > 1 ) ? QString(argv[1]).toInt() : 20000;
+    int rounds = ( argc > 2 ) ? QString(argv[2]).toInt() : 3;
+    if ( frames <= 0 ) frames = 20000;
+    if ( rounds <= 0 ) rounds = 3;
+
+    QList<QByteArray> checkPayloads;
+    QByteArray checkStream = makeStream(3000, &checkPayloads);
+    if ( !checkSplits(checkStream, checkPayloads) || !checkGarbage() )
+        return 1;
+    printf("split and garbage checks passed\n");
+
+    QList<QByteArray> payloads;
+    QByteArray stream = makeStream(frames, &payloads);
+    printf("frames %d, stream %.1f MB, rounds %d\n", frames, stream.length() / 1048576.0, rounds);
+
+    const char *titles[] = { "", "1460-byte segments", "64KB reads", "random 1..8192" };
+    for ( int mode = SPLIT_SEGMENT; mode <= SPLIT_RANDOM; ++mode ) {
+        QList<QByteArray> chunks = splitStream(stream, mode, 1);
+        qint64 bytesA = 0, bytesB = 0;
+        int framesA = 0, framesB = 0;
+
+        QElapsedTimer timer;
+        timer.start();
+        for ( int r = 0; r < rounds; ++r ) {
+            framesA = midParse(chunks, &bytesA);
+        }
+        qint64 msA = qMax(qint64(1), timer.elapsed());
+
+        timer.restart();
+        for ( int r = 0; r < rounds; ++r ) {
+            framesB = decoderParse(chunks, &bytesB);
+        }
+        qint64 msB = qMax(qint64(1), timer.elapsed());
+
+        double mb = double(stream.length()) * rounds / 1048576.0;
+        printf("%-20s A mid() %8.1f MB/s   B decoder %8.1f MB/s   frames %d/%d\n",
+               titles[mode], mb * 1000.0 / msA, mb * 1000.0 / msB, framesA, framesB);
+    }
+    return 0;
+}
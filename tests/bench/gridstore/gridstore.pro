@@ -0,0 +1,14 @@
+#查询表格基准：每格一项的QTableWidget与列式存储模型对比装载、显示、合计、排序耗时与内存
+QT += core gui widgets sql
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = benchgridstore
+
+INCLUDEPATH += $$PWD/../../../main
+
+#只用到头文件内联的BsGridItem；不列入HEADERS，免得moc为BsGrid等生成需链接bailigrid.cpp的代码
+SOURCES += \
+    main.cpp
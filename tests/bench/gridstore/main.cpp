@@ -0,0 +1,271 @@
+#include "bailigrid.h"
+
+#include <QApplication>
+#include <algorithm>
+#include <cstdio>
+
+using namespace BailiSoft;
+
+// 查询表格装载基准 ============================================================================
+// 生成rows行查询结果（文本列取值重复度高，如门店、货号、颜色；数值列为数量金额），分别计时装载、首次显示、
+// 数值列合计（同页脚合计）、按数值列排序、按文本列排序，并记进程常驻内存增量：
+//   A 改前做法：QTableWidget，每格一个BsGridItem（即bailigrid.h中的类），排序时按显示文本转数比较
+//   B 改后做法：QTableView加列式存储模型（数值列存原整数、文本列存字典序号，data()即时格式化，排序只排行号）
+// BsGridStore与BsGridModel实现在bailigrid.cpp中，牵连整个界面层不便链接，B按其结构简化照写。
+// 两法都跑时核对合计与排序结果须一致。先跑的A释放后堆内存未必还给系统，内存对比宜分开跑（末参数A或B）。
+// 用法：QT_QPA_PLATFORM=offscreen benchgridstore [rows] [textcols] [intcols] [A|B]
+
+static qint64 rssKib()
+{
+    QFile f(QStringLiteral("/proc/self/statm"));
+    if ( !f.open(QIODevice::ReadOnly) )
+        return -1;
+    QList<QByteArray> parts = f.readAll().split(' ');
+    return ( parts.length() > 1 ) ? parts.at(1).toLongLong() * 4 : -1;
+}
+
+static QString textValue(const int row, const int col)
+{
+    return QStringLiteral("V%1-%2").arg(col).arg((row * (col + 3)) % (50 + col * 40));
+}
+
+static qint64 intValue(const int row, const int col)
+{
+    return qint64((row * 7919 + col * 104729) % 100000) * ( (col % 2) ? 100 : 1 );
+}
+
+//B：列式存储模型
+class BenchStoreModel : public QAbstractTableModel
+{
+public:
+    BenchStoreModel(const int textCols, const int intCols, QObject *parent)
+        : QAbstractTableModel(parent), mTextCols(textCols), mIntCols(intCols) {}
+
+    void load(const int rows) {
+        beginResetModel();
+        mIds.resize(mTextCols);
+        mDicts.resize(mTextCols);
+        mDictIndexes.resize(mTextCols);
+        mInts.resize(mIntCols);
+        for ( int c = 0; c < mTextCols; ++c ) mIds[c].reserve(rows);
+        for ( int c = 0; c < mIntCols; ++c ) mInts[c].reserve(rows);
+        for ( int r = 0; r < rows; ++r ) {
+            for ( int c = 0; c < mTextCols; ++c ) {
+                QString text = textValue(r, c);
+                int id = mDictIndexes.at(c).value(text, -1);
+                if ( id < 0 ) {
+                    id = mDicts.at(c).length();
+                    mDicts[c] << text;
+                    mDictIndexes[c].insert(text, id);
+                }
+                mIds[c] << id;
+            }
+            for ( int c = 0; c < mIntCols; ++c ) {
+                mInts[c] << intValue(r, c);
+            }
+        }
+        mRows.resize(rows);
+        for ( int r = 0; r < rows; ++r ) mRows[r] = r;
+        endResetModel();
+    }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override {
+        return ( parent.isValid() ) ? 0 : mRows.length();
+    }
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override {
+        return ( parent.isValid() ) ? 0 : mTextCols + mIntCols;
+    }
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override {
+        if ( !index.isValid() || role != Qt::DisplayRole )
+            return QVariant();
+        int srow = mRows.at(index.row());
+        int col = index.column();
+        if ( col < mTextCols )
+            return mDicts.at(col).at(mIds.at(col).at(srow));
+        qint64 v = mInts.at(col - mTextCols).at(srow);
+        return ( (col - mTextCols) % 2 ) ? QString::number(v / 100.0, 'f', 2) : QString::number(v);
+    }
+
+    double sumColumns() const {
+        double sum = 0;
+        for ( int c = 0; c < mIntCols; ++c ) {
+            qint64 colSum = 0;
+            const QVector<qint64> &ints = mInts.at(c);
+            for ( int r = 0, rLen = ints.length(); r < rLen; ++r ) colSum += ints.at(r);
+            sum += ( c % 2 ) ? colSum / 100.0 : double(colSum);
+        }
+        return sum;
+    }
+
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override {
+        beginResetModel();
+        bool desc = ( order == Qt::DescendingOrder );
+        if ( column < mTextCols ) {
+            const QStringList &dict = mDicts.at(column);
+            const QVector<int> &ids = mIds.at(column);
+            QVector<int> byText(dict.length());
+            for ( int i = 0; i < byText.length(); ++i ) byText[i] = i;
+            std::sort(byText.begin(), byText.end(), [&dict](int a, int b) { return dict.at(a) < dict.at(b); });
+            QVector<int> rank(byText.length());
+            for ( int i = 0; i < byText.length(); ++i ) rank[byText.at(i)] = i;
+            std::stable_sort(mRows.begin(), mRows.end(), [&ids, &rank, desc](int a, int b) {
+                return ( desc ) ? rank.at(ids.at(a)) > rank.at(ids.at(b)) : rank.at(ids.at(a)) < rank.at(ids.at(b));
+            });
+        } else {
+            const QVector<qint64> &ints = mInts.at(column - mTextCols);
+            std::stable_sort(mRows.begin(), mRows.end(), [&ints, desc](int a, int b) {
+                return ( desc ) ? ints.at(a) > ints.at(b) : ints.at(a) < ints.at(b);
+            });
+        }
+        endResetModel();
+    }
+
+private:
+    int                             mTextCols;
+    int                             mIntCols;
+    QVector<QVector<int> >          mIds;
+    QVector<QStringList>            mDicts;
+    QVector<QHash<QString, int> >   mDictIndexes;
+    QVector<QVector<qint64> >       mInts;
+    QVector<int>                    mRows;
+};
+
+static void showAndPaint(QWidget *w)
+{
+    w->resize(1200, 800);
+    w->show();
+    QApplication::processEvents();
+    w->grab();
+}
+
+//排序后前checkRows行各列显示文本，供两法比对
+static QStringList tableLines(QTableWidget *table, const int checkRows)
+{
+    QStringList lines;
+    for ( int r = 0, rLen = qMin(checkRows, table->rowCount()); r < rLen; ++r ) {
+        QStringList values;
+        for ( int c = 0, cLen = table->columnCount(); c < cLen; ++c ) {
+            values << table->item(r, c)->text();
+        }
+        lines << values.join(QChar('\t'));
+    }
+    return lines;
+}
+
+static QStringList modelLines(QAbstractItemModel *model, const int checkRows)
+{
+    QStringList lines;
+    for ( int r = 0, rLen = qMin(checkRows, model->rowCount()); r < rLen; ++r ) {
+        QStringList values;
+        for ( int c = 0, cLen = model->columnCount(); c < cLen; ++c ) {
+            values << model->data(model->index(r, c)).toString();
+        }
+        lines << values.join(QChar('\t'));
+    }
+    return lines;
+}
+
+int main(int argc, char *argv[])
+{
+    QApplication app(argc, argv);
+    int rows = ( argc > 1 ) ? QString(argv[1]).toInt() : 200000;
+    int textCols = ( argc > 2 ) ? QString(argv[2]).toInt() : 6;
+    int intCols = ( argc > 3 ) ? QString(argv[3]).toInt() : 6;
+    QString which = ( argc > 4 ) ? QString(argv[4]).toUpper() : QStringLiteral("AB");
+    if ( rows <= 0 ) rows = 200000;
+    if ( textCols <= 1 ) textCols = 6;
+    if ( intCols <= 1 ) intCols = 6;
+    int cols = textCols + intCols;
+    const int checkRows = 2000;
+    printf("rows %d, text columns %d, int columns %d\n", rows, textCols, intCols);
+
+    QElapsedTimer timer;
+    QStringList linesA, linesB;
+    double sumA = 0, sumB = 0;
+
+    //A
+    if ( which.contains(QChar('A')) ) {
+        qint64 rss0 = rssKib();
+        QTableWidget *table = new QTableWidget;
+        timer.start();
+        table->setColumnCount(cols);
+        table->setRowCount(rows);
+        for ( int r = 0; r < rows; ++r ) {
+            for ( int c = 0; c < textCols; ++c ) {
+                table->setItem(r, c, new BsGridItem(textValue(r, c), SORT_TYPE_TEXT));
+            }
+            for ( int c = 0; c < intCols; ++c ) {
+                qint64 v = intValue(r, c);
+                QString text = ( c % 2 ) ? QString::number(v / 100.0, 'f', 2) : QString::number(v);
+                table->setItem(r, textCols + c, new BsGridItem(text, SORT_TYPE_NUM));
+            }
+        }
+        qint64 msLoad = timer.elapsed();
+        timer.restart();
+        showAndPaint(table);
+        qint64 msPaint = timer.elapsed();
+        qint64 mem = rssKib() - rss0;
+
+        //同原updateFooterSumCount：逐格取文本转数
+        timer.restart();
+        for ( int c = textCols; c < cols; ++c ) {
+            for ( int r = 0; r < rows; ++r ) {
+                sumA += table->item(r, c)->text().toDouble();
+            }
+        }
+        qint64 msSum = timer.elapsed();
+
+        timer.restart();
+        table->sortItems(textCols + 1, Qt::DescendingOrder);
+        qint64 msSortInt = timer.elapsed();
+        timer.restart();
+        table->sortItems(1, Qt::AscendingOrder);
+        qint64 msSortText = timer.elapsed();
+        linesA = tableLines(table, checkRows);
+        delete table;
+        QApplication::processEvents();
+        printf("A QTableWidget items   load %6lld ms  paint %5lld ms  sum %5lld ms  sort int %5lld ms  "
+               "sort text %5lld ms  rss +%lld KiB\n", msLoad, msPaint, msSum, msSortInt, msSortText, mem);
+    }
+
+    //B
+    if ( which.contains(QChar('B')) ) {
+        qint64 rss0 = rssKib();
+        QTableView *view = new QTableView;
+        BenchStoreModel *model = new BenchStoreModel(textCols, intCols, view);
+        timer.restart();
+        model->load(rows);
+        view->setModel(model);
+        qint64 msLoad = timer.elapsed();
+        timer.restart();
+        showAndPaint(view);
+        qint64 msPaint = timer.elapsed();
+        qint64 mem = rssKib() - rss0;
+
+        timer.restart();
+        sumB = model->sumColumns();
+        qint64 msSum = timer.elapsed();
+
+        timer.restart();
+        model->sort(textCols + 1, Qt::DescendingOrder);
+        qint64 msSortInt = timer.elapsed();
+        timer.restart();
+        model->sort(1, Qt::AscendingOrder);
+        qint64 msSortText = timer.elapsed();
+        linesB = modelLines(model, checkRows);
+        delete view;
+        printf("B columnar store model load %6lld ms  paint %5lld ms  sum %5lld ms  sort int %5lld ms  "
+               "sort text %5lld ms  rss +%lld KiB\n", msLoad, msPaint, msSum, msSortInt, msSortText, mem);
+    }
+
+    //两法都跑时核对：合计相同，两次排序后前checkRows行逐格相同（两者均为稳定排序）
+    if ( which.contains(QChar('A')) && which.contains(QChar('B')) ) {
+        if ( qAbs(sumA - sumB) > 0.005 || linesA != linesB ) {
+            printf("results differ: sum A %.2f, sum B %.2f, sorted rows %s\n", sumA, sumB,
+                   ( linesA == linesB ) ? "same" : "differ");
+            return 1;
+        }
+        printf("sums and sorted rows match (sum %.2f, first %d rows checked)\n", sumB, linesB.length());
+    }
+    return 0;
+}
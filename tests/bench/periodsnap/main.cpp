@@ -0,0 +1,195 @@
+#include <QCoreApplication>
+#include <QtSql>
+#include <cstdio>
+
+// 期末快照基准 ============================================================================
+// 生成years年的进出单据（每天sheets张，每张dtlrows行明细），按月建库存快照，再对各截止日计时期末库存：
+//   A 原做法：从建账第一张单据起全量累计vi_stock
+//   B 截止日前最近快照加其后单据增量
+// 两者结果逐行比对须一致。快照表结构、建快照与取数SQL同main/bailisql.cpp中periodSnapshotSqls、
+// periodSnapshotBuildOne、periodSnapshotSource（该单元牵连界面层，不便直接链接，此处照录）；
+// 单据与视图只保留库存计算用到的列。
+// 用法：benchperiodsnap [years] [sheets] [dtlrows]
+
+static void execSql(QSqlDatabase &db, const QString &sql)
+{
+    QSqlQuery qry(db);
+    if ( !qry.exec(sql) )
+        qDebug() << qry.lastError().text() << sql;
+    qry.finish();
+}
+
+static qint64 monthEndSecs(const QDate &monthStart)
+{
+    return QDateTime(monthStart.addMonths(1)).toMSecsSinceEpoch() / 1000 - 1;
+}
+
+static void buildSnapshot(QSqlDatabase &db, const qint64 prevSnap, const qint64 snapdated)
+{
+    QString cols = QStringLiteral("shop, cargo, color, sizers, qty, actmoney, dismoney");
+    db.transaction();
+    execSql(db, QStringLiteral("DELETE FROM snap_stock WHERE snapdated=%1;").arg(snapdated));
+    execSql(db, QStringLiteral("INSERT INTO snap_stock(snapdated, %1) SELECT %2, shop, cargo, color, "
+                               "ifnull(group_concat(sizers, ''), ''), ifnull(sum(qty), 0), "
+                               "ifnull(sum(actmoney), 0), ifnull(sum(dismoney), 0) FROM ("
+                               "SELECT %1 FROM snap_stock WHERE snapdated=%3 "
+                               "UNION ALL SELECT %1 FROM vi_stock WHERE dated>%3 AND dated<=%2"
+                               ") WHERE shop IS NOT NULL AND cargo IS NOT NULL AND color IS NOT NULL "
+                               "GROUP BY shop, cargo, color;")
+            .arg(cols).arg(snapdated).arg(prevSnap));
+    execSql(db, QStringLiteral("INSERT OR REPLACE INTO snap_period(snapdated, builttime) VALUES(%1, 0);").arg(snapdated));
+    db.commit();
+}
+
+static QStringList closingStock(QSqlDatabase &db, const QString &source, const qint64 datee)
+{
+    QStringList lines;
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("SELECT shop, cargo, color, sum(qty), sum(actmoney), sum(dismoney) FROM %1 "
+                            "WHERE dated<=%2 GROUP BY shop, cargo, color HAVING sum(qty)<>0 "
+                            "ORDER BY shop, cargo, color;").arg(source).arg(datee));
+    if ( qry.lastError().isValid() )
+        qDebug() << qry.lastError().text();
+    while ( qry.next() ) {
+        lines << QStringLiteral("%1\t%2\t%3\t%4\t%5\t%6").arg(qry.value(0).toString(), qry.value(1).toString(),
+                                                             qry.value(2).toString(), qry.value(3).toString(),
+                                                             qry.value(4).toString(), qry.value(5).toString());
+    }
+    return lines;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int years = ( argc > 1 ) ? QString(argv[1]).toInt() : 3;
+    int sheets = ( argc > 2 ) ? QString(argv[2]).toInt() : 40;
+    int dtlRows = ( argc > 3 ) ? QString(argv[3]).toInt() : 5;
+    if ( years <= 0 ) years = 3;
+    if ( sheets <= 0 ) sheets = 40;
+    if ( dtlRows <= 0 ) dtlRows = 5;
+
+    QString dbFile = QDir::temp().absoluteFilePath(QStringLiteral("benchperiodsnap.db"));
+    QFile::remove(dbFile);
+    QString connName = QStringLiteral("bench");
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connName);
+        db.setDatabaseName(dbFile);
+        if ( !db.open() ) {
+            qDebug() << db.lastError().text();
+            return 1;
+        }
+        execSql(db, QStringLiteral("PRAGMA journal_mode=WAL;"));
+        execSql(db, QStringLiteral("PRAGMA synchronous=NORMAL;"));
+        execSql(db, QStringLiteral("create table sheet(sheetid integer primary key, dated integer, shop text, "
+                                   "minus integer);"));
+        execSql(db, QStringLiteral("create table sheetdtl(parentid integer, cargo text, color text, sizers text, "
+                                   "qty integer, actmoney integer, dismoney integer);"));
+        execSql(db, QStringLiteral("create index idxsheetdated on sheet(dated);"));
+        execSql(db, QStringLiteral("create index idxsheetdtl on sheetdtl(parentid);"));
+        execSql(db, QStringLiteral("create view vi_stock as select s.dated, s.shop, d.cargo, d.color, "
+                                   "(case s.minus when 1 then char(13,12) else char(13,11) end)||d.sizers as sizers, "
+                                   "(case s.minus when 1 then -d.qty else d.qty end) as qty, "
+                                   "(case s.minus when 1 then -d.actmoney else d.actmoney end) as actmoney, "
+                                   "(case s.minus when 1 then -d.dismoney else d.dismoney end) as dismoney "
+                                   "from sheet s join sheetdtl d on d.parentid=s.sheetid;"));
+        execSql(db, QStringLiteral("CREATE TABLE snap_period(snapdated INTEGER PRIMARY KEY, builttime INTEGER DEFAULT 0);"));
+        execSql(db, QStringLiteral("CREATE TABLE snap_stock(snapdated INTEGER NOT NULL, shop TEXT NOT NULL, "
+                                   "cargo TEXT NOT NULL, color TEXT NOT NULL, sizers TEXT DEFAULT '', "
+                                   "qty INTEGER DEFAULT 0, actmoney INTEGER DEFAULT 0, dismoney INTEGER DEFAULT 0, "
+                                   "primary key(snapdated, shop, cargo, color));"));
+
+        //单据：约三成为出库
+        QDate firstDay = QDate::currentDate().addYears(0 - years);
+        firstDay = QDate(firstDay.year(), firstDay.month(), 1);
+        QDate lastDay = QDate::currentDate();
+        QElapsedTimer timer;
+        timer.start();
+        db.transaction();
+        QSqlQuery insMain(db);
+        insMain.prepare(QStringLiteral("insert into sheet(dated, shop, minus) values(?, ?, ?);"));
+        QSqlQuery insDtl(db);
+        insDtl.prepare(QStringLiteral("insert into sheetdtl(parentid, cargo, color, sizers, qty, actmoney, dismoney) "
+                                      "values(?, ?, ?, ?, ?, ?, ?);"));
+        int seq = 0;
+        for ( QDate day = firstDay; day <= lastDay; day = day.addDays(1) ) {
+            qint64 daySecs = QDateTime(day).toMSecsSinceEpoch() / 1000;
+            for ( int i = 0; i < sheets; ++i, ++seq ) {
+                insMain.addBindValue(daySecs + i * 60);
+                insMain.addBindValue(QStringLiteral("shop%1").arg(seq % 6));
+                insMain.addBindValue(( seq % 10 < 3 ) ? 1 : 0);
+                insMain.exec();
+                qint64 sheetId = insMain.lastInsertId().toLongLong();
+                for ( int j = 0; j < dtlRows; ++j ) {
+                    int qty = 1 + (seq + j) % 5;
+                    insDtl.addBindValue(sheetId);
+                    insDtl.addBindValue(QStringLiteral("C%1").arg((seq * 7 + j * 13) % 800, 4, 10, QChar('0')));
+                    insDtl.addBindValue(QStringLiteral("col%1").arg(j % 4));
+                    insDtl.addBindValue(QStringLiteral("M\t%1").arg(qty));
+                    insDtl.addBindValue(qty);
+                    insDtl.addBindValue(qty * 9900);
+                    insDtl.addBindValue(qty * 100);
+                    insDtl.exec();
+                }
+            }
+        }
+        insMain.finish();
+        insDtl.finish();
+        db.commit();
+        printf("years %d, %d sheets, %d detail rows, filled in %lld ms\n", years, seq, seq * dtlRows, timer.elapsed());
+
+        //逐月建快照（刷新一个月只读上一快照加本月单据）
+        timer.restart();
+        QList<qint64> snaps;
+        qint64 prevSnap = 0;
+        for ( QDate month = firstDay; month.addMonths(1) <= lastDay; month = month.addMonths(1) ) {
+            qint64 snapdated = monthEndSecs(month);
+            buildSnapshot(db, prevSnap, snapdated);
+            snaps << snapdated;
+            prevSnap = snapdated;
+        }
+        printf("%d month snapshots built in %lld ms\n", snaps.length(), timer.elapsed());
+
+        //截止日：最后一月中旬、最后一天，以及中间一年的中旬
+        QList<qint64> dates;
+        dates << QDateTime(QDate(lastDay.year(), lastDay.month(), qMin(15, lastDay.day()))).toMSecsSinceEpoch() / 1000;
+        dates << QDateTime(lastDay.addDays(1)).toMSecsSinceEpoch() / 1000 - 1;
+        dates << QDateTime(firstDay.addMonths(years * 6).addDays(14)).toMSecsSinceEpoch() / 1000;
+        for ( int i = 0, iLen = dates.length(); i < iLen; ++i ) {
+            qint64 datee = dates.at(i);
+            qint64 snapdated = 0;
+            for ( int k = 0, kLen = snaps.length(); k < kLen; ++k ) {
+                if ( snaps.at(k) <= datee ) snapdated = snaps.at(k);
+            }
+
+            timer.restart();
+            QStringList linesA = closingStock(db, QStringLiteral("vi_stock"), datee);
+            qint64 msA = timer.elapsed();
+
+            QString source = QStringLiteral("(SELECT %1 AS dated, shop, cargo, color, sizers, qty, actmoney, dismoney "
+                                            "FROM snap_stock WHERE snapdated=%1 "
+                                            "UNION ALL SELECT dated, shop, cargo, color, sizers, qty, actmoney, dismoney "
+                                            "FROM vi_stock WHERE dated>%1 AND dated<=%2) AS vi_stock")
+                    .arg(snapdated).arg(datee);
+            timer.restart();
+            QStringList linesB = closingStock(db, source, datee);
+            qint64 msB = timer.elapsed();
+
+            if ( linesA != linesB ) {
+                printf("cut-off %s: results differ (A %d rows, B %d rows)\n",
+                       qPrintable(QDateTime::fromMSecsSinceEpoch(datee * 1000).toString(QStringLiteral("yyyy-MM-dd"))),
+                       linesA.length(), linesB.length());
+                return 1;
+            }
+            printf("cut-off %s  A full scan %6lld ms   B snapshot + delta %6lld ms   %d rows\n",
+                   qPrintable(QDateTime::fromMSecsSinceEpoch(datee * 1000).toString(QStringLiteral("yyyy-MM-dd"))),
+                   msA, msB, linesB.length());
+        }
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connName);
+    QFile::remove(dbFile);
+    QFile::remove(dbFile + QStringLiteral("-wal"));
+    QFile::remove(dbFile + QStringLiteral("-shm"));
+    return 0;
+}
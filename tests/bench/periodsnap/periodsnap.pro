@@ -0,0 +1,12 @@
+#期末快照基准：截止日期末库存按最近快照加增量与从头全量累计对比
+QT += core sql
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = benchperiodsnap
+
+SOURCES += \
+    main.cpp
@@ -0,0 +1,93 @@
+#include "bailisearch.h"
+
+#include <QCoreApplication>
+#include <algorithm>
+#include <cstdio>
+
+using namespace BailiSoft;
+
+// 登记查找索引基准 ============================================================================
+// 生成entries个货品（编码、名称、拼音首字母），计时建索引，再对几类输入各查rounds次：
+//   scan    逐行核对包含并打分（建索引前的做法）
+//   index   BsSearchIndex::search
+//   filter  同上，另带行过滤（模拟货号限制，只准一半货品）
+// 用法：benchsearch [entries] [rounds]
+
+static const char *namePieces[] = { "男", "女", "童", "春", "夏", "秋", "冬", "款", "衬衫", "外套",
+                                    "长裤", "短裤", "连衣裙", "针织", "羽绒", "卫衣", "牛仔", "休闲" };
+static const char *initialPieces[] = { "n", "n", "t", "c", "x", "q", "d", "k", "cs", "wt",
+                                       "ck", "dk", "lyq", "zz", "yr", "wy", "nz", "xx" };
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int entries = ( argc > 1 ) ? QString(argv[1]).toInt() : 100000;
+    int rounds = ( argc > 2 ) ? QString(argv[2]).toInt() : 200;
+    if ( entries <= 0 ) entries = 100000;
+    if ( rounds <= 0 ) rounds = 200;
+
+    QStringList codes, names, initials;
+    for ( int i = 0; i < entries; ++i ) {
+        codes << QStringLiteral("%1%2-%3").arg(QChar('A' + i % 26)).arg(i / 26 % 10000, 4, 10, QChar('0')).arg(i % 97);
+        QString name, initial;
+        for ( int k = 0; k < 3; ++k ) {
+            int p = (i * (k + 3) + k * 7) % 18;
+            name += QString::fromUtf8(namePieces[p]);
+            initial += QLatin1String(initialPieces[p]);
+        }
+        names << name;
+        initials << initial;
+    }
+
+    //编码排序位次
+    QVector<int> sortedRows(entries);
+    for ( int i = 0; i < entries; ++i ) sortedRows[i] = i;
+    std::sort(sortedRows.begin(), sortedRows.end(), [&codes](const int a, const int b) { return codes.at(a) < codes.at(b); });
+
+    QElapsedTimer timer;
+    timer.start();
+    BsSearchIndex index;
+    index.build(codes, names, initials, sortedRows);
+    printf("entries %d, build %lld ms\n", entries, timer.elapsed());
+
+    BsSearchFilter halfRows = [](const int row) { return row % 2 == 0; };
+
+    QStringList terms({"a0012", "b01", "-5", "衬衫", "nzwt", "lyq", "zz羽"});
+    for ( int t = 0, tLen = terms.length(); t < tLen; ++t ) {
+        QString term = terms.at(t);
+        QString lowerTerm = term.toLower();
+
+        timer.restart();
+        int scanHits = 0;
+        for ( int r = 0; r < rounds; ++r ) {
+            QVector<QPair<qint64, int> > pairs;
+            for ( int row = 0; row < entries; ++row ) {
+                int s = index.score(row, lowerTerm);
+                if ( s >= 0 ) pairs << qMakePair(qint64(s), row);
+            }
+            std::sort(pairs.begin(), pairs.end());
+            scanHits = qMin(pairs.length(), SEARCH_DEFAULT_LIMIT);
+        }
+        double scanUs = timer.nsecsElapsed() / 1000.0 / rounds;
+
+        timer.restart();
+        bool truncated = false;
+        int indexHits = 0;
+        for ( int r = 0; r < rounds; ++r ) {
+            indexHits = index.search(term, SEARCH_DEFAULT_LIMIT, &truncated).length();
+        }
+        double indexUs = timer.nsecsElapsed() / 1000.0 / rounds;
+
+        timer.restart();
+        int filterHits = 0;
+        for ( int r = 0; r < rounds; ++r ) {
+            filterHits = index.search(term, SEARCH_DEFAULT_LIMIT, nullptr, halfRows).length();
+        }
+        double filterUs = timer.nsecsElapsed() / 1000.0 / rounds;
+
+        printf("%-8s scan %9.1f us (%3d)  index %8.1f us (%3d%s)  filter %8.1f us (%3d)\n",
+               term.toUtf8().constData(), scanUs, scanHits, indexUs, indexHits,
+               ( truncated ) ? "+" : "", filterUs, filterHits);
+    }
+    return 0;
+}
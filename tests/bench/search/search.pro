@@ -0,0 +1,18 @@
+#登记查找索引基准：10万货品下n-gram索引查找与逐行包含比对对比
+QT += core
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = benchsearch
+
+INCLUDEPATH += $$PWD/../../../main
+
+HEADERS += \
+    ../../../main/bailisearch.h
+
+SOURCES += \
+    ../../../main/bailisearch.cpp \
+    main.cpp
@@ -0,0 +1,153 @@
+#include "bailisqlfunc.h"
+
+#include <QCoreApplication>
+#include <cstdio>
+
+using namespace BailiSoft;
+
+// 尺码扩展函数基准 ============================================================================
+// 生成rows行明细（cargos个货号，每行若干尺码，约一成为\r\f负段），分别计时：
+//   A 原SQL：group_concat取回各货号全部尺码串，程序内逐行拆分合并（扩展函数不可用时的做法）
+//   B sizer_sum聚合：库内合并，只取回合并结果
+//   C sizer_each表值函数：按尺码分组合计
+//   D 原SQL：逐尺码INSTR/SUBSTR取数UNION ALL入临时表（同BsQryWin::getSizersQtySplitSql），再按尺码分组合计，与C对比
+// 用法：benchsizerfunc [rows] [cargos]
+
+//码名互不为后缀，INSTR取数不会误中他码，D与C合计可互相核对
+static const char *sizerNames[] = { "34", "35", "36", "37", "38", "39" };
+
+static QString makeSizers(const int seed)
+{
+    QStringList lines;
+    int count = 1 + seed % 6;
+    for ( int i = 0; i < count; ++i ) {
+        lines << QStringLiteral("%1\t%2").arg(QLatin1String(sizerNames[(seed + i) % 6])).arg(1 + (seed * 7 + i) % 9);
+    }
+    QString sizers = lines.join(QChar('\n'));
+    return ( seed % 10 == 0 ) ? QStringLiteral("\r\f") + sizers : QStringLiteral("\r\v") + sizers;
+}
+
+//原SQL路径的程序内合并（与库存账表合并同样逐段逐行拆分）
+static QString mergeSizers(const QString &text)
+{
+    QMap<QString, qint64> sums;
+    bool minus = false;
+    QStringList lines = text.split(QChar('\n'));
+    for ( int i = 0, iLen = lines.length(); i < iLen; ++i ) {
+        QString line = lines.at(i);
+        while ( line.startsWith(QChar('\r')) && line.length() >= 2 ) {
+            minus = ( line.at(1) == QChar('\f') );
+            line = line.mid(2);
+        }
+        int tab = line.indexOf(QChar('\t'));
+        if ( tab <= 0 ) continue;
+        qint64 qty = line.mid(tab + 1).toLongLong();
+        sums[line.left(tab)] += ( minus ) ? 0 - qty : qty;
+    }
+    QStringList parts;
+    for ( QMap<QString, qint64>::const_iterator it = sums.constBegin(); it != sums.constEnd(); ++it ) {
+        if ( it.value() != 0 ) parts << QStringLiteral("%1\t%2").arg(it.key()).arg(it.value());
+    }
+    return ( parts.isEmpty() ) ? QString() : QStringLiteral("\r\v") + parts.join(QChar('\n'));
+}
+
+static qint64 timeQuery(QSqlDatabase &db, const QString &sql, int *rowCount, const bool mergeInApp)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    if ( !qry.exec(sql) ) {
+        qDebug() << qry.lastError().text() << sql;
+        return -1;
+    }
+    int n = 0;
+    while ( qry.next() ) {
+        if ( mergeInApp )
+            mergeSizers(qry.value(1).toString());
+        else
+            qry.value(1).toString();
+        n++;
+    }
+    *rowCount = n;
+    return timer.elapsed();
+}
+
+//原SQL拆码：每个尺码一段SELECT，带\r\f负标志的取负（与库存视图拆码同式）
+static QString instrSplitSql()
+{
+    QStringList unionUnitSqls;
+    for ( int i = 0; i < 6; ++i ) {
+        QString sizerName = QLatin1String(sizerNames[i]);
+        QString qtyExp = QStringLiteral("(CASE WHEN INSTR(sizers,'%1')>2 THEN "
+                                        "CAST(SUBSTR(sizers,INSTR(sizers,'%1')+%2,"
+                                        "INSTR(SUBSTR(sizers,INSTR(sizers,'%1'))||'\n','\n')-"
+                                        "INSTR(SUBSTR(sizers,INSTR(sizers,'%1')),'\t')-1) AS INTEGER) "
+                                        "ELSE 0 END)")
+                .arg(sizerName + QChar(9)).arg(sizerName.length() + 1);
+        unionUnitSqls << QStringLiteral("SELECT cargo, '%1' AS sizer, (CASE SUBSTR(sizers,2,1) WHEN '\v' THEN %2 "
+                                        "ELSE -1*%2 END) AS qty FROM dtl")
+                         .arg(sizerName, qtyExp);
+    }
+    return QStringLiteral("CREATE TEMP TABLE splitqty AS %1;").arg(unionUnitSqls.join(QStringLiteral(" UNION ALL ")));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int rows = ( argc > 1 ) ? QString(argv[1]).toInt() : 200000;
+    int cargos = ( argc > 2 ) ? QString(argv[2]).toInt() : 2000;
+    if ( rows <= 0 ) rows = 200000;
+    if ( cargos <= 0 ) cargos = 2000;
+
+    QString dbFile = QDir::temp().absoluteFilePath(QStringLiteral("benchsizerfunc.db"));
+    QFile::remove(dbFile);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("bench"));
+        db.setDatabaseName(dbFile);
+        if ( !db.open() ) {
+            qDebug() << db.lastError().text();
+            return 1;
+        }
+        if ( !registerSizerFunctions(db) ) {
+            qDebug() << "sizer functions not available, check the QSQLITE driver uses the linked SQLite.";
+            return 1;
+        }
+
+        db.exec(QStringLiteral("create table dtl(cargo text, sizers text);"));
+        db.transaction();
+        QSqlQuery ins(db);
+        ins.prepare(QStringLiteral("insert into dtl(cargo, sizers) values(?, ?);"));
+        for ( int i = 0; i < rows; ++i ) {
+            ins.addBindValue(QStringLiteral("C%1").arg(i % cargos, 5, 10, QChar('0')));
+            ins.addBindValue(makeSizers(i));
+            ins.exec();
+        }
+        db.commit();
+        printf("rows %d, cargos %d\n", rows, cargos);
+
+        int n = 0;
+        qint64 ms = timeQuery(db, QStringLiteral("select cargo, group_concat(sizers, '\n') from dtl group by cargo;"), &n, true);
+        printf("A group_concat + merge in app : %6lld ms, %d rows\n", ms, n);
+
+        ms = timeQuery(db, QStringLiteral("select cargo, sizer_sum(sizers) from dtl group by cargo;"), &n, false);
+        printf("B sizer_sum                   : %6lld ms, %d rows\n", ms, n);
+
+        ms = timeQuery(db, QStringLiteral("select s.sizer, sum(s.qty) from dtl, sizer_each(dtl.sizers) s group by s.sizer;"), &n, false);
+        printf("C sizer_each                  : %6lld ms, %d rows\n", ms, n);
+
+        QElapsedTimer timer;
+        timer.start();
+        QSqlQuery split(db);
+        if ( !split.exec(instrSplitSql()) )
+            qDebug() << split.lastError().text();
+        qint64 splitMs = timer.elapsed();
+        ms = timeQuery(db, QStringLiteral("select sizer, sum(qty) from temp.splitqty group by sizer;"), &n, false);
+        printf("D INSTR UNION ALL split       : %6lld ms, %d rows (split %lld ms)\n", splitMs + ms, n, splitMs);
+
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("bench"));
+    QFile::remove(dbFile);
+    return 0;
+}
@@ -0,0 +1,26 @@
+#尺码扩展函数基准：sizer_sum/sizer_each与原SQL（group_concat后程序内合并、INSTR拆码UNION ALL）对比
+QT += core sql
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = benchsizerfunc
+
+INCLUDEPATH += $$PWD/../../../main
+
+HEADERS += \
+    ../../../main/bailisqlfunc.h
+
+SOURCES += \
+    ../../../main/bailisqlfunc.cpp \
+    main.cpp
+
+#须链接QSQLITE驱动所用的共享SQLite（见BailiR17Server.pro），基准总是编入扩展函数
+DEFINES += BAILI_SQLITE_FUNCS
+!isEmpty(SQLITE_DIR) {
+    INCLUDEPATH += $$SQLITE_DIR
+    LIBS += -L$$SQLITE_DIR
+}
+LIBS += -lsqlite3
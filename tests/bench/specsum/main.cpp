@@ -0,0 +1,175 @@
+#include "bailispecsum.h"
+
+#include <QCoreApplication>
+#include <cstdio>
+
+using namespace BailiSoft;
+
+// 尺码明细汇总基准 ============================================================================
+// 生成rows行明细（门店、货号、颜色、尺码串，约一成为\r\f负段），按门店+货号+颜色+尺码汇总数量，分别计时：
+//   A 原做法（BsTerminator::buildSpecVSum改用内存汇总之前）：逐码拼INSERT文本写临时表，再GROUP BY取回
+//   B BsSpecAggregator：逐行送入，内存分组累加
+// 两者结果按行比对须一致（B另剔除合计为0的组，与A的HAVING相同）。
+// 用法：benchspecsum [rows]
+
+static const char *sizerNames[] = { "S", "M", "L", "XL", "XXL", "3XL" };
+static const char *colorNames[] = { "red", "blue", "black", "white", "grey" };
+
+static QString makeSizers(const int seed)
+{
+    QStringList lines;
+    int count = 1 + seed % 6;
+    for ( int i = 0; i < count; ++i ) {
+        lines << QStringLiteral("%1\t%2").arg(QLatin1String(sizerNames[(seed + i) % 6])).arg(1 + (seed * 7 + i) % 9);
+    }
+    QString sizers = lines.join(QChar('\n'));
+    return ( seed % 10 == 0 ) ? QStringLiteral("\r\f") + sizers : QStringLiteral("\r\v") + sizers;
+}
+
+//与原buildSpecVSum相同的临时表做法，输出去掉表头的各行
+static QStringList tempTableSum(QSqlDatabase &db, const QString &sql)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(sql);
+    QSqlRecord rec = qry.record();
+    int fcount = rec.count();
+    int idxSizers = rec.indexOf(QStringLiteral("sizers"));
+    int idxQty = rec.indexOf(QStringLiteral("qty"));
+
+    QStringList fldNames, fldDefines, fldSels;
+    for ( int i = 0; i < fcount; ++i ) {
+        QString fname = rec.fieldName(i);
+        bool fldQtyy = ( fname.toLower() == QStringLiteral("qty") );
+        QString dtype = ( fldQtyy ) ? QStringLiteral("integer default 0") : QStringLiteral("text default ''");
+        if ( fname == QStringLiteral("sizers") )
+            fname = QStringLiteral("sizer");
+        fldNames << fname;
+        fldDefines << QStringLiteral("%1 %2").arg(fname).arg(dtype);
+        if ( !fldQtyy )
+            fldSels << fname;
+    }
+    QString fldNamesSql = fldNames.join(QChar(','));
+    QString batchPattern = QStringLiteral("insert into tmpnetspecqry(%1) values(%2);");
+
+    QStringList batches;
+    batches << QStringLiteral("drop table if exists temp.tmpnetspecqry;");
+    batches << QStringLiteral("create temp table tmpnetspecqry(%1);").arg(fldDefines.join(QChar(',')));
+    while ( qry.next() ) {
+        QStringList fldValues;
+        for ( int i = 0; i < fcount; ++i ) {
+            if ( i == idxSizers )
+                fldValues << QStringLiteral("__sizer__");
+            else if ( i == idxQty )
+                fldValues << QStringLiteral("__qty__");
+            else
+                fldValues << QStringLiteral("'%1'").arg(qry.value(i).toString());
+        }
+        QString valuesPattern = fldValues.join(QChar(','));
+
+        QStringList sizersList = qry.value(idxSizers).toString().split(QChar('\r'));
+        for ( int i = 0, iLen = sizersList.length(); i < iLen; ++i ) {
+            QString sizers = sizersList.at(i);
+            if ( sizers.length() > 4 ) {
+                bool minuss = sizers.at(0) == QChar('\f');
+                QStringList pairs = sizers.mid(1).split(QChar('\n'));
+                for ( int j = 0, jLen = pairs.length(); j < jLen; ++j ) {
+                    QStringList pair = QString(pairs.at(j)).split(QChar('\t'));
+                    qint64 qty = ( minuss ) ? 0 - pair.at(1).toLongLong() : pair.at(1).toLongLong();
+                    QString values = valuesPattern;
+                    values.replace(QStringLiteral("__sizer__"), QStringLiteral("'%1'").arg(pair.at(0)))
+                            .replace(QStringLiteral("__qty__"), QString::number(qty));
+                    batches << batchPattern.arg(fldNamesSql).arg(values);
+                }
+            }
+        }
+    }
+    qry.finish();
+
+    db.transaction();
+    for ( int i = 0, iLen = batches.length(); i < iLen; ++i ) {
+        db.exec(batches.at(i));
+    }
+    db.commit();
+
+    QStringList lines;
+    QString fldSelsSql = fldSels.join(QChar(','));
+    qry.exec(QStringLiteral("select %1, sum(tmpnetspecqry.qty) as qty from tmpnetspecqry "
+                            "group by %1 having sum(tmpnetspecqry.qty)<>0;").arg(fldSelsSql));
+    int width = qry.record().count();
+    while ( qry.next() ) {
+        QStringList values;
+        for ( int i = 0; i < width; ++i ) {
+            values << qry.value(i).toString();
+        }
+        lines << values.join(QChar('\t'));
+    }
+    return lines;
+}
+
+static QStringList aggregatorSum(QSqlDatabase &db, const QString &sql)
+{
+    QSqlQuery qry(db);
+    qry.setForwardOnly(true);
+    qry.exec(sql);
+    BsSpecAggregator aggregator(qry.record());
+    while ( qry.next() ) {
+        aggregator.addRow(qry);
+    }
+    QStringList lines = aggregator.result().split(QChar('\n'));
+    lines.removeFirst();    //表头
+    return lines;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int rows = ( argc > 1 ) ? QString(argv[1]).toInt() : 20000;
+    if ( rows <= 0 ) rows = 20000;
+
+    QString connName = QStringLiteral("bench");
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connName);
+        db.setDatabaseName(QStringLiteral(":memory:"));
+        if ( !db.open() ) {
+            qDebug() << db.lastError().text();
+            return 1;
+        }
+
+        db.exec(QStringLiteral("create table dtl(shop text, cargo text, color text, sizers text, qty integer);"));
+        db.transaction();
+        QSqlQuery ins(db);
+        ins.prepare(QStringLiteral("insert into dtl(shop, cargo, color, sizers, qty) values(?, ?, ?, ?, 0);"));
+        for ( int i = 0; i < rows; ++i ) {
+            ins.addBindValue(QStringLiteral("shop%1").arg(i % 8));
+            ins.addBindValue(QStringLiteral("C%1").arg(i % 500, 4, 10, QChar('0')));
+            ins.addBindValue(QLatin1String(colorNames[i % 5]));
+            ins.addBindValue(makeSizers(i));
+            ins.exec();
+        }
+        db.commit();
+
+        QString sql = QStringLiteral("select shop, cargo, color, sizers, qty from dtl;");
+        QElapsedTimer timer;
+        timer.start();
+        QStringList linesA = tempTableSum(db, sql);
+        qint64 msA = timer.elapsed();
+
+        timer.restart();
+        QStringList linesB = aggregatorSum(db, sql);
+        qint64 msB = timer.elapsed();
+
+        linesA.sort();
+        linesB.sort();
+        if ( linesA != linesB ) {
+            printf("results differ: A %d groups, B %d groups\n", linesA.length(), linesB.length());
+            return 1;
+        }
+        printf("rows %d, groups %d\n", rows, linesB.length());
+        printf("A temp table INSERT + GROUP BY : %6lld ms\n", msA);
+        printf("B BsSpecAggregator             : %6lld ms\n", msB);
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(connName);
+    return 0;
+}
@@ -0,0 +1,18 @@
+#尺码明细汇总基准：BsSpecAggregator内存分组与原临时表INSERT加GROUP BY对比
+QT += core sql
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = benchspecsum
+
+INCLUDEPATH += $$PWD/../../../main
+
+HEADERS += \
+    ../../../main/bailispecsum.h
+
+SOURCES += \
+    ../../../main/bailispecsum.cpp \
+    main.cpp
@@ -0,0 +1,267 @@
+#include "bailistore.h"
+
+#include <QCoreApplication>
+#include <QtSql>
+#include <QThread>
+#include <algorithm>
+#include <cstdio>
+
+// WAL检查点吞吐基准 ============================================================================
+// 模拟终端保存单据：每个事务插入一行主表加若干行明细。同时readers个读线程反复跑报表查询
+// （近期单据按客户汇总明细数量），如桌面端与终端同时查报表。分三种方式各跑commits个事务，
+// 统计每秒提交数与提交耗时、报表查询耗时的中位、P99、最大值（自动检查点落在提交上时、读写互相挡住时会出现长尾）：
+//   A 回滚日志（DELETE，synchronous=FULL），升级前的默认
+//   B WAL，默认自动检查点阈值1000页
+//   C WAL，自动检查点阈值调大，另有线程按BsCheckpointer的规则做检查点
+// 各连接均经openBookDatabase()打开（见main/bailistore.cpp），A、B只在其后改回各自的pragma。
+// 用法：benchwalcheckpoint [commits] [dtlrows] [readers]
+
+#define CHECKPOINT_INTERVAL_MS      200             //基准时长短，间隔按比例缩小
+#define CHECKPOINT_QUIET_MS         100
+#define CHECKPOINT_FORCE_BYTES      (32 * 1024 * 1024)
+#define READER_RECENT_SHEETS        500             //报表取最近若干张单据
+#define READER_PAUSE_MS             10
+
+using namespace BailiSoft;
+
+static QAtomicInteger<qint64> lastActivity(0);
+static QAtomicInteger<int> committed(0);
+
+static void execSql(QSqlDatabase &db, const QString &sql)
+{
+    QSqlQuery qry(db);
+    if ( !qry.exec(sql) )
+        qDebug() << qry.lastError().text() << sql;
+    qry.finish();
+}
+
+//与BsCheckpointer::checkpointTick相同：安静时截断式，-wal过大时被动式
+class BenchCheckpointer : public QThread
+{
+public:
+    BenchCheckpointer(const QString &dbFile) : mDbFile(dbFile), mStopping(0), mPassives(0), mTruncates(0) {}
+    void stop() { mStopping.store(1); wait(); }
+    int passives() const { return mPassives; }
+    int truncates() const { return mTruncates; }
+
+protected:
+    void run() override {
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("benchckpt"));
+            openBookDatabase(db, mDbFile);
+            execSql(db, QStringLiteral("PRAGMA busy_timeout=1000;"));
+            QString walFile = mDbFile + QStringLiteral("-wal");
+            while ( !mStopping.load() ) {
+                QThread::msleep(CHECKPOINT_INTERVAL_MS);
+                qint64 walSize = QFileInfo(walFile).size();
+                if ( walSize <= 0 ) continue;
+                qint64 idleMs = QDateTime::currentMSecsSinceEpoch() - lastActivity.load();
+                if ( idleMs >= CHECKPOINT_QUIET_MS ) {
+                    execSql(db, QStringLiteral("PRAGMA wal_checkpoint(TRUNCATE);"));
+                    mTruncates++;
+                }
+                else if ( walSize >= CHECKPOINT_FORCE_BYTES ) {
+                    execSql(db, QStringLiteral("PRAGMA wal_checkpoint(PASSIVE);"));
+                    mPassives++;
+                }
+            }
+            db.close();
+        }
+        QSqlDatabase::removeDatabase(QStringLiteral("benchckpt"));
+    }
+
+private:
+    QString             mDbFile;
+    QAtomicInteger<int> mStopping;
+    int                 mPassives;
+    int                 mTruncates;
+};
+
+//报表读线程：只读连接，每次查询计时
+class BenchReader : public QThread
+{
+public:
+    BenchReader(const QString &dbFile, const int index) : mDbFile(dbFile), mIndex(index), mStopping(0), mErrors(0) {}
+    void stop() { mStopping.store(1); wait(); }
+    const QVector<qint64> &costs() const { return mCosts; }
+    int errors() const { return mErrors; }
+
+protected:
+    void run() override {
+        QString connName = QStringLiteral("benchreader%1").arg(mIndex);
+        {
+            QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connName);
+            if ( openBookDatabase(db, mDbFile, true) ) {
+                QSqlQuery qry(db);
+                qry.setForwardOnly(true);
+                while ( !mStopping.load() ) {
+                    QElapsedTimer one;
+                    one.start();
+                    int from = committed.load() - READER_RECENT_SHEETS;
+                    if ( qry.exec(QStringLiteral("select s.trader, count(*), sum(d.qty) from sheet s "
+                                                 "join sheetdtl d on d.parentid=s.sheetid "
+                                                 "where s.dated>=%1 group by s.trader;").arg(from)) ) {
+                        while ( qry.next() ) qry.value(2);
+                        mCosts << one.nsecsElapsed() / 1000;
+                    } else {
+                        mErrors++;
+                    }
+                    qry.finish();
+                    lastActivity.store(QDateTime::currentMSecsSinceEpoch());
+                    QThread::msleep(READER_PAUSE_MS);
+                }
+                db.close();
+            } else {
+                mErrors++;
+            }
+        }
+        QSqlDatabase::removeDatabase(connName);
+    }
+
+private:
+    QString             mDbFile;
+    int                 mIndex;
+    QAtomicInteger<int> mStopping;
+    QVector<qint64>     mCosts;
+    int                 mErrors;
+};
+
+static void printCosts(QVector<qint64> costs)
+{
+    if ( costs.isEmpty() ) {
+        printf("  median %6s us  p99 %7s us  max %8s us", "-", "-", "-");
+        return;
+    }
+    std::sort(costs.begin(), costs.end());
+    printf("  median %6lld us  p99 %7lld us  max %8lld us", costs.at(costs.size() / 2),
+           costs.at(qMin(costs.size() - 1, costs.size() * 99 / 100)), costs.last());
+}
+
+static void runCase(const char *title, const int mode, const int commits, const int dtlRows, const int readerCount)
+{
+    QString dbFile = QDir::temp().absoluteFilePath(QStringLiteral("benchwalcheckpoint.db"));
+    QFile::remove(dbFile);
+    QFile::remove(dbFile + QStringLiteral("-wal"));
+    QFile::remove(dbFile + QStringLiteral("-shm"));
+
+    QVector<qint64> costs;
+    qint64 totalMs = 0;
+    BenchCheckpointer *checkpointer = nullptr;
+    QList<BenchReader *> readers;
+    committed.store(0);
+    {
+        QSqlDatabase db = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("benchwal"));
+        if ( !openBookDatabase(db, dbFile) ) {
+            qDebug() << db.lastError().text();
+            return;
+        }
+        if ( mode == 0 ) {
+            execSql(db, QStringLiteral("PRAGMA journal_mode=DELETE;"));
+            execSql(db, QStringLiteral("PRAGMA synchronous=FULL;"));
+        }
+        else if ( mode == 1 ) {
+            execSql(db, QStringLiteral("PRAGMA wal_autocheckpoint=1000;"));
+        }
+        execSql(db, QStringLiteral("create table sheet(sheetid integer primary key, dated integer, trader text, remark text);"));
+        execSql(db, QStringLiteral("create table sheetdtl(parentid integer, cargo text, color text, sizers text, qty integer);"));
+        execSql(db, QStringLiteral("create index idxsheetdtl on sheetdtl(parentid);"));
+        execSql(db, QStringLiteral("create index idxsheetdated on sheet(dated);"));
+
+        if ( mode == 2 ) {
+            checkpointer = new BenchCheckpointer(dbFile);
+            checkpointer->start();
+        }
+        for ( int i = 0; i < readerCount; ++i ) {
+            BenchReader *reader = new BenchReader(dbFile, i);
+            reader->start();
+            readers << reader;
+        }
+
+        QSqlQuery insMain(db);
+        insMain.prepare(QStringLiteral("insert into sheet(dated, trader, remark) values(?, ?, ?);"));
+        QSqlQuery insDtl(db);
+        insDtl.prepare(QStringLiteral("insert into sheetdtl(parentid, cargo, color, sizers, qty) values(?, ?, ?, ?, ?);"));
+        QString remark(200, QChar('x'));
+
+        QElapsedTimer total;
+        total.start();
+        for ( int i = 0; i < commits; ++i ) {
+            QElapsedTimer one;
+            one.start();
+            db.transaction();
+            insMain.addBindValue(i);
+            insMain.addBindValue(QStringLiteral("T%1").arg(i % 300));
+            insMain.addBindValue(remark);
+            insMain.exec();
+            qint64 sheetId = insMain.lastInsertId().toLongLong();
+            for ( int j = 0; j < dtlRows; ++j ) {
+                insDtl.addBindValue(sheetId);
+                insDtl.addBindValue(QStringLiteral("C%1").arg((i * 13 + j) % 5000));
+                insDtl.addBindValue(QStringLiteral("red"));
+                insDtl.addBindValue(QStringLiteral("S\t1\nM\t2\nL\t3"));
+                insDtl.addBindValue(6);
+                insDtl.exec();
+            }
+            db.commit();
+            committed.store(i + 1);
+            lastActivity.store(QDateTime::currentMSecsSinceEpoch());
+            costs << one.nsecsElapsed() / 1000;
+        }
+        totalMs = qMax(qint64(1), total.elapsed());
+        for ( int i = 0; i < readers.length(); ++i ) {
+            readers.at(i)->stop();
+        }
+        insMain.finish();
+        insDtl.finish();
+        db.close();
+    }
+    QSqlDatabase::removeDatabase(QStringLiteral("benchwal"));
+
+    int passives = 0, truncates = 0;
+    if ( checkpointer ) {
+        checkpointer->stop();
+        passives = checkpointer->passives();
+        truncates = checkpointer->truncates();
+        delete checkpointer;
+    }
+
+    printf("%-36s %8.0f commits/s", title, commits * 1000.0 / totalMs);
+    printCosts(costs);
+    if ( mode == 2 )
+        printf("  (passive %d, truncate %d)", passives, truncates);
+    printf("\n");
+
+    if ( !readers.isEmpty() ) {
+        QVector<qint64> readCosts;
+        int errors = 0;
+        for ( int i = 0; i < readers.length(); ++i ) {
+            readCosts << readers.at(i)->costs();
+            errors += readers.at(i)->errors();
+        }
+        printf("%-36s %8.0f queries/s ", "  report readers", readCosts.size() * 1000.0 / totalMs);
+        printCosts(readCosts);
+        printf("  (%d readers, %d errors)\n", readers.length(), errors);
+        qDeleteAll(readers);
+    }
+
+    QFile::remove(dbFile);
+    QFile::remove(dbFile + QStringLiteral("-wal"));
+    QFile::remove(dbFile + QStringLiteral("-shm"));
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    int commits = ( argc > 1 ) ? QString(argv[1]).toInt() : 5000;
+    int dtlRows = ( argc > 2 ) ? QString(argv[2]).toInt() : 20;
+    if ( commits <= 0 ) commits = 5000;
+    int readerCount = ( argc > 3 ) ? QString(argv[3]).toInt() : 4;
+    if ( dtlRows < 0 ) dtlRows = 20;
+    if ( readerCount < 0 ) readerCount = 4;
+
+    printf("commits %d, detail rows per sheet %d, report readers %d\n", commits, dtlRows, readerCount);
+    runCase("A rollback journal", 0, commits, dtlRows, readerCount);
+    runCase("B WAL, default autocheckpoint", 1, commits, dtlRows, readerCount);
+    runCase("C WAL, background checkpointer", 2, commits, dtlRows, readerCount);
+    return 0;
+}
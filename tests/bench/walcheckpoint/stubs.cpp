@@ -0,0 +1,27 @@
+#include "bailisql.h"
+
+//基准只用openBookDatabase()与检查点规则，BsCheckpointer顺带的维护（见bailisql.cpp）不参与，
+//空实现以免牵入整个界面层
+namespace BailiSoft {
+
+int stockBalanceCompact(QSqlDatabase &db, const int minLength)
+{
+    Q_UNUSED(db)
+    Q_UNUSED(minLength)
+    return 0;
+}
+
+QString periodSnapshotRefresh(QSqlDatabase &db)
+{
+    Q_UNUSED(db)
+    return QString();
+}
+
+QString regChangeLogCompact(QSqlDatabase &db, const int keepDays)
+{
+    Q_UNUSED(db)
+    Q_UNUSED(keepDays)
+    return QString();
+}
+
+}
@@ -0,0 +1,23 @@
+#WAL与检查点调度基准：回滚日志、WAL默认自动检查点、WAL加后台检查点三种方式的小事务提交吞吐与延时，
+#并有若干读线程同时跑报表查询，统计查询延时
+QT += core sql
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TEMPLATE = app
+TARGET = benchwalcheckpoint
+
+INCLUDEPATH += $$PWD/../../../main
+
+HEADERS += \
+    ../../../main/bailistore.h \
+    ../../../main/bailisqlfunc.h \
+    ../../../main/bailisql.h
+
+SOURCES += \
+    ../../../main/bailistore.cpp \
+    ../../../main/bailisqlfunc.cpp \
+    stubs.cpp \
+    main.cpp
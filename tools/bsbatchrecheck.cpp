@@ -3,6 +3,7 @@
 #include "main/bailidata.h"
 #include "main/bailiedit.h"
 #include "main/bailigrid.h"
+#include "main/bailicache.h"
 
 namespace BailiSoft {
 
@@ -87,8 +88,10 @@ void BsBatchReCheck::doExec()
     if ( db.lastError().isValid() )
         QMessageBox::information(this, QString(), QStringLiteral("%1不成功，您可联系软件www.bailisoft.com协助解决。")
                                  .arg(mpBtnExec->text()));
-    else
+    else {
+        BsResultCache::bump(mpOptTable->currentData().toString());
         QMessageBox::information(this, QString(), QStringLiteral("%1成功！").arg(mpBtnExec->text()));
+    }
 }
 
 }
@@ -3,6 +3,7 @@
 #include "main/bailidata.h"
 #include "main/bailiedit.h"
 #include "main/bailigrid.h"
+#include "main/bailistmt.h"
 
 namespace BailiSoft {
 
@@ -98,90 +99,95 @@ void BsBatchRename::doExec()
         return;
     }
 
-    QStringList sqls;
+    QList<BsBoundSql> sqls;
 
     QStringList tbls;
     tbls << "cgd" << "cgj" << "cgt" << "pfd" << "pff" << "pft" << "lsd" << "dbd" << "syd";  //注意不要含szd
 
+    //新旧值与条件值全部绑定，不拼入SQL；单引号仍按录入时约定转换，以便与已存值一致
     QString strOld = mpEdtOld->text();
     QString strNew = mpEdtNew->text();
     strOld.replace(QChar(39), QChar(8217));
     strNew.replace(QChar(39), QChar(8217));
+    QString fld = mpRegTable->currentData().toString();
+    QString conCargo = mpConCargo->text();
+    QVariantList renameBinds;
+    renameBinds << strNew << strOld;
 
     switch (mpRegTable->currentIndex()) {
     //customer
     case 0:
-        sqls << QStringLiteral("update pfd set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
-        sqls << QStringLiteral("update pff set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
-        sqls << QStringLiteral("update pft set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
-        sqls << QStringLiteral("update lsd set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
-        sqls << QStringLiteral("update szd set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
+        sqls << BsBoundSql(BsStmtCache::updateSql("pfd", QStringList() << "trader", QStringList() << "trader"), renameBinds);
+        sqls << BsBoundSql(BsStmtCache::updateSql("pff", QStringList() << "trader", QStringList() << "trader"), renameBinds);
+        sqls << BsBoundSql(BsStmtCache::updateSql("pft", QStringList() << "trader", QStringList() << "trader"), renameBinds);
+        sqls << BsBoundSql(BsStmtCache::updateSql("lsd", QStringList() << "trader", QStringList() << "trader"), renameBinds);
+        sqls << BsBoundSql(BsStmtCache::updateSql("szd", QStringList() << "trader", QStringList() << "trader"), renameBinds);
         break;
     //supplier
     case 1:
-        sqls << QStringLiteral("update cgd set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
-        sqls << QStringLiteral("update cgj set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
-        sqls << QStringLiteral("update cgt set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
-        sqls << QStringLiteral("update szd set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
+        sqls << BsBoundSql(BsStmtCache::updateSql("cgd", QStringList() << "trader", QStringList() << "trader"), renameBinds);
+        sqls << BsBoundSql(BsStmtCache::updateSql("cgj", QStringList() << "trader", QStringList() << "trader"), renameBinds);
+        sqls << BsBoundSql(BsStmtCache::updateSql("cgt", QStringList() << "trader", QStringList() << "trader"), renameBinds);
+        sqls << BsBoundSql(BsStmtCache::updateSql("szd", QStringList() << "trader", QStringList() << "trader"), renameBinds);
         break;
     //shop, staff
     case 2:
     case 3:
         for ( int i = 0, iLen = tbls.length(); i < iLen; ++i ) {
-            sqls << QStringLiteral("update %1 set %2='%3' where %2='%4';")
-                    .arg(tbls.at(i)).arg(mpRegTable->currentData().toString()).arg(strNew).arg(strOld);
+            sqls << BsBoundSql(BsStmtCache::updateSql(tbls.at(i), QStringList() << fld, QStringList() << fld), renameBinds);
         }
-        sqls << QStringLiteral("update szd set %1='%2' where %1='%3';")
-                .arg(mpRegTable->currentData().toString()).arg(strNew).arg(strOld);
+        sqls << BsBoundSql(BsStmtCache::updateSql("szd", QStringList() << fld, QStringList() << fld), renameBinds);
         break;
 
     //subject
     case 4:
-        sqls << QStringLiteral("update szddtl set subject='%1' where subject='%2'").arg(strNew).arg(strOld);
+        sqls << BsBoundSql(BsStmtCache::updateSql("szddtl", QStringList() << "subject", QStringList() << "subject"), renameBinds);
         break;
 
     //cargo
     case 5:
         for ( int i = 0, iLen = tbls.length(); i < iLen; ++i ) {
-            QString sql = QStringLiteral("update %1dtl set %2='%3' where %2='%4';")
-                    .arg(tbls.at(i)).arg(mpRegTable->currentData().toString()).arg(strNew).arg(strOld);
-            sqls << sql;
+            sqls << BsBoundSql(BsStmtCache::updateSql(tbls.at(i) + "dtl", QStringList() << fld, QStringList() << fld), renameBinds);
         }
         break;
     //color
     case 6:
         for ( int i = 0, iLen = tbls.length(); i < iLen; ++i ) {
-            QString cargoCon = (mpConCargo->text().isEmpty())
-                    ? QString()
-                    : QStringLiteral(" and cargo='%1' ").arg(mpConCargo->text());
-            QString sql = QStringLiteral("update %1dtl set %2='%3' where %2='%4' %5;")
-                    .arg(tbls.at(i)).arg(mpRegTable->currentData().toString())
-                    .arg(strNew).arg(strOld).arg(cargoCon);
-            sqls << sql;
+            QStringList keys;
+            keys << fld;
+            QVariantList binds = renameBinds;
+            if ( !conCargo.isEmpty() ) {
+                keys << QStringLiteral("cargo");
+                binds << conCargo;
+            }
+            sqls << BsBoundSql(BsStmtCache::updateSql(tbls.at(i) + "dtl", QStringList() << fld, keys), binds);
         }
         break;
     //sizers
     default:
         for ( int i = 0, iLen = tbls.length(); i < iLen; ++i ) {
-            QString cargoCon = (mpConCargo->text().isEmpty())
-                    ? QString()
-                    : QStringLiteral(" and cargo='%1'").arg(mpConCargo->text());
-
-            sqls << QStringLiteral("update %1dtl set sizers = "
-                                   "substr(sizers, 1, instr(('\n' || sizers), '\n%3\t') - 1) || '%2' || "
-                                   "substr(sizers, instr(('\n' || sizers), '\n%3\t') + %4) "
-                                   "where ('\n' || sizers) like '%\n%3\t%' %5;")
-                    .arg(tbls.at(i)).arg(strNew).arg(strOld).arg(strOld.length()).arg(cargoCon);
+            QString cargoCon = (conCargo.isEmpty()) ? QString() : QStringLiteral(" and cargo=?");
+            QVariantList binds;
+            binds << strOld << strNew << strOld << strOld.length() << strOld;
+            if ( !conCargo.isEmpty() )
+                binds << conCargo;
+
+            sqls << BsBoundSql(QStringLiteral("update %1dtl set sizers = "
+                                              "substr(sizers, 1, instr(('\n' || sizers), '\n' || ? || '\t') - 1) || ? || "
+                                              "substr(sizers, instr(('\n' || sizers), '\n' || ? || '\t') + ?) "
+                                              "where ('\n' || sizers) like '%\n' || ? || '\t%'%2;")
+                               .arg(tbls.at(i), cargoCon), binds);
         }
         break;
     }
 
     //shop补充调拨单trader
     if ( mpRegTable->currentIndex() == 2 )
-        sqls << QStringLiteral("update dbd set trader='%1' where trader='%2';").arg(strNew).arg(strOld);
+        sqls << BsBoundSql(BsStmtCache::updateSql("dbd", QStringList() << "trader", QStringList() << "trader"), renameBinds);
 
     //执行
-    QString sqlErr = sqliteCommit(sqls);
+    QSqlDatabase db = QSqlDatabase::database();
+    QString sqlErr = BsStmtCache::commit(db, sqls);
     if ( sqlErr.isEmpty() )
         QMessageBox::information(this, QString(), QStringLiteral("更改成功！"));
     else
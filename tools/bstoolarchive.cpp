@@ -0,0 +1,91 @@
+#include "bstoolarchive.h"
+#include "main/bailicode.h"
+#include "main/bailidata.h"
+#include "main/bailiarchive.h"
+
+namespace BailiSoft {
+
+BsToolArchive::BsToolArchive(QWidget *parent) : QDialog(parent)
+{
+    mpArchives = new QTableWidget(this);
+    mpArchives->setColumnCount(4);
+    mpArchives->setHorizontalHeaderLabels(QStringList() << QStringLiteral("年份") << QStringLiteral("单据数")
+                                          << QStringLiteral("归档时间") << QStringLiteral("归档库文件"));
+    mpArchives->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mpArchives->horizontalHeader()->setStretchLastSection(true);
+    mpArchives->verticalHeader()->hide();
+
+    mpYear = new QSpinBox(this);
+    mpYear->setRange(2000, QDate::currentDate().year());
+    mpYear->setValue(QDate::currentDate().year() - 1);
+    mpYear->setSuffix(QStringLiteral("年1月1日"));
+    mpYear->setMinimumWidth(160);
+
+    mpBtnExec = new QPushButton(mapMsg.value("word_execute"), this);
+    mpBtnExec->setFixedSize(100, 30);
+    connect(mpBtnExec, SIGNAL(clicked(bool)), this, SLOT(doExec()));
+
+    QHBoxLayout *layYear = new QHBoxLayout;
+    layYear->addWidget(new QLabel(QStringLiteral("归档截止于：")));
+    layYear->addWidget(mpYear);
+    layYear->addStretch();
+    layYear->addWidget(mpBtnExec);
+
+    QVBoxLayout *lay = new QVBoxLayout(this);
+    lay->addWidget(new QLabel(QStringLiteral("已归档年份：")));
+    lay->addWidget(mpArchives, 1);
+    lay->addWidget(new QLabel(QStringLiteral("截止日之前的已审核单据按年移入账册旁的归档库，本账册只留各店库存、"
+                                             "订单欠货、往来余额的结转单据。\n查询起始日早于截止日时自动挂接归档库，"
+                                             "可照常查询全部历史。归档库文件请与账册一起保管。")));
+    lay->addLayout(layYear);
+
+    setWindowFlags(windowFlags() &~ Qt::WindowContextHelpButtonHint);
+    resize(640, 400);
+
+    loadArchives();
+}
+
+void BsToolArchive::loadArchives()
+{
+    QSqlQuery qry;
+    qry.setForwardOnly(true);
+    qry.exec(QStringLiteral("select archyear, sheets, archtime, filename from archive_book order by archyear;"));
+    int row = 0;
+    mpArchives->setRowCount(0);
+    while ( qry.next() ) {
+        mpArchives->setRowCount(row + 1);
+        mpArchives->setItem(row, 0, new QTableWidgetItem(qry.value(0).toString()));
+        mpArchives->setItem(row, 1, new QTableWidgetItem(qry.value(1).toString()));
+        mpArchives->setItem(row, 2, new QTableWidgetItem(QDateTime::fromMSecsSinceEpoch(1000 * qry.value(2).toLongLong())
+                                                         .toString(QStringLiteral("yyyy-MM-dd hh:mm"))));
+        mpArchives->setItem(row, 3, new QTableWidgetItem(qry.value(3).toString()));
+        mpYear->setMinimum(qry.value(0).toInt() + 1);
+        row++;
+    }
+    mpArchives->resizeColumnsToContents();
+}
+
+void BsToolArchive::doExec()
+{
+    int year = mpYear->value();
+    QString hint = QStringLiteral("将把%1年1月1日之前的已审核单据移入归档库，并生成结转单据。\n"
+                                  "数据量大时需较长时间，执行前建议先备份账册。确定执行吗？").arg(year);
+    if ( QMessageBox::question(this, QString(), hint, QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes )
+        return;
+
+    int moved = 0;
+    QSqlDatabase db = QSqlDatabase::database();
+    qApp->setOverrideCursor(Qt::WaitCursor);
+    QString strErr = BsArchive::archiveBefore(db, year, loginer, &moved);
+    qApp->restoreOverrideCursor();
+
+    if ( strErr.isEmpty() ) {
+        loadArchives();
+        QMessageBox::information(this, QString(), QStringLiteral("归档完成，共移出%1张单据。").arg(moved));
+    }
+    else {
+        QMessageBox::information(this, QString(), QStringLiteral("归档不成功：%1").arg(strErr));
+    }
+}
+
+}
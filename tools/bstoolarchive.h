@@ -0,0 +1,27 @@
+#ifndef BSTOOLARCHIVE_H
+#define BSTOOLARCHIVE_H
+
+#include <QtWidgets>
+
+namespace BailiSoft {
+
+class BsToolArchive : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit BsToolArchive(QWidget *parent);
+
+    QTableWidget*   mpArchives;
+    QSpinBox*       mpYear;
+    QPushButton*    mpBtnExec;
+
+private slots:
+    void doExec();
+
+private:
+    void loadArchives();
+};
+
+}
+
+#endif // BSTOOLARCHIVE_H
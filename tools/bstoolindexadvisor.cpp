@@ -0,0 +1,177 @@
+#include "bstoolindexadvisor.h"
+#include "main/bailicode.h"
+#include "main/bailiplan.h"
+#include "main/bailicache.h"
+
+namespace BailiSoft {
+
+BsToolIndexAdvisor::BsToolIndexAdvisor(QWidget *parent) : QDialog(parent)
+{
+    mpPlans = new QTableWidget(this);
+    mpPlans->setColumnCount(6);
+    mpPlans->setHorizontalHeaderLabels(QStringList() << QStringLiteral("来源") << QStringLiteral("次数")
+                                       << QStringLiteral("全表扫描") << QStringLiteral("所用索引")
+                                       << QStringLiteral("建议索引") << QStringLiteral("语句"));
+    mpPlans->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mpPlans->setSelectionBehavior(QAbstractItemView::SelectRows);
+    mpPlans->setSelectionMode(QAbstractItemView::SingleSelection);
+    mpPlans->horizontalHeader()->setStretchLastSection(true);
+    mpPlans->verticalHeader()->hide();
+    connect(mpPlans, SIGNAL(itemSelectionChanged()), this, SLOT(showPlanDetail()));
+
+    mpIndexes = new QTableWidget(this);
+    mpIndexes->setColumnCount(2);
+    mpIndexes->setHorizontalHeaderLabels(QStringList() << QStringLiteral("索引") << QStringLiteral("使用次数"));
+    mpIndexes->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    mpIndexes->horizontalHeader()->setStretchLastSection(true);
+    mpIndexes->verticalHeader()->hide();
+    mpIndexes->setMinimumWidth(260);
+
+    mpDetail = new QPlainTextEdit(this);
+    mpDetail->setReadOnly(true);
+    mpDetail->setMaximumHeight(120);
+
+    mpBtnAnalyze = new QPushButton(QStringLiteral("分析查询计划"), this);
+    mpBtnAnalyze->setFixedSize(120, 30);
+    connect(mpBtnAnalyze, SIGNAL(clicked(bool)), this, SLOT(doAnalyze()));
+
+    mpBtnApply = new QPushButton(QStringLiteral("创建建议索引"), this);
+    mpBtnApply->setFixedSize(120, 30);
+    mpBtnApply->setEnabled(false);
+    connect(mpBtnApply, SIGNAL(clicked(bool)), this, SLOT(doApply()));
+
+    mpBtnClear = new QPushButton(QStringLiteral("清空记录"), this);
+    mpBtnClear->setFixedSize(120, 30);
+    connect(mpBtnClear, SIGNAL(clicked(bool)), this, SLOT(doClear()));
+
+    mpCacheStats = new QLabel(this);
+
+    QSplitter *split = new QSplitter(this);
+    split->addWidget(mpPlans);
+    split->addWidget(mpIndexes);
+    split->setStretchFactor(0, 3);
+    split->setStretchFactor(1, 1);
+
+    QHBoxLayout *layBtns = new QHBoxLayout;
+    layBtns->addStretch();
+    layBtns->addWidget(mpBtnAnalyze);
+    layBtns->addWidget(mpBtnApply);
+    layBtns->addWidget(mpBtnClear);
+    layBtns->addStretch();
+
+    QVBoxLayout *lay = new QVBoxLayout(this);
+    lay->addWidget(new QLabel(QStringLiteral("本次运行以来各统计查询、网络请求所生成的语句（按形状去重）：")));
+    lay->addWidget(split, 1);
+    lay->addWidget(mpDetail);
+    lay->addWidget(mpCacheStats);
+    lay->addLayout(layBtns);
+
+    setWindowFlags(windowFlags() &~ Qt::WindowContextHelpButtonHint);
+    resize(960, 600);
+    updateCacheStats();
+}
+
+void BsToolIndexAdvisor::doAnalyze()
+{
+    QSqlDatabase db = QSqlDatabase::database();
+    QMap<QString, int> indexUses;
+    qApp->setOverrideCursor(Qt::WaitCursor);
+    QList<BsPlanReport> reports = BsPlanAdvisor::analyze(db, &indexUses);
+    qApp->restoreOverrideCursor();
+
+    //语句计划
+    mProposals.clear();
+    mDetails.clear();
+    mpPlans->setRowCount(reports.length());
+    for ( int i = 0, iLen = reports.length(); i < iLen; ++i ) {
+        const BsPlanReport &report = reports.at(i);
+        mpPlans->setItem(i, 0, new QTableWidgetItem(report.entry.source));
+        mpPlans->setItem(i, 1, new QTableWidgetItem(QString::number(report.entry.hits)));
+        mpPlans->setItem(i, 2, new QTableWidgetItem(report.fullScans.join(QChar(','))));
+        mpPlans->setItem(i, 3, new QTableWidgetItem(report.usedIndexes.join(QChar(','))));
+        mpPlans->setItem(i, 4, new QTableWidgetItem(report.proposals.join(QChar(' '))));
+        mpPlans->setItem(i, 5, new QTableWidgetItem(report.entry.shape));
+        if ( !report.fullScans.isEmpty() )
+            mpPlans->item(i, 2)->setForeground(Qt::red);
+
+        mDetails << ( ( report.error.isEmpty() )
+                      ? report.details.join(QChar('\n'))
+                      : report.error ) + QStringLiteral("\n\n") + report.entry.sample;
+        mProposals << report.proposals;
+    }
+    mProposals.removeDuplicates();
+    mpPlans->resizeColumnsToContents();
+
+    //索引使用（少用的在前，便于发现冗余索引）
+    QList<QPair<int, QString> > uses;
+    QMapIterator<QString, int> it(indexUses);
+    while ( it.hasNext() ) {
+        it.next();
+        uses << qMakePair(it.value(), it.key());
+    }
+    std::sort(uses.begin(), uses.end());
+    mpIndexes->setRowCount(uses.length());
+    for ( int i = 0, iLen = uses.length(); i < iLen; ++i ) {
+        mpIndexes->setItem(i, 0, new QTableWidgetItem(uses.at(i).second));
+        mpIndexes->setItem(i, 1, new QTableWidgetItem(QString::number(uses.at(i).first)));
+    }
+    mpIndexes->resizeColumnsToContents();
+
+    mpBtnApply->setEnabled(!mProposals.isEmpty());
+    mpDetail->clear();
+    updateCacheStats();
+}
+
+void BsToolIndexAdvisor::doApply()
+{
+    QString hint = QStringLiteral("将创建以下%1个索引，数据量大时需一些时间：\n\n%2")
+            .arg(mProposals.length()).arg(mProposals.join(QChar('\n')));
+    if ( QMessageBox::question(this, QString(), hint, QMessageBox::Yes | QMessageBox::No) != QMessageBox::Yes )
+        return;
+
+    QStringList sqls = mProposals;
+    sqls << QStringLiteral("ANALYZE;");
+
+    qApp->setOverrideCursor(Qt::WaitCursor);
+    QString sqlErr = sqliteCommit(sqls);
+    qApp->restoreOverrideCursor();
+
+    if ( sqlErr.isEmpty() ) {
+        QMessageBox::information(this, QString(), QStringLiteral("索引创建完成。"));
+        doAnalyze();
+    }
+    else {
+        QMessageBox::information(this, QString(), QStringLiteral("索引创建不成功：%1").arg(sqlErr));
+    }
+}
+
+void BsToolIndexAdvisor::doClear()
+{
+    BsPlanAdvisor::clear();
+    mProposals.clear();
+    mDetails.clear();
+    mpPlans->setRowCount(0);
+    mpIndexes->setRowCount(0);
+    mpDetail->clear();
+    mpBtnApply->setEnabled(false);
+}
+
+void BsToolIndexAdvisor::showPlanDetail()
+{
+    int row = mpPlans->currentRow();
+    mpDetail->setPlainText( ( row >= 0 && row < mDetails.length() ) ? mDetails.at(row) : QString() );
+}
+
+void BsToolIndexAdvisor::updateCacheStats()
+{
+    qint64 hits, misses;
+    int entries, usedBytes;
+    BsResultCache::stats(&hits, &misses, &entries, &usedBytes);
+    qint64 total = hits + misses;
+    mpCacheStats->setText(QStringLiteral("报表结果缓存：命中%1次，未中%2次（命中率%3%），现存%4项，约%5KB")
+                          .arg(hits).arg(misses)
+                          .arg(( total > 0 ) ? 100 * hits / total : 0)
+                          .arg(entries).arg(usedBytes / 1024));
+}
+
+}
@@ -0,0 +1,37 @@
+#ifndef BSTOOLINDEXADVISOR_H
+#define BSTOOLINDEXADVISOR_H
+
+#include <QtWidgets>
+
+namespace BailiSoft {
+
+class BsToolIndexAdvisor : public QDialog
+{
+    Q_OBJECT
+public:
+    explicit BsToolIndexAdvisor(QWidget *parent);
+
+    QTableWidget*   mpPlans;
+    QTableWidget*   mpIndexes;
+    QPlainTextEdit* mpDetail;
+    QLabel*         mpCacheStats;
+
+    QPushButton*    mpBtnAnalyze;
+    QPushButton*    mpBtnApply;
+    QPushButton*    mpBtnClear;
+
+private slots:
+    void doAnalyze();
+    void doApply();
+    void doClear();
+    void showPlanDetail();
+
+private:
+    void updateCacheStats();
+    QStringList     mProposals;
+    QStringList     mDetails;
+};
+
+}
+
+#endif // BSTOOLINDEXADVISOR_H
@@ -77,10 +77,19 @@ void BsToolStockReset::doExec()
     //读库存
     QString shop = mpEdtShop->getDataValueForSql();
     qint64 dated = mpEdtDate->getDataValueForSql().toLongLong();
-    QString sql = QStringLiteral("select cargo, color, group_concat(sizers, '') as sizers "
-                                 "from vi_stock "
-                                 "where dated<=%1 and shop='%2' "
-                                 "group by cargo, color;").arg(dated).arg(shop);
+    //该店没有晚于盘点日的单据时，直接取库存账表
+    qry.exec(QStringLiteral("select 1 from stock_balance where shop='%1' and lastdated>%2 limit 1;")
+             .arg(shop).arg(dated));
+    bool useBalance = !qry.lastError().isValid() && !qry.next();
+    qry.finish();
+
+    QString sql = (useBalance)
+            ? QStringLiteral("select cargo, color, sizers from stock_balance "
+                             "where shop='%1';").arg(shop)
+            : QStringLiteral("select cargo, color, group_concat(sizers, '') as sizers "
+                             "from vi_stock "
+                             "where dated<=%1 and shop='%2' "
+                             "group by cargo, color;").arg(dated).arg(shop);
     qry.exec(sql);
     if ( qry.lastError().isValid() ) qDebug() << qry.lastError();
     while ( qry.next() ) {